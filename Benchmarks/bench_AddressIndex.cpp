@@ -0,0 +1,122 @@
+#include "AddressIndex.h"
+#include "BatchHash.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+// Address index benchmark on 1M outputs paid to 100k addresses
+//  1. Indexing: blocks fed to the index as the chain would, logged to disk,
+//     with the entries in their file and the memory left resident.
+//  2. History lookup: getHistory() with the default cache and with none,
+//     against walking every output of every block, as needed without the
+//     index.
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedSeconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static const size_t BlockCount = 1000;
+static const size_t TxPerBlock = 500;
+static const size_t AddressCount = 100000;
+
+// Prevents the compiler from dropping results
+static volatile size_t sink;
+
+static std::string address(size_t i) {
+    return "pkh_" + std::to_string(i);
+}
+
+// Blocks of two-output transactions; their txids are computed up front
+static std::vector<Block> makeBlocks() {
+    std::mt19937_64 random(1);
+    std::vector<Block> blocks;
+    blocks.reserve(BlockCount);
+    std::string prevHash(64, '0');
+    for (size_t b = 0; b < BlockCount; ++b) {
+        std::vector<Transaction> txs;
+        txs.reserve(TxPerBlock);
+        for (size_t t = 0; t < TxPerBlock; ++t) {
+            txs.emplace_back(std::vector<TxIn>{TxIn(std::string(64, '0'), 0, std::to_string(b * TxPerBlock + t), "")},
+                             std::vector<TxOut>{TxOut(random() % 1000, address(random() % AddressCount)),
+                                                TxOut(random() % 1000, address(random() % AddressCount))},
+                             1700000000000ULL);
+        }
+        hashTransactions(txs);
+        Block block(txs, prevHash);
+        block.computeHash();
+        prevHash = block.getHash();
+        blocks.push_back(std::move(block));
+    }
+    return blocks;
+}
+
+int main() {
+    const std::string path = (std::filesystem::temp_directory_path() / "bench_address_index.log").string();
+    std::filesystem::remove(path);
+    const std::vector<Block> blocks = makeBlocks();
+    const BlockUndo undo;
+
+    std::printf("=== Address index, %zu outputs, %zu addresses ===\n",
+                BlockCount * TxPerBlock * 2, AddressCount);
+
+    AddressIndex index(path);
+    // Blocks are fed directly: the index is not attached to a chain
+    Blockchain chain;
+    index.open(chain);
+    Clock::time_point start = Clock::now();
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        index.blockConnected(blocks[b], undo, b + 1);
+    }
+    const double indexing = elapsedSeconds(start);
+    std::printf("  indexing         %8.3f s   %6.1f MB log   %6.1f MB entries   %6.1f MB memory\n",
+                indexing, std::filesystem::file_size(path) / 1e6, index.entryBytes() / 1e6,
+                index.memoryUsage() / 1e6);
+
+    const size_t lookups = 100000;
+    std::mt19937_64 random(2);
+    size_t found = 0;
+    for (int pass = 0; pass < 2; ++pass) {
+        start = Clock::now();
+        for (size_t i = 0; i < lookups; ++i) {
+            found += index.getHistory(address(random() % AddressCount)).size();
+        }
+        std::printf("  %-16s %8.2f us/lookup   %6.1f MB cached\n", pass == 0 ? "getHistory cold" : "getHistory warm",
+                    elapsedSeconds(start) * 1e6 / lookups, index.cacheUsage() / 1e6);
+    }
+
+    // The same blocks without a cache: every lookup reads the entries file
+    AddressIndex uncached(std::string(), 0);
+    uncached.open(chain);
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        uncached.blockConnected(blocks[b], undo, b + 1);
+    }
+    start = Clock::now();
+    for (size_t i = 0; i < lookups; ++i) {
+        found += uncached.getHistory(address(random() % AddressCount)).size();
+    }
+    std::printf("  %-16s %8.2f us/lookup   %.1f outputs per address\n", "no cache",
+                elapsedSeconds(start) * 1e6 / lookups, 2.0 * BlockCount * TxPerBlock / AddressCount);
+
+    const size_t scans = 10;
+    start = Clock::now();
+    for (size_t i = 0; i < scans; ++i) {
+        const std::string wanted = address(random() % AddressCount);
+        for (const auto& block : blocks) {
+            for (const auto& tx : block.getTransactions()) {
+                for (const auto& output : tx.getOutputs()) {
+                    found += output.publicKeyHash == wanted;
+                }
+            }
+        }
+    }
+    std::printf("  scan of blocks   %8.2f us/lookup\n", elapsedSeconds(start) * 1e6 / scans);
+    sink = found;
+    index.close();
+    std::filesystem::remove(path);
+    return 0;
+}
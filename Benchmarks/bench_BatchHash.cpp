@@ -0,0 +1,65 @@
+#include "BatchHash.h"
+#include "ThreadPool.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Block assembly benchmark: computing the txids of a block template.
+//  - one by one: getTxid() on each transaction from a single thread, as
+//    computeMerkleRoot() did before batch hashing
+//  - batch: hashTransactions() on the shared thread pool
+// Every round starts from fresh copies, so no txid is cached.
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedSeconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Transactions with two inputs and two outputs, close to a typical payment
+static std::vector<Transaction> makeTemplate(size_t count) {
+    std::vector<Transaction> txs;
+    txs.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const std::string prev(64, static_cast<char>('a' + i % 6));
+        txs.emplace_back(std::vector<TxIn>{TxIn(prev, 0, std::string(72, 's'), std::string(65, 'p')),
+                                           TxIn(prev, 1, std::string(72, 's'), std::string(65, 'p'))},
+                         std::vector<TxOut>{TxOut(1000 + i, std::string(64, 'd')),
+                                            TxOut(2000 + i, std::string(64, 'c'))},
+                         1700000000000ULL + i);
+    }
+    return txs;
+}
+
+int main() {
+    std::printf("=== Block template txids (%u pool threads) ===\n", ThreadPool::instance().threadCount());
+    std::printf("  transactions   one by one (ms)   batch (ms)   speedup\n");
+
+    for (size_t count : {100, 1000, 4000, 16000}) {
+        const std::vector<Transaction> source = makeTemplate(count);
+        const int rounds = static_cast<int>(64000 / count);
+
+        double serial = 0;
+        for (int round = 0; round < rounds; ++round) {
+            std::vector<Transaction> txs = source;
+            Clock::time_point start = Clock::now();
+            for (const auto& tx : txs) {
+                tx.getTxid();
+            }
+            serial += elapsedSeconds(start);
+        }
+
+        double batch = 0;
+        for (int round = 0; round < rounds; ++round) {
+            std::vector<Transaction> txs = source;
+            Clock::time_point start = Clock::now();
+            hashTransactions(txs);
+            batch += elapsedSeconds(start);
+        }
+
+        std::printf("  %12zu   %15.3f   %10.3f   %6.2fx\n", count,
+                    serial * 1e3 / rounds, batch * 1e3 / rounds, serial / batch);
+    }
+    return 0;
+}
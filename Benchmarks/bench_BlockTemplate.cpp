@@ -0,0 +1,93 @@
+#include "Blockchain.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Block template benchmark on a pool of 20000 transactions, half of which
+// fit in the byte budget
+//  1. Measuring every transaction: serialize().size(), encode() into a
+//     buffer, and getEncodedSize() cold and cached.
+//  2. Filling the budget the former way (serialize() of the block after
+//     each transaction is tried) against createBlock().
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedSeconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static const size_t TxCount = 20000;
+static const int Rounds = 5;
+
+int main() {
+    std::vector<Transaction> pool;
+    pool.reserve(TxCount);
+    for (size_t t = 0; t < TxCount; ++t) {
+        std::vector<TxIn> ins;
+        for (size_t i = 0; i < 1 + t % 3; ++i) {
+            ins.emplace_back(std::string(64, 'a' + i), static_cast<uint32_t>(t),
+                             std::string(72, 's'), std::string(88, 'p'));
+        }
+        pool.emplace_back(ins, std::vector<TxOut>{TxOut(500, std::string(64, 'b')),
+                                                  TxOut(500, std::string(64, 'c'))}, t + 10);
+        pool.back().computeHash();
+    }
+    Blockchain chain;
+
+    std::printf("=== Block template, %zu pool transactions ===\n", TxCount);
+
+    uint64_t total = 0;
+    Clock::time_point start = Clock::now();
+    for (const auto& tx : pool) {
+        total += tx.serialize().size();
+    }
+    std::printf("  serialize().size()       %8.2f ms\n", elapsedSeconds(start) * 1e3);
+
+    start = Clock::now();
+    std::string buffer;
+    for (const auto& tx : pool) {
+        buffer.clear();
+        tx.encode(buffer);
+        total += buffer.size();
+    }
+    std::printf("  encode() size            %8.2f ms\n", elapsedSeconds(start) * 1e3);
+
+    uint64_t poolBytes = 0;
+    start = Clock::now();
+    for (const auto& tx : pool) {
+        poolBytes += tx.getEncodedSize();
+    }
+    std::printf("  getEncodedSize(), cold   %8.2f ms\n", elapsedSeconds(start) * 1e3);
+    start = Clock::now();
+    for (const auto& tx : pool) {
+        total += tx.getEncodedSize();
+    }
+    std::printf("  getEncodedSize(), cached %8.2f ms\n", elapsedSeconds(start) * 1e3);
+
+    // Former builder: a transaction stays if the serialized block still fits;
+    // only the first 1000 are tried, the full pool takes too long
+    const uint64_t budget = poolBytes / 2;
+    const size_t tried = 1000;
+    start = Clock::now();
+    Block former(chain.getLatestBlock().getHash());
+    std::vector<Transaction> kept;
+    for (size_t t = 0; t < tried; ++t) {
+        kept.push_back(pool[t]);
+        if (Block(kept, former.getPreviousHash()).serialize().size() > budget) {
+            kept.pop_back();
+        }
+    }
+    std::printf("  serialize() per try      %8.2f ms (first %zu transactions)\n",
+                elapsedSeconds(start) * 1e3, tried);
+
+    size_t included = 0;
+    start = Clock::now();
+    for (int round = 0; round < Rounds; ++round) {
+        included = chain.createBlock(pool, budget).getTransactions().size();
+    }
+    std::printf("  createBlock()            %8.2f ms, %zu transactions\n",
+                elapsedSeconds(start) * 1e3 / Rounds, included);
+    // Keeps the measured sizes alive
+    return total == 0 ? 1 : 0;
+}
@@ -0,0 +1,78 @@
+#include "BlockValidator.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+// Block validation benchmark on a 20000-transaction block, a third of which
+// spend outputs created earlier in the same block
+//  1. connectBlockSequential() against connectBlock() on 8 threads.
+//  2. BlockValidator::check() alone on pools of 1 to 16 threads.
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedSeconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static const size_t TxCount = 20000;
+static const int Rounds = 5;
+
+int main() {
+    std::mt19937_64 random(1);
+    std::vector<TxOut> fundingOutputs(TxCount, TxOut(1000, "owner"));
+    Transaction funding({TxIn(std::string(64, '0'), 0, "coinbase", "")}, fundingOutputs, 1);
+    UTXOSet utxos;
+    BlockUndo fundingUndo;
+    utxos.connectBlockSequential(Block({funding}, "0"), fundingUndo);
+
+    std::vector<Transaction> txs;
+    txs.reserve(TxCount);
+    std::vector<OutPoint> recent;
+    for (size_t t = 0; t < TxCount; ++t) {
+        std::vector<TxIn> ins{TxIn(funding.getTxid(), static_cast<uint32_t>(t), "sig", "pk")};
+        if (!recent.empty() && random() % 3 == 0) {
+            const size_t pick = random() % recent.size();
+            ins.emplace_back(recent[pick].txid, recent[pick].index, "sig", "pk");
+            recent.erase(recent.begin() + pick);
+        }
+        txs.emplace_back(ins, std::vector<TxOut>{TxOut(500, "a"), TxOut(500, "b")}, t + 10);
+        txs.back().computeHash();
+        recent.emplace_back(txs.back().getTxid(), 1);
+        if (recent.size() > 100) {
+            recent.erase(recent.begin());
+        }
+    }
+    const Block block(txs, "0");
+
+    std::printf("=== Block validation, %zu transactions, %u hardware threads ===\n",
+                TxCount, std::thread::hardware_concurrency());
+
+    ThreadPool pool(8);
+    double sequential = 0, parallel = 0;
+    for (int round = 0; round < Rounds; ++round) {
+        UTXOSet a = utxos, b = utxos;
+        BlockUndo undoA, undoB;
+        Clock::time_point start = Clock::now();
+        a.connectBlockSequential(block, undoA);
+        sequential += elapsedSeconds(start);
+        start = Clock::now();
+        b.connectBlock(block, undoB, pool);
+        parallel += elapsedSeconds(start);
+    }
+    std::printf("  connectBlockSequential %8.2f ms\n", sequential * 1e3 / Rounds);
+    std::printf("  connectBlock, 8 threads %7.2f ms\n", parallel * 1e3 / Rounds);
+
+    for (unsigned threads : {1u, 2u, 4u, 8u, 16u}) {
+        ThreadPool pool(threads);
+        BlockValidator validator(utxos, pool);
+        validator.check(block);
+        Clock::time_point start = Clock::now();
+        for (int round = 0; round < Rounds; ++round) {
+            validator.check(block);
+        }
+        std::printf("  check, %2u threads       %8.2f ms\n", threads, elapsedSeconds(start) * 1e3 / Rounds);
+    }
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include "Blockchain.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Chain export benchmark on 5000 blocks of 20 transactions, written to
+// /dev/null
+//  1. serialize() into one string against serialize(std::ostream&).
+//  2. Text and binary exportBlocks() to a file descriptor, whole chain and
+//     the last 100 blocks.
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedSeconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static const int BlockCount = 5000;
+static const int TxPerBlock = 20;
+
+int main() {
+    Blockchain chain;
+    for (int b = 0; b < BlockCount; ++b) {
+        std::vector<Transaction> txs;
+        for (int t = 0; t < TxPerBlock; ++t) {
+            const std::string tag = std::to_string(b) + "-" + std::to_string(t);
+            txs.emplace_back(std::vector<TxIn>{TxIn(std::string(64, '0'), 0, "coinbase_" + tag, "")},
+                             std::vector<TxOut>{TxOut(50, std::string(64, 'a'))}, b);
+        }
+        Block block(txs, chain.getLatestBlock().getHash());
+        block.setHeader(BlockHeader(1, chain.getLatestBlock().getHash(), "", b, 0, 1));
+        block.computeMerkleRoot();
+        block.mine();
+        chain.addBlock(block);
+    }
+
+    FILE* null = std::fopen("/dev/null", "w");
+    const int fd = fileno(null);
+    std::printf("=== Chain export, %d blocks of %d transactions ===\n", BlockCount, TxPerBlock);
+
+    Clock::time_point start = Clock::now();
+    const std::string serialized = chain.serialize();
+    const double stringSeconds = elapsedSeconds(start);
+    std::fwrite(serialized.data(), 1, serialized.size(), null);
+    std::printf("  serialize() string      %8.2f ms, %zu bytes held\n", stringSeconds * 1e3, serialized.size());
+
+    {
+        std::ofstream out("/dev/null");
+        start = Clock::now();
+        chain.serialize(out);
+        std::printf("  serialize(ostream)      %8.2f ms\n", elapsedSeconds(start) * 1e3);
+    }
+
+    start = Clock::now();
+    chain.exportBlocks(fd, Blockchain::ExportFormat::Text);
+    std::printf("  export text, fd         %8.2f ms\n", elapsedSeconds(start) * 1e3);
+    start = Clock::now();
+    chain.exportBlocks(fd, Blockchain::ExportFormat::Binary);
+    std::printf("  export binary, fd       %8.2f ms\n", elapsedSeconds(start) * 1e3);
+    start = Clock::now();
+    chain.exportBlocks(fd, Blockchain::ExportFormat::Binary, BlockCount - 99);
+    std::printf("  export binary, last 100 %8.2f ms\n", elapsedSeconds(start) * 1e3);
+
+    std::fclose(null);
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include "ChainImporter.h"
+#include "Checksum.h"
+#include "Encoding.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Bulk import benchmark on an export of 2000 blocks of 100 transactions
+//  1. One block at a time on the calling thread: read, decode, recompute
+//     the Merkle root and block hash, addBlock().
+//  2. ChainImporter with one thread per stage, then one per hardware thread.
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedSeconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static const int BlockCount = 2000;
+static const int TxPerBlock = 100;
+
+int main() {
+    Blockchain source;
+    for (int b = 0; b < BlockCount; ++b) {
+        std::vector<Transaction> txs;
+        for (int t = 0; t < TxPerBlock; ++t) {
+            const std::string tag = std::to_string(b) + "-" + std::to_string(t);
+            txs.emplace_back(std::vector<TxIn>{TxIn(std::string(64, '0'), 0, "coinbase_" + tag, "")},
+                             std::vector<TxOut>{TxOut(50, std::string(64, 'a'))}, b);
+        }
+        Block block(txs, source.getLatestBlock().getHash());
+        block.setHeader(BlockHeader(1, source.getLatestBlock().getHash(), "", b, 0, 1));
+        block.computeMerkleRoot();
+        block.mine();
+        source.addBlock(block);
+    }
+    const std::string path = "bench_import.blocks";
+    {
+        std::ofstream out(path, std::ios::binary);
+        source.exportBlocks(out, Blockchain::ExportFormat::Binary);
+    }
+
+    std::printf("=== Chain import, %d blocks of %d transactions, %u hardware threads ===\n",
+                BlockCount, TxPerBlock, std::thread::hardware_concurrency());
+
+    {
+        Blockchain chain(source.getBlock(0));
+        Clock::time_point start = Clock::now();
+        std::ifstream in(path, std::ios::binary);
+        std::string payload(8, '\0');
+        uint64_t bytes = 8;
+        in.read(&payload[0], 8);
+        char header[8];
+        while (in.read(header, sizeof(header))) {
+            ByteReader reader(header, sizeof(header));
+            uint32_t size, crc;
+            reader.readU32(size);
+            reader.readU32(crc);
+            payload.resize(size);
+            in.read(&payload[0], size);
+            bytes += sizeof(header) + size;
+            ByteReader body(payload);
+            Block block("");
+            if (crc32(payload.data(), size) != crc || !Block::decode(body, block)) {
+                break;
+            }
+            block.computeMerkleRoot();
+            block.computeHash();
+            if (!chain.hasBlock(block.getHash())) {
+                chain.addBlock(block);
+            }
+        }
+        const double seconds = elapsedSeconds(start);
+        std::printf("  addBlock() loop          %8.2f ms, %6.1f MB/s, height %llu\n", seconds * 1e3,
+                    bytes / seconds / 1e6, static_cast<unsigned long long>(chain.getHeight()));
+    }
+
+    std::vector<size_t> threadCounts{1};
+    if (std::thread::hardware_concurrency() > 1) {
+        threadCounts.push_back(std::thread::hardware_concurrency());
+    }
+    for (size_t threads : threadCounts) {
+        ImportConfig config;
+        config.hashThreads = threads;
+        config.signatureThreads = threads;
+        Blockchain chain(source.getBlock(0));
+        ChainImporter importer(chain, nullptr, config);
+        Clock::time_point start = Clock::now();
+        importer.importFile(path);
+        const double seconds = elapsedSeconds(start);
+        std::printf("  ChainImporter, %2zu thr.  %8.2f ms, %6.1f MB/s, height %llu\n", threads,
+                    seconds * 1e3, importer.getBytesRead() / seconds / 1e6,
+                    static_cast<unsigned long long>(chain.getHeight()));
+    }
+    std::remove(path.c_str());
+    return 0;
+}
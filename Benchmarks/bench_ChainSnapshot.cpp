@@ -0,0 +1,125 @@
+#include "Blockchain.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Read throughput under appends, on 2000 blocks of 100 transactions
+//  Reader threads look up the tip and a random block's header and
+//  transaction count while one writer adds the blocks as fast as it can.
+//  1. Reader/writer lock around the chain: addBlock() holds it exclusively.
+//  2. Snapshots: readers never wait for the writer.
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedSeconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static const int BlockCount = 2000;
+static const int TxPerBlock = 100;
+
+// Prevents the compiler from dropping results
+static std::atomic<uint64_t> sink(0);
+
+static std::vector<Block> makeBlocks(const Block& genesis) {
+    std::vector<Block> blocks;
+    std::string prevHash = genesis.getHash();
+    for (int b = 0; b < BlockCount; ++b) {
+        std::vector<Transaction> txs;
+        for (int t = 0; t < TxPerBlock; ++t) {
+            const std::string tag = std::to_string(b) + "-" + std::to_string(t);
+            txs.emplace_back(std::vector<TxIn>{TxIn(std::string(64, '0'), 0, "coinbase_" + tag, "")},
+                             std::vector<TxOut>{TxOut(50, std::string(64, 'a'))}, b);
+        }
+        Block block(txs, prevHash);
+        block.setHeader(BlockHeader(1, prevHash, "", b, 0, 1));
+        block.computeMerkleRoot();
+        block.mine();
+        prevHash = block.getHash();
+        blocks.push_back(std::move(block));
+    }
+    return blocks;
+}
+
+// Runs readers against a chain receiving blocks; read(random) does one read
+template <class Read, class Append>
+static void run(const char* name, size_t readerCount, const std::vector<Block>& blocks,
+                Read read, Append append) {
+    std::atomic<bool> done(false);
+    std::atomic<uint64_t> reads(0);
+    std::vector<std::thread> readers;
+    for (size_t r = 0; r < readerCount; ++r) {
+        readers.emplace_back([&, r] {
+            std::mt19937_64 random(r);
+            uint64_t count = 0;
+            while (!done.load(std::memory_order_relaxed)) {
+                sink.fetch_add(read(random), std::memory_order_relaxed);
+                ++count;
+            }
+            reads += count;
+        });
+    }
+    const Clock::time_point start = Clock::now();
+    for (const Block& block : blocks) {
+        append(block);
+    }
+    const double seconds = elapsedSeconds(start);
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    std::printf("  %-10s %2zu readers   %10.0f reads/s   %7.0f blocks/s\n", name, readerCount,
+                reads.load() / seconds, blocks.size() / seconds);
+}
+
+int main() {
+    Blockchain source;
+    const std::vector<Block> blocks = makeBlocks(source.getBlock(0));
+    const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+
+    std::printf("=== Chain reads during appends, %d blocks of %d transactions, %u hardware threads ===\n",
+                BlockCount, TxPerBlock, hardware);
+
+    std::vector<size_t> readerCounts = {1};
+    for (size_t count = 2; count < hardware; count *= 2) {
+        readerCounts.push_back(count);
+    }
+    if (hardware - 1 > readerCounts.back()) {
+        readerCounts.push_back(hardware - 1);
+    }
+
+    for (size_t readerCount : readerCounts) {
+        {
+            Blockchain chain(source.getBlock(0));
+            std::shared_mutex mutex;
+            run("locked", readerCount, blocks,
+                [&](std::mt19937_64& random) {
+                    std::shared_lock<std::shared_mutex> lock(mutex);
+                    const Block& block = chain.getBlock(random() % (chain.getHeight() + 1));
+                    return block.getHeader().timestamp + block.getTransactions().size();
+                },
+                [&](const Block& block) {
+                    std::unique_lock<std::shared_mutex> lock(mutex);
+                    chain.addBlock(block);
+                });
+        }
+        {
+            Blockchain chain(source.getBlock(0));
+            run("snapshot", readerCount, blocks,
+                [&](std::mt19937_64& random) {
+                    const ChainSnapshot snapshot = chain.snapshot();
+                    const Block* block = snapshot.getBlock(random() % (snapshot.getHeight() + 1));
+                    return block->getHeader().timestamp + block->getTransactions().size();
+                },
+                [&](const Block& block) { chain.addBlock(block); });
+        }
+    }
+    return 0;
+}
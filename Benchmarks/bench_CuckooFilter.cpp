@@ -0,0 +1,140 @@
+#include "CuckooFilter.h"
+#include "Hex.h"
+#include "KnownTxids.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Known-txid filter benchmarks
+//  1. False-positive rate of the cuckoo filter against its load.
+//  2. Lookup of unknown txids (the common case in relay) in a set of 1M known
+//     ones: the exact std::unordered_set alone against the filter in front of
+//     it, and a scan of the blocks' transactions as done before the filter.
+//  3. Insert and erase throughput.
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedSeconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Prevents the compiler from dropping results
+static volatile size_t sink;
+
+// Random txids in hex, like the SHA-256 ones
+static std::vector<TXID> makeTxids(size_t count, uint64_t seed) {
+    std::mt19937_64 random(seed);
+    std::vector<TXID> txids(count);
+    unsigned char bytes[32];
+    for (auto& txid : txids) {
+        for (int i = 0; i < 32; i += 8) {
+            const uint64_t word = random();
+            for (int j = 0; j < 8; ++j) {
+                bytes[i + j] = static_cast<unsigned char>(word >> (8 * j));
+            }
+        }
+        txid = toHex(bytes, sizeof(bytes));
+    }
+    return txids;
+}
+
+static void benchFalsePositives() {
+    std::printf("=== False-positive rate (1M slots) ===\n");
+    std::printf("  load    false positives\n");
+    std::mt19937_64 random(7);
+    for (double load : {0.25, 0.5, 0.75, 0.95}) {
+        CuckooFilter filter(1 << 20);
+        const size_t count = static_cast<size_t>(filter.slotCount() * load);
+        for (size_t i = 0; i < count; ++i) {
+            filter.insert(random());
+        }
+        const size_t probes = 10000000;
+        size_t hits = 0;
+        for (size_t i = 0; i < probes; ++i) {
+            hits += filter.contains(random());
+        }
+        std::printf("  %3.0f%%    %.4f%%\n", load * 100, 100.0 * hits / probes);
+    }
+    std::printf("\n");
+}
+
+static void benchLookups() {
+    const size_t count = 1000000;
+    const std::vector<TXID> known = makeTxids(count, 1);
+    const std::vector<TXID> unknown = makeTxids(count, 2);
+
+    std::unordered_set<TXID> exact(known.begin(), known.end());
+    CuckooFilter filter(count);
+    for (const auto& txid : known) {
+        filter.insert(KnownTxids::filterKey(txid));
+    }
+    std::printf("=== Lookup of 1M unknown txids among 1M known (filter %.1f MB) ===\n",
+                filter.memoryUsage() / 1e6);
+
+    Clock::time_point start = Clock::now();
+    size_t found = 0;
+    for (const auto& txid : unknown) {
+        found += exact.count(txid);
+    }
+    const double baseline = elapsedSeconds(start);
+    std::printf("  unordered_set            %6.1f ns/lookup\n", baseline * 1e9 / count);
+
+    start = Clock::now();
+    size_t passed = 0;
+    for (const auto& txid : unknown) {
+        if (filter.contains(KnownTxids::filterKey(txid))) {
+            ++passed;
+            found += exact.count(txid);
+        }
+    }
+    const double filtered = elapsedSeconds(start);
+    std::printf("  filter + unordered_set   %6.1f ns/lookup   %5.1fx   %zu reached the set\n",
+                filtered * 1e9 / count, baseline / filtered, passed);
+
+    // Scan of 1000 blocks of 100 transactions, the previous way to find a
+    // confirmed txid; measured on a few lookups only
+    const size_t scanned = 100000;
+    const size_t scanLookups = 200;
+    start = Clock::now();
+    for (size_t i = 0; i < scanLookups; ++i) {
+        for (size_t j = 0; j < scanned; ++j) {
+            found += known[j] == unknown[i];
+        }
+    }
+    std::printf("  scan of 100k txids       %6.1f ns/lookup\n",
+                elapsedSeconds(start) * 1e9 / scanLookups);
+    sink = found;
+    std::printf("\n");
+}
+
+static void benchUpdates() {
+    const size_t count = 1000000;
+    std::mt19937_64 random(3);
+    std::vector<uint64_t> keys(count);
+    for (auto& key : keys) {
+        key = random();
+    }
+    CuckooFilter filter(count);
+
+    std::printf("=== Updates (1M keys) ===\n");
+    Clock::time_point start = Clock::now();
+    for (uint64_t key : keys) {
+        filter.insert(key);
+    }
+    std::printf("  insert   %6.1f ns/key\n", elapsedSeconds(start) * 1e9 / count);
+    start = Clock::now();
+    for (uint64_t key : keys) {
+        filter.erase(key);
+    }
+    std::printf("  erase    %6.1f ns/key\n", elapsedSeconds(start) * 1e9 / count);
+}
+
+int main() {
+    benchFalsePositives();
+    benchLookups();
+    benchUpdates();
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include "HeaderStore.h"
+#include "Hex.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+// Header storage benchmark on 2M linked headers
+//  1. Size: a std::vector<BlockHeader> against the packed store.
+//  2. Scan: every header read in order, and the timestamps alone.
+//  3. Random access: single headers decoded from the store.
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedSeconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static const size_t HeaderCount = 2000000;
+
+// Prevents the compiler from dropping results
+static volatile uint64_t sink;
+
+static std::string randomHash(std::mt19937_64& random) {
+    unsigned char bytes[32];
+    for (auto& byte : bytes) {
+        byte = static_cast<unsigned char>(random());
+    }
+    return toHex(bytes, sizeof(bytes));
+}
+
+// Heap bytes of a string, counting the allocator's 16-byte granularity
+static size_t heapBytes(const std::string& value) {
+    return value.capacity() < sizeof(std::string) ? 0 : (value.capacity() + 1 + 15) / 16 * 16 + 16;
+}
+
+int main() {
+    const std::string path = (std::filesystem::temp_directory_path() / "bench_header_store.hdr").string();
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + ".exc");
+
+    std::mt19937_64 random(1);
+    std::vector<BlockHeader> headers;
+    headers.reserve(HeaderCount);
+    std::string prevHash(64, '0');
+    uint64_t timestamp = 1700000000000ULL;
+    for (size_t i = 0; i < HeaderCount; ++i) {
+        headers.emplace_back(1, prevHash, randomHash(random), timestamp, static_cast<uint32_t>(random()), 3);
+        headers.back().blockHash = randomHash(random);
+        prevHash = headers.back().blockHash;
+        timestamp += 1000 + random() % 600000;
+    }
+
+    std::printf("=== Header storage, %zu headers ===\n", HeaderCount);
+
+    size_t vectorBytes = headers.capacity() * sizeof(BlockHeader);
+    for (const auto& header : headers) {
+        vectorBytes += heapBytes(header.hashPrevBlock) + heapBytes(header.hashMerkleRoot) +
+                       heapBytes(header.blockHash);
+    }
+
+    HeaderStore store(path);
+    store.open();
+    Clock::time_point start = Clock::now();
+    for (const auto& header : headers) {
+        store.append(header);
+    }
+    const double appending = elapsedSeconds(start);
+    store.sync();
+    std::printf("  append             %8.3f s\n", appending);
+    std::printf("  vector<BlockHeader>  %8.1f MB   %6.0f bytes/header\n",
+                vectorBytes / 1e6, double(vectorBytes) / HeaderCount);
+    std::printf("  header store         %8.1f MB   %6.0f bytes/header   (10M headers: %.0f MB)\n",
+                store.memoryUsage() / 1e6, double(store.memoryUsage()) / HeaderCount,
+                store.memoryUsage() * (10e6 / HeaderCount) / 1e6);
+
+    uint64_t sum = 0;
+    start = Clock::now();
+    for (const auto& header : headers) {
+        sum += header.timestamp + header.nonce + header.blockHash[0];
+    }
+    const double vectorScan = elapsedSeconds(start);
+    start = Clock::now();
+    store.forEach([&](uint64_t, const BlockHeader& header) {
+        sum += header.timestamp + header.nonce + header.blockHash[0];
+    });
+    const double storeScan = elapsedSeconds(start);
+    sink = sum;
+    std::printf("  scan vector        %8.3f s\n", vectorScan);
+    std::printf("  scan store         %8.3f s   %6.1f ns/header (decodes the hex strings)\n",
+                storeScan, storeScan * 1e9 / HeaderCount);
+
+    const size_t lookups = 200000;
+    start = Clock::now();
+    for (size_t i = 0; i < lookups; ++i) {
+        sum += store.get(random() % HeaderCount).timestamp;
+    }
+    const double lookup = elapsedSeconds(start);
+    sink = sum;
+    std::printf("  random get         %8.3f us/header\n", lookup * 1e6 / lookups);
+
+    store.close();
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + ".exc");
+    return 0;
+}
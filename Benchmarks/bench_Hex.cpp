@@ -0,0 +1,137 @@
+#include "Hex.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Hex codec benchmarks on 32-byte digests
+//  1. Encoding: the ostringstream loop previously used by computeHash() and
+//     computeMerkleRoot() against the scalar, SSSE3 and AVX2 codecs, both into
+//     a caller buffer and into a new std::string (toHex).
+//  2. Decoding: strtoul on each character pair against the codecs.
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedSeconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static const size_t DigestCount = 4096;
+static const size_t Rounds = 256;
+
+// Prevents the compiler from dropping results
+static volatile unsigned sink;
+
+static std::vector<unsigned char> makeDigests() {
+    std::vector<unsigned char> digests(DigestCount * 32);
+    uint32_t state = 1;
+    for (auto& byte : digests) {
+        state = state * 1103515245u + 12345u;
+        byte = static_cast<unsigned char>(state >> 16);
+    }
+    return digests;
+}
+
+static const char* implName(HexImpl impl) {
+    switch (impl) {
+    case HexImpl::AVX2:
+        return "AVX2";
+    case HexImpl::SSSE3:
+        return "SSSE3";
+    default:
+        return "scalar";
+    }
+}
+
+static void report(const char* name, double seconds, double baseline) {
+    const double ns = seconds * 1e9 / (DigestCount * Rounds);
+    std::printf("  %-24s %8.1f ns/hash   %7.1fx\n", name, ns, baseline > 0 ? baseline / seconds : 1.0);
+}
+
+static void benchEncode(const std::vector<unsigned char>& digests) {
+    std::printf("=== Encode 32-byte digest to 64 hex characters ===\n");
+
+    Clock::time_point start = Clock::now();
+    for (size_t round = 0; round < Rounds; ++round) {
+        for (size_t i = 0; i < DigestCount; ++i) {
+            std::ostringstream oss;
+            for (int j = 0; j < 32; ++j) {
+                oss << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(digests[i * 32 + j]);
+            }
+            sink = sink + static_cast<unsigned char>(oss.str()[round & 63]);
+        }
+    }
+    const double baseline = elapsedSeconds(start);
+    report("ostringstream", baseline, 0);
+
+    char buffer[64];
+    for (HexImpl impl : {HexImpl::Scalar, HexImpl::SSSE3, HexImpl::AVX2}) {
+        if (!hexImplSupported(impl)) {
+            continue;
+        }
+        start = Clock::now();
+        for (size_t round = 0; round < Rounds; ++round) {
+            for (size_t i = 0; i < DigestCount; ++i) {
+                hexEncode(impl, &digests[i * 32], 32, buffer);
+                sink = sink + static_cast<unsigned char>(buffer[round & 63]);
+            }
+        }
+        std::string name = std::string(implName(impl)) + " (caller buffer)";
+        report(name.c_str(), elapsedSeconds(start), baseline);
+    }
+
+    start = Clock::now();
+    for (size_t round = 0; round < Rounds; ++round) {
+        for (size_t i = 0; i < DigestCount; ++i) {
+            sink = sink + static_cast<unsigned char>(toHex(&digests[i * 32], 32)[round & 63]);
+        }
+    }
+    std::string name = std::string("toHex (") + implName(hexImpl()) + ")";
+    report(name.c_str(), elapsedSeconds(start), baseline);
+    std::printf("\n");
+}
+
+static void benchDecode(const std::vector<unsigned char>& digests) {
+    std::printf("=== Decode 64 hex characters to 32-byte digest ===\n");
+
+    std::vector<char> hex(digests.size() * 2);
+    hexEncode(digests.data(), digests.size(), hex.data());
+
+    unsigned char bytes[32];
+    Clock::time_point start = Clock::now();
+    for (size_t round = 0; round < Rounds; ++round) {
+        for (size_t i = 0; i < DigestCount; ++i) {
+            for (int j = 0; j < 32; ++j) {
+                char pair[3] = {hex[i * 64 + 2 * j], hex[i * 64 + 2 * j + 1], '\0'};
+                bytes[j] = static_cast<unsigned char>(std::strtoul(pair, nullptr, 16));
+            }
+            sink = sink + bytes[round & 31];
+        }
+    }
+    const double baseline = elapsedSeconds(start);
+    report("strtoul", baseline, 0);
+
+    for (HexImpl impl : {HexImpl::Scalar, HexImpl::SSSE3, HexImpl::AVX2}) {
+        if (!hexImplSupported(impl)) {
+            continue;
+        }
+        start = Clock::now();
+        for (size_t round = 0; round < Rounds; ++round) {
+            for (size_t i = 0; i < DigestCount; ++i) {
+                hexDecode(impl, &hex[i * 64], 32, bytes);
+                sink = sink + bytes[round & 31];
+            }
+        }
+        report(implName(impl), elapsedSeconds(start), baseline);
+    }
+}
+
+int main() {
+    std::vector<unsigned char> digests = makeDigests();
+    benchEncode(digests);
+    benchDecode(digests);
+    return 0;
+}
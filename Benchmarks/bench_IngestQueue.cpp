@@ -0,0 +1,154 @@
+#include "IngestQueue.h"
+#include "Mempool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Ingestion throughput of 400000 transactions from several producer threads
+//  1. Staging only, one consumer taking what was staged:
+//     a. mutex-protected vector, swapped out by the consumer
+//     b. lock-free MPMCQueue, popped in batches of 256
+//  2. IngestQueue end to end: txids computed on the pool and the transactions
+//     drained into a Mempool by the owning thread.
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedSeconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static const size_t TxCount = 400000;
+static const size_t BatchSize = 256;
+
+static std::vector<Transaction> makeTransactions() {
+    std::vector<Transaction> txs;
+    txs.reserve(TxCount);
+    for (size_t i = 0; i < TxCount; ++i) {
+        txs.emplace_back(std::vector<TxIn>{TxIn(std::string(64, '0'), 0, "coinbase_" + std::to_string(i), "")},
+                         std::vector<TxOut>{TxOut(50, std::string(64, 'a'))}, i);
+    }
+    return txs;
+}
+
+// Producer p submits the transactions at p, p + producerCount, ... with
+// submit(tx), which returns false when the queue is full
+template <class Submit>
+static std::vector<std::thread> startProducers(std::vector<Transaction>& txs, size_t producerCount,
+                                               Submit submit) {
+    std::vector<std::thread> producers;
+    for (size_t p = 0; p < producerCount; ++p) {
+        producers.emplace_back([&txs, producerCount, p, submit] {
+            for (size_t i = p; i < txs.size(); i += producerCount) {
+                while (!submit(txs[i])) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    return producers;
+}
+
+static void report(const char* name, size_t producerCount, double seconds) {
+    std::printf("  %-12s %2zu producers   %10.0f tx/s\n", name, producerCount, TxCount / seconds);
+}
+
+static void benchLocked(std::vector<Transaction> txs, size_t producerCount) {
+    std::mutex mutex;
+    std::vector<Transaction> staged;
+    const size_t capacity = 1 << 16;
+
+    const Clock::time_point start = Clock::now();
+    auto producers = startProducers(txs, producerCount, [&](Transaction& tx) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (staged.size() >= capacity) {
+            return false;
+        }
+        staged.push_back(std::move(tx));
+        return true;
+    });
+    std::vector<Transaction> batch;
+    for (size_t consumed = 0; consumed < TxCount;) {
+        batch.clear();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            staged.swap(batch);
+        }
+        if (batch.empty()) {
+            std::this_thread::yield();
+        }
+        consumed += batch.size();
+    }
+    const double seconds = elapsedSeconds(start);
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    report("locked", producerCount, seconds);
+}
+
+static void benchLockFree(std::vector<Transaction> txs, size_t producerCount) {
+    MPMCQueue<Transaction> staged(1 << 16);
+
+    const Clock::time_point start = Clock::now();
+    auto producers = startProducers(txs, producerCount,
+                                    [&](Transaction& tx) { return staged.tryPush(std::move(tx)); });
+    std::vector<Transaction> batch;
+    for (size_t consumed = 0; consumed < TxCount;) {
+        batch.clear();
+        if (staged.tryPopBatch(batch, BatchSize) == 0) {
+            std::this_thread::yield();
+        }
+        consumed += batch.size();
+    }
+    const double seconds = elapsedSeconds(start);
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    report("lock-free", producerCount, seconds);
+}
+
+static void benchIngest(std::vector<Transaction> txs, size_t producerCount) {
+    IngestQueue queue;
+    Mempool mempool;
+
+    const Clock::time_point start = Clock::now();
+    auto producers = startProducers(txs, producerCount,
+                                    [&](Transaction& tx) { return queue.submit(std::move(tx)); });
+    while (mempool.size() < TxCount) {
+        if (queue.drain(mempool) == 0) {
+            std::this_thread::yield();
+        }
+    }
+    const double seconds = elapsedSeconds(start);
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    report("ingest", producerCount, seconds);
+}
+
+int main() {
+    const std::vector<Transaction> txs = makeTransactions();
+    const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+
+    std::printf("=== Ingestion of %zu transactions, %u hardware threads ===\n", TxCount, hardware);
+
+    std::vector<size_t> producerCounts = {1};
+    for (size_t count = 2; count <= std::max(4u, hardware); count *= 2) {
+        producerCounts.push_back(count);
+    }
+
+    std::printf("Staging only:\n");
+    for (size_t producerCount : producerCounts) {
+        benchLocked(txs, producerCount);
+        benchLockFree(txs, producerCount);
+    }
+    std::printf("Into the mempool:\n");
+    for (size_t producerCount : producerCounts) {
+        benchIngest(txs, producerCount);
+    }
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include "Blockchain.h"
+#include "Mempool.h"
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Memory accounting on 2000 blocks of 100 transactions and a pool of 100000
+//  1. Accuracy: reported bytes against the growth of the resident set while
+//     the chain and the mempool are filled.
+//  2. Cost of one poll: getMemoryUsage() and Mempool::memoryUsage(), which
+//     read running totals, against recounting every block and undo record.
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedSeconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static const int BlockCount = 2000;
+static const int TxPerBlock = 100;
+static const int PoolSize = 100000;
+
+// Prevents the compiler from dropping results
+static std::atomic<uint64_t> sink(0);
+
+static Transaction makeTransaction(const std::string& tag, uint64_t timestamp) {
+    return Transaction({TxIn(std::string(64, '0'), 0, "coinbase_" + tag, "")},
+                       {TxOut(50, std::string(64, 'a'))}, timestamp);
+}
+
+static std::vector<Block> makeBlocks(const Block& genesis) {
+    std::vector<Block> blocks;
+    std::string prevHash = genesis.getHash();
+    for (int b = 0; b < BlockCount; ++b) {
+        std::vector<Transaction> txs;
+        for (int t = 0; t < TxPerBlock; ++t) {
+            txs.push_back(makeTransaction(std::to_string(b) + "-" + std::to_string(t), b));
+        }
+        Block block(txs, prevHash);
+        block.setHeader(BlockHeader(1, prevHash, "", b, 0, 1));
+        block.computeMerkleRoot();
+        block.mine();
+        prevHash = block.getHash();
+        blocks.push_back(std::move(block));
+    }
+    return blocks;
+}
+
+// Resident set size from /proc/self/statm
+static uint64_t residentBytes() {
+    FILE* statm = std::fopen("/proc/self/statm", "r");
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    if (!statm) {
+        return 0;
+    }
+    if (std::fscanf(statm, "%lu %lu", &size, &resident) != 2) {
+        resident = 0;
+    }
+    std::fclose(statm);
+    return static_cast<uint64_t>(resident) * sysconf(_SC_PAGESIZE);
+}
+
+static void reportAccuracy(const char* name, uint64_t reported, uint64_t resident) {
+    std::printf("  %-12s reported %8.1f MB   resident growth %8.1f MB   (%+.1f%%)\n", name,
+                reported / 1e6, resident / 1e6, resident ? 100.0 * reported / resident - 100.0 : 0.0);
+}
+
+template <class Poll>
+static void reportPoll(const char* name, size_t iterations, Poll poll) {
+    const Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        sink += poll();
+    }
+    std::printf("  %-12s %12.0f ns per poll\n", name, elapsedSeconds(start) * 1e9 / iterations);
+}
+
+int main() {
+    Blockchain chain;
+    Mempool mempool;
+    std::printf("=== Memory accounting, %d blocks of %d transactions, %d pooled ===\n",
+                BlockCount, TxPerBlock, PoolSize);
+    std::printf("Accuracy:\n");
+    {
+        std::vector<Transaction> pooled;
+        for (int i = 0; i < PoolSize; ++i) {
+            pooled.push_back(makeTransaction("pool-" + std::to_string(i), i));
+            pooled.back().getTxid();
+        }
+        const size_t poolBefore = mempool.memoryUsage();
+        const uint64_t resident = residentBytes();
+        for (const Transaction& tx : pooled) {
+            mempool.addTransaction(tx);
+        }
+        reportAccuracy("mempool", mempool.memoryUsage() - poolBefore, residentBytes() - resident);
+    }
+    {
+        // Made in the memory the pool copies freed, so that only the chain
+        // grows the resident set
+        const std::vector<Block> blocks = makeBlocks(chain.getLatestBlock());
+        const uint64_t chainBefore = chain.getMemoryUsage().total();
+        const uint64_t resident = residentBytes();
+        for (const Block& block : blocks) {
+            chain.addBlock(block);
+        }
+        reportAccuracy("chain", chain.getMemoryUsage().total() - chainBefore, residentBytes() - resident);
+    }
+
+    std::printf("Cost of one poll:\n");
+    reportPoll("chain", 1000000, [&] { return chain.getMemoryUsage().total(); });
+    reportPoll("mempool", 1000000, [&] { return mempool.memoryUsage(); });
+    reportPoll("recount", 20, [&] {
+        uint64_t total = 0;
+        for (uint64_t height = 0; height <= chain.getHeight(); ++height) {
+            total += chain.getBlock(height).memoryUsage() + chain.getBlockUndo(height).memoryUsage();
+        }
+        return total;
+    });
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "MempoolJournal.h"
+#include "ThreadPool.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Mempool journal benchmark
+//  1. Logging: transactions added to a journaled pool, then one sync();
+//     reports the add rate and the number of records sharing each fsync.
+//  2. Recovery: opening the journal into an empty pool.
+//  3. Compaction: rewriting the journal after most transactions left.
+// The transaction count defaults to one million; pass another as argument.
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedSeconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Transactions with two inputs and two outputs, close to a typical payment
+static std::vector<Transaction> makeTransactions(size_t count) {
+    std::vector<Transaction> txs;
+    txs.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const std::string prev(64, static_cast<char>('a' + i % 6));
+        txs.emplace_back(std::vector<TxIn>{TxIn(prev, 0, std::string(72, 's'), std::string(65, 'p')),
+                                           TxIn(prev, 1, std::string(72, 's'), std::string(65, 'p'))},
+                         std::vector<TxOut>{TxOut(1000 + i, std::string(64, 'd')),
+                                            TxOut(2000 + i, std::string(64, 'c'))},
+                         1700000000000ULL + i);
+    }
+    return txs;
+}
+
+int main(int argc, char** argv) {
+    const size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    const std::string path = (std::filesystem::temp_directory_path() / "bench_mempool.journal").string();
+    std::filesystem::remove(path);
+
+    std::vector<Transaction> txs = makeTransactions(count);
+    for (const auto& tx : txs) {
+        tx.getTxid();
+    }
+
+    std::printf("=== Mempool journal, %zu transactions (%u pool threads) ===\n",
+                count, ThreadPool::instance().threadCount());
+    {
+        Mempool pool;
+        MempoolJournal journal(path);
+        if (!journal.open(pool)) {
+            return 1;
+        }
+        Clock::time_point start = Clock::now();
+        for (const auto& tx : txs) {
+            pool.addTransaction(tx);
+        }
+        journal.sync();
+        const double seconds = elapsedSeconds(start);
+        std::printf("  log + sync       %8.3f s   %10.0f tx/s   %8.0f records/fsync   %6.1f MB\n",
+                    seconds, count / seconds, static_cast<double>(count) / journal.batchCount(),
+                    std::filesystem::file_size(path) / 1e6);
+    }
+
+    Mempool pool;
+    MempoolJournal journal(path);
+    Clock::time_point start = Clock::now();
+    if (!journal.open(pool)) {
+        return 1;
+    }
+    double seconds = elapsedSeconds(start);
+    std::printf("  recovery         %8.3f s   %10.0f tx/s   %zu transactions restored\n",
+                seconds, count / seconds, pool.size());
+
+    // Keep one transaction in ten
+    for (size_t i = 0; i < count; ++i) {
+        if (i % 10 != 0) {
+            pool.removeTransaction(txs[i].getTxid());
+        }
+    }
+    const uint64_t before = journal.recordCount();
+    start = Clock::now();
+    journal.compact();
+    seconds = elapsedSeconds(start);
+    std::printf("  compaction       %8.3f s   %llu -> %llu records\n", seconds,
+                static_cast<unsigned long long>(before),
+                static_cast<unsigned long long>(journal.recordCount()));
+
+    journal.close();
+    std::filesystem::remove(path);
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include "P2PNode.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <sys/resource.h>
+#include <thread>
+#include <vector>
+
+// P2PNode benchmarks over loopback
+//  1. Connections: time to open thousands of peers on one listening node.
+//  2. Block relay: a node broadcasts 1 MB block frames to every peer; the
+//     throughput is compared with a 10 GbE link (1.25 GB/s).
+// Usage: bench_Relay [peers...]   (default 1 16 256 2000)
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedSeconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Each peer takes two descriptors in this process (both ends of the socket)
+static void raiseDescriptorLimit() {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+static void benchRelay(size_t peerCount) {
+    const size_t blockSize = 1024 * 1024;
+    const size_t blockCount = std::max<size_t>(4, 2000 / peerCount);
+    const unsigned receiverNodes = 4;
+
+    P2PConfig config;
+    config.ioThreads = 4;
+    // Frames are shared between peers, so a queue holding every block costs little
+    config.maxSendQueueBytes = (blockCount + 1) * (blockSize + FrameHeaderSize);
+    P2PNode sender(config);
+    if (!sender.listen(0)) {
+        std::printf("  listen failed\n");
+        return;
+    }
+
+    std::atomic<uint64_t> receivedBytes(0);
+    std::vector<std::unique_ptr<P2PNode>> receivers;
+    for (unsigned i = 0; i < receiverNodes; ++i) {
+        P2PConfig receiverConfig;
+        receiverConfig.ioThreads = 2;
+        receivers.push_back(std::make_unique<P2PNode>(receiverConfig));
+        receivers.back()->setMessageHandler([&receivedBytes](PeerId, MessageType, const std::string& payload) {
+            receivedBytes.fetch_add(payload.size(), std::memory_order_relaxed);
+        });
+    }
+
+    Clock::time_point start = Clock::now();
+    size_t connected = 0;
+    for (size_t i = 0; i < peerCount; ++i) {
+        connected += receivers[i % receiverNodes]->connect("127.0.0.1", sender.listeningPort()) != 0;
+    }
+    while (sender.peerCount() < connected && elapsedSeconds(start) < 30) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const double connectSeconds = elapsedSeconds(start);
+
+    const std::string block(blockSize, 'b');
+    const uint64_t expected = static_cast<uint64_t>(blockCount) * blockSize * sender.peerCount();
+    start = Clock::now();
+    for (size_t i = 0; i < blockCount; ++i) {
+        sender.broadcast(MessageType::Block, block);
+    }
+    while (receivedBytes.load() < expected && elapsedSeconds(start) < 60) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    const double seconds = elapsedSeconds(start);
+    const double gigabits = receivedBytes.load() * 8.0 / seconds / 1e9;
+
+    std::printf("  %6zu   %9.1f   %6zu   %9.1f   %8.2f   %7.0f%%\n",
+                sender.peerCount(), connectSeconds * 1e3, blockCount, seconds * 1e3,
+                gigabits, gigabits / 10.0 * 100.0);
+}
+
+int main(int argc, char* argv[]) {
+    raiseDescriptorLimit();
+
+    std::vector<size_t> peerCounts = {1, 16, 256, 2000};
+    if (argc > 1) {
+        peerCounts.clear();
+        for (int i = 1; i < argc; ++i) {
+            peerCounts.push_back(static_cast<size_t>(std::atoll(argv[i])));
+        }
+    }
+
+    std::printf("=== Block relay over loopback (1 MB blocks) ===\n");
+    std::printf("   peers   connect ms   blocks     relay ms     Gbit/s   of 10GbE\n");
+    for (size_t peers : peerCounts) {
+        benchRelay(peers);
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include "SignatureCache.h"
+#include <chrono>
+#include <cstdio>
+#include <openssl/ec.h>
+#include <openssl/x509.h>
+#include <string>
+#include <vector>
+
+// Signature checks of a 2000-transaction block, every transaction spending
+// one funding output with a secp256k1 signature
+//  1. verifyTransactionSignatures() of every transaction, as at mempool entry.
+//  2. verifyBlockSignatures() without a cache, then with a cache holding
+//     none, 90% and all of the block's signatures.
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedSeconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static const size_t TxCount = 2000;
+static const int Rounds = 3;
+
+int main() {
+    EVP_PKEY* key = EVP_EC_gen("secp256k1");
+    unsigned char* der = nullptr;
+    int derLength = i2d_PUBKEY(key, &der);
+    const std::string publicKey(reinterpret_cast<char*>(der), derLength);
+    OPENSSL_free(der);
+    const std::string owner = Transaction::hashPublicKey(publicKey);
+
+    std::vector<TxOut> fundingOutputs(TxCount, TxOut(1000, owner));
+    Transaction funding({TxIn(std::string(64, '0'), 0, "coinbase", "")}, fundingOutputs, 1);
+    UTXOSet utxos;
+    BlockUndo fundingUndo;
+    utxos.connectBlockSequential(Block({funding}, "0"), fundingUndo);
+
+    std::vector<Transaction> txs;
+    txs.reserve(TxCount);
+    for (size_t t = 0; t < TxCount; ++t) {
+        txs.emplace_back(std::vector<TxIn>{TxIn(funding.getTxid(), static_cast<uint32_t>(t), "", publicKey)},
+                         std::vector<TxOut>{TxOut(1000, "recipient")}, t + 10);
+        txs.back().signInput(0, key);
+        txs.back().computeHash();
+    }
+    const Block block(txs, "0");
+    BlockUndo undo;
+    utxos.connectBlockSequential(block, undo);
+
+    std::printf("=== Signature checks, %zu transactions, %zu pool threads ===\n",
+                TxCount, static_cast<size_t>(ThreadPool::instance().threadCount()));
+
+    SignatureCache warm;
+    Clock::time_point start = Clock::now();
+    for (size_t t = 0; t < TxCount; ++t) {
+        verifyTransactionSignatures(txs[t], {&fundingOutputs[t]}, &warm);
+    }
+    std::printf("  mempool entry          %8.2f ms\n", elapsedSeconds(start) * 1e3);
+
+    SignatureCache partial;
+    for (size_t t = 0; t < TxCount; ++t) {
+        if (t % 10 != 0) {
+            partial.insert(txs[t].getTxid(), 0, txs[t].getInputs()[0].signature);
+        }
+    }
+    SignatureCache cold;
+
+    struct Case { const char* name; SignatureCache* cache; };
+    for (const Case& c : {Case{"no cache", nullptr}, Case{"cache,   0% seen", &cold},
+                          Case{"cache,  90% seen", &partial}, Case{"cache, 100% seen", &warm}}) {
+        start = Clock::now();
+        bool valid = true;
+        for (int round = 0; round < Rounds; ++round) {
+            valid = verifyBlockSignatures(block, undo, c.cache) && valid;
+        }
+        std::printf("  block, %-16s %8.2f ms%s\n", c.name, elapsedSeconds(start) * 1e3 / Rounds,
+                    valid ? "" : " (invalid)");
+    }
+
+    EVP_PKEY_free(key);
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include "ThreadPool.h"
+#include <openssl/sha.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// ThreadPool benchmarks
+//  1. Scheduling overhead: cost of posting and running empty tasks, and of
+//     parallelFor with one index per chunk.
+//  2. Scaling: SHA-256 hashing with parallelFor on pools of 1 to 64 threads.
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedSeconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void benchSchedulingOverhead() {
+    ThreadPool pool;
+    const size_t taskCount = 1000000;
+
+    std::printf("=== Scheduling overhead (%u threads) ===\n", pool.threadCount());
+
+    std::atomic<size_t> done(0);
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < taskCount; ++i) {
+        pool.post([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+    }
+    while (done.load() < taskCount) {
+        std::this_thread::yield();
+    }
+    double seconds = elapsedSeconds(start);
+    std::printf("  post + run empty task     : %8.1f ns/task\n", seconds * 1e9 / taskCount);
+
+    start = Clock::now();
+    std::future<void> last;
+    for (size_t i = 0; i < taskCount; ++i) {
+        last = pool.submit([]() {}, TaskPriority::High);
+    }
+    last.get();
+    seconds = elapsedSeconds(start);
+    std::printf("  submit (future) empty task: %8.1f ns/task\n", seconds * 1e9 / taskCount);
+
+    std::atomic<size_t> sum(0);
+    start = Clock::now();
+    pool.parallelFor(0, taskCount, [&sum](size_t i) { sum.fetch_add(i, std::memory_order_relaxed); },
+                     TaskPriority::Normal, 1);
+    seconds = elapsedSeconds(start);
+    std::printf("  parallelFor grain 1       : %8.1f ns/index\n\n", seconds * 1e9 / taskCount);
+}
+
+static void benchScaling() {
+    const size_t hashCount = 400000;
+    std::vector<unsigned char> input(256, 0x5a);
+    std::vector<unsigned char> digests(hashCount * SHA256_DIGEST_LENGTH);
+
+    std::printf("=== Scaling: %zu SHA-256 hashes of %zu bytes ===\n", hashCount, input.size());
+    std::printf("  threads   time (ms)   Mhash/s   speedup\n");
+
+    double baseline = 0;
+    for (unsigned threads = 1; threads <= 64; threads *= 2) {
+        ThreadPool pool(threads);
+        Clock::time_point start = Clock::now();
+        pool.parallelFor(0, hashCount, [&](size_t i) {
+            SHA256(input.data(), input.size(), &digests[i * SHA256_DIGEST_LENGTH]);
+        });
+        const double seconds = elapsedSeconds(start);
+        if (threads == 1) {
+            baseline = seconds;
+        }
+        std::printf("  %7u   %9.2f   %7.2f   %7.2fx\n", threads, seconds * 1e3,
+                    hashCount / seconds / 1e6, baseline / seconds);
+    }
+}
+
+int main() {
+    benchSchedulingOverhead();
+    benchScaling();
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include "TxIndex.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+// Txid index benchmark on a chain of 200k transactions
+//  1. Build: background indexing of the existing chain into a mapped file.
+//  2. Lookup: find() against walking every block, as needed without the
+//     index, for txids spread over the chain.
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedSeconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static const size_t BlockCount = 400;
+static const size_t TxPerBlock = 500;
+
+// Prevents the compiler from dropping results
+static volatile size_t sink;
+
+// Blocks of coinbase transactions, mined at difficulty 1
+static std::vector<TXID> buildChain(Blockchain& chain) {
+    std::vector<TXID> txids;
+    txids.reserve(BlockCount * TxPerBlock);
+    for (size_t b = 0; b < BlockCount; ++b) {
+        std::vector<Transaction> txs;
+        txs.reserve(TxPerBlock);
+        for (size_t t = 0; t < TxPerBlock; ++t) {
+            txs.emplace_back(std::vector<TxIn>{TxIn(std::string(64, '0'), 0, std::to_string(b * TxPerBlock + t), "")},
+                             std::vector<TxOut>{TxOut(50, "pkh_" + std::to_string(t))},
+                             1700000000000ULL);
+            txids.push_back(txs.back().getTxid());
+        }
+        const std::string prevHash = chain.getLatestBlock().getHash();
+        Block block(txs, prevHash);
+        block.setHeader(BlockHeader(1, prevHash, "", 0, 0, 1));
+        block.computeMerkleRoot();
+        block.mine();
+        chain.addBlock(block);
+    }
+    return txids;
+}
+
+int main() {
+    const std::string path = (std::filesystem::temp_directory_path() / "bench_txindex.idx").string();
+    std::filesystem::remove(path);
+    Blockchain chain;
+    const std::vector<TXID> txids = buildChain(chain);
+
+    std::printf("=== Txid index, %zu transactions in %zu blocks ===\n", txids.size(), BlockCount);
+
+    Clock::time_point start = Clock::now();
+    {
+        TxIndex index(path);
+        index.open(chain);
+        index.waitForBuild();
+        std::printf("  build            %8.3f s   %6.1f MB mapped\n", elapsedSeconds(start),
+                    index.mappedBytes() / 1e6);
+    }
+
+    TxIndex index(path);
+    start = Clock::now();
+    index.open(chain);
+    index.waitForBuild();
+    std::printf("  reopen           %8.3f ms\n", elapsedSeconds(start) * 1e3);
+
+    const size_t lookups = 200000;
+    std::mt19937_64 random(1);
+    size_t found = 0;
+    TxLocation location;
+    start = Clock::now();
+    for (size_t i = 0; i < lookups; ++i) {
+        found += index.find(txids[random() % txids.size()], location);
+    }
+    std::printf("  find             %8.3f us/lookup   %zu of %zu found\n",
+                elapsedSeconds(start) * 1e6 / lookups, found, lookups);
+
+    const size_t scans = 20;
+    start = Clock::now();
+    for (size_t i = 0; i < scans; ++i) {
+        const TXID& wanted = txids[random() % txids.size()];
+        bool hit = false;
+        for (uint64_t height = 0; height <= chain.getHeight() && !hit; ++height) {
+            for (const auto& tx : chain.getBlock(height).getTransactions()) {
+                if (tx.getTxid() == wanted) {
+                    hit = true;
+                    break;
+                }
+            }
+        }
+        found += hit;
+    }
+    std::printf("  scan of blocks   %8.3f us/lookup\n", elapsedSeconds(start) * 1e6 / scans);
+    sink = found;
+    index.close();
+    std::filesystem::remove(path);
+    return 0;
+}
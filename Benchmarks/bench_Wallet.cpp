@@ -0,0 +1,108 @@
+#include "Wallet.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+// Coin selection in a wallet holding 100000 outputs of 1 to 100000 coins
+//  1. Scan: the outputs of the key collected from the UTXO set, sorted and
+//     taken largest first, as a wallet without an index would do.
+//  2. Wallet::selectCoins(): branch and bound on the ordered outputs, with the
+//     smallest covering output as fallback.
+//  3. Wallet::createTransaction(): selection, then one signature per input.
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedSeconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static const int TxCount = 100;
+static const int OutputsPerTx = 1000;
+static const int Selections = 1000;
+
+// Prevents the compiler from dropping results
+static std::atomic<uint64_t> sink(0);
+
+static uint64_t selectByScan(const Blockchain& chain, const std::string& owner, uint64_t amount) {
+    std::vector<uint64_t> amounts;
+    chain.getUTXOSet().forEach([&](const OutPoint&, const TxOut& output) {
+        if (output.publicKeyHash == owner) {
+            amounts.push_back(output.amount);
+        }
+    });
+    std::sort(amounts.rbegin(), amounts.rend());
+    uint64_t total = 0;
+    size_t count = 0;
+    while (total < amount && count < amounts.size()) {
+        total += amounts[count++];
+    }
+    return count;
+}
+
+int main() {
+    Blockchain chain;
+    Wallet wallet(chain);
+    const std::string owner = wallet.generateKey()->publicKeyHash;
+
+    std::mt19937_64 random(42);
+    std::uniform_int_distribution<uint64_t> amountOf(1, 100000);
+    std::vector<Transaction> txs;
+    for (int t = 0; t < TxCount; ++t) {
+        std::vector<TxOut> outputs;
+        for (int o = 0; o < OutputsPerTx; ++o) {
+            outputs.emplace_back(amountOf(random), owner);
+        }
+        txs.emplace_back(std::vector<TxIn>{TxIn(std::string(64, '0'), 0, "coinbase_" + std::to_string(t), "")},
+                         std::move(outputs), t);
+    }
+    Block block(txs, chain.getLatestBlock().getHash());
+    block.setHeader(BlockHeader(1, chain.getLatestBlock().getHash(), "", 0, 0, 1));
+    block.computeMerkleRoot();
+    block.mine();
+    chain.addBlock(block);
+
+    std::printf("=== Coin selection, %zu outputs, balance %llu ===\n", wallet.coinCount(),
+                static_cast<unsigned long long>(wallet.getBalance()));
+    std::vector<uint64_t> targets;
+    std::uniform_int_distribution<uint64_t> targetOf(1, 1000000);
+    for (int i = 0; i < Selections; ++i) {
+        targets.push_back(targetOf(random));
+    }
+
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < Selections / 10; ++i) {
+        sink += selectByScan(chain, owner, targets[i]);
+    }
+    std::printf("  %-20s %10.1f us per selection\n", "scan and sort", elapsedSeconds(start) * 1e6 / (Selections / 10));
+
+    std::vector<Wallet::Coin> coins;
+    size_t changeless = 0;
+    size_t inputs = 0;
+    start = Clock::now();
+    for (uint64_t target : targets) {
+        wallet.selectCoins(target, coins);
+        uint64_t total = 0;
+        for (const Wallet::Coin& coin : coins) {
+            total += coin.amount;
+        }
+        changeless += total == target;
+        inputs += coins.size();
+    }
+    std::printf("  %-20s %10.1f us per selection (%zu%% without change, %.1f inputs)\n", "selectCoins()",
+                elapsedSeconds(start) * 1e6 / Selections, changeless * 100 / Selections,
+                static_cast<double>(inputs) / Selections);
+
+    Transaction tx;
+    start = Clock::now();
+    for (int i = 0; i < Selections / 10; ++i) {
+        wallet.createTransaction(std::string(64, 'b'), targets[i], tx);
+        sink += tx.getInputs().size();
+    }
+    std::printf("  %-20s %10.1f us per transaction\n", "createTransaction()",
+                elapsedSeconds(start) * 1e6 / (Selections / 10));
+    return 0;
+}
@@ -0,0 +1,725 @@
+#include "AddressIndex.h"
+#include "Checksum.h"
+#include "Encoding.h"
+#include "Hex.h"
+#include "MemoryUsage.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+
+namespace {
+
+// File header: identifies the format
+const char Magic[8] = {'A', 'D', 'D', 'R', 'I', 'D', 'X', '2'};
+
+// Record header: payload length, CRC-32 of the payload
+const size_t RecordHeaderSize = 8;
+
+// The log is read in chunks of this size
+const size_t ReadChunkSize = 4 * 1024 * 1024;
+
+// Pages of an address hold 1, 2, 4 ... entries for the first SmallPages,
+// then PageEntries each
+const size_t SmallPages = 6;
+const uint32_t PageEntries = 64;
+
+// A history takes at most this share of the cache, so that one long
+// history doesn't push every other address out
+const size_t MaxCacheShare = 8;
+
+uint32_t pageCapacity(size_t page)
+{
+    return page < SmallPages ? 1u << page : PageEntries;
+}
+
+// Position in the history of the first entry of page
+uint64_t pageStart(size_t page)
+{
+    return page < SmallPages ? (1u << page) - 1
+                             : PageEntries - 1 + static_cast<uint64_t>(page - SmallPages) * PageEntries;
+}
+
+size_t pageOf(uint64_t position)
+{
+    if (position >= pageStart(SmallPages)) {
+        return SmallPages + static_cast<size_t>((position - pageStart(SmallPages)) / PageEntries);
+    }
+    size_t page = 0;
+    while (pageStart(page + 1) <= position) {
+        ++page;
+    }
+    return page;
+}
+
+// The entries file outgrows the range of long on some platforms
+bool seekTo(std::FILE* file, uint64_t offset)
+{
+#ifdef _WIN32
+    return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+    return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+// Txids are SHA-256 digests in hex, stored as their 32 bytes
+void packTxid(const TXID& txid, unsigned char* out)
+{
+    if (txid.size() != 64 || !hexDecode(txid.data(), 32, out)) {
+        std::memset(out, 0, 32);
+    }
+}
+
+void writeTxid(ByteWriter& writer, const TXID& txid)
+{
+    unsigned char packed[32];
+    packTxid(txid, packed);
+    for (unsigned char byte : packed) {
+        writer.writeU8(byte);
+    }
+}
+
+bool readTxid(ByteReader& reader, TXID& txid)
+{
+    unsigned char packed[32];
+    for (unsigned char& byte : packed) {
+        uint8_t value;
+        if (!reader.readU8(value)) {
+            return false;
+        }
+        byte = value;
+    }
+    txid = toHex(packed, sizeof(packed));
+    return true;
+}
+
+}
+
+const size_t AddressIndex::DefaultCacheBytes;
+
+AddressIndex::AddressIndex(const std::string& path, size_t cacheBytes)
+    : _path(path),
+      _chain(nullptr),
+      _file(nullptr),
+      _loadedBlocks(0),
+      _entries(nullptr),
+      _entryEnd(0),
+      _directoryMemory(0),
+      _cacheLimit(cacheBytes),
+      _cacheBytes(0)
+{
+}
+
+AddressIndex::~AddressIndex()
+{
+    close();
+}
+
+// -----------------------------------------------------------------------------
+//  open()
+//  Blocks connected while the index was closed are indexed from the chain
+//  with their undo data, as if they had just been connected.
+// -----------------------------------------------------------------------------
+bool AddressIndex::open(Blockchain& chain)
+{
+    if (_chain) {
+        return false;
+    }
+    _recordOffsets.clear();
+    _loadedBlocks = 0;
+
+    if (!openEntries()) {
+        return false;
+    }
+    if (_path.empty()) {
+        _file = std::tmpfile();
+        if (!_file || std::fwrite(Magic, 1, sizeof(Magic), _file) != sizeof(Magic)) {
+            std::cerr << "Error: can't create a temporary address index\n";
+            closeFiles();
+            return false;
+        }
+    } else if (!load(chain)) {
+        closeFiles();
+        return false;
+    }
+
+    _chain = &chain;
+    for (uint64_t height = _recordOffsets.size(); height <= chain.getHeight(); ++height) {
+        blockConnected(chain.getBlock(height), chain.getBlockUndo(height), height);
+    }
+    chain.addListener(this);
+    return true;
+}
+
+void AddressIndex::close()
+{
+    if (!_chain) {
+        return;
+    }
+    _chain->removeListener(this);
+    _chain = nullptr;
+    closeFiles();
+}
+
+// The entries are rebuilt by every open(): the file is created empty
+bool AddressIndex::openEntries()
+{
+    _entries = _path.empty() ? std::tmpfile() : std::fopen((_path + ".entries").c_str(), "w+b");
+    if (!_entries) {
+        std::cerr << "Error: can't create address index entries " << _path << ".entries\n";
+        return false;
+    }
+    return true;
+}
+
+void AddressIndex::closeFiles()
+{
+    if (_file) {
+        std::fclose(_file);
+        _file = nullptr;
+    }
+    if (_entries) {
+        std::fclose(_entries);
+        _entries = nullptr;
+        if (!_path.empty()) {
+            std::error_code error;
+            std::filesystem::remove(_path + ".entries", error);
+        }
+    }
+    _entryEnd = 0;
+    _addresses.clear();
+    _directoryMemory = 0;
+    _unspent.clear();
+    _cache.clear();
+    _cacheBytes = 0;
+}
+
+// -----------------------------------------------------------------------------
+//  load()
+//  Records are kept while they follow each other from height 0 and match the
+//  active chain; the rest of the file, stale or torn, is cut off.
+// -----------------------------------------------------------------------------
+bool AddressIndex::load(Blockchain& chain)
+{
+    std::error_code error;
+    const bool exists = std::filesystem::exists(_path, error);
+    _file = std::fopen(_path.c_str(), exists ? "r+b" : "w+b");
+    if (!_file) {
+        std::cerr << "Error: can't open address index " << _path << "\n";
+        return false;
+    }
+
+    char magic[sizeof(Magic)];
+    const size_t magicSize = std::fread(magic, 1, sizeof(magic), _file);
+    if (magicSize == 0) {
+        std::fseek(_file, 0, SEEK_SET);
+        if (std::fwrite(Magic, 1, sizeof(Magic), _file) != sizeof(Magic) || std::fflush(_file) != 0) {
+            std::cerr << "Error: can't write address index " << _path << "\n";
+            std::fclose(_file);
+            _file = nullptr;
+            return false;
+        }
+        return true;
+    }
+    if (magicSize != sizeof(Magic) || !std::equal(magic, magic + sizeof(magic), Magic)) {
+        std::cerr << "Error: " << _path << " is not an address index\n";
+        std::fclose(_file);
+        _file = nullptr;
+        return false;
+    }
+
+    uint64_t validEnd = sizeof(Magic);
+    std::string buffer;
+    size_t offset = 0;
+    bool valid = true;
+    std::vector<char> chunk(ReadChunkSize);
+    size_t read;
+    while (valid && (read = std::fread(chunk.data(), 1, chunk.size(), _file)) > 0) {
+        buffer.erase(0, offset);
+        offset = 0;
+        buffer.append(chunk.data(), read);
+
+        while (buffer.size() - offset >= RecordHeaderSize) {
+            ByteReader header(buffer.data() + offset, RecordHeaderSize);
+            uint32_t length, crc;
+            header.readU32(length);
+            header.readU32(crc);
+            if (buffer.size() - offset - RecordHeaderSize < length) {
+                break;
+            }
+
+            const char* payload = buffer.data() + offset + RecordHeaderSize;
+            ByteReader reader(payload, length);
+            BlockRecord record;
+            const uint64_t height = _recordOffsets.size();
+            if (crc32(payload, length) != crc || !decodeRecord(reader, record) ||
+                record.height != height || height > chain.getHeight() ||
+                record.hash != chain.getBlock(height).getHash()) {
+                valid = false;
+                break;
+            }
+            apply(record);
+            _recordOffsets.push_back(validEnd);
+            offset += RecordHeaderSize + length;
+            validEnd += RecordHeaderSize + length;
+        }
+    }
+    _loadedBlocks = _recordOffsets.size();
+
+    std::fflush(_file);
+    std::filesystem::resize_file(_path, validEnd, error);
+    if (error) {
+        std::cerr << "Error: can't truncate address index " << _path << "\n";
+        std::fclose(_file);
+        _file = nullptr;
+        return false;
+    }
+    std::fseek(_file, 0, SEEK_END);
+    return true;
+}
+
+std::vector<AddressOutput> AddressIndex::getHistory(const std::string& publicKeyHash) const
+{
+    return getHistory(publicKeyHash, 0, SIZE_MAX);
+}
+
+// -----------------------------------------------------------------------------
+//  getHistory()
+//  A history small enough for the cache is read whole and cached; a longer
+//  one is read from the file, only the pages asked for.
+// -----------------------------------------------------------------------------
+std::vector<AddressOutput> AddressIndex::getHistory(const std::string& publicKeyHash,
+                                                    uint64_t first, size_t count) const
+{
+    std::vector<AddressOutput> history;
+    auto it = _addresses.find(publicKeyHash);
+    if (it == _addresses.end() || first >= it->second.count) {
+        return history;
+    }
+    const Address& address = it->second;
+    const size_t size = static_cast<size_t>(std::min<uint64_t>(count, address.count - first));
+
+    std::vector<Entry> read;
+    if (address.cached != _cache.end()) {
+        _cache.splice(_cache.begin(), _cache, address.cached);
+    } else if (mallocUsage(address.count * sizeof(Entry)) <= _cacheLimit / MaxCacheShare) {
+        read.resize(address.count);
+        if (!readEntries(address, 0, address.count, read.data())) {
+            return history;
+        }
+        cacheHistory(address, std::move(read));
+    } else {
+        read.resize(size);
+        if (!readEntries(address, static_cast<uint32_t>(first), size, read.data())) {
+            return history;
+        }
+    }
+    const Entry* entries = address.cached != _cache.end() ? address.cached->second.data() + first
+                                                          : read.data();
+
+    history.resize(size);
+    for (size_t i = 0; i < size; ++i) {
+        const Entry& entry = entries[i];
+        AddressOutput& output = history[i];
+        output.outPoint = OutPoint(toHex(entry.txid, sizeof(entry.txid)), entry.index);
+        output.amount = entry.amount;
+        output.height = entry.height;
+        if (entry.spentHeight != NotSpent) {
+            output.spentBy = toHex(entry.spentBy, sizeof(entry.spentBy));
+            output.spentInput = entry.spentInput;
+            output.spentHeight = entry.spentHeight;
+        }
+    }
+    return history;
+}
+
+size_t AddressIndex::outputCount(const std::string& publicKeyHash) const
+{
+    auto it = _addresses.find(publicKeyHash);
+    return it == _addresses.end() ? 0 : it->second.count;
+}
+
+size_t AddressIndex::memoryUsage() const
+{
+    return _directoryMemory + dynamicUsage(_addresses) + dynamicUsage(_unspent) + _cacheBytes +
+           dynamicUsage(_recordOffsets);
+}
+
+// -----------------------------------------------------------------------------
+//  makeRecord()
+//  The undo data lists the spent outputs, with their publicKeyHash, in the
+//  order of the inputs that spent them, coinbase inputs excluded.
+// -----------------------------------------------------------------------------
+AddressIndex::BlockRecord AddressIndex::makeRecord(const Block& block, const BlockUndo& undo,
+                                                   uint64_t height)
+{
+    BlockRecord record;
+    record.height = height;
+    record.hash = block.getHash();
+
+    size_t spent = 0;
+    for (const auto& tx : block.getTransactions()) {
+        const std::vector<TxIn>& inputs = tx.getInputs();
+        for (uint32_t i = 0; i < inputs.size(); ++i) {
+            if (inputs[i].isCoinbase() || spent >= undo.spentOutputs.size()) {
+                continue;
+            }
+            const auto& output = undo.spentOutputs[spent++];
+            record.spends.push_back({output.second.publicKeyHash, output.first, tx.getTxid(), i, 0});
+        }
+        const std::vector<TxOut>& outputs = tx.getOutputs();
+        for (uint32_t i = 0; i < outputs.size(); ++i) {
+            record.fundings.push_back({outputs[i].publicKeyHash, tx.getTxid(), i, outputs[i].amount});
+        }
+    }
+    return record;
+}
+
+void AddressIndex::encodeRecord(const BlockRecord& record, std::string& output)
+{
+    ByteWriter writer(output);
+    writer.writeVarInt(record.height);
+    writer.writeString(record.hash);
+    writer.writeVarInt(record.fundings.size());
+    for (const auto& funding : record.fundings) {
+        writer.writeString(funding.publicKeyHash);
+        writeTxid(writer, funding.txid);
+        writer.writeVarInt(funding.index);
+        writer.writeVarInt(funding.amount);
+    }
+    writer.writeVarInt(record.spends.size());
+    for (const auto& spend : record.spends) {
+        writer.writeString(spend.publicKeyHash);
+        writeTxid(writer, spend.outPoint.txid);
+        writer.writeVarInt(spend.outPoint.index);
+        writeTxid(writer, spend.spentBy);
+        writer.writeVarInt(spend.spentInput);
+        writer.writeVarInt(spend.position);
+    }
+}
+
+bool AddressIndex::decodeRecord(ByteReader& reader, BlockRecord& record)
+{
+    uint64_t count;
+    if (!reader.readVarInt(record.height) || !reader.readString(record.hash) ||
+        !reader.readVarInt(count) || count > reader.remaining()) {
+        return false;
+    }
+    record.fundings.resize(static_cast<size_t>(count));
+    for (auto& funding : record.fundings) {
+        uint64_t index;
+        if (!reader.readString(funding.publicKeyHash) || !readTxid(reader, funding.txid) ||
+            !reader.readVarInt(index) || !reader.readVarInt(funding.amount)) {
+            return false;
+        }
+        funding.index = static_cast<uint32_t>(index);
+    }
+
+    if (!reader.readVarInt(count) || count > reader.remaining()) {
+        return false;
+    }
+    record.spends.resize(static_cast<size_t>(count), {std::string(), OutPoint("", 0), TXID(), 0, 0});
+    for (auto& spend : record.spends) {
+        uint64_t index, input, position;
+        if (!reader.readString(spend.publicKeyHash) || !readTxid(reader, spend.outPoint.txid) ||
+            !reader.readVarInt(index) || !readTxid(reader, spend.spentBy) ||
+            !reader.readVarInt(input) || !reader.readVarInt(position)) {
+            return false;
+        }
+        spend.outPoint.index = static_cast<uint32_t>(index);
+        spend.spentInput = static_cast<uint32_t>(input);
+        spend.position = static_cast<uint32_t>(position);
+    }
+    return reader.atEnd();
+}
+
+AddressIndex::OutPointKey AddressIndex::keyOf(const OutPoint& outPoint)
+{
+    OutPointKey key;
+    packTxid(outPoint.txid, key.txid);
+    key.index = outPoint.index;
+    return key;
+}
+
+// -----------------------------------------------------------------------------
+//  apply()
+//  Outputs are added before the spends are recorded, so that spends of
+//  outputs created in the same block find their entry. A txid repeated by a
+//  later transaction hides the earlier output, as in the UTXO set.
+// -----------------------------------------------------------------------------
+void AddressIndex::apply(BlockRecord& record)
+{
+    for (const auto& funding : record.fundings) {
+        Entry entry;
+        packTxid(funding.txid, entry.txid);
+        entry.amount = funding.amount;
+        entry.index = funding.index;
+        entry.height = static_cast<uint32_t>(record.height);
+        std::memset(entry.spentBy, 0, sizeof(entry.spentBy));
+        entry.spentInput = 0;
+        entry.spentHeight = NotSpent;
+
+        auto inserted = _addresses.try_emplace(funding.publicKeyHash);
+        Address& address = inserted.first->second;
+        if (inserted.second) {
+            address.count = 0;
+            address.cached = _cache.end();
+            _directoryMemory += dynamicUsage(inserted.first->first);
+        }
+        if (address.count == pageStart(address.pages.size())) {
+            _directoryMemory -= dynamicUsage(address.pages);
+            address.pages.push_back(_entryEnd);
+            _directoryMemory += dynamicUsage(address.pages);
+            _entryEnd += pageCapacity(address.pages.size() - 1);
+        }
+        OutPointKey key;
+        std::memcpy(key.txid, entry.txid, sizeof(key.txid));
+        key.index = entry.index;
+        _unspent[key] = address.count;
+        storeEntry(address, address.count, entry, 0);
+        ++address.count;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < record.spends.size(); ++i) {
+        Spend& spend = record.spends[i];
+        auto it = _unspent.find(keyOf(spend.outPoint));
+        auto address = _addresses.find(spend.publicKeyHash);
+        if (it == _unspent.end() || address == _addresses.end() ||
+            it->second >= address->second.count) {
+            continue;
+        }
+        Entry entry;
+        packTxid(spend.spentBy, entry.spentBy);
+        entry.spentInput = spend.spentInput;
+        entry.spentHeight = static_cast<uint32_t>(record.height);
+        storeEntry(address->second, it->second, entry, offsetof(Entry, spentBy));
+        spend.position = it->second;
+        _unspent.erase(it);
+        if (kept != i) {
+            record.spends[kept] = std::move(spend);
+        }
+        ++kept;
+    }
+    record.spends.resize(kept, {std::string(), OutPoint("", 0), TXID(), 0, 0});
+}
+
+// -----------------------------------------------------------------------------
+//  storeEntry()
+//  The cached history follows the file: an entry past its end is appended.
+// -----------------------------------------------------------------------------
+bool AddressIndex::storeEntry(Address& address, uint32_t position, const Entry& entry, size_t from)
+{
+    const size_t page = pageOf(position);
+    const uint64_t slot = address.pages[page] + (position - pageStart(page));
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&entry) + from;
+    const size_t size = sizeof(Entry) - from;
+    const bool written = seekTo(_entries, slot * sizeof(Entry) + from) &&
+                         std::fwrite(bytes, 1, size, _entries) == size;
+    if (!written) {
+        std::cerr << "Error: can't write address index entries " << _path << ".entries\n";
+    }
+
+    if (address.cached != _cache.end()) {
+        std::vector<Entry>& history = address.cached->second;
+        if (position < history.size()) {
+            std::memcpy(reinterpret_cast<unsigned char*>(&history[position]) + from, bytes, size);
+        } else {
+            _cacheBytes -= dynamicUsage(history);
+            history.push_back(entry);
+            _cacheBytes += dynamicUsage(history);
+            if (dynamicUsage(history) > _cacheLimit / MaxCacheShare) {
+                evict(address.cached);
+            }
+            while (_cacheBytes > _cacheLimit) {
+                evict(std::prev(_cache.end()));
+            }
+        }
+    }
+    return written;
+}
+
+bool AddressIndex::readEntries(const Address& address, uint32_t position, size_t count,
+                               Entry* entries) const
+{
+    while (count > 0) {
+        const size_t page = pageOf(position);
+        const uint64_t slot = position - pageStart(page);
+        const size_t run = static_cast<size_t>(std::min<uint64_t>(count, pageCapacity(page) - slot));
+        if (!seekTo(_entries, (address.pages[page] + slot) * sizeof(Entry)) ||
+            std::fread(entries, sizeof(Entry), run, _entries) != run) {
+            std::cerr << "Error: can't read address index entries " << _path << ".entries\n";
+            return false;
+        }
+        position += static_cast<uint32_t>(run);
+        entries += run;
+        count -= run;
+    }
+    return true;
+}
+
+// Cache nodes are counted as in dynamicUsage() of a list
+void AddressIndex::cacheHistory(const Address& address, std::vector<Entry>&& history) const
+{
+    _cache.emplace_front(&address, std::move(history));
+    address.cached = _cache.begin();
+    _cacheBytes += mallocUsage(2 * sizeof(void*) + sizeof(Cache::value_type)) +
+                   dynamicUsage(_cache.front().second);
+    while (_cacheBytes > _cacheLimit) {
+        evict(std::prev(_cache.end()));
+    }
+}
+
+void AddressIndex::evict(Cache::iterator slot) const
+{
+    slot->first->cached = _cache.end();
+    _cacheBytes -= mallocUsage(2 * sizeof(void*) + sizeof(Cache::value_type)) +
+                   dynamicUsage(slot->second);
+    _cache.erase(slot);
+}
+
+bool AddressIndex::appendRecord(const BlockRecord& record)
+{
+    std::string payload;
+    encodeRecord(record, payload);
+    std::string data;
+    ByteWriter writer(data);
+    writer.writeU32(static_cast<uint32_t>(payload.size()));
+    writer.writeU32(crc32(payload.data(), payload.size()));
+    data.append(payload);
+
+    // The index can be rebuilt from the chain, so records are flushed but
+    // not synced; a torn record is cut off on the next open()
+    if (std::fwrite(data.data(), 1, data.size(), _file) != data.size() || std::fflush(_file) != 0) {
+        std::cerr << "Error: can't write address index " << _path << "\n";
+        return false;
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+//  readLastRecord()
+//  The log ends with the record of the last block indexed, at the last
+//  offset kept; the file is left positioned for the next append.
+// -----------------------------------------------------------------------------
+bool AddressIndex::readLastRecord(BlockRecord& record)
+{
+    if (!_file || _recordOffsets.empty()) {
+        return false;
+    }
+    const long end = std::ftell(_file);
+    char header[RecordHeaderSize];
+    std::string payload;
+    bool read = std::fseek(_file, static_cast<long>(_recordOffsets.back()), SEEK_SET) == 0 &&
+                std::fread(header, 1, sizeof(header), _file) == sizeof(header);
+    uint32_t length = 0, crc = 0;
+    if (read) {
+        ByteReader reader(header, sizeof(header));
+        reader.readU32(length);
+        reader.readU32(crc);
+        read = static_cast<uint64_t>(end) == _recordOffsets.back() + RecordHeaderSize + length;
+    }
+    if (read) {
+        payload.resize(length);
+        read = std::fread(&payload[0], 1, length, _file) == length;
+    }
+    std::fseek(_file, end, SEEK_SET);
+
+    ByteReader reader(payload);
+    return read && crc32(payload.data(), payload.size()) == crc && decodeRecord(reader, record);
+}
+
+void AddressIndex::blockConnected(const Block& block, const BlockUndo& undo, uint64_t height)
+{
+    if (!_entries) {
+        return;
+    }
+    BlockRecord record = makeRecord(block, undo, height);
+    apply(record);
+    uint64_t offset = 0;
+    if (_file) {
+        offset = static_cast<uint64_t>(std::ftell(_file));
+        appendRecord(record);
+    }
+    _recordOffsets.push_back(offset);
+}
+
+// -----------------------------------------------------------------------------
+//  blockDisconnected()
+//  The block is the last one indexed: its entries are the last of each
+//  history and its record, with the positions of its spends, the last of
+//  the log. Spends are undone first, so that outputs created and spent in
+//  the block are unspent before they are removed.
+// -----------------------------------------------------------------------------
+void AddressIndex::blockDisconnected(const Block& block, const BlockUndo&, uint64_t height)
+{
+    if (height + 1 != _recordOffsets.size()) {
+        return;
+    }
+    BlockRecord record;
+    if (!readLastRecord(record) || record.height != height || record.hash != block.getHash()) {
+        std::cerr << "Error: can't read address index " << _path << "\n";
+        return;
+    }
+
+    for (size_t i = record.spends.size(); i > 0; --i) {
+        const Spend& spend = record.spends[i - 1];
+        auto it = _addresses.find(spend.publicKeyHash);
+        if (it == _addresses.end() || spend.position >= it->second.count) {
+            continue;
+        }
+        Entry entry;
+        std::memset(entry.spentBy, 0, sizeof(entry.spentBy));
+        entry.spentInput = 0;
+        entry.spentHeight = NotSpent;
+        storeEntry(it->second, spend.position, entry, offsetof(Entry, spentBy));
+        _unspent[keyOf(spend.outPoint)] = spend.position;
+    }
+
+    // Pages are freed in the reverse order of their allocation, so each one
+    // freed ends the file
+    for (size_t i = record.fundings.size(); i > 0; --i) {
+        const Funding& funding = record.fundings[i - 1];
+        auto it = _addresses.find(funding.publicKeyHash);
+        if (it == _addresses.end()) {
+            continue;
+        }
+        Address& address = it->second;
+        const uint32_t position = address.count - 1;
+        auto unspent = _unspent.find(keyOf(OutPoint(funding.txid, funding.index)));
+        if (unspent != _unspent.end() && unspent->second == position) {
+            _unspent.erase(unspent);
+        }
+        --address.count;
+        if (address.cached != _cache.end()) {
+            address.cached->second.pop_back();
+        }
+        if (address.count == pageStart(address.pages.size() - 1)) {
+            if (address.pages.back() + pageCapacity(address.pages.size() - 1) == _entryEnd) {
+                _entryEnd = address.pages.back();
+            }
+            address.pages.pop_back();
+        }
+        if (address.count == 0) {
+            if (address.cached != _cache.end()) {
+                evict(address.cached);
+            }
+            _directoryMemory -= dynamicUsage(it->first) + dynamicUsage(address.pages);
+            _addresses.erase(it);
+        }
+    }
+
+    // A temporary log is not cut: the next record overwrites this one
+    std::fflush(_file);
+    if (!_path.empty()) {
+        std::error_code error;
+        std::filesystem::resize_file(_path, _recordOffsets.back(), error);
+        if (error) {
+            std::cerr << "Error: can't truncate address index " << _path << "\n";
+        }
+    }
+    std::fseek(_file, static_cast<long>(_recordOffsets.back()), SEEK_SET);
+    _recordOffsets.pop_back();
+}
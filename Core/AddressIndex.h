@@ -0,0 +1,256 @@
+#ifndef ADDRESSINDEX_H
+#define ADDRESSINDEX_H
+
+#include "Blockchain.h"
+#include <cstdio>
+#include <cstring>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @file AddressIndex.h
+ * @brief Definition of the AddressIndex class, the history of each address.
+ * @details For every publicKeyHash the index lists the outputs paid to it on
+ *          the active chain and, for each one, the input that spent it. It is
+ *          an optional ChainListener: connected blocks append to the history
+ *          of their addresses and disconnected blocks remove what they added.
+ *          Entries are 88-byte records with binary txids, stored on disk in
+ *          an entries file. Each address owns pages of that file, of 1, 2,
+ *          4 and up to 32 entries, then of 64, so an address paid once
+ *          wastes no room and a long history is read a page at a time.
+ *          Memory holds, by address, the offsets of its pages, and a cache
+ *          of the histories read last, bounded in bytes; a lookup costs one
+ *          hash probe plus, outside the cache, one read per page.
+ *          A spend finds the entry of its output through a table of the
+ *          unspent outputs, which gives the position of the entry in the
+ *          history of its address; the position is logged with the spend.
+ *          The index is also written to disk as a log of one compact record
+ *          per connected block. A disconnected block is always the last one
+ *          logged: its record is read back for the positions of its spends,
+ *          then cut off the end of the file. On restart the log is replayed
+ *          into a new entries file and only blocks connected since are
+ *          indexed from the chain, instead of walking every block.
+ *          The index is not thread-safe, lookups included, as they fill the
+ *          cache.
+ */
+
+// Output paid to an address, and the input that spent it if any
+struct AddressOutput {
+    OutPoint outPoint;
+    uint64_t amount;
+    uint64_t height;
+    // Spending transaction and input, empty while unspent
+    TXID spentBy;
+    uint32_t spentInput;
+    uint64_t spentHeight;
+
+    AddressOutput() : outPoint("", 0), amount(0), height(0), spentInput(0), spentHeight(0) {}
+
+    bool isSpent() const { return !spentBy.empty(); }
+};
+
+class AddressIndex : public ChainListener {
+public:
+
+    static const size_t DefaultCacheBytes = 64 * 1024 * 1024;
+
+    /**
+     * Creates an index logged to path, with its entries in path.entries, or
+     * in temporary files if path is empty. Histories read are cached up to
+     * cacheBytes.
+     */
+    explicit AddressIndex(const std::string& path = std::string(),
+                          size_t cacheBytes = DefaultCacheBytes);
+
+    ~AddressIndex() override;
+
+    AddressIndex(const AddressIndex&) = delete;
+    AddressIndex& operator=(const AddressIndex&) = delete;
+
+    /**
+     * Loads the log, drops the blocks no longer on the active chain, indexes
+     * the blocks connected since, and starts following chain, which must
+     * outlive the index or call close() first.
+     * Returns false if the log or the entries can't be read or written.
+     */
+    bool open(Blockchain& chain);
+
+    /**
+     * Stops following the chain, closes the log and removes the entries;
+     * the index is empty until the next open().
+     */
+    void close();
+
+    /**
+     * Outputs paid to publicKeyHash, oldest first.
+     */
+    std::vector<AddressOutput> getHistory(const std::string& publicKeyHash) const;
+
+    /**
+     * Outputs paid to publicKeyHash from the first-th oldest, at most count
+     * of them, so a long history can be read a page at a time.
+     */
+    std::vector<AddressOutput> getHistory(const std::string& publicKeyHash, uint64_t first,
+                                          size_t count) const;
+
+    /**
+     * Number of outputs paid to publicKeyHash.
+     */
+    size_t outputCount(const std::string& publicKeyHash) const;
+
+    /**
+     * Number of addresses that received at least one output.
+     */
+    size_t addressCount() const { return _addresses.size(); }
+
+    /**
+     * Heap bytes held by the page offsets and their table, the table of the
+     * unspent outputs and the cache, counted from container capacities (see
+     * MemoryUsage.h) and kept up to date as blocks are indexed.
+     */
+    size_t memoryUsage() const;
+
+    /**
+     * Heap bytes held by the cache, at most the cacheBytes given.
+     */
+    size_t cacheUsage() const { return _cacheBytes; }
+
+    /**
+     * Bytes of the entries file in use.
+     */
+    uint64_t entryBytes() const { return _entryEnd * sizeof(Entry); }
+
+    /**
+     * Number of blocks read from the log by the last open().
+     */
+    uint64_t loadedBlocks() const { return _loadedBlocks; }
+
+    // ChainListener
+    void blockConnected(const Block& block, const BlockUndo& undo, uint64_t height) override;
+    void blockDisconnected(const Block& block, const BlockUndo& undo, uint64_t height) override;
+
+private:
+    typedef unsigned char PackedTxid[32];
+
+    // One output of an address, as stored in the entries file, in host byte
+    // order since every open() writes the file anew. The fields a spend sets
+    // come last, so a spend writes one run of bytes.
+    struct Entry {
+        PackedTxid txid;
+        uint64_t amount;
+        uint32_t index;
+        uint32_t height;
+        PackedTxid spentBy;
+        uint32_t spentInput;
+        // NotSpent while unspent
+        uint32_t spentHeight;
+    };
+    static_assert(sizeof(Entry) == 88, "Entry layout changed");
+
+    struct Address;
+    // Histories of the addresses read last, most recent first
+    typedef std::list<std::pair<const Address*, std::vector<Entry>>> Cache;
+
+    struct Address {
+        uint32_t count;
+        // Offset of each page in the entries file, in entries
+        std::vector<uint64_t> pages;
+        // Place in the cache, or the end of the cache
+        mutable Cache::iterator cached;
+    };
+
+    // Additions of one block, as logged
+    struct Funding {
+        std::string publicKeyHash;
+        TXID txid;
+        uint32_t index;
+        uint64_t amount;
+    };
+    struct Spend {
+        std::string publicKeyHash;
+        OutPoint outPoint;
+        TXID spentBy;
+        uint32_t spentInput;
+        // Position of the spent output in the history of publicKeyHash
+        uint32_t position;
+    };
+    struct BlockRecord {
+        uint64_t height;
+        std::string hash;
+        std::vector<Funding> fundings;
+        std::vector<Spend> spends;
+    };
+
+    // Outpoint with a binary txid, the key of the unspent outputs
+    struct OutPointKey {
+        PackedTxid txid;
+        uint32_t index;
+
+        bool operator==(const OutPointKey& other) const {
+            return index == other.index && std::memcmp(txid, other.txid, sizeof(txid)) == 0;
+        }
+    };
+    // Txids are hashes already: their first bytes are spread enough
+    struct OutPointKeyHash {
+        size_t operator()(const OutPointKey& key) const {
+            uint64_t prefix;
+            std::memcpy(&prefix, key.txid, sizeof(prefix));
+            return static_cast<size_t>(prefix ^ (key.index * 0x9e3779b97f4a7c15ULL));
+        }
+    };
+
+    static const uint32_t NotSpent = 0xffffffff;
+
+    static BlockRecord makeRecord(const Block& block, const BlockUndo& undo, uint64_t height);
+    static void encodeRecord(const BlockRecord& record, std::string& output);
+    static bool decodeRecord(ByteReader& reader, BlockRecord& record);
+
+    static OutPointKey keyOf(const OutPoint& outPoint);
+
+    // Adds the fundings and spends of record, and sets the position of its
+    // spends; spends of outputs that are not indexed are dropped
+    void apply(BlockRecord& record);
+
+    // Writes the bytes of entry from offset `from` on, at position in the
+    // history of address, to the file and the cache
+    bool storeEntry(Address& address, uint32_t position, const Entry& entry, size_t from);
+    // Reads count entries of address from position; they must exist
+    bool readEntries(const Address& address, uint32_t position, size_t count, Entry* entries) const;
+    // Puts the history of address at the front of the cache
+    void cacheHistory(const Address& address, std::vector<Entry>&& history) const;
+    void evict(Cache::iterator slot) const;
+
+    // Reads the log; keeps the records of blocks still on the active chain
+    bool load(Blockchain& chain);
+    bool appendRecord(const BlockRecord& record);
+    // Reads back the last record of the log
+    bool readLastRecord(BlockRecord& record);
+    bool openEntries();
+    void closeFiles();
+
+    std::string _path;
+    Blockchain* _chain;
+    std::FILE* _file;
+    // Offsets in the log of the record of each indexed block, by height
+    std::vector<uint64_t> _recordOffsets;
+    uint64_t _loadedBlocks;
+
+    std::FILE* _entries;
+    // End of the pages in the entries file, in entries
+    uint64_t _entryEnd;
+
+    std::unordered_map<std::string, Address> _addresses;
+    // Heap bytes of the page offsets and of the address keys
+    size_t _directoryMemory;
+    // Position in its history of each unspent output
+    std::unordered_map<OutPointKey, uint32_t, OutPointKeyHash> _unspent;
+
+    const size_t _cacheLimit;
+    mutable Cache _cache;
+    mutable size_t _cacheBytes;
+};
+
+#endif // ADDRESSINDEX_H
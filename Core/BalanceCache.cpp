@@ -0,0 +1,167 @@
+#include "BalanceCache.h"
+#include "MemoryUsage.h"
+
+BalanceCache::BalanceCache(Blockchain& chain, Mempool* mempool)
+    : _chain(chain),
+      _mempool(mempool),
+      _entryMemory(0)
+{
+    _chain.getUTXOSet().forEach([this](const OutPoint&, const TxOut& output) {
+        addConfirmed(output.publicKeyHash, static_cast<int64_t>(output.amount));
+    });
+    _chain.addListener(this);
+
+    if (_mempool) {
+        _mempool->forEach([this](const Transaction& tx) { transactionAdded(tx); });
+        _mempool->addListener(this);
+    }
+}
+
+BalanceCache::~BalanceCache()
+{
+    if (_mempool) {
+        _mempool->removeListener(this);
+    }
+    _chain.removeListener(this);
+}
+
+uint64_t BalanceCache::getBalance(const std::string& publicKeyHash) const
+{
+    auto it = _confirmed.find(publicKeyHash);
+    return it == _confirmed.end() ? 0 : it->second;
+}
+
+int64_t BalanceCache::getPendingDelta(const std::string& publicKeyHash) const
+{
+    auto it = _pending.find(publicKeyHash);
+    return it == _pending.end() ? 0 : it->second;
+}
+
+int64_t BalanceCache::getUnconfirmedBalance(const std::string& publicKeyHash) const
+{
+    return static_cast<int64_t>(getBalance(publicKeyHash)) + getPendingDelta(publicKeyHash);
+}
+
+void BalanceCache::addConfirmed(const std::string& publicKeyHash, int64_t delta)
+{
+    auto inserted = _confirmed.emplace(publicKeyHash, 0);
+    auto it = inserted.first;
+    if (inserted.second) {
+        _entryMemory += dynamicUsage(it->first);
+    }
+    it->second += static_cast<uint64_t>(delta);
+    if (it->second == 0) {
+        _entryMemory -= dynamicUsage(it->first);
+        _confirmed.erase(it);
+    }
+}
+
+void BalanceCache::addPending(const std::string& publicKeyHash, int64_t delta)
+{
+    auto inserted = _pending.emplace(publicKeyHash, 0);
+    auto it = inserted.first;
+    if (inserted.second) {
+        _entryMemory += dynamicUsage(it->first);
+    }
+    it->second += delta;
+    if (it->second == 0) {
+        _entryMemory -= dynamicUsage(it->first);
+        _pending.erase(it);
+    }
+}
+
+size_t BalanceCache::deltasUsage(const Deltas& deltas)
+{
+    size_t bytes = dynamicUsage(deltas);
+    for (const auto& delta : deltas) {
+        bytes += dynamicUsage(delta.first);
+    }
+    return bytes;
+}
+
+size_t BalanceCache::memoryUsage() const
+{
+    return _entryMemory + dynamicUsage(_confirmed) + dynamicUsage(_pending) + dynamicUsage(_pendingByTx);
+}
+
+// -----------------------------------------------------------------------------
+//  blockConnected()
+//  The undo data holds every output the block spent, with its owner and
+//  amount, so no lookup of the spent outputs is needed.
+// -----------------------------------------------------------------------------
+void BalanceCache::blockConnected(const Block& block, const BlockUndo& undo, uint64_t)
+{
+    for (const auto& tx : block.getTransactions()) {
+        for (const auto& output : tx.getOutputs()) {
+            addConfirmed(output.publicKeyHash, static_cast<int64_t>(output.amount));
+        }
+    }
+    for (const auto& spent : undo.spentOutputs) {
+        addConfirmed(spent.second.publicKeyHash, -static_cast<int64_t>(spent.second.amount));
+    }
+}
+
+void BalanceCache::blockDisconnected(const Block& block, const BlockUndo& undo, uint64_t)
+{
+    for (const auto& spent : undo.spentOutputs) {
+        addConfirmed(spent.second.publicKeyHash, static_cast<int64_t>(spent.second.amount));
+    }
+    for (const auto& tx : block.getTransactions()) {
+        for (const auto& output : tx.getOutputs()) {
+            addConfirmed(output.publicKeyHash, -static_cast<int64_t>(output.amount));
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+//  transactionAdded()
+//  A pooled transaction may spend a confirmed output or the output of
+//  another pooled transaction; inputs found in neither are ignored.
+// -----------------------------------------------------------------------------
+void BalanceCache::transactionAdded(const Transaction& tx)
+{
+    Deltas deltas;
+    for (const auto& input : tx.getInputs()) {
+        if (input.isCoinbase()) {
+            continue;
+        }
+        const TxOut* spent = _chain.getUTXOSet().find(OutPoint(input.prevTxID, input.outputIndex));
+        if (!spent && _mempool) {
+            const Transaction* parent = _mempool->find(input.prevTxID);
+            if (parent && input.outputIndex < parent->getOutputs().size()) {
+                spent = &parent->getOutputs()[input.outputIndex];
+            }
+        }
+        if (spent) {
+            deltas.emplace_back(spent->publicKeyHash, -static_cast<int64_t>(spent->amount));
+        }
+    }
+    for (const auto& output : tx.getOutputs()) {
+        deltas.emplace_back(output.publicKeyHash, static_cast<int64_t>(output.amount));
+    }
+
+    for (const auto& delta : deltas) {
+        addPending(delta.first, delta.second);
+    }
+    auto inserted = _pendingByTx.try_emplace(tx.getTxid());
+    if (inserted.second) {
+        _entryMemory += dynamicUsage(inserted.first->first);
+    } else {
+        _entryMemory -= deltasUsage(inserted.first->second);
+    }
+    _entryMemory += deltasUsage(deltas);
+    inserted.first->second = std::move(deltas);
+}
+
+void BalanceCache::transactionRemoved(const TXID& txid)
+{
+    auto it = _pendingByTx.find(txid);
+    if (it == _pendingByTx.end()) {
+        return;
+    }
+    for (const auto& delta : it->second) {
+        addPending(delta.first, -delta.second);
+    }
+    _entryMemory -= dynamicUsage(it->first) + deltasUsage(it->second);
+    _pendingByTx.erase(it);
+}
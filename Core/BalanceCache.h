@@ -0,0 +1,93 @@
+#ifndef BALANCECACHE_H
+#define BALANCECACHE_H
+
+#include "Blockchain.h"
+#include "Mempool.h"
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @file BalanceCache.h
+ * @brief Definition of the BalanceCache class, the balance of every address.
+ * @details The confirmed balance of a publicKeyHash is the sum of its unspent
+ *          outputs. Instead of summing them on each query, the cache keeps one
+ *          total per address and applies deltas as blocks are connected
+ *          (outputs created, outputs spent from the undo data) and reverses
+ *          them as blocks are disconnected. A query is a single hash lookup
+ *          whatever the history of the address.
+ *          With a mempool attached, the unconfirmed deltas of pooled
+ *          transactions are kept in an overlay, so callers can also see the
+ *          balance once pending payments confirm.
+ */
+class BalanceCache : public ChainListener, public MempoolListener {
+public:
+
+    /**
+     * Computes the balances from the UTXO set of chain and, if mempool is
+     * given, the pending deltas of its transactions, then follows both.
+     * chain and mempool must outlive the cache.
+     */
+    explicit BalanceCache(Blockchain& chain, Mempool* mempool = nullptr);
+
+    ~BalanceCache() override;
+
+    BalanceCache(const BalanceCache&) = delete;
+    BalanceCache& operator=(const BalanceCache&) = delete;
+
+    /**
+     * Sum of the unspent outputs paid to publicKeyHash on the active chain.
+     */
+    uint64_t getBalance(const std::string& publicKeyHash) const;
+
+    /**
+     * Change of the balance once the pooled transactions confirm: received
+     * minus spent. Always 0 without a mempool.
+     */
+    int64_t getPendingDelta(const std::string& publicKeyHash) const;
+
+    /**
+     * Confirmed balance plus pending delta.
+     */
+    int64_t getUnconfirmedBalance(const std::string& publicKeyHash) const;
+
+    /**
+     * Number of addresses with a non-zero confirmed balance.
+     */
+    size_t addressCount() const { return _confirmed.size(); }
+
+    /**
+     * Heap bytes held by the balances, pending deltas and their tables,
+     * counted from container capacities (see MemoryUsage.h) and kept up to
+     * date as they change.
+     */
+    size_t memoryUsage() const;
+
+    // ChainListener
+    void blockConnected(const Block& block, const BlockUndo& undo, uint64_t height) override;
+    void blockDisconnected(const Block& block, const BlockUndo& undo, uint64_t height) override;
+
+    // MempoolListener
+    void transactionAdded(const Transaction& tx) override;
+    void transactionRemoved(const TXID& txid) override;
+
+private:
+    typedef std::vector<std::pair<std::string, int64_t>> Deltas;
+
+    void addConfirmed(const std::string& publicKeyHash, int64_t delta);
+    void addPending(const std::string& publicKeyHash, int64_t delta);
+    static size_t deltasUsage(const Deltas& deltas);
+
+    Blockchain& _chain;
+    Mempool* _mempool;
+    // Addresses with a zero balance or delta are erased
+    std::unordered_map<std::string, uint64_t> _confirmed;
+    std::unordered_map<std::string, int64_t> _pending;
+    // Deltas of each pooled transaction, reverted when it leaves the pool;
+    // the transaction itself is gone by then
+    std::unordered_map<TXID, Deltas> _pendingByTx;
+    // Heap bytes of the keys and of the deltas of _pendingByTx
+    size_t _entryMemory;
+};
+
+#endif // BALANCECACHE_H
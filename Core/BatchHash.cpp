@@ -0,0 +1,26 @@
+#include "BatchHash.h"
+#include "ThreadPool.h"
+
+namespace {
+// Below this many transactions the batch is hashed on the calling thread
+const size_t ParallelThreshold = 64;
+// Transactions per parallelFor chunk
+const size_t Grain = 32;
+}
+
+void hashTransactions(const Transaction* transactions, size_t count)
+{
+    if (count < ParallelThreshold) {
+        std::string buffer;
+        for (size_t i = 0; i < count; ++i) {
+            transactions[i].getTxid(buffer);
+        }
+        return;
+    }
+
+    // Transaction ids are cached through const access, which is thread-safe
+    ThreadPool::instance().parallelFor(0, count, [transactions](size_t i) {
+        thread_local std::string buffer;
+        transactions[i].getTxid(buffer);
+    }, TaskPriority::Normal, Grain);
+}
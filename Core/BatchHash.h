@@ -0,0 +1,31 @@
+#ifndef BATCHHASH_H
+#define BATCHHASH_H
+
+#include "Transaction.h"
+#include <vector>
+
+/**
+ * @file BatchHash.h
+ * @brief Batch computation of transaction ids for block assembly.
+ * @details hashTransactions() fills in the cached txid of every transaction
+ *          that has none yet, spreading the transactions over the shared
+ *          ThreadPool. Each thread serializes into one reusable buffer, so the
+ *          batch costs no allocation per transaction besides the txid itself.
+ *          Afterwards the Merkle leaves are ready and Block::computeMerkleRoot()
+ *          only hashes the inner nodes.
+ */
+
+/**
+ * Computes the txids of count transactions starting at transactions.
+ */
+void hashTransactions(const Transaction* transactions, size_t count);
+
+/**
+ * Computes the txids of all the transactions.
+ */
+inline void hashTransactions(const std::vector<Transaction>& transactions)
+{
+    hashTransactions(transactions.data(), transactions.size());
+}
+
+#endif // BATCHHASH_H
@@ -1,6 +1,10 @@
 #include "Block.h"
+#include "BatchHash.h"
+#include "Encoding.h"
+#include "Hex.h"
+#include "MemoryUsage.h"
+#include "Trace.h"
 #include <sstream>
-#include <iomanip>
 #include <openssl/sha.h>
 
 // -----------------------------------------------------------------------------
@@ -8,21 +12,27 @@
 // -----------------------------------------------------------------------------
 void Block::computeHash()
 {
-    // Converts a Transaction object into a single, deterministic
-    // sequence of bytes (or a string) that can be hashed
-    std::string data = serialize();
     unsigned char hash[SHA256_DIGEST_LENGTH];
+    digest(hash);
 
-    SHA256(reinterpret_cast<const unsigned char*>(data.c_str()), data.size(), hash);
-
-    // Convert the hash to a hex string
+    // Convert the hash to a hex string, reusing the buffer while mining
+    _header.blockHash.resize(2 * SHA256_DIGEST_LENGTH);
+    hexEncode(hash, SHA256_DIGEST_LENGTH, &_header.blockHash[0]);
+}
 
-    std::ostringstream oss;
-    for (int i = 0; i < SHA256_DIGEST_LENGTH; ++i) {
-        oss << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(hash[i]);
-    }
+std::string Block::calculateHash() const
+{
+    unsigned char hash[SHA256_DIGEST_LENGTH];
+    digest(hash);
+    return toHex(hash, SHA256_DIGEST_LENGTH);
+}
 
-    _header.blockHash = oss.str();
+void Block::digest(unsigned char* hash) const
+{
+    // Converts a Transaction object into a single, deterministic
+    // sequence of bytes (or a string) that can be hashed
+    std::string data = serialize();
+    SHA256(reinterpret_cast<const unsigned char*>(data.c_str()), data.size(), hash);
 }
 
 // -----------------------------------------------------------------------------
@@ -32,6 +42,7 @@ void Block::computeHash()
 // -----------------------------------------------------------------------------
 void Block::mine()
 {
+    TRACE_SCOPE("Block::mine");
     std::string target(_header.difficulty, '0');
 
     do {
@@ -46,18 +57,30 @@ void Block::mine()
 // -----------------------------------------------------------------------------
 void Block::computeMerkleRoot()
 {
+    TRACE_SCOPE("Block::computeMerkleRoot");
     // Step 1: Validate input - Check if the block contains any transactions
     // If empty, do nothing since there's no data to hash
     if (_transactions.empty()) {
         return;
     }
+    _header.hashMerkleRoot = calculateMerkleRoot();
+}
+
+std::string Block::calculateMerkleRoot() const
+{
+    if (_transactions.empty()) {
+        return std::string();
+    }
 
     // Step 2: Build the initial Merkle tree level (leaves)
     // Collect all transaction IDs (TXIDs) which will be the leaves of the Merkle tree
-    // Each TXID is already a SHA-256 hash of the transaction data
+    // Each TXID is a SHA-256 hash of the transaction data; the missing ones
+    // are computed in parallel first
+    hashTransactions(_transactions);
     std::vector<std::string> merkleLeaves;
+    merkleLeaves.reserve(_transactions.size());
     for (const auto& tx : _transactions) {
-        merkleLeaves.push_back(tx.txid);
+        merkleLeaves.push_back(tx.getTxid());
     }
 
     // Step 3: Iteratively build the Merkle tree from bottom to top
@@ -80,13 +103,8 @@ void Block::computeMerkleRoot()
                 // Step 3b-ii: Compute SHA-256 hash of the concatenated pair
                 unsigned char hash[SHA256_DIGEST_LENGTH];
                 SHA256(reinterpret_cast<const unsigned char*>(combined.c_str()), combined.size(), hash);
-                // Convert the hash to a hex string
-                std::ostringstream oss;
-                for (int j = 0; j < SHA256_DIGEST_LENGTH; ++j) {
-                    oss << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(hash[j]);
-                }
                 // Step 3b-iii: Add the resulting parent hash to the next level
-                newLevel.push_back(oss.str());
+                newLevel.push_back(toHex(hash, SHA256_DIGEST_LENGTH));
             } else {
                 // Step 3c: Handle odd number of leaves at current level
                 // If there's an odd leaf remaining with no pair,
@@ -101,10 +119,10 @@ void Block::computeMerkleRoot()
         merkleLeaves = newLevel;
     }
 
-    // Step 4: Store the root hash
+    // Step 4: Return the root hash
     // After all iterations, merkleLeaves contains exactly one element: the Merkle root
     // This root is a deterministic hash of all transactions in the block
-    _header.hashMerkleRoot = merkleLeaves.front();
+    return merkleLeaves.front();
 }
 
 std::string Block::serialize() const
@@ -127,6 +145,102 @@ std::string Block::serialize() const
     return oss.str();
 }
 
+// -----------------------------------------------------------------------------
+//  encode()
+//  The block hash is stored as is rather than recomputed on decoding.
+// -----------------------------------------------------------------------------
+void Block::encode(std::string& output) const
+{
+    ByteWriter writer(output);
+    writer.writeU64(_header.version);
+    writer.writeString(_header.hashPrevBlock);
+    writer.writeString(_header.hashMerkleRoot);
+    writer.writeU64(_header.timestamp);
+    writer.writeU32(_header.nonce);
+    writer.writeU32(_header.difficulty);
+    writer.writeString(_header.blockHash);
+
+    writer.writeVarInt(_transactions.size());
+    for (const auto& tx : _transactions) {
+        tx.encode(output);
+    }
+}
+
+void Block::addTransaction(const Transaction& tx)
+{
+    _transactionBytes += tx.getEncodedSize();
+    _transactions.push_back(tx);
+}
+
+void Block::addTransaction(Transaction&& tx)
+{
+    _transactionBytes += tx.getEncodedSize();
+    _transactions.push_back(std::move(tx));
+}
+
+uint64_t Block::encodedSize(const std::vector<Transaction>& transactions)
+{
+    uint64_t size = 0;
+    for (const auto& tx : transactions) {
+        size += tx.getEncodedSize();
+    }
+    return size;
+}
+
+// -----------------------------------------------------------------------------
+//  getEncodedSize()
+//  The header is measured on each call since it changes while mining; the
+//  transactions are not.
+// -----------------------------------------------------------------------------
+uint64_t Block::getEncodedSize() const
+{
+    return 8 + ByteWriter::stringSize(_header.hashPrevBlock) +
+           ByteWriter::stringSize(_header.hashMerkleRoot) + 8 + 4 + 4 +
+           ByteWriter::stringSize(_header.blockHash) +
+           ByteWriter::varIntSize(_transactions.size()) + _transactionBytes;
+}
+
+size_t Block::memoryUsage() const
+{
+    size_t bytes = _header.memoryUsage() + dynamicUsage(_transactions);
+    for (const auto& tx : _transactions) {
+        bytes += tx.memoryUsage();
+    }
+    return bytes;
+}
+
+bool Block::decode(ByteReader& reader, Block& block)
+{
+    BlockHeader header;
+    uint64_t txCount;
+    if (!reader.readU64(header.version) ||
+        !reader.readString(header.hashPrevBlock) ||
+        !reader.readString(header.hashMerkleRoot) ||
+        !reader.readU64(header.timestamp) ||
+        !reader.readU32(header.nonce) ||
+        !reader.readU32(header.difficulty) ||
+        !reader.readString(header.blockHash) ||
+        !reader.readVarInt(txCount)) {
+        return false;
+    }
+
+    // An encoded transaction takes at least 11 bytes
+    if (txCount > reader.remaining() / 11) {
+        return false;
+    }
+    std::vector<Transaction> transactions(static_cast<size_t>(txCount));
+    for (auto& tx : transactions) {
+        if (!Transaction::decode(reader, tx)) {
+            return false;
+        }
+    }
+
+    block._header = std::move(header);
+    block._transactions = std::move(transactions);
+    block._transactionBytes = encodedSize(block._transactions);
+    return true;
+}
+
 const std::string& Block::getHash() const
 {
     return _header.blockHash;
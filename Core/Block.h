@@ -14,10 +14,12 @@
 class Block : public CoreObject {
 public:
 
-    Block(std::string prevHash): _header(), _transactions(){ _header.hashPrevBlock = prevHash;}
+    Block(std::string prevHash): _header(), _transactions(), _transactionBytes(0)
+    { _header.hashPrevBlock = prevHash;}
 
     Block(const std::vector<Transaction>& transactions, std::string prevHash): _header(),
-    _transactions(transactions) { _header.hashPrevBlock = prevHash;}
+    _transactions(transactions), _transactionBytes(encodedSize(transactions))
+    { _header.hashPrevBlock = prevHash;}
 
     /**
      * Mining Method (PoW), repeatedly changes the nonce and recalculates
@@ -30,6 +32,14 @@ public:
      */
     void computeHash();
 
+    /**
+     * Hash and Merkle root the block should have, as computeHash() and
+     * computeMerkleRoot() would set them, without changing the block. The
+     * Merkle root of a block without transactions is empty.
+     */
+    std::string calculateHash() const;
+    std::string calculateMerkleRoot() const;
+
     /**
      * Mines the block by finding a nonce that results in a hash
      * below the target defined by the difficulty.
@@ -42,6 +52,17 @@ public:
      */
     std::string serialize() const override;
 
+    /**
+     * Appends the binary encoding of the block (header, block hash and
+     * transactions) to output.
+     */
+    void encode(std::string& output) const;
+
+    /**
+     * Reads a block written by encode(). Returns false on malformed input.
+     */
+    static bool decode(ByteReader& reader, Block& block);
+
     /**
      * Accessor to block hash.
      */
@@ -55,17 +76,55 @@ public:
     /**
      * Accessor to block header.
      */
-    const BlockHeader getHeader() const {return _header;};
+    const BlockHeader& getHeader() const {return _header;};
 
     /**
      * Mutator to set block header.
      */
     void setHeader(const BlockHeader& header) {_header = header;};
 
+    /**
+     * Mutator to set the header nonce.
+     */
+    void setNonce(uint32_t nonce) {_header.nonce = nonce;};
+
     /**
      * Accessor to Merkle root.
      */
-    const std::string& Block::getMerkleRoot() const;
+    const std::string& getMerkleRoot() const;
+
+    /**
+     * Accessor to the block transactions.
+     */
+    const std::vector<Transaction>& getTransactions() const { return _transactions; }
+
+    /**
+     * Appends a transaction. The Merkle root is not updated.
+     */
+    void addTransaction(const Transaction& tx);
+    void addTransaction(Transaction&& tx);
+
+    /**
+     * Frees the transactions, keeping the header; used by pruned nodes.
+     */
+    void pruneTransactions() { std::vector<Transaction>().swap(_transactions); _transactionBytes = 0; }
+
+    /**
+     * Sum of the encoded sizes of the transactions, kept up to date as they
+     * are added.
+     */
+    uint64_t getTransactionBytes() const { return _transactionBytes; }
+
+    /**
+     * Number of bytes written by encode().
+     */
+    uint64_t getEncodedSize() const;
+
+    /**
+     * Heap bytes held by the header and the transactions, counted from
+     * their capacities (see MemoryUsage.h).
+     */
+    size_t memoryUsage() const;
 
     /**
      * Validates the block's hash against the difficulty target.
@@ -73,8 +132,14 @@ public:
     bool validateBlock(unsigned int difficulty) const;
 
 private:
+    // SHA-256 of serialize()
+    void digest(unsigned char* hash) const;
+
+    static uint64_t encodedSize(const std::vector<Transaction>& transactions);
+
     BlockHeader _header;
     std::vector<Transaction> _transactions;
+    uint64_t _transactionBytes;
 };
 
 #endif // BLOCK_H
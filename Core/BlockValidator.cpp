@@ -0,0 +1,235 @@
+#include "BlockValidator.h"
+#include "BatchHash.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace {
+
+// Open-addressing table of the block's txids or spent outpoints, storing the
+// number of the transaction or input; keys are compared through the block
+class RefTable {
+public:
+    static const uint32_t Empty = UINT32_MAX;
+
+    void reserve(size_t count) {
+        size_t capacity = 16;
+        while (capacity < 2 * count) {
+            capacity *= 2;
+        }
+        _slots.assign(capacity, Slot{0, Empty});
+        _mask = capacity - 1;
+    }
+
+    // Returns the value already stored under an equal key, or stores value
+    // and returns Empty
+    template <class Equal>
+    uint32_t insert(size_t hash, uint32_t value, Equal&& equal) {
+        for (size_t i = hash & _mask;; i = (i + 1) & _mask) {
+            Slot& slot = _slots[i];
+            if (slot.value == Empty) {
+                slot = Slot{hash, value};
+                return Empty;
+            }
+            if (slot.hash == hash && equal(slot.value)) {
+                return slot.value;
+            }
+        }
+    }
+
+    template <class Equal>
+    uint32_t find(size_t hash, Equal&& equal) const {
+        for (size_t i = hash & _mask;; i = (i + 1) & _mask) {
+            const Slot& slot = _slots[i];
+            if (slot.value == Empty) {
+                return Empty;
+            }
+            if (slot.hash == hash && equal(slot.value)) {
+                return slot.value;
+            }
+        }
+    }
+
+private:
+    struct Slot {
+        size_t hash;
+        uint32_t value;
+    };
+    std::vector<Slot> _slots;
+    size_t _mask = 0;
+};
+
+// Same hash as OutPointHash
+size_t outPointHash(const std::string& txid, uint32_t index)
+{
+    return std::hash<std::string>()(txid) ^ (static_cast<size_t>(index) * 0x9e3779b97f4a7c15ULL);
+}
+
+// Partition of a hash; the low bits also pick the bucket inside the map
+size_t partitionOf(size_t hash, size_t partitions)
+{
+    return (hash >> (sizeof(size_t) * 4)) % partitions;
+}
+
+}
+
+BlockValidator::BlockValidator(const UTXOSet& utxos, ThreadPool& pool)
+    : _utxos(utxos),
+      _pool(pool),
+      _firstInvalid(0)
+{
+}
+
+// -----------------------------------------------------------------------------
+//  check()
+//  1. Txids are computed and every input gets a global number.
+//  2. One task per partition indexes the txids and the first spender of each
+//     outpoint of its partition, in block order.
+//  3. Every transaction is checked on its own against the graph and the set.
+// -----------------------------------------------------------------------------
+BlockValidator::Result BlockValidator::check(const Block& block)
+{
+    const std::vector<Transaction>& transactions = block.getTransactions();
+    const size_t txCount = transactions.size();
+    hashTransactions(transactions);
+
+    // Step 1: inputs by global number
+    std::vector<size_t> inputStart(txCount + 1, 0);
+    for (size_t t = 0; t < txCount; ++t) {
+        inputStart[t + 1] = inputStart[t] + transactions[t].getInputs().size();
+    }
+    const size_t inputCount = inputStart[txCount];
+    std::vector<uint32_t> inputTx(inputCount);
+    std::vector<size_t> inputHash(inputCount);
+    std::vector<size_t> txidHash(txCount);
+    for (size_t t = 0; t < txCount; ++t) {
+        for (size_t g = inputStart[t]; g < inputStart[t + 1]; ++g) {
+            inputTx[g] = static_cast<uint32_t>(t);
+        }
+    }
+    _pool.parallelFor(0, txCount, [&](size_t t) {
+        const Transaction& tx = transactions[t];
+        txidHash[t] = std::hash<std::string>()(tx.getTxid());
+        for (size_t i = 0; i < tx.getInputs().size(); ++i) {
+            const TxIn& input = tx.getInputs()[i];
+            inputHash[inputStart[t] + i] = outPointHash(input.prevTxID, input.outputIndex);
+        }
+    }, TaskPriority::High);
+
+    // Step 2: spend graph
+    const size_t partitions = std::max<size_t>(1, _pool.threadCount());
+    std::vector<RefTable> txids(partitions);
+    std::vector<RefTable> spenders(partitions);
+    auto sameTxid = [&](const std::string& txid) {
+        return [&](uint32_t t) { return transactions[t].getTxid() == txid; };
+    };
+    auto sameOutPoint = [&](const std::string& txid, uint32_t index) {
+        return [&, index](uint32_t g) {
+            const TxIn& input = transactions[inputTx[g]].getInputs()[g - inputStart[inputTx[g]]];
+            return input.outputIndex == index && input.prevTxID == txid;
+        };
+    };
+    // Set on the inputs spending an outpoint already spent earlier in the block
+    std::vector<uint8_t> doubleSpend(inputCount, 0);
+    std::atomic<bool> repeatedTxid(false);
+    _pool.parallelFor(0, partitions, [&](size_t p) {
+        RefTable& txidTable = txids[p];
+        txidTable.reserve(txCount / partitions + 1);
+        for (size_t t = 0; t < txCount; ++t) {
+            if (partitionOf(txidHash[t], partitions) == p &&
+                txidTable.insert(txidHash[t], static_cast<uint32_t>(t),
+                                 sameTxid(transactions[t].getTxid())) != RefTable::Empty) {
+                repeatedTxid.store(true, std::memory_order_relaxed);
+            }
+        }
+        RefTable& spenderTable = spenders[p];
+        spenderTable.reserve(inputCount / partitions + 1);
+        for (size_t g = 0; g < inputCount; ++g) {
+            if (partitionOf(inputHash[g], partitions) != p) {
+                continue;
+            }
+            const TxIn& input = transactions[inputTx[g]].getInputs()[g - inputStart[inputTx[g]]];
+            if (input.isCoinbase()) {
+                continue;
+            }
+            if (spenderTable.insert(inputHash[g], static_cast<uint32_t>(g),
+                                    sameOutPoint(input.prevTxID, input.outputIndex)) != RefTable::Empty) {
+                doubleSpend[g] = 1;
+            }
+        }
+    }, TaskPriority::High, 1);
+    if (repeatedTxid.load()) {
+        return Result::Unsupported;
+    }
+
+    // Step 3: transactions, each as if the ones before it were connected
+    _spentOutputs.assign(inputCount, nullptr);
+    std::vector<uint8_t> invalid(txCount, 0);
+    _pool.parallelFor(0, txCount, [&](size_t t) {
+        const Transaction& tx = transactions[t];
+        uint64_t valueIn = 0;
+        uint64_t valueOut = 0;
+
+        for (size_t g = inputStart[t]; g < inputStart[t + 1]; ++g) {
+            const TxIn& input = tx.getInputs()[g - inputStart[t]];
+            if (input.isCoinbase()) {
+                continue;
+            }
+            if (doubleSpend[g]) {
+                invalid[t] = 1;
+                return;
+            }
+            // Output of an earlier transaction of the block, or of the set
+            const TxOut* spent = nullptr;
+            const size_t parentHash = std::hash<std::string>()(input.prevTxID);
+            const uint32_t parent = txids[partitionOf(parentHash, partitions)].find(
+                parentHash, sameTxid(input.prevTxID));
+            if (parent != RefTable::Empty && parent < t &&
+                input.outputIndex < transactions[parent].getOutputs().size()) {
+                spent = &transactions[parent].getOutputs()[input.outputIndex];
+            } else {
+                spent = _utxos.find(OutPoint(input.prevTxID, input.outputIndex));
+            }
+            if (!spent) {
+                invalid[t] = 1;
+                return;
+            }
+            valueIn += spent->amount;
+            _spentOutputs[g] = spent;
+        }
+
+        for (const auto& output : tx.getOutputs()) {
+            valueOut += output.amount;
+        }
+        // A regular transaction cannot create value
+        if (!tx.isCoinbase() && valueOut > valueIn) {
+            invalid[t] = 1;
+            return;
+        }
+
+        // An output of the set is only replaced once an earlier transaction
+        // of the block, or this one, spent it
+        for (uint32_t i = 0; i < tx.getOutputs().size(); ++i) {
+            const OutPoint outPoint(tx.getTxid(), i);
+            if (!_utxos.find(outPoint)) {
+                continue;
+            }
+            const size_t hash = outPointHash(tx.getTxid(), i);
+            const uint32_t spender = spenders[partitionOf(hash, partitions)].find(
+                hash, sameOutPoint(tx.getTxid(), i));
+            if (spender == RefTable::Empty || inputTx[spender] > t) {
+                invalid[t] = 1;
+                return;
+            }
+        }
+    }, TaskPriority::High);
+
+    for (size_t t = 0; t < txCount; ++t) {
+        if (invalid[t]) {
+            _firstInvalid = t;
+            _spentOutputs.clear();
+            return Result::Invalid;
+        }
+    }
+    return Result::Valid;
+}
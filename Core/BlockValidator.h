@@ -0,0 +1,67 @@
+#ifndef BLOCKVALIDATOR_H
+#define BLOCKVALIDATOR_H
+
+#include "ThreadPool.h"
+#include "UTXOSet.h"
+#include <cstddef>
+#include <vector>
+
+/**
+ * @file BlockValidator.h
+ * @brief Definition of the BlockValidator class, the parallel check of a block.
+ * @details UTXOSet::connectBlock() processes transactions one after the other
+ *          because a transaction may spend an output created earlier in the
+ *          block. The validator first builds the spend graph of the block: the
+ *          txids of the block and the first input spending each outpoint, in
+ *          hash-partitioned maps built one partition per task. An input then
+ *          resolves on its own, to the output of an earlier transaction of the
+ *          block or to the UTXO set, and an input that is not the first to
+ *          spend its outpoint is an in-block double-spend. With the graph, all
+ *          transactions are checked concurrently against the unchanged set,
+ *          and the block gets exactly the result of the sequential pass: it is
+ *          valid when every transaction is valid after the ones before it.
+ *          Blocks that repeat a txid, whose outputs depend on the order of
+ *          creation and spending, are left to the sequential pass.
+ */
+class BlockValidator {
+public:
+
+    enum class Result {
+        Valid,
+        Invalid,
+        // The block repeats a txid: check it with connectBlockSequential()
+        Unsupported,
+    };
+
+    /**
+     * Validator of blocks on top of utxos, which must not change during a
+     * check.
+     */
+    explicit BlockValidator(const UTXOSet& utxos, ThreadPool& pool = ThreadPool::instance());
+
+    /**
+     * Checks the block as UTXOSet::connectBlock() would, without changing
+     * the set.
+     */
+    Result check(const Block& block);
+
+    /**
+     * Output spent by each input of the last valid block, in block order,
+     * nullptr for coinbase inputs. Outputs of the set stay valid until it
+     * changes; the others belong to the block.
+     */
+    const std::vector<const TxOut*>& getSpentOutputs() const { return _spentOutputs; }
+
+    /**
+     * Index of the first transaction that fails, for the last invalid block.
+     */
+    size_t getFirstInvalid() const { return _firstInvalid; }
+
+private:
+    const UTXOSet& _utxos;
+    ThreadPool& _pool;
+    std::vector<const TxOut*> _spentOutputs;
+    size_t _firstInvalid;
+};
+
+#endif // BLOCKVALIDATOR_H
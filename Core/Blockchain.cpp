@@ -1,17 +1,149 @@
 #include "Blockchain.h"
+#include "Checksum.h"
+#include "Encoding.h"
+#include "MemoryUsage.h"
+#include "SignatureCache.h"
+#include "Trace.h"
+#include <cerrno>
+#include <streambuf>
 #include <sstream>
 #include <iostream>
 #include <chrono>
+#include <algorithm>
+#include <unordered_set>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Stream buffer writing to a file descriptor through a fixed buffer
+class FdStreamBuf : public std::streambuf {
+public:
+    explicit FdStreamBuf(int fd) : _fd(fd) { setp(_buffer, _buffer + sizeof(_buffer)); }
+
+protected:
+    int_type overflow(int_type ch) override {
+        if (!flush()) {
+            return traits_type::eof();
+        }
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    int sync() override { return flush() ? 0 : -1; }
+
+private:
+    // Writes the buffered bytes, retrying short and interrupted writes
+    bool flush() {
+        const char* data = pbase();
+        size_t size = static_cast<size_t>(pptr() - pbase());
+        while (size > 0) {
+#ifdef _WIN32
+            const int written = _write(_fd, data, static_cast<unsigned int>(size));
+#else
+            const ssize_t written = ::write(_fd, data, size);
+#endif
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+        setp(_buffer, _buffer + sizeof(_buffer));
+        return true;
+    }
+
+    int _fd;
+    char _buffer[64 * 1024];
+};
+
+}
 
 std::string Blockchain::serialize() const
 {
     std::ostringstream oss;
-    for (const auto& block : _chain) {
-        oss << block.serialize();
-    }
+    serialize(oss);
     return oss.str();
 }
 
+void Blockchain::serialize(std::ostream& out) const
+{
+    for (const BlockIndex* index : _chain) {
+        out << index->block.serialize();
+    }
+}
+
+// -----------------------------------------------------------------------------
+//  exportBlocks()
+//  A single encoding buffer is reused for every block, so the binary form
+//  holds at most one encoded block besides the stream's own buffer.
+// -----------------------------------------------------------------------------
+bool Blockchain::exportBlocks(std::ostream& out, ExportFormat format,
+                              uint64_t from, uint64_t to) const
+{
+    const uint64_t last = std::min(to, getHeight());
+    if (format == ExportFormat::Binary) {
+        out.write(BinaryExportMagic, sizeof(BinaryExportMagic) - 1);
+    }
+
+    std::string encoded;
+    std::string recordHeader;
+    for (uint64_t height = from; height <= last && out; ++height) {
+        const BlockIndex* index = _chain[height];
+        const Block& block = index->block;
+
+        if (format == ExportFormat::Text) {
+            out << "---------------------------------------\n";
+            out << "Height: " << height << "\n";
+            block.getHeader().print(out);
+            if (index->pruned) {
+                out << "Transactions: pruned\n";
+                continue;
+            }
+            out << "Transactions: " << block.getTransactions().size() << "\n";
+            for (const auto& tx : block.getTransactions()) {
+                uint64_t amount = 0;
+                for (const auto& output : tx.getOutputs()) {
+                    amount += output.amount;
+                }
+                out << "  " << tx.getTxid() << ": " << tx.getInputs().size() << " in, "
+                    << tx.getOutputs().size() << " out, amount " << amount << "\n";
+            }
+            continue;
+        }
+
+        if (index->pruned) {
+            std::cerr << "Error: block at height " << height << " is pruned\n";
+            return false;
+        }
+        encoded.clear();
+        block.encode(encoded);
+        recordHeader.clear();
+        ByteWriter writer(recordHeader);
+        writer.writeU32(static_cast<uint32_t>(encoded.size()));
+        writer.writeU32(crc32(encoded.data(), encoded.size()));
+        out.write(recordHeader.data(), recordHeader.size());
+        out.write(encoded.data(), encoded.size());
+    }
+    return static_cast<bool>(out.flush());
+}
+
+bool Blockchain::exportBlocks(int fd, ExportFormat format, uint64_t from, uint64_t to) const
+{
+    FdStreamBuf buffer(fd);
+    std::ostream out(&buffer);
+    return exportBlocks(out, format, from, to);
+}
+
 Block Blockchain::createGenesisBlock()
 {
     Block genesisBlock("0");
@@ -33,25 +165,439 @@ Block Blockchain::createGenesisBlock()
 }
 
 Blockchain::Blockchain()
+    : _pruneDepth(0),
+      _maxBodyBytes(UINT64_MAX),
+      _bodyBytes(0),
+      _checkSignatures(false),
+      _signatureCache(nullptr),
+      _headerMemory(0),
+      _bodyMemory(0),
+      _undoMemory(0),
+      _publishedHeaders(0),
+      _publishedTransactions(0),
+      _publishedUndo(0),
+      _publishedUtxos(0),
+      _publishedSnapshots(0),
+      _snapshot(nullptr),
+      _highWater(0),
+      _changedFrom(0),
+      _prunedHeight(0)
+{
+    initialize(createGenesisBlock());
+}
+
+Blockchain::Blockchain(const Block& genesisBlock)
+    : _pruneDepth(0),
+      _maxBodyBytes(UINT64_MAX),
+      _bodyBytes(0),
+      _checkSignatures(false),
+      _signatureCache(nullptr),
+      _headerMemory(0),
+      _bodyMemory(0),
+      _undoMemory(0),
+      _publishedHeaders(0),
+      _publishedTransactions(0),
+      _publishedUndo(0),
+      _publishedUtxos(0),
+      _publishedSnapshots(0),
+      _snapshot(nullptr),
+      _highWater(0),
+      _changedFrom(0),
+      _prunedHeight(0)
+{
+    initialize(genesisBlock);
+}
+
+Blockchain::~Blockchain()
+{
+    delete _snapshot.load();
+}
+
+void Blockchain::initialize(const Block& genesisBlock)
 {
-    _chain.push_back(createGenesisBlock());
+    auto genesis = std::make_unique<BlockIndex>(genesisBlock, nullptr);
+    genesis->chainWork = blockWork(genesisBlock.getHeader().difficulty);
+    connectTip(insertBlock(std::move(genesis)));
+    publishSnapshot();
 }
 
-bool Blockchain::addBlock(const Block& newBlock)
+Blockchain::BlockIndex* Blockchain::insertBlock(std::unique_ptr<BlockIndex> index)
 {
-    // Check previous hash
-    const std::string& lastHash = _chain.empty() ? "" : _chain.back().getHash();
-    if (!_chain.empty() && newBlock.getPreviousHash() != lastHash) {
-        std::cerr << "Error: previous hash does not match chain tip\n";
+    index->bodyBytes = index->block.getTransactionBytes();
+    _bodyBytes += index->bodyBytes;
+    const size_t headerMemory = index->block.getHeader().memoryUsage();
+    index->bodyMemory = index->block.memoryUsage() - headerMemory;
+    _bodyMemory += index->bodyMemory;
+
+    BlockIndex* node = index.get();
+    _unpruned.emplace(node->height, node);
+    auto entry = _blockIndex.emplace(node->block.getHash(), std::move(index)).first;
+    _headerMemory += mallocUsage(sizeof(BlockIndex)) + headerMemory + dynamicUsage(entry->first);
+    return node;
+}
+
+// -----------------------------------------------------------------------------
+//  blockWork()
+//  A hash is accepted when its first `difficulty` hex digits are zero, which
+//  takes 16^difficulty attempts on average.
+// -----------------------------------------------------------------------------
+uint64_t Blockchain::blockWork(uint32_t difficulty)
+{
+    return 1ULL << (4 * std::min<uint32_t>(difficulty, 15));
+}
+
+// -----------------------------------------------------------------------------
+//  addBlock()
+//  Inserts the block in the block tree. Blocks extending a side branch are
+//  only stored; the active chain moves once a branch has more work.
+// -----------------------------------------------------------------------------
+Blockchain::AddResult Blockchain::addBlock(const Block& newBlock)
+{
+    TRACE_SCOPE("Blockchain::addBlock");
+    if (_blockIndex.count(newBlock.getHash())) {
+        std::cerr << "Error: block is already known\n";
+        return AddResult{false, false};
+    }
+
+    auto parentIt = _blockIndex.find(newBlock.getPreviousHash());
+    if (parentIt == _blockIndex.end()) {
+        std::cerr << "Error: previous block is unknown\n";
+        return AddResult{false, false};
+    }
+
+    BlockIndex* parent = parentIt->second.get();
+    if (parent->failed) {
+        std::cerr << "Error: previous block is invalid\n";
+        return AddResult{false, false};
+    }
+
+    // The work of a block is taken from its header, so the header must be proven
+    const uint32_t difficulty = newBlock.getHeader().difficulty;
+    if (newBlock.calculateHash() != newBlock.getHash() || !newBlock.validateBlock(difficulty)) {
+        std::cerr << "Error: block hash does not meet its difficulty\n";
+        return AddResult{false, false};
+    }
+    if (newBlock.calculateMerkleRoot() != newBlock.getMerkleRoot()) {
+        std::cerr << "Error: Merkle root does not match the transactions\n";
+        return AddResult{false, false};
+    }
+
+    auto index = std::make_unique<BlockIndex>(newBlock, parent);
+    index->height = parent->height + 1;
+    index->chainWork = parent->chainWork + blockWork(difficulty);
+
+    BlockIndex* node = insertBlock(std::move(index));
+
+    // Ties keep the branch that was seen first
+    if (node->chainWork <= _chain.back()->chainWork) {
+        pruneBlocks();
+        publishSnapshot();
+        return AddResult{true, false};
+    }
+
+    const BlockIndex* oldTip = _chain.back();
+    const bool activated = activateBranch(node);
+    const bool tipChanged = _chain.back() != oldTip;
+    pruneBlocks();
+    publishSnapshot();
+    if (!activated) {
+        std::cerr << "Error: block could not be connected"
+                  << (tipChanged ? ", the valid part of its branch is active\n" : "\n");
+        return AddResult{false, tipChanged};
+    }
+    return AddResult{true, true};
+}
+
+// -----------------------------------------------------------------------------
+//  activateBranch()
+//  Disconnects the active chain down to the fork point, then connects the new
+//  branch. Only the blocks above the fork are touched, so the cost of a
+//  reorganization depends on its depth and not on the chain length.
+// -----------------------------------------------------------------------------
+bool Blockchain::activateBranch(BlockIndex* newTip)
+{
+    BlockIndex* oldTip = _chain.back();
+    BlockIndex* fork = findFork(newTip);
+
+    std::vector<BlockIndex*> branch;
+    for (BlockIndex* index = newTip; index != fork; index = index->parent) {
+        branch.push_back(index);
+    }
+
+    // Pruned blocks can be neither connected nor disconnected
+    bool pruned = std::any_of(branch.begin(), branch.end(),
+                              [](const BlockIndex* index) { return index->pruned; });
+    for (size_t height = _chain.size() - 1; !pruned && _chain[height] != fork; --height) {
+        pruned = _chain[height]->pruned;
+    }
+    if (pruned) {
+        std::cerr << "Error: branch forks below the pruned blocks\n";
         return false;
     }
 
-    // TODO: Validate Merkle root and proof of work
+    std::vector<BlockIndex*> disconnected;
+    while (_chain.back() != fork) {
+        disconnected.push_back(_chain.back());
+        disconnectTip();
+    }
+
+    for (auto it = branch.rbegin(); it != branch.rend(); ++it) {
+        if (connectTip(*it)) {
+            continue;
+        }
+
+        // The failing block and everything built on it can never be connected
+        for (auto failed = branch.begin(); failed != it.base(); ++failed) {
+            (*failed)->failed = true;
+        }
+
+        // Keep the valid part of the branch if it already has more work
+        if (_chain.back()->chainWork > oldTip->chainWork) {
+            return false;
+        }
+
+        while (_chain.back() != fork) {
+            disconnectTip();
+        }
+        for (auto restore = disconnected.rbegin(); restore != disconnected.rend(); ++restore) {
+            connectTip(*restore);
+        }
+        return false;
+    }
 
-    _chain.push_back(newBlock);
     return true;
 }
 
+Blockchain::BlockIndex* Blockchain::findFork(BlockIndex* index) const
+{
+    while (index->height >= _chain.size() || _chain[index->height] != index) {
+        index = index->parent;
+    }
+    return index;
+}
+
+bool Blockchain::connectTip(BlockIndex* index)
+{
+    if (!_utxos.connectBlock(index->block, index->undo)) {
+        return false;
+    }
+    if (_checkSignatures &&
+        !verifyBlockSignatures(index->block, index->undo, _signatureCache)) {
+        std::cerr << "Error: invalid signature in block " << index->block.getHash() << "\n";
+        _utxos.disconnectBlock(index->block, index->undo);
+        index->undo = BlockUndo();
+        return false;
+    }
+    _chain.push_back(index);
+    _changedFrom = std::min(_changedFrom, index->height);
+    _undoMemory += index->undo.memoryUsage();
+    // Connecting cached the txids of the transactions
+    const uint64_t bodyMemory = index->block.memoryUsage() - index->block.getHeader().memoryUsage();
+    _bodyMemory += bodyMemory - index->bodyMemory;
+    index->bodyMemory = bodyMemory;
+    for (ChainListener* listener : _listeners) {
+        listener->blockConnected(index->block, index->undo, index->height);
+    }
+    return true;
+}
+
+void Blockchain::disconnectTip()
+{
+    BlockIndex* tip = _chain.back();
+    _utxos.disconnectBlock(tip->block, tip->undo);
+    for (ChainListener* listener : _listeners) {
+        listener->blockDisconnected(tip->block, tip->undo, tip->height);
+    }
+    // Undo data is only kept for connected blocks
+    _undoMemory -= tip->undo.memoryUsage();
+    tip->undo = BlockUndo();
+    _chain.pop_back();
+    _changedFrom = std::min<uint64_t>(_changedFrom, _chain.size());
+}
+
+void Blockchain::enableSignatureChecks(SignatureCache* cache)
+{
+    _checkSignatures = true;
+    _signatureCache = cache;
+}
+
+void Blockchain::addListener(ChainListener* listener)
+{
+    _listeners.push_back(listener);
+}
+
+void Blockchain::removeListener(ChainListener* listener)
+{
+    _listeners.erase(std::remove(_listeners.begin(), _listeners.end(), listener),
+                     _listeners.end());
+}
+
+// -----------------------------------------------------------------------------
+//  createBlock()
+//  Builds a template on top of the tip, with the tip's difficulty. The caller
+//  still has to mine it. Transactions are taken in pool order; one that
+//  doesn't fit is skipped, and so are those spending its outputs, while
+//  smaller ones after it may still fill the budget.
+// -----------------------------------------------------------------------------
+Block Blockchain::createBlock(const std::vector<Transaction>& pool, uint64_t maxBytes)
+{
+    const Block& tip = getLatestBlock();
+    Block block(tip.getHash());
+    std::unordered_set<TXID> skipped;
+    for (const auto& tx : pool) {
+        bool fits = block.getTransactionBytes() + tx.getEncodedSize() <= maxBytes;
+        for (size_t i = 0; fits && !skipped.empty() && i < tx.getInputs().size(); ++i) {
+            fits = !skipped.count(tx.getInputs()[i].prevTxID);
+        }
+        if (fits) {
+            block.addTransaction(tx);
+        } else {
+            skipped.insert(tx.getTxid());
+        }
+    }
+    uint64_t timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count();
+    block.setHeader(BlockHeader(1, tip.getHash(), "", timestamp, 0, tip.getHeader().difficulty));
+    block.computeMerkleRoot();
+    return block;
+}
+
+const Block* Blockchain::findBlock(const std::string& hash) const
+{
+    auto it = _blockIndex.find(hash);
+    return it == _blockIndex.end() || it->second->pruned ? nullptr : &it->second->block;
+}
+
+bool Blockchain::isPruned(const std::string& hash) const
+{
+    auto it = _blockIndex.find(hash);
+    return it != _blockIndex.end() && it->second->pruned;
+}
+
+void Blockchain::enablePruning(uint64_t keepDepth, uint64_t maxBodyBytes)
+{
+    _pruneDepth = std::max<uint64_t>(1, keepDepth);
+    _maxBodyBytes = maxBodyBytes;
+    pruneBlocks();
+    publishSnapshot();
+}
+
+// -----------------------------------------------------------------------------
+//  pruneBlocks()
+//  Bodies are dropped oldest first, side branches included: deep ones because
+//  they can no longer be reorganized to, recent ones while over the budget.
+//  Snapshots may still read them: they are freed by publishSnapshot().
+// -----------------------------------------------------------------------------
+void Blockchain::pruneBlocks()
+{
+    if (_pruneDepth == 0) {
+        return;
+    }
+    const uint64_t tipHeight = getHeight();
+    while (!_unpruned.empty()) {
+        BlockIndex* index = _unpruned.begin()->second;
+        const bool deep = index->height + _pruneDepth < tipHeight;
+        const bool overBudget = _bodyBytes > _maxBodyBytes && index != _chain.back();
+        if (!deep && !overBudget) {
+            break;
+        }
+        _prunedBodies.push_back(index);
+        _undoMemory -= index->undo.memoryUsage();
+        index->undo = BlockUndo();
+        index->pruned = true;
+        _bodyBytes -= index->bodyBytes;
+        _unpruned.erase(_unpruned.begin());
+    }
+}
+
+// -----------------------------------------------------------------------------
+//  publishSnapshot()
+//  Heights from _changedFrom on are written to the chunks; a chunk that a
+//  published view may read at that height is copied first. Readers see the
+//  new view as soon as it is stored. The old view and the bodies pruned since
+//  are retired, and freed once the snapshots that may use them are released.
+// -----------------------------------------------------------------------------
+void Blockchain::publishSnapshot()
+{
+    const uint64_t length = _chain.size();
+    for (uint64_t height = _changedFrom; height < length; ++height) {
+        const size_t chunk = height / ChainSnapshot::ChunkSize;
+        if (chunk == _chunks.size()) {
+            _chunks.push_back(std::make_shared<ChainSnapshot::Chunk>());
+        } else if (height < _highWater && _chunks[chunk].use_count() > 1) {
+            _chunks[chunk] = std::make_shared<ChainSnapshot::Chunk>(*_chunks[chunk]);
+        }
+        _chunks[chunk]->blocks[height % ChainSnapshot::ChunkSize] = &_chain[height]->block;
+    }
+    _changedFrom = length;
+    _highWater = std::max(_highWater, length);
+    // Pruned blocks of the active chain are the lowest ones
+    while (_prunedHeight < length && _chain[_prunedHeight]->pruned) {
+        ++_prunedHeight;
+    }
+
+    auto view = std::make_unique<ChainSnapshot::View>();
+    const size_t chunkCount = (length + ChainSnapshot::ChunkSize - 1) / ChainSnapshot::ChunkSize;
+    view->chunks.assign(_chunks.begin(), _chunks.begin() + chunkCount);
+    view->length = length;
+    view->chainWork = _chain.back()->chainWork;
+    view->prunedHeight = _prunedHeight;
+
+    const ChainSnapshot::View* old = _snapshot.exchange(view.release());
+    _epochs.retire([this, old, bodies = std::move(_prunedBodies)] {
+        delete old;
+        for (BlockIndex* index : bodies) {
+            index->block.pruneTransactions();
+            _bodyMemory -= index->bodyMemory;
+        }
+    });
+    _prunedBodies.clear();
+    _epochs.collect();
+    publishMemoryUsage();
+}
+
+// -----------------------------------------------------------------------------
+//  publishMemoryUsage()
+//  The running totals cover what each block adds; the containers of the
+//  chain itself are measured here, which takes constant time. Chunks kept by
+//  earlier views until their snapshots are released are not counted.
+// -----------------------------------------------------------------------------
+void Blockchain::publishMemoryUsage()
+{
+    const ChainSnapshot::View* view = _snapshot.load(std::memory_order_relaxed);
+    // A chunk shares its allocation with the counts of its shared_ptr
+    const size_t chunkUsage = mallocUsage(sizeof(ChainSnapshot::Chunk) + 2 * sizeof(long));
+
+    _publishedHeaders.store(_headerMemory + dynamicUsage(_blockIndex) + dynamicUsage(_chain) +
+                            dynamicUsage(_unpruned), std::memory_order_relaxed);
+    _publishedTransactions.store(_bodyMemory, std::memory_order_relaxed);
+    _publishedUndo.store(_undoMemory, std::memory_order_relaxed);
+    _publishedUtxos.store(_utxos.memoryUsage(), std::memory_order_relaxed);
+    _publishedSnapshots.store(view->chunks.size() * chunkUsage + mallocUsage(sizeof(*view)) +
+                              dynamicUsage(view->chunks), std::memory_order_relaxed);
+}
+
+Blockchain::MemoryUsage Blockchain::getMemoryUsage() const
+{
+    MemoryUsage usage;
+    usage.headers = _publishedHeaders.load(std::memory_order_relaxed);
+    usage.transactions = _publishedTransactions.load(std::memory_order_relaxed);
+    usage.undo = _publishedUndo.load(std::memory_order_relaxed);
+    usage.utxos = _publishedUtxos.load(std::memory_order_relaxed);
+    usage.snapshots = _publishedSnapshots.load(std::memory_order_relaxed);
+    return usage;
+}
+
+bool Blockchain::isInActiveChain(const std::string& hash) const
+{
+    auto it = _blockIndex.find(hash);
+    if (it == _blockIndex.end()) {
+        return false;
+    }
+    const BlockIndex* index = it->second.get();
+    return index->height < _chain.size() && _chain[index->height] == index;
+}
+
 bool Blockchain::validateChain() const
 {
     // TODO
@@ -62,9 +608,5 @@ bool Blockchain::validateChain() const
 void Blockchain::print() const
 {
     std::cout << "=== Blockchain (" << _chain.size() << " blocks) ===\n";
-
-    for (const auto& block : _chain) {
-        std::cout << "---------------------------------------\n";
-        block.getHeader().print();
-    }
+    exportBlocks(std::cout, ExportFormat::Text);
 }
@@ -2,13 +2,31 @@
 #define BLOCKCHAIN_H
 
 #include "Block.h"
+#include "ChainListener.h"
+#include "ChainSnapshot.h"
+#include "EpochManager.h"
+#include "UTXOSet.h"
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+class SignatureCache;
+
 /**
  * @file Blockchain.h
  * @brief Definition of the Blockchain class representing a chain of blocks.
  * @details This class encapsulates the essential structure of a blockchain,
  *          which is a linked list of blocks, each containing a set of transactions.
+ *          Every accepted block is kept in a block tree, so competing branches
+ *          are not lost. The active chain always follows the branch with the most
+ *          cumulative work; switching branches disconnects and connects blocks
+ *          with their undo data instead of rebuilding the state from genesis.
+ * https://en.bitcoin.it/wiki/Chain_Reorganization
  */
 class Blockchain : public CoreObject {
 public:
@@ -19,14 +37,46 @@ public:
     Blockchain();
 
     /**
-     * Adds a new block to the blockchain after validation.
+     * Creates a chain starting at the given genesis block, so that several
+     * instances can share the same history.
      */
-    bool addBlock(const Block& newBlock);
+    explicit Blockchain(const Block& genesisBlock);
+
+    ~Blockchain() override;
+
+    Blockchain(const Blockchain&) = delete;
+    Blockchain& operator=(const Blockchain&) = delete;
+
+    // Outcome of addBlock()
+    struct AddResult {
+        // The block is valid and stored; it is in the active chain if its
+        // branch has the most work
+        bool accepted;
+        // The active chain changed. This may be true for a refused block:
+        // when a block of a heavier branch fails to connect, the blocks
+        // below it stay active if they already have more work.
+        bool tipChanged;
+
+        explicit operator bool() const { return accepted; }
+    };
 
     /**
-     * Creates a new block from a pool of transactions.
+     * Adds a new block to the block tree after validation: its hash must
+     * match its content and meet the difficulty it declares, and its Merkle
+     * root must match its transactions. Blocks failing these checks are
+     * refused before any work is credited to them.
+     * The active chain switches to the block's branch when that branch has
+     * more cumulative work than the current one.
      */
-    Block createBlock(const std::vector<Transaction>& pool);
+    AddResult addBlock(const Block& newBlock);
+
+    /**
+     * Creates a new block from a pool of transactions, on top of the tip,
+     * with as many of them, in pool order, as fit in maxBytes of encoded
+     * transactions. Transactions spending the outputs of one left out are
+     * left out too. The block is not mined.
+     */
+    Block createBlock(const std::vector<Transaction>& pool, uint64_t maxBytes = UINT64_MAX);
 
     /**
      * Validates the entire blockchain for integrity.
@@ -39,22 +89,264 @@ public:
      */
     std::string serialize() const override;
 
+    /**
+     * Writes the same bytes as serialize() to out, one block at a time.
+     */
+    void serialize(std::ostream& out) const;
+
+    // Formats of exportBlocks()
+    enum class ExportFormat {
+        // The header and a line per transaction of each block, as print()
+        Text,
+        // BinaryExportMagic, then for each block its encoded size (u32),
+        // the CRC-32 of the encoding (u32) and Block::encode()
+        Binary,
+    };
+
+    static constexpr char BinaryExportMagic[9] = "BLOCKS01";
+
+    /**
+     * Writes the blocks of the active chain from height `from` to height
+     * `to` included (capped at the tip), one at a time, so memory use is
+     * bounded by the largest block whatever the range. Like other const
+     * accessors it may run alongside other readers while the chain doesn't
+     * change. Pruned blocks have no transactions to export: the text form
+     * says so and the binary form stops with an error. Returns false if a
+     * write fails.
+     */
+    bool exportBlocks(std::ostream& out, ExportFormat format,
+                      uint64_t from = 0, uint64_t to = UINT64_MAX) const;
+
+    /**
+     * Same as exportBlocks(std::ostream&), writing to a file descriptor
+     * through a fixed 64 KiB buffer.
+     */
+    bool exportBlocks(int fd, ExportFormat format,
+                      uint64_t from = 0, uint64_t to = UINT64_MAX) const;
+
     /**
      * Accessor to the latest block in the chain.
      */
-    const Block getLatestBlock() const { return _chain.back(); }
+    const Block& getLatestBlock() const { return _chain.back()->block; }
+
+    /**
+     * Accessor to the block of the active chain at the given height.
+     * The transactions of a pruned block are empty, once no snapshot taken
+     * before it was pruned is left.
+     */
+    const Block& getBlock(uint64_t height) const { return _chain.at(height)->block; }
+
+    /**
+     * Undo data of the block of the active chain at the given height, which
+     * lists the outputs it spent; empty for a pruned block.
+     */
+    const BlockUndo& getBlockUndo(uint64_t height) const { return _chain.at(height)->undo; }
+
+    /**
+     * Height of the active chain tip (the genesis block has height 0).
+     */
+    uint64_t getHeight() const { return _chain.back()->height; }
+
+    /**
+     * Cumulative work of the active chain.
+     */
+    uint64_t getChainWork() const { return _chain.back()->chainWork; }
+
+    /**
+     * Returns true if the block is known, whether on the active chain or not.
+     */
+    bool hasBlock(const std::string& hash) const { return _blockIndex.count(hash) != 0; }
+
+    /**
+     * Returns the known block with this hash, whether on the active chain or
+     * not, or nullptr. Pruned blocks are not returned: only their header is left.
+     */
+    const Block* findBlock(const std::string& hash) const;
+
+    /**
+     * Turns on pruning: the transactions and undo data of blocks more than
+     * keepDepth blocks below the tip are dropped, and so are those of the
+     * oldest blocks while the stored transactions exceed maxBodyBytes (the
+     * tip is always kept). Headers and the UTXO set are kept, so new blocks
+     * are still validated, but the chain can't be reorganized below the
+     * pruned blocks. keepDepth is at least 1.
+     */
+    void enablePruning(uint64_t keepDepth, uint64_t maxBodyBytes = UINT64_MAX);
+
+    /**
+     * Turns on the verification of input signatures when blocks connect.
+     * Inputs whose signature is in cache, usually verified when the
+     * transaction entered the mempool, are not verified again. cache may be
+     * nullptr and must outlive the chain.
+     */
+    void enableSignatureChecks(SignatureCache* cache = nullptr);
+
+    /**
+     * Returns true if the transactions of the known block with this hash
+     * were dropped.
+     */
+    bool isPruned(const std::string& hash) const;
+
+    /**
+     * Encoded size of the transactions still stored, over all known blocks.
+     */
+    uint64_t getBodyBytes() const { return _bodyBytes; }
+
+    // Heap bytes held by the chain, by part
+    struct MemoryUsage {
+        // Block tree: nodes, headers and hashes of every known block
+        uint64_t headers;
+        // Transactions of the blocks not pruned
+        uint64_t transactions;
+        // Undo data of the connected blocks
+        uint64_t undo;
+        uint64_t utxos;
+        // Chunks of the current snapshot view
+        uint64_t snapshots;
+
+        uint64_t total() const { return headers + transactions + undo + utxos + snapshots; }
+    };
+
+    /**
+     * Heap bytes held by the chain after the last addBlock(), counted from
+     * container capacities (see MemoryUsage.h). The parts are running totals
+     * kept as blocks come and go, so a call costs the same whatever the size
+     * of the chain. Like snapshot(), it may be called from any thread.
+     */
+    MemoryUsage getMemoryUsage() const;
+
+    /**
+     * Returns true if the block is part of the active chain.
+     */
+    bool isInActiveChain(const std::string& hash) const;
+
+    /**
+     * Accessor to the unspent outputs of the active chain.
+     */
+    const UTXOSet& getUTXOSet() const { return _utxos; }
+
+    /**
+     * Read-only view of the active chain after the last addBlock(). Unlike
+     * the other members, it may be called from any thread, while another
+     * thread changes the chain, and never blocks. The snapshot must not
+     * outlive the chain.
+     */
+    ChainSnapshot snapshot() const { return ChainSnapshot(_epochs, _snapshot); }
 
     /**
-     * Prints the entire blockchain to standard output.
+     * Registers a listener notified of every block connected to or
+     * disconnected from the active chain.
+     */
+    void addListener(ChainListener* listener);
+
+    /**
+     * Unregisters a listener.
+     */
+    void removeListener(ChainListener* listener);
+
+    /**
+     * Prints the entire blockchain to standard output, in the text form of
+     * exportBlocks().
      */
     void print() const;
 
 private:
+    // Node of the block tree
+    struct BlockIndex {
+        Block block;
+        BlockIndex* parent;
+        uint64_t height;
+        // Sum of the work of this block and all its ancestors
+        uint64_t chainWork;
+        // Spent outputs, valid while the block is connected
+        BlockUndo undo;
+        // Set when the block failed to connect; its descendants can't win
+        bool failed;
+        // Set when the transactions and undo data were dropped
+        bool pruned;
+        // Encoded size of the transactions, and their heap bytes
+        uint64_t bodyBytes;
+        uint64_t bodyMemory;
+
+        BlockIndex(const Block& block, BlockIndex* parent)
+            : block(block), parent(parent), height(0), chainWork(0), failed(false),
+              pruned(false), bodyBytes(0), bodyMemory(0) {}
+    };
+
     // The first block of a block chain
     // https://en.bitcoin.it/wiki/Genesis_block
     Block createGenesisBlock();
 
-    std::vector<Block> _chain;
+    void initialize(const Block& genesisBlock);
+
+    // Expected number of hashes needed to mine a block at this difficulty
+    static uint64_t blockWork(uint32_t difficulty);
+
+    // Switches the active chain to end at newTip. Returns false if a block of
+    // the branch fails to connect; the chain then ends below it if that part
+    // has more work than the old tip, or is restored otherwise.
+    bool activateBranch(BlockIndex* newTip);
+
+    // Last common block of the active chain and the branch ending at index
+    BlockIndex* findFork(BlockIndex* index) const;
+
+    bool connectTip(BlockIndex* index);
+    void disconnectTip();
+
+    // Records a new block in the block index
+    BlockIndex* insertBlock(std::unique_ptr<BlockIndex> index);
+
+    // Drops the bodies the pruning settings no longer keep
+    void pruneBlocks();
+
+    // Makes the active chain, as it is now, the view of new snapshots
+    void publishSnapshot();
+
+    // Updates the figures of getMemoryUsage()
+    void publishMemoryUsage();
+
+    // All known blocks by hash
+    std::unordered_map<std::string, std::unique_ptr<BlockIndex>> _blockIndex;
+    // Active chain, indexed by height
+    std::vector<BlockIndex*> _chain;
+    // State of the active chain
+    UTXOSet _utxos;
+    std::vector<ChainListener*> _listeners;
+
+    // Pruning settings; disabled while _pruneDepth is 0
+    uint64_t _pruneDepth;
+    uint64_t _maxBodyBytes;
+    uint64_t _bodyBytes;
+    // Blocks with their transactions, oldest first
+    std::set<std::pair<uint64_t, BlockIndex*>> _unpruned;
+
+    // Signature checks of connected blocks
+    bool _checkSignatures;
+    SignatureCache* _signatureCache;
+
+    // Running totals of heap bytes, and the figures published for
+    // getMemoryUsage(). Pruned bodies are counted until they are freed.
+    uint64_t _headerMemory;
+    uint64_t _bodyMemory;
+    uint64_t _undoMemory;
+    std::atomic<uint64_t> _publishedHeaders;
+    std::atomic<uint64_t> _publishedTransactions;
+    std::atomic<uint64_t> _publishedUndo;
+    std::atomic<uint64_t> _publishedUtxos;
+    std::atomic<uint64_t> _publishedSnapshots;
+
+    // Snapshots: the published view, and the writer's copy of its chunks.
+    // Chunk entries below _highWater may be read by a published view and
+    // are only changed in a private copy of their chunk.
+    mutable EpochManager _epochs;
+    std::atomic<const ChainSnapshot::View*> _snapshot;
+    std::vector<std::shared_ptr<ChainSnapshot::Chunk>> _chunks;
+    uint64_t _highWater;
+    // Lowest height changed since the last view
+    uint64_t _changedFrom;
+    uint64_t _prunedHeight;
+    // Pruned blocks whose bodies wait for the next view
+    std::vector<BlockIndex*> _prunedBodies;
 
 };
 
@@ -1,4 +1,5 @@
 #include "Blockheader.h"
+#include "MemoryUsage.h"
 #include <sstream>
 #include <iostream>
 
@@ -35,16 +36,23 @@ std::string BlockHeader::serialize() const
 
 // -----------------------------------------------------------------------------
 //  print()
-//  Prints all BlockHeader parameters to std::cout
+//  Prints all BlockHeader parameters to out, std::cout by default. Lines
+//  end with '\n' rather than std::endl so that printing a chain doesn't
+//  flush for every line.
 // -----------------------------------------------------------------------------
-void BlockHeader::print() const
+void BlockHeader::print(std::ostream& out) const
 {
-    std::cout << "BlockHeader Information:" << std::endl;
-    std::cout << "  Version: " << version << std::endl;
-    std::cout << "  Previous Block Hash: " << hashPrevBlock << std::endl;
-    std::cout << "  Merkle Root Hash: " << hashMerkleRoot << std::endl;
-    std::cout << "  Timestamp: " << timestamp << std::endl;
-    std::cout << "  Nonce: " << nonce << std::endl;
-    std::cout << "  Difficulty: " << difficulty << std::endl;
-    std::cout << "  Block Hash: " << blockHash << std::endl;
+    out << "BlockHeader Information:\n";
+    out << "  Version: " << version << "\n";
+    out << "  Previous Block Hash: " << hashPrevBlock << "\n";
+    out << "  Merkle Root Hash: " << hashMerkleRoot << "\n";
+    out << "  Timestamp: " << timestamp << "\n";
+    out << "  Nonce: " << nonce << "\n";
+    out << "  Difficulty: " << difficulty << "\n";
+    out << "  Block Hash: " << blockHash << "\n";
+}
+
+size_t BlockHeader::memoryUsage() const
+{
+    return dynamicUsage(hashPrevBlock) + dynamicUsage(hashMerkleRoot) + dynamicUsage(blockHash);
 }
@@ -2,6 +2,7 @@
 #define BLOCKHEADER_H
 
 #include "CoreObject.h"
+#include <iostream>
 #include <string>
 
 /**
@@ -56,8 +57,11 @@ public:
     // Serialize the transaction into a deterministic string
     std::string serialize() const override;
 
+    // Heap bytes held by the hash strings
+    size_t memoryUsage() const;
+
     // Print all BlockHeader parameters
-    void print() const;
+    void print(std::ostream& out = std::cout) const;
 
 };
 
@@ -0,0 +1,341 @@
+#include "ChainImporter.h"
+#include "Checksum.h"
+#include "Encoding.h"
+#include "SignatureCache.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const size_t MagicSize = sizeof(Blockchain::BinaryExportMagic) - 1;
+const size_t RecordHeaderSize = 8;
+// Larger sizes come from a corrupt record header
+const uint32_t MaxRecordSize = 1u << 28;
+
+// Block moving through the pipeline, numbered in file order
+struct Item {
+    uint64_t sequence;
+    Block block;
+    // Set by the stage that found the block invalid
+    const char* error;
+
+    Item() : sequence(0), block(""), error(nullptr) {}
+};
+
+// Blocking FIFO of at most capacity items. Once closed, push() fails and
+// pop() fails when the queue is empty.
+template <class T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : _capacity(std::max<size_t>(1, capacity)), _closed(false) {}
+
+    bool push(T&& item) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _notFull.wait(lock, [this] { return _closed || _items.size() < _capacity; });
+        if (_closed) {
+            return false;
+        }
+        _items.push_back(std::move(item));
+        _notEmpty.notify_one();
+        return true;
+    }
+
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _notEmpty.wait(lock, [this] { return _closed || !_items.empty(); });
+        if (_items.empty()) {
+            return false;
+        }
+        item = std::move(_items.front());
+        _items.pop_front();
+        _notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _closed = true;
+        _notFull.notify_all();
+        _notEmpty.notify_all();
+    }
+
+private:
+    const size_t _capacity;
+    std::mutex _mutex;
+    std::condition_variable _notFull;
+    std::condition_variable _notEmpty;
+    std::deque<T> _items;
+    bool _closed;
+};
+
+// Group of threads running the same stage; the last one to finish closes
+// the output queue
+template <class Body>
+void startStage(std::vector<std::thread>& threads, size_t count,
+                BoundedQueue<Item>& input, BoundedQueue<Item>& output, Body body)
+{
+    auto running = std::make_shared<std::atomic<size_t>>(count);
+    for (size_t i = 0; i < count; ++i) {
+        threads.emplace_back([&input, &output, body, running] {
+            Item item;
+            while (input.pop(item)) {
+                if (!item.error) {
+                    body(item);
+                }
+                if (!output.push(std::move(item))) {
+                    break;
+                }
+            }
+            if (running->fetch_sub(1) == 1) {
+                output.close();
+            }
+        });
+    }
+}
+
+// -----------------------------------------------------------------------------
+//  checkHashes()
+//  The Merkle root and the block hash are recomputed from the block's own
+//  content; they must match the header.
+// -----------------------------------------------------------------------------
+void checkHashes(Item& item)
+{
+    Block& block = item.block;
+    const std::string merkleRoot = block.getMerkleRoot();
+    const std::string hash = block.getHash();
+    block.computeMerkleRoot();
+    if (block.getMerkleRoot() != merkleRoot) {
+        item.error = "Merkle root mismatch";
+        return;
+    }
+    block.computeHash();
+    if (block.getHash() != hash || !block.validateBlock(block.getHeader().difficulty)) {
+        item.error = "invalid block hash";
+    }
+}
+
+// Verified signatures go to the cache, where the chain finds them; invalid
+// ones are left for the chain to reject
+void checkSignatures(Item& item, SignatureCache& cache)
+{
+    for (const auto& tx : item.block.getTransactions()) {
+        cacheInputSignatures(tx, cache);
+    }
+}
+
+// Reads one record; returns false at the end of the stream or on error
+bool readRecord(std::istream& in, std::string& payload, bool& corrupt)
+{
+    char header[RecordHeaderSize];
+    corrupt = false;
+    if (!in.read(header, RecordHeaderSize)) {
+        corrupt = in.gcount() != 0;
+        return false;
+    }
+    ByteReader reader(header, RecordHeaderSize);
+    uint32_t size, crc;
+    reader.readU32(size);
+    reader.readU32(crc);
+    if (size > MaxRecordSize) {
+        corrupt = true;
+        return false;
+    }
+    payload.resize(size);
+    if (!in.read(&payload[0], size) || crc32(payload.data(), size) != crc) {
+        corrupt = true;
+        return false;
+    }
+    return true;
+}
+
+bool readMagic(std::istream& in)
+{
+    char magic[MagicSize];
+    return in.read(magic, MagicSize) &&
+           std::memcmp(magic, Blockchain::BinaryExportMagic, MagicSize) == 0;
+}
+
+}
+
+ImportConfig::ImportConfig()
+    : hashThreads(0),
+      signatureThreads(0),
+      queueDepth(64),
+      maxBlocksInFlight(256)
+{
+}
+
+ChainImporter::ChainImporter(Blockchain& chain, SignatureCache* cache, const ImportConfig& config)
+    : _chain(chain),
+      _cache(cache),
+      _config(config),
+      _blocksConnected(0),
+      _blocksSkipped(0),
+      _bytesRead(0)
+{
+    const size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    if (_config.hashThreads == 0) {
+        _config.hashThreads = hardware;
+    }
+    if (_config.signatureThreads == 0) {
+        _config.signatureThreads = hardware;
+    }
+    _config.maxBlocksInFlight = std::max<size_t>(1, _config.maxBlocksInFlight);
+}
+
+bool ChainImporter::importFile(const std::string& path)
+{
+    std::ifstream in;
+    // Large reads keep the disk streaming
+    std::vector<char> buffer(1 << 20);
+    in.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    in.open(path, std::ios::binary);
+    if (!in) {
+        std::cerr << "Error: cannot open " << path << "\n";
+        return false;
+    }
+    return import(in);
+}
+
+bool ChainImporter::readFirstBlock(const std::string& path, Block& block)
+{
+    std::ifstream in(path, std::ios::binary);
+    std::string payload;
+    bool corrupt;
+    if (!readMagic(in) || !readRecord(in, payload, corrupt)) {
+        return false;
+    }
+    ByteReader reader(payload);
+    return Block::decode(reader, block) && reader.atEnd();
+}
+
+// -----------------------------------------------------------------------------
+//  import()
+//  The reader takes a slot for every block it parses and the connect stage
+//  frees it once the block is added. A corrupt record ends the reading, and
+//  the blocks before it are still added; a block failing a check closes all
+//  the queues, and the stages drain without adding anything more.
+// -----------------------------------------------------------------------------
+bool ChainImporter::import(std::istream& in)
+{
+    _blocksConnected = 0;
+    _blocksSkipped = 0;
+    _bytesRead = 0;
+    if (!readMagic(in)) {
+        std::cerr << "Error: not a block export\n";
+        return false;
+    }
+    _bytesRead = MagicSize;
+
+    BoundedQueue<Item> parsed(_config.queueDepth);
+    BoundedQueue<Item> hashed(_config.queueDepth);
+    BoundedQueue<Item> verified(_config.queueDepth);
+
+    std::mutex slotMutex;
+    std::condition_variable slotFreed;
+    size_t inFlight = 0;
+    bool stopped = false;
+    // Sequence number of the first bad record, if the reader met one
+    std::atomic<uint64_t> corruptAt(UINT64_MAX);
+
+    std::vector<std::thread> threads;
+    threads.emplace_back([&] {
+        std::string payload;
+        bool corrupt = false;
+        for (uint64_t sequence = 0;; ++sequence) {
+            {
+                std::unique_lock<std::mutex> lock(slotMutex);
+                slotFreed.wait(lock, [&] { return stopped || inFlight < _config.maxBlocksInFlight; });
+                if (stopped) {
+                    break;
+                }
+                ++inFlight;
+            }
+            Item item;
+            item.sequence = sequence;
+            if (!readRecord(in, payload, corrupt)) {
+                if (corrupt) {
+                    corruptAt = sequence;
+                }
+                break;
+            }
+            _bytesRead.fetch_add(RecordHeaderSize + payload.size(), std::memory_order_relaxed);
+            ByteReader reader(payload);
+            if (!Block::decode(reader, item.block) || !reader.atEnd()) {
+                corruptAt = sequence;
+                break;
+            }
+            if (!parsed.push(std::move(item))) {
+                break;
+            }
+        }
+        parsed.close();
+    });
+    startStage(threads, _config.hashThreads, parsed, hashed, checkHashes);
+    BoundedQueue<Item>* last = &hashed;
+    if (_cache) {
+        SignatureCache* cache = _cache;
+        startStage(threads, _config.signatureThreads, hashed, verified,
+                   [cache](Item& item) { checkSignatures(item, *cache); });
+        last = &verified;
+    }
+
+    // Connect stage, in file order
+    std::map<uint64_t, Item> pending;
+    uint64_t next = 0;
+    bool failed = false;
+    Item item;
+    while (last->pop(item)) {
+        pending.emplace(item.sequence, std::move(item));
+        for (auto it = pending.begin(); !failed && it != pending.end() && it->first == next;
+             it = pending.erase(it), ++next) {
+            const Block& block = it->second.block;
+            if (it->second.error) {
+                std::cerr << "Error: block " << next << " of the import: " << it->second.error << "\n";
+                failed = true;
+            } else if (_chain.hasBlock(block.getHash())) {
+                ++_blocksSkipped;
+            } else {
+                const Blockchain::AddResult result = _chain.addBlock(block);
+                if (result) {
+                    ++_blocksConnected;
+                } else {
+                    std::cerr << "Error: block " << next << " of the import was refused"
+                              << (result.tipChanged ? ", the chain ends at its valid ancestors\n" : "\n");
+                    failed = true;
+                }
+            }
+            std::lock_guard<std::mutex> lock(slotMutex);
+            --inFlight;
+            slotFreed.notify_one();
+        }
+        if (failed) {
+            {
+                std::lock_guard<std::mutex> lock(slotMutex);
+                stopped = true;
+                slotFreed.notify_all();
+            }
+            parsed.close();
+            hashed.close();
+            verified.close();
+        }
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    if (!failed && corruptAt.load() != UINT64_MAX) {
+        std::cerr << "Error: record " << corruptAt.load() << " of the import is corrupt\n";
+        failed = true;
+    }
+    return !failed;
+}
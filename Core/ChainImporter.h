@@ -0,0 +1,94 @@
+#ifndef CHAINIMPORTER_H
+#define CHAINIMPORTER_H
+
+#include "Blockchain.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+class SignatureCache;
+
+/**
+ * @file ChainImporter.h
+ * @brief Definition of the ChainImporter class, the bulk import of a block file.
+ * @details Reads a file written by Blockchain::exportBlocks() in binary form
+ *          and adds its blocks to a chain. The work is split in pipeline
+ *          stages, each on its own threads, with bounded queues between them:
+ *
+ *            read and parse    one thread: records are read, CRC-checked and
+ *                              decoded in file order
+ *            hash              txids, Merkle root and block hash recomputed
+ *                              and checked against the header
+ *            signatures        input signatures verified with the key they
+ *                              carry, and recorded in a SignatureCache
+ *            connect           the calling thread adds the blocks in file
+ *                              order
+ *
+ *          The hash and signature stages run several blocks at once, so
+ *          blocks can leave them out of order; the connect stage puts them
+ *          back in order. At most maxBlocksInFlight blocks are between the
+ *          reader and the chain, which bounds the memory used whatever the
+ *          size of the file. The signature stage only runs with a cache,
+ *          which should be the one given to Blockchain::enableSignatureChecks():
+ *          the chain then finds every signature in it and only checks that
+ *          the keys own the spent outputs.
+ */
+
+struct ImportConfig {
+    // Threads of the hash and signature stages (0: one per hardware thread)
+    size_t hashThreads;
+    size_t signatureThreads;
+    // Capacity of each queue between stages
+    size_t queueDepth;
+    // Blocks read but not yet connected
+    size_t maxBlocksInFlight;
+
+    ImportConfig();
+};
+
+class ChainImporter {
+public:
+
+    explicit ChainImporter(Blockchain& chain, SignatureCache* cache = nullptr,
+                           const ImportConfig& config = ImportConfig());
+
+    ChainImporter(const ChainImporter&) = delete;
+    ChainImporter& operator=(const ChainImporter&) = delete;
+
+    /**
+     * Imports the blocks of the file at path. Blocks the chain already knows
+     * are skipped. Returns false, after connecting the blocks before it, at
+     * the first record that is corrupt, fails a check or is refused by the
+     * chain.
+     */
+    bool importFile(const std::string& path);
+
+    /**
+     * Same as importFile(), reading from a stream.
+     */
+    bool import(std::istream& in);
+
+    /**
+     * Reads the first block of an exported file, usually the genesis block
+     * the importing chain has to be created with.
+     */
+    static bool readFirstBlock(const std::string& path, Block& block);
+
+    // Counters of the last import
+    uint64_t getBlocksConnected() const { return _blocksConnected; }
+    uint64_t getBlocksSkipped() const { return _blocksSkipped; }
+    uint64_t getBytesRead() const { return _bytesRead.load(std::memory_order_relaxed); }
+
+private:
+    Blockchain& _chain;
+    SignatureCache* _cache;
+    ImportConfig _config;
+
+    uint64_t _blocksConnected;
+    uint64_t _blocksSkipped;
+    std::atomic<uint64_t> _bytesRead;
+};
+
+#endif // CHAINIMPORTER_H
@@ -0,0 +1,26 @@
+#ifndef CHAINLISTENER_H
+#define CHAINLISTENER_H
+
+#include "UTXOSet.h"
+
+/**
+ * @file ChainListener.h
+ * @brief Definition of the ChainListener interface, notified of active chain changes.
+ * @details Components that derive data from the active chain (mempool, indexes,
+ *          caches) register with Blockchain::addListener(). They are told about
+ *          every block connected to or disconnected from the tip, together with
+ *          the block's undo data, so they can be updated incrementally, including
+ *          across reorganizations.
+ */
+class ChainListener {
+public:
+    virtual ~ChainListener() = default;
+
+    // Called after block was connected at height; undo lists the outputs it spent
+    virtual void blockConnected(const Block& block, const BlockUndo& undo, uint64_t height) = 0;
+
+    // Called after block was disconnected from height, before its undo data is dropped
+    virtual void blockDisconnected(const Block& block, const BlockUndo& undo, uint64_t height) = 0;
+};
+
+#endif // CHAINLISTENER_H
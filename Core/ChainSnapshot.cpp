@@ -0,0 +1,37 @@
+#include "ChainSnapshot.h"
+
+ChainSnapshot::ChainSnapshot(EpochManager& epochs, const std::atomic<const View*>& current)
+    : _epochs(&epochs),
+      _slot(epochs.pin()),
+      _view(current.load())
+{
+}
+
+ChainSnapshot::ChainSnapshot(ChainSnapshot&& other) noexcept
+    : _epochs(other._epochs),
+      _slot(other._slot),
+      _view(other._view)
+{
+    other._epochs = nullptr;
+}
+
+ChainSnapshot& ChainSnapshot::operator=(ChainSnapshot&& other) noexcept
+{
+    if (this != &other) {
+        if (_epochs) {
+            _epochs->unpin(_slot);
+        }
+        _epochs = other._epochs;
+        _slot = other._slot;
+        _view = other._view;
+        other._epochs = nullptr;
+    }
+    return *this;
+}
+
+ChainSnapshot::~ChainSnapshot()
+{
+    if (_epochs) {
+        _epochs->unpin(_slot);
+    }
+}
@@ -0,0 +1,105 @@
+#ifndef CHAINSNAPSHOT_H
+#define CHAINSNAPSHOT_H
+
+#include "Block.h"
+#include "EpochManager.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @file ChainSnapshot.h
+ * @brief Definition of the ChainSnapshot class, a read-only view of the active chain.
+ * @details Blockchain::snapshot() returns the active chain as it was after
+ *          the last change: tip, chain work and the block at every height.
+ *          Any thread can take and read a snapshot while another thread adds
+ *          blocks; readers never take a lock. The chain publishes a new view
+ *          once per addBlock(), so a reorganization is seen whole or not at
+ *          all. A view lists its blocks in fixed chunks of pointers shared
+ *          with the next view, so appending a block copies no chunk and a
+ *          reorganization copies only the chunks it rewrites. Blocks are
+ *          never freed; the bodies of pruned blocks and old views are, once
+ *          no snapshot taken before they were dropped is left.
+ */
+class ChainSnapshot {
+public:
+
+    static const size_t ChunkSize = 1024;
+
+    // Blocks of the active chain at ChunkSize consecutive heights
+    struct Chunk {
+        const Block* blocks[ChunkSize];
+    };
+
+    // Immutable once published
+    struct View {
+        std::vector<std::shared_ptr<Chunk>> chunks;
+        uint64_t length;
+        uint64_t chainWork;
+        // Blocks below this height have no transactions
+        uint64_t prunedHeight;
+    };
+
+    ChainSnapshot(ChainSnapshot&& other) noexcept;
+    ChainSnapshot& operator=(ChainSnapshot&& other) noexcept;
+
+    ChainSnapshot(const ChainSnapshot&) = delete;
+    ChainSnapshot& operator=(const ChainSnapshot&) = delete;
+
+    /**
+     * Releases the view; the chain may then free what only it used.
+     */
+    ~ChainSnapshot();
+
+    /**
+     * Height of the tip (the genesis block has height 0).
+     */
+    uint64_t getHeight() const { return _view->length - 1; }
+
+    /**
+     * Cumulative work of the chain.
+     */
+    uint64_t getChainWork() const { return _view->chainWork; }
+
+    /**
+     * Hash of the tip.
+     */
+    const std::string& getTipHash() const { return block(getHeight())->getHash(); }
+
+    /**
+     * Header of the block at height, which must not exceed getHeight().
+     */
+    const BlockHeader& getHeader(uint64_t height) const { return block(height)->getHeader(); }
+
+    /**
+     * Block at height, or nullptr if its transactions were pruned or height
+     * exceeds getHeight(). Valid while the snapshot is.
+     */
+    const Block* getBlock(uint64_t height) const {
+        return height < _view->prunedHeight || height >= _view->length ? nullptr : block(height);
+    }
+
+    /**
+     * Blocks below this height have been pruned.
+     */
+    uint64_t getPrunedHeight() const { return _view->prunedHeight; }
+
+private:
+    friend class Blockchain;
+
+    // Pins an epoch, then loads the current view
+    ChainSnapshot(EpochManager& epochs, const std::atomic<const View*>& current);
+
+    const Block* block(uint64_t height) const {
+        return _view->chunks[height / ChunkSize]->blocks[height % ChunkSize];
+    }
+
+    EpochManager* _epochs;
+    size_t _slot;
+    const View* _view;
+};
+
+#endif // CHAINSNAPSHOT_H
@@ -0,0 +1,48 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @file Checksum.h
+ * @brief CRC-32 (IEEE 802.3, as in zlib) for detecting torn or corrupted records
+ *        in the files written by the library.
+ * https://en.wikipedia.org/wiki/Cyclic_redundancy_check
+ */
+
+namespace checksum_detail {
+
+struct Crc32Table {
+    uint32_t entries[256];
+
+    constexpr Crc32Table() : entries{} {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ ((crc & 1) ? 0xedb88320u : 0);
+            }
+            entries[i] = crc;
+        }
+    }
+};
+
+constexpr Crc32Table crc32Table;
+
+}
+
+/**
+ * CRC-32 of size bytes. Pass the previous result as crc to checksum data in
+ * several pieces.
+ */
+inline uint32_t crc32(const void* data, size_t size, uint32_t crc = 0)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = checksum_detail::crc32Table.entries[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+#endif // CHECKSUM_H
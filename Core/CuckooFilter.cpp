@@ -0,0 +1,216 @@
+#include "CuckooFilter.h"
+#include "Encoding.h"
+#include <algorithm>
+
+namespace {
+
+const uint64_t SlotBits = 16;
+const uint64_t SlotMask = 0xffff;
+// Lowest bit of each slot
+const uint64_t LowBits = 0x0001000100010001ULL;
+const uint64_t HighBits = 0x8000800080008000ULL;
+
+// High bit set in each slot of word equal to zero
+inline uint64_t zeroSlots(uint64_t word)
+{
+    return (word - LowBits) & ~word & HighBits;
+}
+
+inline uint16_t slot(uint64_t word, unsigned i)
+{
+    return static_cast<uint16_t>(word >> (i * SlotBits));
+}
+
+}
+
+CuckooFilter::CuckooFilter(size_t capacity)
+    : _mask(0),
+      _count(0),
+      _hasVictim(false),
+      _victim(0),
+      _victimBucket(0)
+{
+    size_t buckets = 1;
+    while (buckets * SlotsPerBucket * 95 / 100 < capacity) {
+        buckets <<= 1;
+    }
+    _buckets.assign(buckets, 0);
+    _mask = buckets - 1;
+}
+
+uint16_t CuckooFilter::fingerprint(uint64_t key)
+{
+    const uint16_t fp = static_cast<uint16_t>(key >> 48);
+    return fp ? fp : 1;
+}
+
+size_t CuckooFilter::primaryBucket(uint64_t key) const
+{
+    return static_cast<size_t>(key) & _mask;
+}
+
+// -----------------------------------------------------------------------------
+//  alternateBucket()
+//  XOR with a hash of the fingerprint is its own inverse, so either bucket of
+//  a fingerprint gives the other without the original key.
+// -----------------------------------------------------------------------------
+size_t CuckooFilter::alternateBucket(size_t bucket, uint16_t fp) const
+{
+    return (bucket ^ static_cast<size_t>(fp * 0x5bd1e995ULL)) & _mask;
+}
+
+bool CuckooFilter::bucketContains(size_t bucket, uint16_t fp) const
+{
+    // A slot equal to fp becomes zero
+    return zeroSlots(_buckets[bucket] ^ (fp * LowBits)) != 0;
+}
+
+bool CuckooFilter::insertInto(size_t bucket, uint16_t fp)
+{
+    if (!zeroSlots(_buckets[bucket])) {
+        return false;
+    }
+    unsigned i = 0;
+    while (slot(_buckets[bucket], i) != 0) {
+        ++i;
+    }
+    _buckets[bucket] |= static_cast<uint64_t>(fp) << (i * SlotBits);
+    return true;
+}
+
+bool CuckooFilter::eraseFrom(size_t bucket, uint16_t fp)
+{
+    for (unsigned i = 0; i < SlotsPerBucket; ++i) {
+        if (slot(_buckets[bucket], i) == fp) {
+            _buckets[bucket] &= ~(SlotMask << (i * SlotBits));
+            return true;
+        }
+    }
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+//  insert()
+//  When both buckets are full, a random resident is moved to its other
+//  bucket, possibly displacing another, until a free slot is found.
+// -----------------------------------------------------------------------------
+bool CuckooFilter::insert(uint64_t key)
+{
+    if (_hasVictim) {
+        return false;
+    }
+    return insertFingerprint(primaryBucket(key), fingerprint(key));
+}
+
+bool CuckooFilter::insertFingerprint(size_t bucket, uint16_t fp)
+{
+    if (insertInto(bucket, fp) || insertInto(alternateBucket(bucket, fp), fp)) {
+        ++_count;
+        return true;
+    }
+
+    // Cheap deterministic choice of the slot to evict
+    uint64_t state = bucket ^ (static_cast<uint64_t>(fp) << 32);
+    bucket = alternateBucket(bucket, fp);
+    for (unsigned kick = 0; kick < MaxKicks; ++kick) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        const unsigned i = static_cast<unsigned>(state >> 62);
+        const uint16_t evicted = slot(_buckets[bucket], i);
+        _buckets[bucket] = (_buckets[bucket] & ~(SlotMask << (i * SlotBits))) |
+                           (static_cast<uint64_t>(fp) << (i * SlotBits));
+        fp = evicted;
+        bucket = alternateBucket(bucket, fp);
+        if (insertInto(bucket, fp)) {
+            ++_count;
+            return true;
+        }
+    }
+
+    // The last evicted fingerprint is kept aside so no key is lost
+    _hasVictim = true;
+    _victim = fp;
+    _victimBucket = bucket;
+    ++_count;
+    return false;
+}
+
+bool CuckooFilter::contains(uint64_t key) const
+{
+    const uint16_t fp = fingerprint(key);
+    const size_t bucket = primaryBucket(key);
+    if (bucketContains(bucket, fp) || bucketContains(alternateBucket(bucket, fp), fp)) {
+        return true;
+    }
+    return _hasVictim && _victim == fp &&
+           (_victimBucket == bucket || _victimBucket == alternateBucket(bucket, fp));
+}
+
+bool CuckooFilter::erase(uint64_t key)
+{
+    const uint16_t fp = fingerprint(key);
+    const size_t bucket = primaryBucket(key);
+    if (eraseFrom(bucket, fp) || eraseFrom(alternateBucket(bucket, fp), fp)) {
+        --_count;
+        // The freed slot may take the victim back
+        if (_hasVictim) {
+            _hasVictim = false;
+            --_count;
+            insertFingerprint(_victimBucket, _victim);
+        }
+        return true;
+    }
+    if (_hasVictim && _victim == fp &&
+        (_victimBucket == bucket || _victimBucket == alternateBucket(bucket, fp))) {
+        _hasVictim = false;
+        --_count;
+        return true;
+    }
+    return false;
+}
+
+void CuckooFilter::clear()
+{
+    std::fill(_buckets.begin(), _buckets.end(), 0);
+    _count = 0;
+    _hasVictim = false;
+}
+
+void CuckooFilter::encode(std::string& output) const
+{
+    ByteWriter writer(output);
+    writer.writeVarInt(_buckets.size());
+    writer.writeVarInt(_count);
+    writer.writeU8(_hasVictim ? 1 : 0);
+    writer.writeU32(_victim);
+    writer.writeVarInt(_victimBucket);
+    for (uint64_t bucket : _buckets) {
+        writer.writeU64(bucket);
+    }
+}
+
+bool CuckooFilter::decode(ByteReader& reader, CuckooFilter& filter)
+{
+    uint64_t buckets, count, victimBucket;
+    uint8_t hasVictim;
+    uint32_t victim;
+    if (!reader.readVarInt(buckets) || !reader.readVarInt(count) ||
+        !reader.readU8(hasVictim) || !reader.readU32(victim) || !reader.readVarInt(victimBucket)) {
+        return false;
+    }
+    // A power of two, and no more than the bytes left
+    if (buckets == 0 || (buckets & (buckets - 1)) != 0 || buckets > reader.remaining() / 8 ||
+        victimBucket >= buckets || victim > SlotMask || hasVictim > 1) {
+        return false;
+    }
+
+    filter._buckets.resize(static_cast<size_t>(buckets));
+    for (auto& bucket : filter._buckets) {
+        reader.readU64(bucket);
+    }
+    filter._mask = static_cast<size_t>(buckets - 1);
+    filter._count = static_cast<size_t>(count);
+    filter._hasVictim = hasVictim != 0;
+    filter._victim = static_cast<uint16_t>(victim);
+    filter._victimBucket = static_cast<size_t>(victimBucket);
+    return true;
+}
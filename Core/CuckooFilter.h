@@ -0,0 +1,101 @@
+#ifndef CUCKOOFILTER_H
+#define CUCKOOFILTER_H
+
+#include "MemoryUsage.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ByteReader;
+
+/**
+ * @file CuckooFilter.h
+ * @brief Definition of the CuckooFilter class, an approximate set of 64-bit keys.
+ * @details Each key is stored as a 16-bit fingerprint in one of two buckets of
+ *          four slots. A bucket is a single 64-bit word, so a lookup reads at
+ *          most two words and compares the four fingerprints of each at once.
+ *          contains() never misses a key that was inserted and returns a false
+ *          positive for about 0.01% of the other keys at full load. Unlike a
+ *          Bloom filter, keys can be erased; a key inserted twice must be
+ *          erased twice.
+ * https://www.cs.cmu.edu/~dga/papers/cuckoo-conext2014.pdf
+ */
+class CuckooFilter {
+public:
+
+    /**
+     * Creates a filter sized for capacity keys at 95% load.
+     */
+    explicit CuckooFilter(size_t capacity = 1024);
+
+    /**
+     * Adds a key. Returns false if the filter is full; the key is still
+     * found by contains(), but nothing more can be inserted.
+     */
+    bool insert(uint64_t key);
+
+    /**
+     * Returns true if the key may have been inserted, false if it was not.
+     */
+    bool contains(uint64_t key) const;
+
+    /**
+     * Removes one copy of a key previously inserted. Erasing a key that was
+     * never inserted may remove another key sharing its fingerprint.
+     */
+    bool erase(uint64_t key);
+
+    void clear();
+
+    /**
+     * Number of keys stored.
+     */
+    size_t size() const { return _count; }
+
+    /**
+     * Number of slots.
+     */
+    size_t slotCount() const { return _buckets.size() * SlotsPerBucket; }
+
+    bool full() const { return _hasVictim; }
+
+    /**
+     * Heap bytes held by the buckets (see MemoryUsage.h).
+     */
+    size_t memoryUsage() const { return dynamicUsage(_buckets); }
+
+    /**
+     * Appends the filter to output in a binary form read back by decode().
+     */
+    void encode(std::string& output) const;
+
+    static bool decode(ByteReader& reader, CuckooFilter& filter);
+
+private:
+    static const unsigned SlotsPerBucket = 4;
+    // Evictions tried before an insertion gives up
+    static const unsigned MaxKicks = 500;
+
+    static uint16_t fingerprint(uint64_t key);
+    size_t primaryBucket(uint64_t key) const;
+    // The other bucket of a fingerprint found in bucket
+    size_t alternateBucket(size_t bucket, uint16_t fp) const;
+
+    // Stores fp in bucket or its alternate, evicting residents if needed
+    bool insertFingerprint(size_t bucket, uint16_t fp);
+    bool bucketContains(size_t bucket, uint16_t fp) const;
+    bool insertInto(size_t bucket, uint16_t fp);
+    bool eraseFrom(size_t bucket, uint16_t fp);
+
+    // Four fingerprints per bucket, 0 marks a free slot
+    std::vector<uint64_t> _buckets;
+    size_t _mask;
+    size_t _count;
+    // Fingerprint evicted by the last failed insertion
+    bool _hasVictim;
+    uint16_t _victim;
+    size_t _victimBucket;
+};
+
+#endif // CUCKOOFILTER_H
@@ -0,0 +1,154 @@
+#ifndef ENCODING_H
+#define ENCODING_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+/**
+ * @file Encoding.h
+ * @brief Definition of the ByteWriter and ByteReader classes for binary encodings.
+ * @details serialize() produces the text used for hashing, which can't be parsed
+ *          back. The binary encoding is the parseable form used to store and
+ *          transmit blocks and transactions: integers are little-endian, counts
+ *          and string lengths are variable-length integers (CompactSize).
+ * https://en.bitcoin.it/wiki/Protocol_documentation#Variable_length_integer
+ */
+
+class ByteWriter {
+public:
+    explicit ByteWriter(std::string& output) : _output(output) {}
+
+    void writeU8(uint8_t value) { _output.push_back(static_cast<char>(value)); }
+
+    void writeU32(uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            _output.push_back(static_cast<char>(value >> (8 * i)));
+        }
+    }
+
+    void writeU64(uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            _output.push_back(static_cast<char>(value >> (8 * i)));
+        }
+    }
+
+    void writeVarInt(uint64_t value) {
+        if (value < 0xfd) {
+            writeU8(static_cast<uint8_t>(value));
+        } else if (value <= 0xffff) {
+            writeU8(0xfd);
+            writeU8(static_cast<uint8_t>(value));
+            writeU8(static_cast<uint8_t>(value >> 8));
+        } else if (value <= 0xffffffff) {
+            writeU8(0xfe);
+            writeU32(static_cast<uint32_t>(value));
+        } else {
+            writeU8(0xff);
+            writeU64(value);
+        }
+    }
+
+    void writeString(const std::string& value) {
+        writeVarInt(value.size());
+        _output.append(value);
+    }
+
+    // Number of bytes written by writeVarInt(value)
+    static size_t varIntSize(uint64_t value) {
+        return value < 0xfd ? 1 : value <= 0xffff ? 3 : value <= 0xffffffff ? 5 : 9;
+    }
+
+    // Number of bytes written by writeString(value)
+    static size_t stringSize(const std::string& value) {
+        return varIntSize(value.size()) + value.size();
+    }
+
+private:
+    std::string& _output;
+};
+
+class ByteReader {
+public:
+    ByteReader(const char* data, size_t size) : _data(data), _end(data + size) {}
+    explicit ByteReader(const std::string& data) : ByteReader(data.data(), data.size()) {}
+
+    bool readU8(uint8_t& value) {
+        if (_end - _data < 1) {
+            return false;
+        }
+        value = static_cast<uint8_t>(*_data++);
+        return true;
+    }
+
+    bool readU32(uint32_t& value) {
+        if (_end - _data < 4) {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= static_cast<uint32_t>(static_cast<uint8_t>(_data[i])) << (8 * i);
+        }
+        _data += 4;
+        return true;
+    }
+
+    bool readU64(uint64_t& value) {
+        if (_end - _data < 8) {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < 8; ++i) {
+            value |= static_cast<uint64_t>(static_cast<uint8_t>(_data[i])) << (8 * i);
+        }
+        _data += 8;
+        return true;
+    }
+
+    bool readVarInt(uint64_t& value) {
+        uint8_t prefix;
+        if (!readU8(prefix)) {
+            return false;
+        }
+        if (prefix < 0xfd) {
+            value = prefix;
+            return true;
+        }
+        if (prefix == 0xfd) {
+            uint8_t low, high;
+            if (!readU8(low) || !readU8(high)) {
+                return false;
+            }
+            value = low | (static_cast<uint64_t>(high) << 8);
+            return true;
+        }
+        if (prefix == 0xfe) {
+            uint32_t value32;
+            if (!readU32(value32)) {
+                return false;
+            }
+            value = value32;
+            return true;
+        }
+        return readU64(value);
+    }
+
+    bool readString(std::string& value) {
+        uint64_t size;
+        if (!readVarInt(size) || size > remaining()) {
+            return false;
+        }
+        value.assign(_data, static_cast<size_t>(size));
+        _data += size;
+        return true;
+    }
+
+    size_t remaining() const { return static_cast<size_t>(_end - _data); }
+    bool atEnd() const { return _data == _end; }
+
+private:
+    const char* _data;
+    const char* _end;
+};
+
+#endif // ENCODING_H
@@ -0,0 +1,70 @@
+#include "EpochManager.h"
+#include <thread>
+
+EpochManager::EpochManager()
+    : _epoch(1)
+{
+    for (Slot& slot : _slots) {
+        slot.epoch.store(Free, std::memory_order_relaxed);
+    }
+}
+
+EpochManager::~EpochManager()
+{
+    for (auto& retired : _retired) {
+        retired.second();
+    }
+}
+
+// -----------------------------------------------------------------------------
+//  pin()
+//  A thread starts at the slot it used last, which is almost always free, so
+//  pinning costs one compare-and-swap. The epoch read may already be stale
+//  when the slot is claimed; an older pinned epoch only delays reclamation.
+//  Every operation is sequentially consistent: the slot is claimed before
+//  the reader loads any shared pointer, in the order the writer sees.
+// -----------------------------------------------------------------------------
+size_t EpochManager::pin()
+{
+    thread_local size_t hint = 0;
+    for (;;) {
+        for (size_t i = 0; i < MaxReaders; ++i) {
+            const size_t slot = (hint + i) % MaxReaders;
+            uint64_t expected = Free;
+            if (_slots[slot].epoch.load(std::memory_order_relaxed) == Free &&
+                _slots[slot].epoch.compare_exchange_strong(expected, _epoch.load())) {
+                hint = slot;
+                return slot;
+            }
+        }
+        std::this_thread::yield();
+    }
+}
+
+void EpochManager::unpin(size_t slot)
+{
+    _slots[slot].epoch.store(Free, std::memory_order_release);
+}
+
+void EpochManager::retire(std::function<void()> reclaim)
+{
+    _retired.emplace_back(_epoch.fetch_add(1), std::move(reclaim));
+}
+
+size_t EpochManager::collect()
+{
+    uint64_t oldest = UINT64_MAX;
+    for (const Slot& slot : _slots) {
+        const uint64_t epoch = slot.epoch.load();
+        if (epoch != Free && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+    size_t reclaimed = 0;
+    while (!_retired.empty() && _retired.front().first < oldest) {
+        _retired.front().second();
+        _retired.pop_front();
+        ++reclaimed;
+    }
+    return reclaimed;
+}
@@ -0,0 +1,84 @@
+#ifndef EPOCHMANAGER_H
+#define EPOCHMANAGER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <utility>
+
+/**
+ * @file EpochManager.h
+ * @brief Definition of the EpochManager class, epoch-based reclamation for one writer.
+ * @details Readers pin the current epoch before they load a shared pointer
+ *          and unpin it once they no longer use what it points to. The
+ *          writer replaces the pointer, then retires the old object with the
+ *          epoch it was replaced in, and advances the epoch. An object
+ *          retired in epoch e is reclaimed once every pinned reader pinned
+ *          an epoch after e: those readers loaded the pointer after it was
+ *          replaced. A reader pins by claiming one of MaxReaders slots and
+ *          never waits for the writer; the writer never waits for readers,
+ *          it reclaims what it can and leaves the rest for a later collect().
+ *          Slots are cache-line sized so readers on different cores don't
+ *          share a line.
+ */
+class EpochManager {
+public:
+
+    // Readers pinned at the same time, beyond which pin() spins
+    static const size_t MaxReaders = 256;
+
+    EpochManager();
+
+    /**
+     * Runs every retired reclaim function; no reader may be pinned.
+     */
+    ~EpochManager();
+
+    EpochManager(const EpochManager&) = delete;
+    EpochManager& operator=(const EpochManager&) = delete;
+
+    /**
+     * Pins the current epoch; returns the slot to pass to unpin(). Objects
+     * loaded after pin() stay valid until unpin(). Thread-safe.
+     */
+    size_t pin();
+
+    /**
+     * Releases a slot returned by pin(). Thread-safe.
+     */
+    void unpin(size_t slot);
+
+    /**
+     * Writer only: schedules reclaim, which frees objects readers can no
+     * longer reach, for when the readers pinned so far are gone. Advances
+     * the epoch.
+     */
+    void retire(std::function<void()> reclaim);
+
+    /**
+     * Writer only: runs the reclaim functions no pinned reader can still
+     * need, oldest first. Returns how many ran.
+     */
+    size_t collect();
+
+    /**
+     * Writer only: number of reclaim functions waiting for readers.
+     */
+    size_t pending() const { return _retired.size(); }
+
+private:
+    // Epoch pinned by a reader, or Free
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch;
+    };
+    static const uint64_t Free = 0;
+
+    Slot _slots[MaxReaders];
+    // Starts at 1, so no pinned epoch is Free
+    std::atomic<uint64_t> _epoch;
+    std::deque<std::pair<uint64_t, std::function<void()>>> _retired;
+};
+
+#endif // EPOCHMANAGER_H
@@ -0,0 +1,652 @@
+#include "HeaderStore.h"
+#include "Checksum.h"
+#include "Encoding.h"
+#include "Hex.h"
+#include "MemoryUsage.h"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// File header: format, then the number of headers
+const char Magic[8] = {'H', 'D', 'R', 'S', 'T', 'O', 'R', '1'};
+const size_t FileHeaderSize = 16;
+
+// Exception log header, then records: length, CRC-32, payload
+const char ExceptionMagic[8] = {'H', 'D', 'R', 'E', 'X', 'C', '0', '1'};
+const size_t ExceptionHeaderSize = 8;
+
+// Record layout
+const size_t HashOffset = 0;
+const size_t MerkleRootOffset = 32;
+const size_t TimeDeltaOffset = 64;
+const size_t NonceOffset = 68;
+const size_t DifficultyOffset = 72;
+const size_t VersionOffset = 76;
+
+// Time delta of a header kept in the exception table
+const uint32_t Escaped = 0x80000000;
+
+// The timestamp of every AnchorInterval-th header is kept in memory
+const uint64_t AnchorInterval = 64;
+
+// Smallest mapping, in records
+const uint64_t MinCapacity = 4096;
+
+uint32_t loadU32(const unsigned char* p)
+{
+    return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+           static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+}
+
+void storeU32(unsigned char* p, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i) {
+        p[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+uint64_t loadU64(const unsigned char* p)
+{
+    return static_cast<uint64_t>(loadU32(p)) | static_cast<uint64_t>(loadU32(p + 4)) << 32;
+}
+
+void storeU64(unsigned char* p, uint64_t value)
+{
+    storeU32(p, static_cast<uint32_t>(value));
+    storeU32(p + 4, static_cast<uint32_t>(value >> 32));
+}
+
+// Hashes the library computes: 64 lowercase hex digits, which decode and
+// encode back to the same string. The digits of a hash are random, so the
+// check has no branch per digit.
+bool isPackedHash(const std::string& hash)
+{
+    if (hash.size() != 64) {
+        return false;
+    }
+    unsigned valid = 1;
+    for (char c : hash) {
+        const unsigned char digit = static_cast<unsigned char>(c);
+        valid &= static_cast<unsigned>(static_cast<unsigned>(digit - '0') < 10u) |
+                 static_cast<unsigned>(static_cast<unsigned>(digit - 'a') < 6u);
+    }
+    return valid != 0;
+}
+
+// Signed difference of two timestamps, if it fits a record
+bool timeDelta(uint64_t previous, uint64_t timestamp, uint32_t& delta)
+{
+    if (timestamp >= previous) {
+        if (timestamp - previous > INT32_MAX) {
+            return false;
+        }
+        delta = static_cast<uint32_t>(timestamp - previous);
+    } else {
+        if (previous - timestamp > INT32_MAX) {
+            return false;
+        }
+        delta = static_cast<uint32_t>(-static_cast<int64_t>(previous - timestamp));
+    }
+    return true;
+}
+
+bool syncFile(std::FILE* file)
+{
+    if (std::fflush(file) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+}
+
+HeaderStore::HeaderStore(const std::string& path)
+    : _path(path),
+      _open(false),
+      _count(0),
+      _capacity(0),
+      _lastTimestamp(0),
+      _base(nullptr),
+      _mappedBytes(0),
+#ifdef _WIN32
+      _fileHandle(INVALID_HANDLE_VALUE),
+      _mapping(nullptr)
+#else
+      _fd(-1)
+#endif
+{
+}
+
+HeaderStore::~HeaderStore()
+{
+    close();
+}
+
+// -----------------------------------------------------------------------------
+//  open()
+//  A record escaped to the exception table is only valid once its exception
+//  was logged; the headers from the first one missing, torn by a crash, on
+//  are dropped.
+// -----------------------------------------------------------------------------
+bool HeaderStore::open()
+{
+    if (_open) {
+        return true;
+    }
+
+    uint64_t fileSize = 0;
+    if (!_path.empty()) {
+#ifdef _WIN32
+        _fileHandle = CreateFileA(_path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+                                  OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        LARGE_INTEGER size;
+        if (_fileHandle == INVALID_HANDLE_VALUE || !GetFileSizeEx(_fileHandle, &size)) {
+            std::cerr << "Error: can't open header store " << _path << "\n";
+            unmap();
+            return false;
+        }
+        fileSize = static_cast<uint64_t>(size.QuadPart);
+#else
+        _fd = ::open(_path.c_str(), O_RDWR | O_CREAT, 0644);
+        struct stat status;
+        if (_fd < 0 || fstat(_fd, &status) != 0) {
+            std::cerr << "Error: can't open header store " << _path << "\n";
+            unmap();
+            return false;
+        }
+        fileSize = static_cast<uint64_t>(status.st_size);
+#endif
+    }
+
+    if (fileSize != 0 && fileSize < FileHeaderSize) {
+        std::cerr << "Error: " << _path << " is not a header store\n";
+        unmap();
+        return false;
+    }
+    const uint64_t records = fileSize == 0 ? 0 : (fileSize - FileHeaderSize) / RecordSize;
+    if (!map(std::max(MinCapacity, records))) {
+        std::cerr << "Error: can't map header store " << _path << "\n";
+        unmap();
+        return false;
+    }
+
+    if (fileSize == 0) {
+        std::memcpy(_base, Magic, sizeof(Magic));
+        storeU64(_base + sizeof(Magic), 0);
+    } else if (std::memcmp(_base, Magic, sizeof(Magic)) != 0 ||
+               loadU64(_base + sizeof(Magic)) > records) {
+        std::cerr << "Error: " << _path << " is not a header store\n";
+        unmap();
+        return false;
+    }
+    _count = loadU64(_base + sizeof(Magic));
+    _open = true;
+
+    if (!_path.empty() && !loadExceptions()) {
+        close();
+        return false;
+    }
+
+    // Rebuild the timestamp index
+    uint64_t timestamp = 0;
+    for (uint64_t height = 0; height < _count; ++height) {
+        const unsigned char* rec = record(height);
+        if (loadU32(rec + TimeDeltaOffset) == Escaped || height == 0) {
+            auto it = _exceptions.find(height);
+            if (it == _exceptions.end()) {
+                truncate(height);
+                break;
+            }
+            timestamp = it->second.timestamp;
+        } else {
+            timestamp += static_cast<int32_t>(loadU32(rec + TimeDeltaOffset));
+        }
+        if (height % AnchorInterval == 0) {
+            _anchors.push_back(timestamp);
+        }
+        _lastTimestamp = timestamp;
+    }
+    return true;
+}
+
+void HeaderStore::close()
+{
+    if (!_open) {
+        return;
+    }
+    sync();
+    const uint64_t used = FileHeaderSize + _count * RecordSize;
+    unmap();
+    // Give the unused capacity back
+    if (!_path.empty()) {
+        std::error_code error;
+        std::filesystem::resize_file(_path, used, error);
+    }
+    _open = false;
+    _count = 0;
+    _lastTimestamp = 0;
+    _anchors.clear();
+    _exceptions.clear();
+}
+
+// -----------------------------------------------------------------------------
+//  map()
+//  A file mapping grows with the file; an anonymous one is copied to a
+//  bigger one.
+// -----------------------------------------------------------------------------
+bool HeaderStore::map(uint64_t capacity)
+{
+    const size_t bytes = static_cast<size_t>(FileHeaderSize + capacity * RecordSize);
+#ifdef _WIN32
+    HANDLE file = _path.empty() ? INVALID_HANDLE_VALUE : static_cast<HANDLE>(_fileHandle);
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE,
+                                        static_cast<DWORD>(static_cast<uint64_t>(bytes) >> 32),
+                                        static_cast<DWORD>(bytes), nullptr);
+    if (!mapping) {
+        return false;
+    }
+    unsigned char* base = static_cast<unsigned char*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes));
+    if (!base) {
+        CloseHandle(mapping);
+        return false;
+    }
+    if (_base) {
+        if (_path.empty()) {
+            std::memcpy(base, _base, _mappedBytes);
+        }
+        UnmapViewOfFile(_base);
+        CloseHandle(static_cast<HANDLE>(_mapping));
+    }
+    _mapping = mapping;
+#else
+    void* address;
+    if (_path.empty()) {
+        address = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    } else {
+        if (ftruncate(_fd, static_cast<off_t>(bytes)) != 0) {
+            return false;
+        }
+        address = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    }
+    if (address == MAP_FAILED) {
+        return false;
+    }
+    unsigned char* base = static_cast<unsigned char*>(address);
+    if (_base) {
+        if (_path.empty()) {
+            std::memcpy(base, _base, _mappedBytes);
+        }
+        munmap(_base, _mappedBytes);
+    }
+#endif
+    _base = base;
+    _mappedBytes = bytes;
+    _capacity = capacity;
+    return true;
+}
+
+void HeaderStore::unmap()
+{
+#ifdef _WIN32
+    if (_base) {
+        UnmapViewOfFile(_base);
+        CloseHandle(static_cast<HANDLE>(_mapping));
+        _mapping = nullptr;
+    }
+    if (_fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(static_cast<HANDLE>(_fileHandle));
+        _fileHandle = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (_base) {
+        munmap(_base, _mappedBytes);
+    }
+    if (_fd >= 0) {
+        ::close(_fd);
+        _fd = -1;
+    }
+#endif
+    _base = nullptr;
+    _mappedBytes = 0;
+    _capacity = 0;
+}
+
+bool HeaderStore::sync()
+{
+    if (!_open || _path.empty()) {
+        return true;
+    }
+#ifdef _WIN32
+    return FlushViewOfFile(_base, _mappedBytes) && FlushFileBuffers(static_cast<HANDLE>(_fileHandle));
+#else
+    return msync(_base, _mappedBytes, MS_SYNC) == 0;
+#endif
+}
+
+unsigned char* HeaderStore::record(uint64_t height) const
+{
+    return _base + FileHeaderSize + height * RecordSize;
+}
+
+bool HeaderStore::isException(uint64_t height) const
+{
+    return loadU32(record(height) + TimeDeltaOffset) == Escaped;
+}
+
+// -----------------------------------------------------------------------------
+//  append()
+//  The first header is always an exception: it has no previous record for its
+//  hashPrevBlock and timestamp.
+// -----------------------------------------------------------------------------
+bool HeaderStore::append(const BlockHeader& header)
+{
+    if (!_open) {
+        return false;
+    }
+    if (_count == _capacity && !map(2 * _capacity)) {
+        std::cerr << "Error: can't grow header store " << _path << "\n";
+        return false;
+    }
+
+    uint32_t delta = 0;
+    const bool packedHash = isPackedHash(header.blockHash);
+    const bool packed = _count > 0 &&
+                        packedHash &&
+                        isPackedHash(header.hashMerkleRoot) &&
+                        header.version <= UINT32_MAX &&
+                        timeDelta(_lastTimestamp, header.timestamp, delta) &&
+                        delta != Escaped &&
+                        linksTo(header.hashPrevBlock, _count - 1);
+
+    if (!packed) {
+        if (!_path.empty() && !appendException(_count, header)) {
+            std::cerr << "Error: can't write header store exceptions " << _path << "\n";
+            return false;
+        }
+        _exceptions[_count] = header;
+    }
+
+    unsigned char* rec = record(_count);
+    std::memset(rec, 0, RecordSize);
+    // The hash links the next record even for an exception
+    if (packedHash) {
+        hexDecode(header.blockHash.data(), 32, rec + HashOffset);
+    }
+    if (packed) {
+        hexDecode(header.hashMerkleRoot.data(), 32, rec + MerkleRootOffset);
+        storeU32(rec + TimeDeltaOffset, delta);
+        storeU32(rec + NonceOffset, header.nonce);
+        storeU32(rec + DifficultyOffset, header.difficulty);
+        storeU32(rec + VersionOffset, static_cast<uint32_t>(header.version));
+    } else {
+        storeU32(rec + TimeDeltaOffset, Escaped);
+    }
+
+    if (_count % AnchorInterval == 0) {
+        _anchors.push_back(header.timestamp);
+    }
+    _lastTimestamp = header.timestamp;
+    ++_count;
+    storeU64(_base + sizeof(Magic), _count);
+    return true;
+}
+
+void HeaderStore::truncate(uint64_t count)
+{
+    if (count >= _count) {
+        return;
+    }
+
+    bool dropped = false;
+    for (auto it = _exceptions.begin(); it != _exceptions.end();) {
+        if (it->first >= count) {
+            it = _exceptions.erase(it);
+            dropped = true;
+        } else {
+            ++it;
+        }
+    }
+    // The count goes first: an exception logged above it is ignored on open
+    _count = count;
+    storeU64(_base + sizeof(Magic), _count);
+    if (dropped && !_path.empty()) {
+        rewriteExceptions();
+    }
+
+    _anchors.resize(static_cast<size_t>((count + AnchorInterval - 1) / AnchorInterval));
+    _lastTimestamp = count > 0 ? getTimestamp(count - 1) : 0;
+}
+
+// Compares binary hashes, without encoding the stored one
+bool HeaderStore::linksTo(const std::string& prevHash, uint64_t height) const
+{
+    if (isException(height)) {
+        return prevHash == _exceptions.at(height).blockHash;
+    }
+    unsigned char hash[32];
+    return isPackedHash(prevHash) && hexDecode(prevHash.data(), sizeof(hash), hash) &&
+           std::memcmp(hash, record(height) + HashOffset, sizeof(hash)) == 0;
+}
+
+std::string HeaderStore::getHash(uint64_t height) const
+{
+    if (isException(height)) {
+        return _exceptions.at(height).blockHash;
+    }
+    return toHex(record(height) + HashOffset, 32);
+}
+
+uint64_t HeaderStore::getTimestamp(uint64_t height) const
+{
+    const uint64_t anchor = height - height % AnchorInterval;
+    uint64_t timestamp = _anchors[static_cast<size_t>(anchor / AnchorInterval)];
+    for (uint64_t i = anchor + 1; i <= height; ++i) {
+        const uint32_t delta = loadU32(record(i) + TimeDeltaOffset);
+        timestamp = delta == Escaped ? _exceptions.at(i).timestamp
+                                     : timestamp + static_cast<int32_t>(delta);
+    }
+    return timestamp;
+}
+
+BlockHeader HeaderStore::get(uint64_t height) const
+{
+    BlockHeader header;
+    uint64_t timestamp = height > 0 ? getTimestamp(height - 1) : 0;
+    unpack(height, timestamp, header);
+    return header;
+}
+
+// -----------------------------------------------------------------------------
+//  unpack()
+//  The strings of header are overwritten in place, so a scan reusing the same
+//  header does not allocate.
+// -----------------------------------------------------------------------------
+void HeaderStore::unpack(uint64_t height, uint64_t& timestamp, BlockHeader& header) const
+{
+    const unsigned char* rec = record(height);
+    const uint32_t delta = loadU32(rec + TimeDeltaOffset);
+    if (delta == Escaped) {
+        header = _exceptions.at(height);
+        timestamp = header.timestamp;
+        return;
+    }
+
+    timestamp += static_cast<int32_t>(delta);
+    header.version = loadU32(rec + VersionOffset);
+    header.timestamp = timestamp;
+    header.nonce = loadU32(rec + NonceOffset);
+    header.difficulty = loadU32(rec + DifficultyOffset);
+    header.blockHash.resize(64);
+    hexEncode(rec + HashOffset, 32, &header.blockHash[0]);
+    header.hashMerkleRoot.resize(64);
+    hexEncode(rec + MerkleRootOffset, 32, &header.hashMerkleRoot[0]);
+    if (isException(height - 1)) {
+        header.hashPrevBlock = _exceptions.at(height - 1).blockHash;
+    } else {
+        header.hashPrevBlock.resize(64);
+        hexEncode(record(height - 1) + HashOffset, 32, &header.hashPrevBlock[0]);
+    }
+}
+
+size_t HeaderStore::memoryUsage() const
+{
+    size_t bytes = static_cast<size_t>(_count * RecordSize) + dynamicUsage(_anchors) +
+                   dynamicUsage(_exceptions);
+    for (const auto& entry : _exceptions) {
+        bytes += entry.second.memoryUsage();
+    }
+    return bytes;
+}
+
+// ---- exception log ----
+
+namespace {
+
+void encodeException(uint64_t height, const BlockHeader& header, std::string& output)
+{
+    std::string payload;
+    ByteWriter writer(payload);
+    writer.writeU64(height);
+    writer.writeU64(header.version);
+    writer.writeString(header.hashPrevBlock);
+    writer.writeString(header.hashMerkleRoot);
+    writer.writeU64(header.timestamp);
+    writer.writeU32(header.nonce);
+    writer.writeU32(header.difficulty);
+    writer.writeString(header.blockHash);
+
+    ByteWriter record(output);
+    record.writeU32(static_cast<uint32_t>(payload.size()));
+    record.writeU32(crc32(payload.data(), payload.size()));
+    output += payload;
+}
+
+bool decodeException(ByteReader& reader, uint64_t& height, BlockHeader& header)
+{
+    return reader.readU64(height) &&
+           reader.readU64(header.version) &&
+           reader.readString(header.hashPrevBlock) &&
+           reader.readString(header.hashMerkleRoot) &&
+           reader.readU64(header.timestamp) &&
+           reader.readU32(header.nonce) &&
+           reader.readU32(header.difficulty) &&
+           reader.readString(header.blockHash) &&
+           reader.atEnd();
+}
+
+}
+
+// -----------------------------------------------------------------------------
+//  loadExceptions()
+//  Exceptions of dropped headers and a torn last record are left out, and the
+//  log is rewritten without them.
+// -----------------------------------------------------------------------------
+bool HeaderStore::loadExceptions()
+{
+    const std::string path = _path + ".exc";
+    std::string data;
+    if (std::FILE* file = std::fopen(path.c_str(), "rb")) {
+        char chunk[64 * 1024];
+        size_t read;
+        while ((read = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+            data.append(chunk, read);
+        }
+        std::fclose(file);
+    }
+    if (data.empty()) {
+        return rewriteExceptions();
+    }
+    if (data.size() < ExceptionHeaderSize || data.compare(0, sizeof(ExceptionMagic), ExceptionMagic, sizeof(ExceptionMagic)) != 0) {
+        std::cerr << "Error: " << path << " is not a header store exception log\n";
+        return false;
+    }
+
+    size_t offset = ExceptionHeaderSize;
+    bool clean = true;
+    while (offset < data.size()) {
+        ByteReader header(data.data() + offset, data.size() - offset);
+        uint32_t length, crc;
+        if (!header.readU32(length) || !header.readU32(crc) || header.remaining() < length) {
+            clean = false;
+            break;
+        }
+        const char* payload = data.data() + offset + 8;
+        ByteReader fields(payload, length);
+        uint64_t height;
+        BlockHeader exception;
+        if (crc32(payload, length) != crc || !decodeException(fields, height, exception)) {
+            clean = false;
+            break;
+        }
+        offset += 8 + length;
+        if (height >= _count) {
+            clean = false;
+            continue;
+        }
+        _exceptions[height] = exception;
+    }
+    return clean || rewriteExceptions();
+}
+
+bool HeaderStore::appendException(uint64_t height, const BlockHeader& header)
+{
+    std::string record;
+    encodeException(height, header, record);
+    std::FILE* file = std::fopen((_path + ".exc").c_str(), "ab");
+    if (!file) {
+        return false;
+    }
+    const bool ok = std::fwrite(record.data(), 1, record.size(), file) == record.size() && syncFile(file);
+    std::fclose(file);
+    return ok;
+}
+
+// -----------------------------------------------------------------------------
+//  rewriteExceptions()
+//  Written to a temporary file and renamed over the log, so a crash leaves
+//  either log whole.
+// -----------------------------------------------------------------------------
+bool HeaderStore::rewriteExceptions()
+{
+    std::string data(ExceptionMagic, sizeof(ExceptionMagic));
+    for (const auto& entry : _exceptions) {
+        encodeException(entry.first, entry.second, data);
+    }
+
+    const std::string path = _path + ".exc";
+    const std::string temporary = path + ".tmp";
+    std::FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Error: can't write " << temporary << "\n";
+        return false;
+    }
+    const bool ok = std::fwrite(data.data(), 1, data.size(), file) == data.size() && syncFile(file);
+    std::fclose(file);
+    std::error_code error;
+    if (ok) {
+        std::filesystem::rename(temporary, path, error);
+    }
+    if (!ok || error) {
+        std::cerr << "Error: can't write " << path << "\n";
+        return false;
+    }
+    return true;
+}
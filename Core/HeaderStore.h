@@ -0,0 +1,159 @@
+#ifndef HEADERSTORE_H
+#define HEADERSTORE_H
+
+#include "Blockheader.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @file HeaderStore.h
+ * @brief Definition of the HeaderStore class, a packed array of block headers.
+ * @details A BlockHeader holds three hex strings and takes about 400 bytes of
+ *          memory with their allocations. The store keeps each header of a
+ *          chain in a fixed 80-byte record instead:
+ *
+ *            block hash       32 bytes, binary
+ *            Merkle root      32 bytes, binary
+ *            timestamp delta   4 bytes, from the previous header
+ *            nonce             4 bytes
+ *            difficulty        4 bytes
+ *            version           4 bytes
+ *
+ *          The previous block hash is not stored: it is the hash of the
+ *          previous record. Headers that don't fit (the first one, hashes
+ *          that are not 64 lowercase hex digits, a timestamp far from the
+ *          previous one, a version over 32 bits) are kept whole in an
+ *          exception table, and their record only holds what links the chain.
+ *          The records are a contiguous memory-mapped array, so 10M headers
+ *          take 800 MB of file, loaded on demand by the OS, and a scan reads
+ *          memory sequentially. The timestamp of every 64th header is kept
+ *          in memory so a single header is decoded without a full scan.
+ *          The exception table is logged next to the file, in <path>.exc.
+ */
+class HeaderStore {
+public:
+
+    static const size_t RecordSize = 80;
+
+    /**
+     * Creates a store in the file at path, or in anonymous memory if path
+     * is empty.
+     */
+    explicit HeaderStore(const std::string& path = std::string());
+
+    ~HeaderStore();
+
+    HeaderStore(const HeaderStore&) = delete;
+    HeaderStore& operator=(const HeaderStore&) = delete;
+
+    /**
+     * Maps the file, creating it if needed, and loads the exception table.
+     * Returns false if the files can't be read or written or are not header
+     * stores.
+     */
+    bool open();
+
+    /**
+     * Writes the headers back to the file and unmaps it.
+     */
+    void close();
+
+    /**
+     * Appends the header of the next block. Its hashPrevBlock should be the
+     * hash of the last header; when it isn't, the header is stored as an
+     * exception. Returns false if the file can't grow.
+     */
+    bool append(const BlockHeader& header);
+
+    /**
+     * Drops the headers from height count on, after a reorganization.
+     */
+    void truncate(uint64_t count);
+
+    /**
+     * Number of headers.
+     */
+    uint64_t size() const { return _count; }
+
+    /**
+     * Header at the given height, which must be below size().
+     */
+    BlockHeader get(uint64_t height) const;
+
+    /**
+     * Hash and timestamp of the header at the given height, without building
+     * the whole header.
+     */
+    std::string getHash(uint64_t height) const;
+    uint64_t getTimestamp(uint64_t height) const;
+
+    /**
+     * Calls visitor(height, header) for every header from height from on,
+     * in order. The header object is reused between calls.
+     */
+    template <typename F>
+    void forEach(F&& visitor, uint64_t from = 0) const {
+        BlockHeader header;
+        uint64_t timestamp = from > 0 && from < _count ? getTimestamp(from - 1) : 0;
+        for (uint64_t height = from; height < _count; ++height) {
+            unpack(height, timestamp, header);
+            visitor(height, static_cast<const BlockHeader&>(header));
+        }
+    }
+
+    /**
+     * Writes the mapped records to disk; exceptions are synced as they are
+     * logged.
+     */
+    bool sync();
+
+    /**
+     * Number of headers kept in the exception table.
+     */
+    size_t exceptionCount() const { return _exceptions.size(); }
+
+    /**
+     * Bytes of the records in use, plus the in-memory timestamp index and
+     * exception table.
+     */
+    size_t memoryUsage() const;
+
+private:
+    // Maps capacity records; the previous mapping is released
+    bool map(uint64_t capacity);
+    void unmap();
+
+    unsigned char* record(uint64_t height) const;
+    // Decodes the header at height; timestamp is the one of the previous
+    // header on entry and of this one on return
+    void unpack(uint64_t height, uint64_t& timestamp, BlockHeader& header) const;
+    bool isException(uint64_t height) const;
+    // Returns true if prevHash is the hash of the header at height
+    bool linksTo(const std::string& prevHash, uint64_t height) const;
+
+    bool loadExceptions();
+    bool appendException(uint64_t height, const BlockHeader& header);
+    bool rewriteExceptions();
+
+    std::string _path;
+    bool _open;
+    uint64_t _count;
+    uint64_t _capacity;
+    uint64_t _lastTimestamp;
+    // Start of the mapping: the file header, then the records
+    unsigned char* _base;
+    size_t _mappedBytes;
+#ifdef _WIN32
+    void* _fileHandle;
+    void* _mapping;
+#else
+    int _fd;
+#endif
+    // Timestamp of every AnchorInterval-th header
+    std::vector<uint64_t> _anchors;
+    std::unordered_map<uint64_t, BlockHeader> _exceptions;
+};
+
+#endif // HEADERSTORE_H
@@ -0,0 +1,302 @@
+#include "Hex.h"
+#include <cstdint>
+
+// SIMD implementations are compiled for x86 with per-function target
+// attributes, so the rest of the library needs no special compiler flags.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HEX_X86 1
+#define HEX_TARGET(isa) __attribute__((target(isa)))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define HEX_X86 1
+#define HEX_TARGET(isa)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace {
+
+const char HexDigits[] = "0123456789abcdef";
+
+// Two characters per byte value
+struct EncodeTable {
+    char pairs[256][2];
+
+    constexpr EncodeTable() : pairs{} {
+        for (int i = 0; i < 256; ++i) {
+            pairs[i][0] = HexDigits[i >> 4];
+            pairs[i][1] = HexDigits[i & 0x0f];
+        }
+    }
+};
+
+// Value of each character, or -1
+struct DecodeTable {
+    int8_t values[256];
+
+    constexpr DecodeTable() : values{} {
+        for (int i = 0; i < 256; ++i) {
+            values[i] = -1;
+        }
+        for (int i = 0; i < 10; ++i) {
+            values['0' + i] = static_cast<int8_t>(i);
+        }
+        for (int i = 0; i < 6; ++i) {
+            values['a' + i] = static_cast<int8_t>(10 + i);
+            values['A' + i] = static_cast<int8_t>(10 + i);
+        }
+    }
+};
+
+// Built at compile time, so they are usable during static initialization
+constexpr EncodeTable encodeTable;
+constexpr DecodeTable decodeTable;
+
+void encodeScalar(const unsigned char* data, size_t size, char* out)
+{
+    for (size_t i = 0; i < size; ++i) {
+        out[2 * i] = encodeTable.pairs[data[i]][0];
+        out[2 * i + 1] = encodeTable.pairs[data[i]][1];
+    }
+}
+
+bool decodeScalar(const char* hex, size_t size, unsigned char* out)
+{
+    for (size_t i = 0; i < size; ++i) {
+        const int high = decodeTable.values[static_cast<unsigned char>(hex[2 * i])];
+        const int low = decodeTable.values[static_cast<unsigned char>(hex[2 * i + 1])];
+        if ((high | low) < 0) {
+            return false;
+        }
+        out[i] = static_cast<unsigned char>((high << 4) | low);
+    }
+    return true;
+}
+
+#ifdef HEX_X86
+
+// -----------------------------------------------------------------------------
+//  SSSE3
+//  Encoding splits each byte into nibbles and maps them to characters with a
+//  pshufb lookup. Decoding maps '0'-'9' and 'a'-'f' (case folded) to values,
+//  rejects anything else, and merges nibble pairs with pmaddubsw.
+// -----------------------------------------------------------------------------
+HEX_TARGET("ssse3")
+void encodeSSSE3(const unsigned char* data, size_t size, char* out)
+{
+    const __m128i lut = _mm_loadu_si128(reinterpret_cast<const __m128i*>(HexDigits));
+    const __m128i mask = _mm_set1_epi8(0x0f);
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const __m128i high = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(bytes, 4), mask));
+        const __m128i low = _mm_shuffle_epi8(lut, _mm_and_si128(bytes, mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i), _mm_unpacklo_epi8(high, low));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i + 16), _mm_unpackhi_epi8(high, low));
+    }
+    encodeScalar(data + i, size - i, out + 2 * i);
+}
+
+// Nibble values of 16 characters; valid is set to 0xffff if all are hex digits
+HEX_TARGET("ssse3")
+inline __m128i nibblesSSSE3(__m128i chars, int& valid)
+{
+    const __m128i digits = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+    const __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+    const __m128i letters = _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    const __m128i isLetter = _mm_cmpeq_epi8(_mm_min_epu8(letters, _mm_set1_epi8(5)), letters);
+    valid = _mm_movemask_epi8(_mm_or_si128(isDigit, isLetter));
+    return _mm_or_si128(_mm_and_si128(isDigit, digits),
+                        _mm_and_si128(isLetter, _mm_add_epi8(letters, _mm_set1_epi8(10))));
+}
+
+HEX_TARGET("ssse3")
+bool decodeSSSE3(const char* hex, size_t size, unsigned char* out)
+{
+    // High nibble weighs 16, low nibble 1
+    const __m128i weights = _mm_set1_epi16(0x0110);
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        int valid0, valid1;
+        const __m128i first = nibblesSSSE3(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(hex + 2 * i)), valid0);
+        const __m128i second = nibblesSSSE3(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(hex + 2 * i + 16)), valid1);
+        if ((valid0 & valid1) != 0xffff) {
+            return false;
+        }
+        const __m128i bytes = _mm_packus_epi16(_mm_maddubs_epi16(first, weights),
+                                               _mm_maddubs_epi16(second, weights));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), bytes);
+    }
+    return decodeScalar(hex + 2 * i, size - i, out + i);
+}
+
+// -----------------------------------------------------------------------------
+//  AVX2
+//  Same as SSSE3 on 32 bytes; the unpack and pack instructions work within
+//  128-bit lanes, so the halves are put back in order with permutes.
+// -----------------------------------------------------------------------------
+HEX_TARGET("avx2")
+void encodeAVX2(const unsigned char* data, size_t size, char* out)
+{
+    const __m256i lut = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(HexDigits)));
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const __m256i high = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), mask));
+        const __m256i low = _mm256_shuffle_epi8(lut, _mm256_and_si256(bytes, mask));
+        const __m256i first = _mm256_unpacklo_epi8(high, low);
+        const __m256i second = _mm256_unpackhi_epi8(high, low);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i),
+                            _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i + 32),
+                            _mm256_permute2x128_si256(first, second, 0x31));
+    }
+    encodeSSSE3(data + i, size - i, out + 2 * i);
+}
+
+HEX_TARGET("avx2")
+inline __m256i nibblesAVX2(__m256i chars, unsigned& valid)
+{
+    const __m256i digits = _mm256_sub_epi8(chars, _mm256_set1_epi8('0'));
+    const __m256i isDigit = _mm256_cmpeq_epi8(_mm256_min_epu8(digits, _mm256_set1_epi8(9)), digits);
+    const __m256i letters = _mm256_sub_epi8(_mm256_or_si256(chars, _mm256_set1_epi8(0x20)),
+                                            _mm256_set1_epi8('a'));
+    const __m256i isLetter = _mm256_cmpeq_epi8(_mm256_min_epu8(letters, _mm256_set1_epi8(5)), letters);
+    valid = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(isDigit, isLetter)));
+    return _mm256_or_si256(_mm256_and_si256(isDigit, digits),
+                           _mm256_and_si256(isLetter, _mm256_add_epi8(letters, _mm256_set1_epi8(10))));
+}
+
+HEX_TARGET("avx2")
+bool decodeAVX2(const char* hex, size_t size, unsigned char* out)
+{
+    const __m256i weights = _mm256_set1_epi16(0x0110);
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        unsigned valid0, valid1;
+        const __m256i first = nibblesAVX2(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hex + 2 * i)), valid0);
+        const __m256i second = nibblesAVX2(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hex + 2 * i + 32)), valid1);
+        if ((valid0 & valid1) != 0xffffffffu) {
+            return false;
+        }
+        const __m256i packed = _mm256_packus_epi16(_mm256_maddubs_epi16(first, weights),
+                                                   _mm256_maddubs_epi16(second, weights));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                            _mm256_permute4x64_epi64(packed, 0xd8));
+    }
+    return decodeSSSE3(hex + 2 * i, size - i, out + i);
+}
+
+bool cpuSupports(HexImpl impl)
+{
+#if defined(__GNUC__)
+    __builtin_cpu_init();
+    return impl == HexImpl::AVX2 ? __builtin_cpu_supports("avx2") != 0
+                                 : __builtin_cpu_supports("ssse3") != 0;
+#else
+    int info[4];
+    __cpuid(info, 1);
+    if (impl == HexImpl::SSSE3) {
+        return (info[2] & (1 << 9)) != 0;
+    }
+    // AVX2 also needs the OS to save the YMM registers (OSXSAVE + XCR0)
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!osxsave || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#endif
+}
+
+#endif // HEX_X86
+
+HexImpl detectImpl()
+{
+#ifdef HEX_X86
+    if (cpuSupports(HexImpl::AVX2)) {
+        return HexImpl::AVX2;
+    }
+    if (cpuSupports(HexImpl::SSSE3)) {
+        return HexImpl::SSSE3;
+    }
+#endif
+    return HexImpl::Scalar;
+}
+
+// Zero-initialized to Scalar until the detection runs
+const HexImpl bestImpl = detectImpl();
+
+}
+
+HexImpl hexImpl()
+{
+    return bestImpl;
+}
+
+bool hexImplSupported(HexImpl impl)
+{
+#ifdef HEX_X86
+    return impl == HexImpl::Scalar || cpuSupports(impl);
+#else
+    return impl == HexImpl::Scalar;
+#endif
+}
+
+void hexEncode(HexImpl impl, const unsigned char* data, size_t size, char* out)
+{
+    switch (impl) {
+#ifdef HEX_X86
+    case HexImpl::AVX2:
+        encodeAVX2(data, size, out);
+        return;
+    case HexImpl::SSSE3:
+        encodeSSSE3(data, size, out);
+        return;
+#endif
+    default:
+        encodeScalar(data, size, out);
+        return;
+    }
+}
+
+bool hexDecode(HexImpl impl, const char* hex, size_t size, unsigned char* out)
+{
+    switch (impl) {
+#ifdef HEX_X86
+    case HexImpl::AVX2:
+        return decodeAVX2(hex, size, out);
+    case HexImpl::SSSE3:
+        return decodeSSSE3(hex, size, out);
+#endif
+    default:
+        return decodeScalar(hex, size, out);
+    }
+}
+
+void hexEncode(const unsigned char* data, size_t size, char* out)
+{
+    hexEncode(bestImpl, data, size, out);
+}
+
+bool hexDecode(const char* hex, size_t size, unsigned char* out)
+{
+    return hexDecode(bestImpl, hex, size, out);
+}
+
+std::string toHex(const unsigned char* data, size_t size)
+{
+    std::string hex(2 * size, '\0');
+    hexEncode(bestImpl, data, size, &hex[0]);
+    return hex;
+}
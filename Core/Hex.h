@@ -0,0 +1,56 @@
+#ifndef HEX_H
+#define HEX_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @file Hex.h
+ * @brief Hexadecimal encoding and decoding of hashes and other binary data.
+ * @details Hashes are stored and compared as lowercase hex strings, so every
+ *          SHA-256 computed by the library goes through hexEncode(). The codec
+ *          writes into caller-provided buffers and picks the fastest
+ *          implementation the CPU supports at run time: AVX2 (32 bytes per
+ *          step), SSSE3 (16 bytes per step) or a table-driven scalar loop.
+ */
+
+enum class HexImpl {
+    Scalar,
+    SSSE3,
+    AVX2,
+};
+
+/**
+ * Writes 2 * size lowercase hex characters to out (not null-terminated).
+ */
+void hexEncode(const unsigned char* data, size_t size, char* out);
+
+/**
+ * Reads 2 * size hex characters (either case) into size bytes.
+ * Returns false if a character is not a hex digit; out is then unspecified.
+ */
+bool hexDecode(const char* hex, size_t size, unsigned char* out);
+
+/**
+ * Returns the hex string of data.
+ */
+std::string toHex(const unsigned char* data, size_t size);
+
+/**
+ * Implementation used by hexEncode() and hexDecode().
+ */
+HexImpl hexImpl();
+
+/**
+ * Returns true if the CPU can run the implementation.
+ */
+bool hexImplSupported(HexImpl impl);
+
+/**
+ * Same as hexEncode() and hexDecode() with a given implementation, which must
+ * be supported. Meant for tests and benchmarks.
+ */
+void hexEncode(HexImpl impl, const unsigned char* data, size_t size, char* out);
+bool hexDecode(HexImpl impl, const char* hex, size_t size, unsigned char* out);
+
+#endif // HEX_H
@@ -0,0 +1,191 @@
+#include "IngestQueue.h"
+#include "Mempool.h"
+#include "SignatureCache.h"
+#include <algorithm>
+#include <iterator>
+#include <thread>
+
+IngestConfig::IngestConfig()
+    : capacity(1 << 16),
+      maxTasks(0),
+      batchSize(256)
+{
+}
+
+IngestQueue::IngestQueue(SignatureCache* cache, const IngestConfig& config, ThreadPool& pool)
+    : _cache(cache),
+      _config(config),
+      _pool(pool),
+      _staged(config.capacity),
+      _nextPosition(0),
+      _readyCount(0),
+      _activeTasks(0),
+      _tasks(0),
+      _stopping(false),
+      _drained(0),
+      _refused(0),
+      _accepted(0),
+      _rejected(0)
+{
+    _config.capacity = _staged.capacity();
+    if (_config.maxTasks == 0) {
+        _config.maxTasks = _pool.threadCount();
+    }
+    _config.batchSize = std::max<size_t>(1, _config.batchSize);
+}
+
+IngestQueue::~IngestQueue()
+{
+    _stopping = true;
+    while (_tasks.load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+    }
+}
+
+// -----------------------------------------------------------------------------
+//  submit()
+//  The fence pairs with the one of a finishing task: either this thread sees
+//  the task's slot released and schedules a new one, or the task sees the
+//  transaction and keeps running.
+// -----------------------------------------------------------------------------
+bool IngestQueue::submit(Transaction&& tx)
+{
+    if (!_staged.tryPush(std::move(tx))) {
+        _refused.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_activeTasks.load(std::memory_order_relaxed) < _config.maxTasks &&
+        _readyCount.load(std::memory_order_relaxed) < _config.capacity) {
+        schedule();
+    }
+    return true;
+}
+
+bool IngestQueue::submit(const Transaction& tx)
+{
+    Transaction copy(tx);
+    return submit(std::move(copy));
+}
+
+// -----------------------------------------------------------------------------
+//  drain()
+//  Batches are taken under the lock and added after it is released, so the
+//  tasks keep preparing while the mempool works. Tasks may finish their
+//  batches out of order; only the batches following the last one drained
+//  are taken, the others wait for the gap to be filled. Room made in the
+//  prepared batches lets stopped tasks start again.
+// -----------------------------------------------------------------------------
+size_t IngestQueue::drain(Mempool& mempool, size_t maxCount)
+{
+    std::vector<std::vector<Transaction>> batches;
+    size_t taken = 0;
+    {
+        std::lock_guard<std::mutex> lock(_readyMutex);
+        while (taken < maxCount && !_ready.empty() && _ready.begin()->first == _nextPosition) {
+            std::vector<Transaction>& front = _ready.begin()->second;
+            const size_t count = std::min(front.size(), maxCount - taken);
+            if (count == front.size()) {
+                batches.push_back(std::move(front));
+                _ready.erase(_ready.begin());
+            } else {
+                batches.emplace_back(std::make_move_iterator(front.begin()),
+                                     std::make_move_iterator(front.begin() + count));
+                front.erase(front.begin(), front.begin() + count);
+                auto rest = _ready.extract(_ready.begin());
+                rest.key() += count;
+                _ready.insert(std::move(rest));
+            }
+            _nextPosition += count;
+            taken += count;
+        }
+    }
+    _readyCount.fetch_sub(taken, std::memory_order_relaxed);
+
+    for (const auto& batch : batches) {
+        for (const auto& tx : batch) {
+            if (mempool.addTransaction(tx)) {
+                ++_accepted;
+            } else {
+                ++_rejected;
+            }
+        }
+    }
+    _drained.fetch_add(taken, std::memory_order_release);
+
+    if (_staged.sizeApprox() > 0) {
+        schedule();
+    }
+    return taken;
+}
+
+bool IngestQueue::empty() const
+{
+    return sizeApprox() == 0;
+}
+
+size_t IngestQueue::sizeApprox() const
+{
+    const uint64_t drained = _drained.load(std::memory_order_acquire);
+    return static_cast<size_t>(_staged.pushCount() - drained);
+}
+
+bool IngestQueue::acquireSlot()
+{
+    size_t active = _activeTasks.load(std::memory_order_relaxed);
+    do {
+        if (active >= _config.maxTasks) {
+            return false;
+        }
+    } while (!_activeTasks.compare_exchange_weak(active, active + 1));
+    return true;
+}
+
+void IngestQueue::schedule()
+{
+    if (_stopping.load(std::memory_order_relaxed) || !acquireSlot()) {
+        return;
+    }
+    _tasks.fetch_add(1, std::memory_order_relaxed);
+    _pool.post([this] { runTask(); });
+}
+
+// -----------------------------------------------------------------------------
+//  runTask()
+//  Prepares batches until the staging queue is empty or the prepared ones
+//  are full, then releases its slot. A transaction submitted just before
+//  may have found the slot still taken, so the task looks again and takes
+//  a slot back if work is left. Decrementing _tasks is the task's last use
+//  of the queue, which the destructor may free right after.
+// -----------------------------------------------------------------------------
+void IngestQueue::runTask()
+{
+    std::vector<Transaction> batch;
+    size_t position;
+    do {
+        while (!_stopping.load(std::memory_order_relaxed) &&
+               _readyCount.load(std::memory_order_relaxed) < _config.capacity) {
+            batch.reserve(_config.batchSize);
+            if (_staged.tryPopBatch(batch, _config.batchSize, position) == 0) {
+                break;
+            }
+            for (const auto& tx : batch) {
+                tx.getTxid();
+                if (_cache) {
+                    cacheInputSignatures(tx, *_cache);
+                }
+            }
+            const size_t count = batch.size();
+            {
+                std::lock_guard<std::mutex> lock(_readyMutex);
+                _ready.emplace(position, std::move(batch));
+            }
+            _readyCount.fetch_add(count, std::memory_order_relaxed);
+            batch = std::vector<Transaction>();
+        }
+        _activeTasks.fetch_sub(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    } while (!_stopping.load(std::memory_order_relaxed) && _staged.sizeApprox() > 0 &&
+             _readyCount.load(std::memory_order_relaxed) < _config.capacity && acquireSlot());
+    _tasks.fetch_sub(1, std::memory_order_release);
+}
@@ -0,0 +1,137 @@
+#ifndef INGESTQUEUE_H
+#define INGESTQUEUE_H
+
+#include "MPMCQueue.h"
+#include "ThreadPool.h"
+#include "Transaction.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+class Mempool;
+class SignatureCache;
+
+/**
+ * @file IngestQueue.h
+ * @brief Definition of the IngestQueue class, the entry point of new transactions.
+ * @details Network and RPC threads submit the transactions they receive
+ *          concurrently; submit() only pushes to a lock-free MPMCQueue, so
+ *          producers never wait for each other or for the mempool. Tasks on
+ *          the shared ThreadPool take the staged transactions in batches,
+ *          compute their txids and, with a SignatureCache, verify their input
+ *          signatures, then hand the batches to the thread owning the mempool,
+ *          which adds them with drain(). The signatures are then found in the
+ *          cache given to Mempool::enableSignatureChecks(), leaving the mempool
+ *          thread only the lookups of the spent outputs.
+ *          The queue is bounded twice: at most capacity transactions are staged
+ *          and at most capacity are prepared but not drained. When the mempool
+ *          thread falls behind the prepared ones fill up, the tasks stop taking
+ *          staged ones, and submit() returns false: the producer is told to
+ *          slow down or drop the transaction instead of the queue growing.
+ */
+
+struct IngestConfig {
+    // Transactions staged, and prepared but not drained (rounded up to a power of two)
+    size_t capacity;
+    // Pool tasks preparing batches at once (0: one per pool thread)
+    size_t maxTasks;
+    // Transactions taken from the staging queue at a time
+    size_t batchSize;
+
+    IngestConfig();
+};
+
+class IngestQueue {
+public:
+
+    /**
+     * Verified signatures are recorded in cache when it is not nullptr; it
+     * must outlive the queue.
+     */
+    explicit IngestQueue(SignatureCache* cache = nullptr, const IngestConfig& config = IngestConfig(),
+                         ThreadPool& pool = ThreadPool::instance());
+
+    /**
+     * Waits for the running tasks; transactions not drained are dropped.
+     */
+    ~IngestQueue();
+
+    IngestQueue(const IngestQueue&) = delete;
+    IngestQueue& operator=(const IngestQueue&) = delete;
+
+    /**
+     * Stages a transaction; any thread may call it. Returns false, leaving
+     * tx untouched, if the queue is full.
+     */
+    bool submit(Transaction&& tx);
+    bool submit(const Transaction& tx);
+
+    /**
+     * Adds up to maxCount prepared transactions to mempool, in the order
+     * they were staged, and returns how many were taken. A batch still being
+     * prepared holds back the ones staged after it, so that a transaction
+     * submitted after its parent is added after it. To be called by the
+     * thread owning the mempool, which is not thread-safe.
+     */
+    size_t drain(Mempool& mempool, size_t maxCount = SIZE_MAX);
+
+    /**
+     * Returns true once no submitted transaction is left to prepare or drain.
+     */
+    bool empty() const;
+
+    /**
+     * Number of transactions submitted but not drained yet, which may be
+     * stale.
+     */
+    size_t sizeApprox() const;
+
+    /**
+     * Transactions refused by submit() because the queue was full.
+     */
+    uint64_t getRefused() const { return _refused.load(std::memory_order_relaxed); }
+
+    // Transactions drain() added to the mempool, and the ones the mempool
+    // refused (duplicates or invalid signatures)
+    uint64_t getAccepted() const { return _accepted; }
+    uint64_t getRejected() const { return _rejected; }
+
+private:
+    // Takes one of the maxTasks task slots, if one is free
+    bool acquireSlot();
+
+    // Posts a task if a slot is free
+    void schedule();
+
+    void runTask();
+
+    SignatureCache* _cache;
+    IngestConfig _config;
+    ThreadPool& _pool;
+
+    MPMCQueue<Transaction> _staged;
+
+    // Prepared batches by staging position of their first transaction, and
+    // the position of the next transaction to drain
+    std::mutex _readyMutex;
+    std::map<size_t, std::vector<Transaction>> _ready;
+    size_t _nextPosition;
+    std::atomic<size_t> _readyCount;
+
+    // Task slots taken, and tasks posted and not finished
+    std::atomic<size_t> _activeTasks;
+    std::atomic<size_t> _tasks;
+    std::atomic<bool> _stopping;
+
+    // Transactions drain() took, submitted ones being counted by _staged
+    std::atomic<uint64_t> _drained;
+
+    std::atomic<uint64_t> _refused;
+    uint64_t _accepted;
+    uint64_t _rejected;
+};
+
+#endif // INGESTQUEUE_H
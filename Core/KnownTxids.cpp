@@ -0,0 +1,213 @@
+#include "KnownTxids.h"
+#include "Encoding.h"
+#include "Hex.h"
+#include "MemoryUsage.h"
+#include <algorithm>
+
+KnownTxids::KnownTxids(Blockchain& chain, Mempool& mempool)
+    : _chain(chain),
+      _mempool(mempool),
+      _keyMemory(0),
+      _exactLookups(0)
+{
+    rebuild();
+    _chain.addListener(this);
+    _mempool.addListener(this);
+}
+
+KnownTxids::~KnownTxids()
+{
+    _mempool.removeListener(this);
+    _chain.removeListener(this);
+}
+
+// -----------------------------------------------------------------------------
+//  filterKey()
+//  Txids that are not hex (only built by hand) fall back to std::hash.
+// -----------------------------------------------------------------------------
+uint64_t KnownTxids::filterKey(const TXID& txid)
+{
+    unsigned char bytes[8];
+    if (txid.size() < 16 || !hexDecode(txid.data(), sizeof(bytes), bytes)) {
+        return std::hash<std::string>()(txid) * 0x9e3779b97f4a7c15ULL;
+    }
+    uint64_t key = 0;
+    for (int i = 7; i >= 0; --i) {
+        key = (key << 8) | bytes[i];
+    }
+    return key;
+}
+
+bool KnownTxids::isKnown(const TXID& txid) const
+{
+    if (!_filter.contains(filterKey(txid))) {
+        return false;
+    }
+    ++_exactLookups;
+    return _confirmed.count(txid) != 0 || _mempool.contains(txid);
+}
+
+bool KnownTxids::isConfirmed(const TXID& txid) const
+{
+    if (!_filter.contains(filterKey(txid))) {
+        return false;
+    }
+    ++_exactLookups;
+    return _confirmed.count(txid) != 0;
+}
+
+void KnownTxids::rebuild()
+{
+    _confirmed.clear();
+    _keyMemory = 0;
+    for (uint64_t height = 0; height <= _chain.getHeight(); ++height) {
+        for (const auto& tx : _chain.getBlock(height).getTransactions()) {
+            addConfirmed(tx.getTxid());
+        }
+    }
+
+    // Room for the chain and the pool to double before the filter grows
+    grow(std::max<size_t>(1024, 2 * (_confirmed.size() + _mempool.size())));
+}
+
+// -----------------------------------------------------------------------------
+//  grow()
+//  A cuckoo filter can't be resized from its fingerprints alone, so the keys
+//  come back from the exact indexes.
+// -----------------------------------------------------------------------------
+void KnownTxids::grow(size_t capacity)
+{
+    for (;; capacity *= 2) {
+        _filter = CuckooFilter(capacity);
+        bool ok = true;
+        for (const auto& entry : _confirmed) {
+            for (uint32_t i = 0; ok && i < entry.second; ++i) {
+                ok = _filter.insert(filterKey(entry.first));
+            }
+        }
+        _mempool.forEach([&](const Transaction& tx) {
+            ok = ok && _filter.insert(filterKey(tx.getTxid()));
+        });
+        if (ok) {
+            return;
+        }
+    }
+}
+
+void KnownTxids::addConfirmed(const TXID& txid)
+{
+    auto inserted = _confirmed.try_emplace(txid, 0);
+    if (inserted.second) {
+        _keyMemory += dynamicUsage(inserted.first->first);
+    }
+    ++inserted.first->second;
+}
+
+size_t KnownTxids::memoryUsage() const
+{
+    return _filter.memoryUsage() + _keyMemory + dynamicUsage(_confirmed);
+}
+
+void KnownTxids::insert(const TXID& txid)
+{
+    if (!_filter.insert(filterKey(txid))) {
+        // The exact indexes already hold txid; a filter sized for its
+        // current slot count has twice as many
+        grow(_filter.slotCount());
+    }
+}
+
+void KnownTxids::blockConnected(const Block& block, const BlockUndo&, uint64_t)
+{
+    for (const auto& tx : block.getTransactions()) {
+        addConfirmed(tx.getTxid());
+        insert(tx.getTxid());
+    }
+}
+
+void KnownTxids::blockDisconnected(const Block& block, const BlockUndo&, uint64_t)
+{
+    for (const auto& tx : block.getTransactions()) {
+        auto it = _confirmed.find(tx.getTxid());
+        if (it == _confirmed.end()) {
+            continue;
+        }
+        if (--it->second == 0) {
+            _keyMemory -= dynamicUsage(it->first);
+            _confirmed.erase(it);
+        }
+        _filter.erase(filterKey(tx.getTxid()));
+    }
+}
+
+void KnownTxids::transactionAdded(const Transaction& tx)
+{
+    insert(tx.getTxid());
+}
+
+void KnownTxids::transactionRemoved(const TXID& txid)
+{
+    _filter.erase(filterKey(txid));
+}
+
+// -----------------------------------------------------------------------------
+//  encode()
+//  Only confirmed txids are saved: the pool is rebuilt or replayed on its own,
+//  so its txids are taken out of a copy of the filter.
+// -----------------------------------------------------------------------------
+void KnownTxids::encode(std::string& output) const
+{
+    CuckooFilter confirmed = _filter;
+    _mempool.forEach([&](const Transaction& tx) {
+        confirmed.erase(filterKey(tx.getTxid()));
+    });
+
+    ByteWriter writer(output);
+    writer.writeString(_chain.getLatestBlock().getHash());
+    writer.writeVarInt(_confirmed.size());
+    for (const auto& entry : _confirmed) {
+        writer.writeString(entry.first);
+        writer.writeVarInt(entry.second);
+    }
+    confirmed.encode(output);
+}
+
+bool KnownTxids::decode(ByteReader& reader)
+{
+    std::string tip;
+    uint64_t count;
+    if (!reader.readString(tip) || tip != _chain.getLatestBlock().getHash() ||
+        !reader.readVarInt(count)) {
+        return false;
+    }
+
+    std::unordered_map<TXID, uint32_t> confirmed;
+    confirmed.reserve(static_cast<size_t>(std::min<uint64_t>(count, reader.remaining())));
+    for (uint64_t i = 0; i < count; ++i) {
+        std::string txid;
+        uint64_t occurrences;
+        if (!reader.readString(txid) || !reader.readVarInt(occurrences) || occurrences == 0) {
+            return false;
+        }
+        confirmed.emplace(std::move(txid), static_cast<uint32_t>(occurrences));
+    }
+    CuckooFilter filter;
+    if (!CuckooFilter::decode(reader, filter)) {
+        return false;
+    }
+
+    _confirmed = std::move(confirmed);
+    _keyMemory = 0;
+    for (const auto& entry : _confirmed) {
+        _keyMemory += dynamicUsage(entry.first);
+    }
+    _filter = std::move(filter);
+    bool full = _filter.full();
+    _mempool.forEach([&](const Transaction& tx) {
+        full = full || !_filter.insert(filterKey(tx.getTxid()));
+    });
+    if (full) {
+        grow(_filter.slotCount());
+    }
+    return true;
+}
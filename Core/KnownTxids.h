@@ -0,0 +1,111 @@
+#ifndef KNOWNTXIDS_H
+#define KNOWNTXIDS_H
+
+#include "Blockchain.h"
+#include "CuckooFilter.h"
+#include "Mempool.h"
+#include <unordered_map>
+
+/**
+ * @file KnownTxids.h
+ * @brief Definition of the KnownTxids class, answering "have we seen this txid?".
+ * @details Every txid of the active chain and of the mempool is kept in a
+ *          cuckoo filter of a few bytes per transaction, small enough to stay
+ *          in cache. A lookup of an unknown txid, the common case when
+ *          transactions are relayed, is answered by the filter alone; only
+ *          possible matches are checked against the exact indexes (the
+ *          confirmed txids and the mempool).
+ *          The filter follows the chain and the pool as a listener of both,
+ *          reorganizations included, and grows when it is full. It can be
+ *          saved with the chain state so a restart does not rescan the chain.
+ */
+class KnownTxids : public ChainListener, public MempoolListener {
+public:
+
+    /**
+     * Indexes the active chain and the pool, then follows their changes.
+     * chain and mempool must outlive this object.
+     */
+    KnownTxids(Blockchain& chain, Mempool& mempool);
+
+    ~KnownTxids() override;
+
+    KnownTxids(const KnownTxids&) = delete;
+    KnownTxids& operator=(const KnownTxids&) = delete;
+
+    /**
+     * Returns true if txid is in the active chain or in the pool.
+     */
+    bool isKnown(const TXID& txid) const;
+
+    /**
+     * Returns true if txid is in the active chain.
+     */
+    bool isConfirmed(const TXID& txid) const;
+
+    /**
+     * Lookups that passed the filter and went to the exact indexes.
+     */
+    uint64_t exactLookups() const { return _exactLookups; }
+
+    const CuckooFilter& getFilter() const { return _filter; }
+
+    /**
+     * Heap bytes held by the filter and the confirmed txids, counted from
+     * container capacities (see MemoryUsage.h) and kept up to date as
+     * blocks come and go.
+     */
+    size_t memoryUsage() const;
+
+    /**
+     * Rebuilds the filter and the confirmed txids from the chain and the pool.
+     */
+    void rebuild();
+
+    /**
+     * Appends the confirmed txids and their filter to output, tagged with the
+     * chain tip.
+     */
+    void encode(std::string& output) const;
+
+    /**
+     * Restores the state saved by encode(). Fails, leaving the current state,
+     * if the data is malformed or was saved at another tip.
+     */
+    bool decode(ByteReader& reader);
+
+    /**
+     * Filter key of a txid: its first 8 bytes, already uniformly distributed
+     * for a SHA-256 in hex.
+     */
+    static uint64_t filterKey(const TXID& txid);
+
+    // ChainListener
+    void blockConnected(const Block& block, const BlockUndo& undo, uint64_t height) override;
+    void blockDisconnected(const Block& block, const BlockUndo& undo, uint64_t height) override;
+
+    // MempoolListener
+    void transactionAdded(const Transaction& tx) override;
+    void transactionRemoved(const TXID& txid) override;
+
+private:
+    void insert(const TXID& txid);
+    // Counts one more occurrence of a confirmed txid
+    void addConfirmed(const TXID& txid);
+    // Replaces the filter with one sized for at least capacity txids and
+    // inserts every known txid
+    void grow(size_t capacity);
+
+    Blockchain& _chain;
+    Mempool& _mempool;
+    // Confirmed and pending txids; a txid both confirmed and pending, briefly
+    // during a reorg, is in it twice
+    CuckooFilter _filter;
+    // Txids of the active chain with their number of occurrences
+    std::unordered_map<TXID, uint32_t> _confirmed;
+    // Heap bytes of the keys of _confirmed
+    size_t _keyMemory;
+    mutable uint64_t _exactLookups;
+};
+
+#endif // KNOWNTXIDS_H
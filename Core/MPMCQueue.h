@@ -0,0 +1,201 @@
+#ifndef MPMCQUEUE_H
+#define MPMCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+/**
+ * @file MPMCQueue.h
+ * @brief Definition of the MPMCQueue class, a bounded lock-free queue.
+ * @details Any number of threads push and pop concurrently without a lock.
+ *          The queue is a ring of cells, each with a sequence number telling
+ *          whether it is free for the push or the pop at a given position:
+ *          a thread claims a position with one compare-and-swap on the head
+ *          or tail counter, then publishes its cell by advancing the cell's
+ *          sequence. Threads only touch the counter they move and the cells
+ *          they claim, so producers and consumers don't share cache lines.
+ *          A full queue refuses pushes instead of waiting: the caller decides
+ *          whether to retry, drop or slow down. tryPopBatch() claims a run of
+ *          ready cells with a single compare-and-swap.
+ *          Based on Dmitry Vyukov's bounded MPMC queue.
+ */
+template <class T>
+class MPMCQueue {
+public:
+
+    /**
+     * Creates a queue of capacity elements, rounded up to a power of two.
+     */
+    explicit MPMCQueue(size_t capacity)
+        : _capacity(roundUp(capacity)),
+          _mask(_capacity - 1),
+          _cells(new Cell[_capacity]),
+          _enqueuePos(0),
+          _dequeuePos(0) {
+        for (size_t i = 0; i < _capacity; ++i) {
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~MPMCQueue() {
+        size_t pos;
+        while (claim(1, pos) == 1) {
+            take(pos);
+        }
+    }
+
+    MPMCQueue(const MPMCQueue&) = delete;
+    MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+    /**
+     * Appends value, which is moved from only on success. Returns false if
+     * the queue is full.
+     */
+    bool tryPush(T&& value) {
+        Cell* cell;
+        size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &_cells[pos & _mask];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = _enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        new (cell->storage) T(std::move(value));
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPush(const T& value) {
+        T copy(value);
+        return tryPush(std::move(copy));
+    }
+
+    /**
+     * Removes the oldest element into value. Returns false if the queue is
+     * empty.
+     */
+    bool tryPop(T& value) {
+        size_t pos;
+        if (claim(1, pos) == 0) {
+            return false;
+        }
+        value = take(pos);
+        return true;
+    }
+
+    /**
+     * Appends up to maxCount of the oldest elements to out, in order, and
+     * returns how many. Only the elements already published are taken.
+     */
+    size_t tryPopBatch(std::vector<T>& out, size_t maxCount) {
+        size_t first;
+        return tryPopBatch(out, maxCount, first);
+    }
+
+    /**
+     * Same, setting first to the number of elements popped before the
+     * batch, so that batches taken by several consumers can be put back in
+     * order.
+     */
+    size_t tryPopBatch(std::vector<T>& out, size_t maxCount, size_t& first) {
+        const size_t count = claim(maxCount, first);
+        for (size_t i = 0; i < count; ++i) {
+            out.push_back(take(first + i));
+        }
+        return count;
+    }
+
+    /**
+     * Capacity, a power of two.
+     */
+    size_t capacity() const { return _capacity; }
+
+    /**
+     * Number of successful pushes since the queue was created, including
+     * the ones still being written.
+     */
+    size_t pushCount() const { return _enqueuePos.load(std::memory_order_acquire); }
+
+    /**
+     * Number of elements, which may be stale by the time it is returned.
+     */
+    size_t sizeApprox() const {
+        const size_t dequeued = _dequeuePos.load(std::memory_order_relaxed);
+        const size_t enqueued = _enqueuePos.load(std::memory_order_relaxed);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<size_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    static size_t roundUp(size_t capacity) {
+        size_t rounded = 2;
+        while (rounded < capacity) {
+            rounded *= 2;
+        }
+        return rounded;
+    }
+
+    // Claims up to maxCount consecutive published cells from the head;
+    // first is set to the position of the first one
+    size_t claim(size_t maxCount, size_t& first) {
+        if (maxCount == 0) {
+            return 0;
+        }
+        size_t pos = _dequeuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            size_t ready = 0;
+            while (ready < maxCount &&
+                   _cells[(pos + ready) & _mask].sequence.load(std::memory_order_acquire) == pos + ready + 1) {
+                ++ready;
+            }
+            if (ready == 0) {
+                const size_t sequence = _cells[pos & _mask].sequence.load(std::memory_order_acquire);
+                if (static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1) < 0) {
+                    return 0;
+                }
+                // Another consumer took the cell
+                pos = _dequeuePos.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (_dequeuePos.compare_exchange_weak(pos, pos + ready, std::memory_order_relaxed)) {
+                first = pos;
+                return ready;
+            }
+        }
+    }
+
+    // Moves the element out of a claimed cell and frees the cell
+    T take(size_t pos) {
+        Cell& cell = _cells[pos & _mask];
+        T* stored = std::launder(reinterpret_cast<T*>(cell.storage));
+        T value(std::move(*stored));
+        stored->~T();
+        cell.sequence.store(pos + _capacity, std::memory_order_release);
+        return value;
+    }
+
+    const size_t _capacity;
+    const size_t _mask;
+    std::unique_ptr<Cell[]> _cells;
+    alignas(64) std::atomic<size_t> _enqueuePos;
+    alignas(64) std::atomic<size_t> _dequeuePos;
+};
+
+#endif // MPMCQUEUE_H
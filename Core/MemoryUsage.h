@@ -0,0 +1,103 @@
+#ifndef MEMORYUSAGE_H
+#define MEMORYUSAGE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @file MemoryUsage.h
+ * @brief Heap accounting helpers behind the memoryUsage() of Core classes.
+ * @details A memoryUsage() counts the heap memory an object holds from the
+ *          capacity of its containers rather than their size, so reserved
+ *          but unused space shows up, and rounds every allocation the way
+ *          the 64-bit glibc malloc does: an 8-byte header, 16-byte granules
+ *          and 32 bytes at least. The dynamicUsage() overloads cover one
+ *          container: its buffer or its nodes and, for hash tables, the
+ *          bucket array. The heap memory owned by the elements themselves,
+ *          such as the characters of string keys, is left to the caller.
+ *          The figures are estimates of resident memory, within the slack
+ *          of the allocator.
+ */
+
+/**
+ * Bytes taken from the heap by one allocation of bytes.
+ */
+inline size_t mallocUsage(size_t bytes)
+{
+    if (bytes == 0) {
+        return 0;
+    }
+    return std::max<size_t>(32, (bytes + 8 + 15) & ~static_cast<size_t>(15));
+}
+
+inline size_t dynamicUsage(const std::string& s)
+{
+    // Short strings live inside the object
+    static const size_t inlineCapacity = std::string().capacity();
+    return s.capacity() > inlineCapacity ? mallocUsage(s.capacity() + 1) : 0;
+}
+
+template <class T, class A>
+size_t dynamicUsage(const std::vector<T, A>& v)
+{
+    return mallocUsage(v.capacity() * sizeof(T));
+}
+
+template <class T, class A>
+size_t dynamicUsage(const std::list<T, A>& l)
+{
+    return l.size() * mallocUsage(2 * sizeof(void*) + sizeof(T));
+}
+
+template <class T, class A>
+size_t dynamicUsage(const std::deque<T, A>& d)
+{
+    // Blocks of 512 bytes, and the map of block pointers
+    const size_t perBlock = sizeof(T) < 512 ? 512 / sizeof(T) : 1;
+    const size_t blocks = d.size() / perBlock + 1;
+    return blocks * mallocUsage(perBlock * sizeof(T)) +
+           mallocUsage(std::max<size_t>(8, blocks + 2) * sizeof(void*));
+}
+
+// Red-black tree nodes: color, parent and children before the value
+template <class T, class C, class A>
+size_t dynamicUsage(const std::set<T, C, A>& s)
+{
+    return s.size() * mallocUsage(4 * sizeof(void*) + sizeof(T));
+}
+
+template <class K, class V, class C, class A>
+size_t dynamicUsage(const std::map<K, V, C, A>& m)
+{
+    return m.size() * mallocUsage(4 * sizeof(void*) + sizeof(std::pair<const K, V>));
+}
+
+// Hash table nodes: next pointer, value and cached hash; one bucket is
+// stored inside the table
+inline size_t hashTableUsage(size_t count, size_t valueSize, size_t bucketCount)
+{
+    return count * mallocUsage(sizeof(void*) + valueSize + sizeof(size_t)) +
+           (bucketCount > 1 ? mallocUsage(bucketCount * sizeof(void*)) : 0);
+}
+
+template <class K, class V, class H, class E, class A>
+size_t dynamicUsage(const std::unordered_map<K, V, H, E, A>& m)
+{
+    return hashTableUsage(m.size(), sizeof(std::pair<const K, V>), m.bucket_count());
+}
+
+template <class K, class H, class E, class A>
+size_t dynamicUsage(const std::unordered_set<K, H, E, A>& s)
+{
+    return hashTableUsage(s.size(), sizeof(K), s.bucket_count());
+}
+
+#endif // MEMORYUSAGE_H
@@ -0,0 +1,138 @@
+#include "Mempool.h"
+#include "MemoryUsage.h"
+#include "SignatureCache.h"
+#include <algorithm>
+#include <iterator>
+
+Mempool::Mempool()
+    : _txMemory(0),
+      _utxos(nullptr),
+      _signatureCache(nullptr)
+{
+}
+
+void Mempool::enableSignatureChecks(const UTXOSet& utxos, SignatureCache* cache)
+{
+    _utxos = &utxos;
+    _signatureCache = cache;
+}
+
+bool Mempool::addTransaction(const Transaction& tx)
+{
+    if (_byTxid.count(tx.getTxid())) {
+        return false;
+    }
+    if (_utxos && !checkSignatures(tx)) {
+        return false;
+    }
+    _transactions.push_back(tx);
+    auto entry = _byTxid.emplace(tx.getTxid(), std::prev(_transactions.end())).first;
+    _txMemory += _transactions.back().memoryUsage() + dynamicUsage(entry->first);
+    for (MempoolListener* listener : _listeners) {
+        listener->transactionAdded(tx);
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+//  checkSignatures()
+//  Inputs spend confirmed outputs or the outputs of pooled parents.
+// -----------------------------------------------------------------------------
+bool Mempool::checkSignatures(const Transaction& tx) const
+{
+    std::vector<const TxOut*> spent(tx.getInputs().size(), nullptr);
+    for (size_t i = 0; i < spent.size(); ++i) {
+        const TxIn& input = tx.getInputs()[i];
+        if (input.isCoinbase()) {
+            continue;
+        }
+        spent[i] = _utxos->find(OutPoint(input.prevTxID, input.outputIndex));
+        if (!spent[i]) {
+            const Transaction* parent = find(input.prevTxID);
+            if (!parent || input.outputIndex >= parent->getOutputs().size()) {
+                return false;
+            }
+            spent[i] = &parent->getOutputs()[input.outputIndex];
+        }
+    }
+    return verifyTransactionSignatures(tx, spent, _signatureCache);
+}
+
+bool Mempool::removeTransaction(const TXID& txid)
+{
+    auto it = _byTxid.find(txid);
+    if (it == _byTxid.end()) {
+        return false;
+    }
+    // txid may refer to the erased transaction
+    const TXID removed = it->first;
+    _txMemory -= it->second->memoryUsage() + dynamicUsage(it->first);
+    _transactions.erase(it->second);
+    _byTxid.erase(it);
+    for (MempoolListener* listener : _listeners) {
+        listener->transactionRemoved(removed);
+    }
+    return true;
+}
+
+size_t Mempool::memoryUsage() const
+{
+    return _txMemory + dynamicUsage(_transactions) + dynamicUsage(_byTxid);
+}
+
+const Transaction* Mempool::find(const TXID& txid) const
+{
+    auto it = _byTxid.find(txid);
+    return it == _byTxid.end() ? nullptr : &*it->second;
+}
+
+void Mempool::addListener(MempoolListener* listener)
+{
+    _listeners.push_back(listener);
+}
+
+void Mempool::removeListener(MempoolListener* listener)
+{
+    _listeners.erase(std::remove(_listeners.begin(), _listeners.end(), listener),
+                     _listeners.end());
+}
+
+std::vector<Transaction> Mempool::getTransactions(size_t maxCount) const
+{
+    std::vector<Transaction> result;
+    result.reserve(std::min(maxCount, _transactions.size()));
+    for (const auto& tx : _transactions) {
+        if (result.size() == maxCount) {
+            break;
+        }
+        result.push_back(tx);
+    }
+    return result;
+}
+
+// -----------------------------------------------------------------------------
+//  blockConnected()
+//  Confirmed transactions leave the pool.
+// -----------------------------------------------------------------------------
+void Mempool::blockConnected(const Block& block, const BlockUndo&, uint64_t)
+{
+    for (const auto& tx : block.getTransactions()) {
+        removeTransaction(tx.getTxid());
+    }
+}
+
+// -----------------------------------------------------------------------------
+//  blockDisconnected()
+//  Transactions of a disconnected block return to the pool, except the
+//  block's own coinbase which is only valid in that block.
+// -----------------------------------------------------------------------------
+void Mempool::blockDisconnected(const Block& block, const BlockUndo&, uint64_t)
+{
+    const std::vector<Transaction>& transactions = block.getTransactions();
+    for (size_t i = 0; i < transactions.size(); ++i) {
+        if (i == 0 && transactions[i].isCoinbase()) {
+            continue;
+        }
+        addTransaction(transactions[i]);
+    }
+}
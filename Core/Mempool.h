@@ -0,0 +1,113 @@
+#ifndef MEMPOOL_H
+#define MEMPOOL_H
+
+#include "ChainListener.h"
+#include "MempoolListener.h"
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+class SignatureCache;
+
+/**
+ * @file Mempool.h
+ * @brief Definition of the Mempool class holding transactions waiting for a block.
+ * @details Transactions are kept in arrival order, which is the order used to
+ *          fill block templates. As a ChainListener the mempool drops the
+ *          transactions confirmed by a connected block and takes back the ones of
+ *          a disconnected block, so a reorganization does not lose them.
+ * https://en.bitcoin.it/wiki/Vocabulary#Memory_pool
+ */
+class Mempool : public ChainListener {
+public:
+
+    Mempool();
+
+    /**
+     * Adds a transaction. Returns false if it is already in the pool, or if
+     * signature checks are on and one of its inputs doesn't spend an output
+     * of utxos or of a pooled transaction with a valid signature.
+     */
+    bool addTransaction(const Transaction& tx);
+
+    /**
+     * Turns on the verification of input signatures for new transactions,
+     * against the outputs of utxos and of the pooled transactions. Verified
+     * signatures are recorded in cache, which may be nullptr, so that
+     * blocks confirming the transactions skip them. utxos and cache must
+     * outlive the pool.
+     */
+    void enableSignatureChecks(const UTXOSet& utxos, SignatureCache* cache = nullptr);
+
+    /**
+     * Removes a transaction. Returns false if it was not in the pool.
+     */
+    bool removeTransaction(const TXID& txid);
+
+    /**
+     * Returns true if the transaction is in the pool.
+     */
+    bool contains(const TXID& txid) const { return _byTxid.count(txid) != 0; }
+
+    /**
+     * Returns the pooled transaction with this txid, or nullptr.
+     */
+    const Transaction* find(const TXID& txid) const;
+
+    /**
+     * Number of pooled transactions.
+     */
+    size_t size() const { return _transactions.size(); }
+
+    /**
+     * Heap bytes held by the pooled transactions and their indexes, counted
+     * from container capacities (see MemoryUsage.h). Kept up to date as
+     * transactions come and go, so a call takes constant time.
+     */
+    size_t memoryUsage() const;
+
+    /**
+     * Returns up to maxCount transactions, oldest first.
+     */
+    std::vector<Transaction> getTransactions(size_t maxCount = SIZE_MAX) const;
+
+    /**
+     * Calls visitor(tx) on every transaction, oldest first, without copying.
+     */
+    template <class F>
+    void forEach(F&& visitor) const {
+        for (const auto& tx : _transactions) {
+            visitor(tx);
+        }
+    }
+
+    /**
+     * Registers a listener notified of every added and removed transaction.
+     */
+    void addListener(MempoolListener* listener);
+
+    /**
+     * Unregisters a listener.
+     */
+    void removeListener(MempoolListener* listener);
+
+    // ChainListener
+    void blockConnected(const Block& block, const BlockUndo& undo, uint64_t height) override;
+    void blockDisconnected(const Block& block, const BlockUndo& undo, uint64_t height) override;
+
+private:
+    bool checkSignatures(const Transaction& tx) const;
+
+    // Arrival order
+    std::list<Transaction> _transactions;
+    std::unordered_map<TXID, std::list<Transaction>::iterator> _byTxid;
+    std::vector<MempoolListener*> _listeners;
+    // Heap bytes of the pooled transactions and of the txid keys
+    size_t _txMemory;
+
+    // Signature checks; disabled while _utxos is nullptr
+    const UTXOSet* _utxos;
+    SignatureCache* _signatureCache;
+};
+
+#endif // MEMPOOL_H
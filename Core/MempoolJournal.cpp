@@ -0,0 +1,440 @@
+#include "MempoolJournal.h"
+#include "BatchHash.h"
+#include "Checksum.h"
+#include "Encoding.h"
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// File header: identifies the format
+const char Magic[8] = {'M', 'P', 'J', 'R', 'N', 'L', '0', '1'};
+
+// Record header: payload length, CRC-32 of type and payload, type
+const size_t RecordHeaderSize = 9;
+
+// Replay reads the file in chunks of this size
+const size_t ReadChunkSize = 4 * 1024 * 1024;
+
+bool syncFile(std::FILE* file)
+{
+    if (std::fflush(file) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+// Makes a rename in the directory durable
+void syncDirectory(const std::filesystem::path& file)
+{
+#ifndef _WIN32
+    std::filesystem::path directory = file.parent_path();
+    int fd = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        ::close(fd);
+    }
+#else
+    (void)file;
+#endif
+}
+
+}
+
+JournalConfig::JournalConfig()
+    : commitInterval(5),
+      maxBatchBytes(1024 * 1024),
+      compactRatio(4.0),
+      minCompactRecords(100000)
+{
+}
+
+MempoolJournal::MempoolJournal(const std::string& path, const JournalConfig& config)
+    : _path(path),
+      _config(config),
+      _mempool(nullptr),
+      _file(nullptr),
+      _appendedSeq(0),
+      _durableSeq(0),
+      _batches(0),
+      _syncWaiters(0),
+      _stopping(false),
+      _failed(false),
+      _records(0),
+      _replayedRecords(0),
+      _truncatedBytes(0)
+{
+}
+
+MempoolJournal::~MempoolJournal()
+{
+    close();
+}
+
+// -----------------------------------------------------------------------------
+//  open()
+//  A crash can leave a partial record at the end of the file; it is cut off
+//  so that new records follow the last complete one.
+// -----------------------------------------------------------------------------
+bool MempoolJournal::open(Mempool& mempool)
+{
+    if (_mempool) {
+        return false;
+    }
+
+    std::error_code error;
+    const bool exists = std::filesystem::exists(_path, error);
+    const uint64_t fileSize = exists ? std::filesystem::file_size(_path, error) : 0;
+    if (error) {
+        std::cerr << "Error: can't read mempool journal " << _path << "\n";
+        return false;
+    }
+
+    uint64_t validEnd = 0;
+    _records = 0;
+    _replayedRecords = 0;
+    _truncatedBytes = 0;
+    if (fileSize > 0 && !replay(mempool, validEnd)) {
+        std::cerr << "Error: " << _path << " is not a mempool journal\n";
+        return false;
+    }
+    if (fileSize > 0 && validEnd < fileSize) {
+        _truncatedBytes = fileSize - validEnd;
+        std::filesystem::resize_file(_path, validEnd, error);
+        if (error) {
+            std::cerr << "Error: can't truncate mempool journal " << _path << "\n";
+            return false;
+        }
+    }
+
+    _file = std::fopen(_path.c_str(), "ab");
+    if (!_file) {
+        std::cerr << "Error: can't open mempool journal " << _path << "\n";
+        return false;
+    }
+    if (validEnd == 0 && (std::fwrite(Magic, 1, sizeof(Magic), _file) != sizeof(Magic) ||
+                          !syncFile(_file))) {
+        std::cerr << "Error: can't write mempool journal " << _path << "\n";
+        std::fclose(_file);
+        _file = nullptr;
+        return false;
+    }
+
+    _mempool = &mempool;
+    _stopping = false;
+    _failed = false;
+    _writer = std::thread(&MempoolJournal::writerLoop, this);
+    mempool.addListener(this);
+    maybeCompact();
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+//  replay()
+//  Records are parsed first and the txids of all added transactions are then
+//  computed in parallel; applying the records in order only moves strings.
+// -----------------------------------------------------------------------------
+bool MempoolJournal::replay(Mempool& mempool, uint64_t& validEnd)
+{
+    std::FILE* file = std::fopen(_path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    char magic[sizeof(Magic)];
+    if (std::fread(magic, 1, sizeof(magic), file) != sizeof(magic) ||
+        !std::equal(magic, magic + sizeof(magic), Magic)) {
+        std::fclose(file);
+        return false;
+    }
+    validEnd = sizeof(Magic);
+
+    // Added transactions, and the records in file order: an index in added
+    // for an add, a txid for a removal
+    std::vector<Transaction> added;
+    std::vector<std::pair<size_t, TXID>> records;
+
+    std::string buffer;
+    size_t offset = 0;
+    bool valid = true;
+    std::vector<char> chunk(ReadChunkSize);
+    size_t read;
+    while (valid && (read = std::fread(chunk.data(), 1, chunk.size(), file)) > 0) {
+        buffer.erase(0, offset);
+        offset = 0;
+        buffer.append(chunk.data(), read);
+
+        while (buffer.size() - offset >= RecordHeaderSize) {
+            ByteReader header(buffer.data() + offset, RecordHeaderSize);
+            uint32_t length, crc;
+            uint8_t type;
+            header.readU32(length);
+            header.readU32(crc);
+            header.readU8(type);
+            if (buffer.size() - offset - RecordHeaderSize < length) {
+                break;
+            }
+
+            const char* body = buffer.data() + offset + RecordHeaderSize - 1;
+            if (crc32(body, length + 1) != crc) {
+                valid = false;
+                break;
+            }
+            ByteReader payload(body + 1, length);
+            if (type == AddRecord) {
+                Transaction tx;
+                if (!Transaction::decode(payload, tx) || !payload.atEnd()) {
+                    valid = false;
+                    break;
+                }
+                records.emplace_back(added.size(), TXID());
+                added.push_back(std::move(tx));
+            } else if (type == RemoveRecord) {
+                records.emplace_back(SIZE_MAX, TXID(body + 1, length));
+            } else {
+                valid = false;
+                break;
+            }
+            offset += RecordHeaderSize + length;
+            validEnd += RecordHeaderSize + length;
+        }
+    }
+    std::fclose(file);
+
+    hashTransactions(added);
+
+    // Index in added of the live transaction of each txid
+    std::unordered_map<TXID, size_t> live;
+    live.reserve(added.size());
+    for (const auto& record : records) {
+        if (record.first != SIZE_MAX) {
+            live.emplace(added[record.first].getTxid(), record.first);
+        } else {
+            live.erase(record.second);
+        }
+    }
+    for (size_t i = 0; i < added.size(); ++i) {
+        auto it = live.find(added[i].getTxid());
+        if (it != live.end() && it->second == i) {
+            mempool.addTransaction(added[i]);
+        }
+    }
+
+    _records = records.size();
+    _replayedRecords = records.size();
+    return true;
+}
+
+bool MempoolJournal::close()
+{
+    if (!_mempool) {
+        return !failed();
+    }
+    _mempool->removeListener(this);
+    _mempool = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wakeWriter.notify_one();
+    _writer.join();
+
+    std::fclose(_file);
+    _file = nullptr;
+    return !failed();
+}
+
+// -----------------------------------------------------------------------------
+//  sync()
+//  Waiting threads cut the commit interval short; records appended by other
+//  threads in the meantime still share the batch. A failed write wakes them
+//  without making their records durable.
+// -----------------------------------------------------------------------------
+bool MempoolJournal::sync()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    const uint64_t target = _appendedSeq;
+    if (_failed || _durableSeq >= target || !_file) {
+        return !_failed;
+    }
+    ++_syncWaiters;
+    _wakeWriter.notify_one();
+    _durable.wait(lock, [&]() { return _failed || _durableSeq >= target; });
+    --_syncWaiters;
+    return !_failed;
+}
+
+bool MempoolJournal::failed() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _failed;
+}
+
+uint64_t MempoolJournal::batchCount() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _batches;
+}
+
+void MempoolJournal::transactionAdded(const Transaction& tx)
+{
+    std::string payload;
+    tx.encode(payload);
+    append(AddRecord, payload);
+}
+
+void MempoolJournal::transactionRemoved(const TXID& txid)
+{
+    append(RemoveRecord, txid);
+    maybeCompact();
+}
+
+void MempoolJournal::appendRecord(std::string& output, RecordType type, const std::string& payload)
+{
+    const uint8_t typeByte = type;
+    ByteWriter writer(output);
+    writer.writeU32(static_cast<uint32_t>(payload.size()));
+    writer.writeU32(crc32(payload.data(), payload.size(), crc32(&typeByte, 1)));
+    writer.writeU8(typeByte);
+    output.append(payload);
+}
+
+void MempoolJournal::append(RecordType type, const std::string& payload)
+{
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        // The writer starts the commit interval on the first record of a batch
+        wake = _pending.empty();
+        appendRecord(_pending, type, payload);
+        ++_appendedSeq;
+        wake = wake || _pending.size() >= _config.maxBatchBytes;
+    }
+    ++_records;
+    if (wake) {
+        _wakeWriter.notify_one();
+    }
+}
+
+void MempoolJournal::maybeCompact()
+{
+    const double live = static_cast<double>(std::max<size_t>(1, _mempool->size()));
+    if (_records >= _config.minCompactRecords && _records > _config.compactRatio * live) {
+        compact();
+    }
+}
+
+// -----------------------------------------------------------------------------
+//  compact()
+//  The live transactions are written to a new file which replaces the
+//  journal with a rename, so a crash leaves either the old or the new file.
+// -----------------------------------------------------------------------------
+bool MempoolJournal::compact()
+{
+    if (!_mempool || !sync()) {
+        return false;
+    }
+
+    // Keeps the writer away from _file until the swap is done
+    std::lock_guard<std::mutex> lock(_mutex);
+    const std::string tmpPath = _path + ".tmp";
+    std::FILE* out = std::fopen(tmpPath.c_str(), "wb");
+    if (!out) {
+        std::cerr << "Error: can't write " << tmpPath << "\n";
+        return false;
+    }
+
+    bool ok = std::fwrite(Magic, 1, sizeof(Magic), out) == sizeof(Magic);
+    std::string batch;
+    std::string payload;
+    _mempool->forEach([&](const Transaction& tx) {
+        payload.clear();
+        tx.encode(payload);
+        appendRecord(batch, AddRecord, payload);
+        if (batch.size() >= _config.maxBatchBytes) {
+            ok = ok && std::fwrite(batch.data(), 1, batch.size(), out) == batch.size();
+            batch.clear();
+        }
+    });
+    ok = ok && std::fwrite(batch.data(), 1, batch.size(), out) == batch.size();
+    ok = syncFile(out) && ok;
+    std::fclose(out);
+
+    std::error_code error;
+    if (ok) {
+        std::filesystem::rename(tmpPath, _path, error);
+    }
+    if (!ok || error) {
+        std::cerr << "Error: mempool journal compaction failed\n";
+        std::filesystem::remove(tmpPath, error);
+        return false;
+    }
+    syncDirectory(_path);
+
+    std::fclose(_file);
+    _file = std::fopen(_path.c_str(), "ab");
+    if (!_file) {
+        std::cerr << "Error: can't reopen mempool journal " << _path << "\n";
+        _failed = true;
+        return false;
+    }
+    _records = _mempool->size();
+    return true;
+}
+
+void MempoolJournal::writerLoop()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;) {
+        _wakeWriter.wait(lock, [&]() { return _stopping || !_pending.empty(); });
+        if (_pending.empty()) {
+            return;
+        }
+
+        // Group commit: let more records join the batch
+        const auto deadline = std::chrono::steady_clock::now() + _config.commitInterval;
+        _wakeWriter.wait_until(lock, deadline, [&]() {
+            return _stopping || _syncWaiters > 0 || _pending.size() >= _config.maxBatchBytes;
+        });
+
+        std::string batch;
+        batch.swap(_pending);
+        const uint64_t seq = _appendedSeq;
+        const bool failed = _failed;
+
+        // compact() syncs before it takes the mutex to swap _file, so the
+        // file is not replaced while the batch is written
+        lock.unlock();
+        const bool ok = !failed && writeBatch(batch);
+        lock.lock();
+
+        if (ok) {
+            ++_batches;
+            _durableSeq = seq;
+        } else if (!_failed) {
+            std::cerr << "Error: mempool journal write failed\n";
+            _failed = true;
+        }
+        _durable.notify_all();
+    }
+}
+
+bool MempoolJournal::writeBatch(const std::string& data)
+{
+    return std::fwrite(data.data(), 1, data.size(), _file) == data.size() && syncFile(_file);
+}
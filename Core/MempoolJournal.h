@@ -0,0 +1,155 @@
+#ifndef MEMPOOLJOURNAL_H
+#define MEMPOOLJOURNAL_H
+
+#include "Mempool.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * @file MempoolJournal.h
+ * @brief Definition of the MempoolJournal class, the crash-safe log of the mempool.
+ * @details Every transaction entering the pool is appended to the journal with
+ *          its binary encoding, and every removal with its txid. Each record
+ *          carries a CRC-32, so a record torn by a crash is detected and cut
+ *          off on replay. Appends only copy the record into memory; a writer
+ *          thread writes and fsyncs them in batches (group commit), so the cost
+ *          of fsync is shared by all the records of a batch. Callers that need
+ *          a record on disk before going on call sync(). Once a batch fails
+ *          to be written the journal stops writing: later records are dropped
+ *          and sync() and close() return false, as the file no longer
+ *          describes the pool.
+ *          Removals make the journal grow past the pool it describes; once most
+ *          records are dead, the journal is rewritten from the live pool and
+ *          atomically swapped in (compaction).
+ */
+
+struct JournalConfig {
+    // Time a batch waits for more records before it is written and synced
+    std::chrono::milliseconds commitInterval;
+    // A batch is written as soon as it holds this many bytes
+    size_t maxBatchBytes;
+    // Compaction runs when the journal holds more than compactRatio records
+    // per live transaction and at least minCompactRecords records
+    double compactRatio;
+    uint64_t minCompactRecords;
+
+    JournalConfig();
+};
+
+class MempoolJournal : public MempoolListener {
+public:
+
+    explicit MempoolJournal(const std::string& path, const JournalConfig& config = JournalConfig());
+
+    /**
+     * Writes and syncs the pending records, then stops the writer thread.
+     */
+    ~MempoolJournal() override;
+
+    MempoolJournal(const MempoolJournal&) = delete;
+    MempoolJournal& operator=(const MempoolJournal&) = delete;
+
+    /**
+     * Replays the journal into mempool, creating the file if needed, and
+     * starts logging. The journal registers itself as a listener of mempool,
+     * which must outlive it or call close() first.
+     * Returns false if the file can't be read or written.
+     */
+    bool open(Mempool& mempool);
+
+    /**
+     * Syncs the pending records, stops logging and unregisters from the mempool.
+     * Returns false if a record could not be written since open().
+     */
+    bool close();
+
+    /**
+     * Blocks until every record appended so far is on disk. Returns false,
+     * without waiting, once a write has failed.
+     */
+    bool sync();
+
+    /**
+     * Rewrites the journal with the transactions currently in the pool.
+     */
+    bool compact();
+
+    /**
+     * Number of records in the journal file, live or not.
+     */
+    uint64_t recordCount() const { return _records; }
+
+    /**
+     * Number of records found valid by the last open().
+     */
+    uint64_t replayedRecords() const { return _replayedRecords; }
+
+    /**
+     * Number of bytes cut off the end of the file by the last open(),
+     * normally a record torn by a crash.
+     */
+    uint64_t truncatedBytes() const { return _truncatedBytes; }
+
+    /**
+     * Returns true once a write failed since open().
+     */
+    bool failed() const;
+
+    /**
+     * Number of batches written and synced so far.
+     */
+    uint64_t batchCount() const;
+
+    // MempoolListener
+    void transactionAdded(const Transaction& tx) override;
+    void transactionRemoved(const TXID& txid) override;
+
+private:
+    enum RecordType : uint8_t {
+        AddRecord = 1,
+        RemoveRecord = 2,
+    };
+
+    // Reads the records of the file into mempool; sets validEnd to the end of
+    // the last valid record
+    bool replay(Mempool& mempool, uint64_t& validEnd);
+
+    static void appendRecord(std::string& output, RecordType type, const std::string& payload);
+    void append(RecordType type, const std::string& payload);
+    void maybeCompact();
+    void writerLoop();
+    // Writes and syncs data; _file must not be used concurrently
+    bool writeBatch(const std::string& data);
+
+    std::string _path;
+    JournalConfig _config;
+    Mempool* _mempool;
+    std::FILE* _file;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _wakeWriter;
+    std::condition_variable _durable;
+    // Records appended and not yet handed to the writer
+    std::string _pending;
+    // Sequence numbers of the last appended and last synced record; the
+    // latter stops moving once a write failed
+    uint64_t _appendedSeq;
+    uint64_t _durableSeq;
+    uint64_t _batches;
+    // Threads waiting in sync(); the writer skips the commit interval for them
+    unsigned _syncWaiters;
+    bool _stopping;
+    bool _failed;
+    std::thread _writer;
+
+    // Counted on the mutating thread
+    uint64_t _records;
+    uint64_t _replayedRecords;
+    uint64_t _truncatedBytes;
+};
+
+#endif // MEMPOOLJOURNAL_H
@@ -0,0 +1,25 @@
+#ifndef MEMPOOLLISTENER_H
+#define MEMPOOLLISTENER_H
+
+#include "Transaction.h"
+
+/**
+ * @file MempoolListener.h
+ * @brief Definition of the MempoolListener interface, notified of mempool changes.
+ * @details Components that mirror the mempool (journal, filters, caches)
+ *          register with Mempool::addListener(). They are told about every
+ *          transaction entering or leaving the pool, whatever the reason:
+ *          submission, confirmation in a block, or return after a reorg.
+ */
+class MempoolListener {
+public:
+    virtual ~MempoolListener() = default;
+
+    // Called after tx was added to the pool
+    virtual void transactionAdded(const Transaction& tx) = 0;
+
+    // Called after the transaction with this txid was removed from the pool
+    virtual void transactionRemoved(const TXID& txid) = 0;
+};
+
+#endif // MEMPOOLLISTENER_H
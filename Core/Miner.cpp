@@ -0,0 +1,232 @@
+#include "Miner.h"
+#include <algorithm>
+#include <limits>
+
+// -----------------------------------------------------------------------------
+//  MiningJob
+// -----------------------------------------------------------------------------
+void MiningJob::finish(std::optional<Block> block)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    complete(std::move(block));
+}
+
+bool MiningJob::submit(const Block& block, uint64_t templateGeneration)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (templateGeneration != generation.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    complete(block);
+    return true;
+}
+
+void MiningJob::laneStopped()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (--activeLanes == 0) {
+        lanesStopped.notify_all();
+    }
+}
+
+bool MiningJob::parkLane(std::function<void()> resume, uint64_t templateGeneration)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!done.load(std::memory_order_relaxed)) {
+        if (templateGeneration != generation.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        parkedLanes.push_back(std::move(resume));
+        if (parkedLanes.size() == laneCount) {
+            // No nonce of the template meets the difficulty
+            complete(std::nullopt);
+        }
+    }
+    if (--activeLanes == 0) {
+        lanesStopped.notify_all();
+    }
+    return true;
+}
+
+void MiningJob::waitForLanes()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    lanesStopped.wait(lock, [this]() { return activeLanes == 0; });
+}
+
+void MiningJob::complete(std::optional<Block> block)
+{
+    if (done.load(std::memory_order_relaxed)) {
+        return;
+    }
+    done.store(true, std::memory_order_release);
+    // Parked lanes hold the job; the caller keeps it alive
+    parkedLanes.clear();
+    result.set_value(std::move(block));
+}
+
+// -----------------------------------------------------------------------------
+//  MiningHandle
+// -----------------------------------------------------------------------------
+void MiningHandle::cancel()
+{
+    _job->finish(std::nullopt);
+    _job->waitForLanes();
+}
+
+void MiningHandle::updateTemplate(const Block& blockTemplate)
+{
+    std::vector<std::function<void()>> resumed;
+    {
+        std::lock_guard<std::mutex> lock(_job->mutex);
+        if (_job->done.load(std::memory_order_relaxed)) {
+            return;
+        }
+        _job->blockTemplate = blockTemplate;
+        _job->generation.fetch_add(1, std::memory_order_release);
+        resumed.swap(_job->parkedLanes);
+        _job->activeLanes += static_cast<unsigned>(resumed.size());
+    }
+    for (const auto& resume : resumed) {
+        resume();
+    }
+}
+
+// -----------------------------------------------------------------------------
+//  Mining lanes
+// -----------------------------------------------------------------------------
+namespace {
+
+// Hashes computed by a lane before it yields its pool thread
+const uint64_t SliceSize = 256;
+
+// Search state of one lane, carried from one slice to the next
+struct MiningLane {
+    std::shared_ptr<MiningJob> job;
+    ThreadPool* pool;
+    uint64_t index;
+    uint64_t stride;
+    Block work;
+    uint64_t generation;
+    uint64_t nonce;
+
+    MiningLane(std::shared_ptr<MiningJob> job, ThreadPool* pool, uint64_t index, uint64_t stride)
+        : job(std::move(job)), pool(pool), index(index), stride(stride),
+          work(""), generation(0), nonce(0) {}
+
+    void loadTemplate() {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        work = job->blockTemplate;
+        generation = job->generation.load(std::memory_order_relaxed);
+        nonce = static_cast<uint64_t>(work.getHeader().nonce) + index;
+    }
+};
+
+void runSlice(std::shared_ptr<MiningLane> lane);
+
+void publishHashes(MiningJob& job, uint64_t count)
+{
+    const uint64_t before = job.hashes.fetch_add(count, std::memory_order_relaxed);
+    const uint64_t after = before + count;
+    if (job.progress && before / job.progressInterval != after / job.progressInterval &&
+        !job.done.load(std::memory_order_acquire)) {
+        job.progress(after);
+    }
+}
+
+// -----------------------------------------------------------------------------
+//  runSlice()
+//  Lane i tries nonces start + i, start + i + n, ... where n is the number of
+//  lanes. The template generation is checked before every hash, so a lane
+//  never spends more than one hash on a replaced template. A lane past the
+//  last nonce is parked on the job instead of requeued, and a lane that
+//  finds the job done stops, so that waitForLanes() returns.
+// -----------------------------------------------------------------------------
+void postSlice(std::shared_ptr<MiningLane> lane)
+{
+    ThreadPool* pool = lane->pool;
+    pool->post([lane]() { runSlice(lane); }, TaskPriority::Background);
+}
+
+void runSlice(std::shared_ptr<MiningLane> lane)
+{
+    MiningJob& job = *lane->job;
+    uint64_t hashes = 0;
+    bool exhausted = false;
+
+    while (hashes < SliceSize && !job.done.load(std::memory_order_relaxed)) {
+        if (job.generation.load(std::memory_order_acquire) != lane->generation) {
+            lane->loadTemplate();
+            continue;
+        }
+        if (lane->nonce > std::numeric_limits<uint32_t>::max()) {
+            exhausted = true;
+            break;
+        }
+
+        lane->work.setNonce(static_cast<uint32_t>(lane->nonce));
+        lane->work.computeHash();
+        ++hashes;
+        if (lane->work.validateBlock(lane->work.getHeader().difficulty)) {
+            // Counted before the result is published, for hashesDone()
+            publishHashes(job, hashes);
+            hashes = 0;
+            job.submit(lane->work, lane->generation);
+        }
+        lane->nonce += lane->stride;
+    }
+
+    publishHashes(job, hashes);
+    if (exhausted) {
+        if (!job.parkLane([lane]() { postSlice(lane); }, lane->generation)) {
+            postSlice(lane);
+        }
+    } else if (job.done.load(std::memory_order_relaxed)) {
+        job.laneStopped();
+    } else {
+        postSlice(lane);
+    }
+}
+
+}
+
+// -----------------------------------------------------------------------------
+//  Miner
+// -----------------------------------------------------------------------------
+Miner::Miner(unsigned laneCount, ThreadPool& pool)
+    : _laneCount(std::max(1u, laneCount)), _pool(pool)
+{
+}
+
+Miner::~Miner()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_currentJob) {
+        _currentJob->finish(std::nullopt);
+        _currentJob->waitForLanes();
+    }
+}
+
+MiningHandle Miner::mine(const Block& blockTemplate,
+                         MiningProgressCallback progress,
+                         uint64_t progressInterval)
+{
+    auto job = std::make_shared<MiningJob>(blockTemplate, std::move(progress),
+                                           std::max<uint64_t>(1, progressInterval), _laneCount);
+    MiningHandle handle(job);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_currentJob) {
+            _currentJob->finish(std::nullopt);
+            _currentJob->waitForLanes();
+        }
+        _currentJob = job;
+    }
+
+    for (unsigned i = 0; i < _laneCount; ++i) {
+        auto lane = std::make_shared<MiningLane>(job, &_pool, i, _laneCount);
+        lane->loadTemplate();
+        postSlice(lane);
+    }
+    return handle;
+}
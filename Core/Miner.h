@@ -0,0 +1,168 @@
+#ifndef MINER_H
+#define MINER_H
+
+#include "Block.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+/**
+ * @file Miner.h
+ * @brief Definition of the Miner class, an asynchronous proof-of-work miner.
+ * @details Block::mine() blocks its caller until a nonce is found. The Miner runs
+ *          the same search as Background tasks on the shared ThreadPool instead:
+ *          mine() returns a MiningHandle immediately, through which the caller
+ *          can wait for the result, cancel the search, follow its progress, or
+ *          replace the block template (new previous hash, new Merkle root) while
+ *          the search keeps running. The search is split in lanes that each hash
+ *          a short slice of nonces and then requeue themselves, so higher-priority
+ *          pool work such as block validation gets a thread between slices. Lanes
+ *          check for a new template before every hash, so stale work is dropped
+ *          as soon as the template changes. A lane that tried every nonce of its
+ *          share waits for the next template without holding a pool thread.
+ */
+
+// Called from a worker thread with the total number of hashes computed so far;
+// never called once cancel() returned or the Miner was destroyed
+using MiningProgressCallback = std::function<void(uint64_t hashes)>;
+
+// State shared between a MiningHandle and the mining lanes
+struct MiningJob {
+    // Serializes template updates and completion
+    std::mutex mutex;
+    Block blockTemplate;
+    // Incremented on every template update
+    std::atomic<uint64_t> generation;
+    std::atomic<uint64_t> hashes;
+    std::atomic<bool> done;
+    std::promise<std::optional<Block>> result;
+    MiningProgressCallback progress;
+    uint64_t progressInterval;
+    const unsigned laneCount;
+    // Lanes queued or running on the pool, guarded by mutex
+    unsigned activeLanes;
+    // Lanes that exhausted their nonces, requeued by the next template update
+    std::vector<std::function<void()>> parkedLanes;
+    std::condition_variable lanesStopped;
+
+    MiningJob(const Block& block, MiningProgressCallback callback, uint64_t interval, unsigned lanes)
+        : blockTemplate(block), generation(0), hashes(0), done(false),
+          progress(std::move(callback)), progressInterval(interval),
+          laneCount(lanes), activeLanes(lanes) {}
+
+    // Publishes the result; only the first call has an effect
+    void finish(std::optional<Block> block);
+
+    // Publishes a mined block if it was built from the current template
+    bool submit(const Block& block, uint64_t templateGeneration);
+
+    // Called by a lane that returns its pool thread for good
+    void laneStopped();
+
+    // Called by a lane that tried every nonce of templateGeneration. Returns
+    // false if the template changed meanwhile, so the lane must keep going.
+    bool parkLane(std::function<void()> resume, uint64_t templateGeneration);
+
+    // Waits until no lane runs; the job must be done
+    void waitForLanes();
+
+private:
+    void complete(std::optional<Block> block);
+};
+
+class MiningHandle {
+public:
+
+    /**
+     * Waits for the search to end. Returns the mined block, or no value
+     * when the search was cancelled or every nonce of the template failed.
+     */
+    std::optional<Block> get() { return _result.get(); }
+
+    /**
+     * Waits up to timeout for the search to end.
+     */
+    template <class Rep, class Period>
+    bool waitFor(const std::chrono::duration<Rep, Period>& timeout) const {
+        return _result.wait_for(timeout) == std::future_status::ready;
+    }
+
+    /**
+     * Stops the search and waits for its lanes to return, so the progress
+     * callback is no longer called. get() then returns no value. Must not be
+     * called from the progress callback or from a task of the miner's pool.
+     */
+    void cancel();
+
+    /**
+     * Replaces the block being mined. Lanes switch to the new template
+     * without being restarted; hashes of the old template are discarded.
+     * Lanes that ran out of nonces are requeued.
+     */
+    void updateTemplate(const Block& blockTemplate);
+
+    /**
+     * Returns true once a block was found or the search ended without one.
+     */
+    bool isDone() const { return _job->done.load(std::memory_order_acquire); }
+
+    /**
+     * Number of hashes computed so far, across all templates.
+     */
+    uint64_t hashesDone() const { return _job->hashes.load(std::memory_order_relaxed); }
+
+private:
+    friend class Miner;
+    explicit MiningHandle(std::shared_ptr<MiningJob> job)
+        : _job(std::move(job)), _result(_job->result.get_future().share()) {}
+
+    std::shared_ptr<MiningJob> _job;
+    std::shared_future<std::optional<Block>> _result;
+};
+
+class Miner {
+public:
+
+    /**
+     * Creates a miner that searches with laneCount parallel lanes on pool.
+     */
+    explicit Miner(unsigned laneCount = ThreadPool::instance().threadCount(),
+                   ThreadPool& pool = ThreadPool::instance());
+
+    /**
+     * Cancels the current search and waits for its lanes to return.
+     */
+    ~Miner();
+
+    Miner(const Miner&) = delete;
+    Miner& operator=(const Miner&) = delete;
+
+    /**
+     * Starts mining blockTemplate and returns immediately. A search that is
+     * still running is cancelled first, and its lanes have returned when
+     * the new one starts. The nonce space is split across the lanes,
+     * starting from the template nonce.
+     */
+    MiningHandle mine(const Block& blockTemplate,
+                      MiningProgressCallback progress = nullptr,
+                      uint64_t progressInterval = 1 << 16);
+
+    /**
+     * Number of parallel lanes of a search.
+     */
+    unsigned laneCount() const { return _laneCount; }
+
+private:
+    const unsigned _laneCount;
+    ThreadPool& _pool;
+    std::mutex _mutex;
+    std::shared_ptr<MiningJob> _currentJob;
+};
+
+#endif // MINER_H
@@ -0,0 +1,193 @@
+#include "SignatureCache.h"
+#include "MemoryUsage.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <openssl/sha.h>
+
+SignatureCache::SignatureCache(size_t maxEntries)
+    : _maxEntries(maxEntries),
+      _shardCapacity(std::max<size_t>(1, maxEntries / ShardCount)),
+      _hits(0),
+      _misses(0)
+{
+}
+
+// -----------------------------------------------------------------------------
+//  makeKey()
+//  SHA-256 of the txid, the index and the signature; the fields are length
+//  prefixed so that different triples can't share an encoding.
+// -----------------------------------------------------------------------------
+SignatureCache::Key SignatureCache::makeKey(const TXID& txid, uint32_t index,
+                                            const std::string& signature)
+{
+    thread_local std::string data;
+    const uint64_t txidSize = txid.size();
+    data.assign(reinterpret_cast<const char*>(&txidSize), sizeof(txidSize));
+    data += txid;
+    data.append(reinterpret_cast<const char*>(&index), sizeof(index));
+    data += signature;
+
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    SHA256(reinterpret_cast<const unsigned char*>(data.data()), data.size(), digest);
+    Key key;
+    std::memcpy(key.data(), digest, sizeof(digest));
+    return key;
+}
+
+bool SignatureCache::contains(const TXID& txid, uint32_t index, const std::string& signature) const
+{
+    const Key key = makeKey(txid, index, signature);
+    const Shard& shard = shardOf(key);
+    bool found;
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        found = shard.keys.count(key) != 0;
+    }
+    (found ? _hits : _misses).fetch_add(1, std::memory_order_relaxed);
+    return found;
+}
+
+void SignatureCache::insert(const TXID& txid, uint32_t index, const std::string& signature)
+{
+    const Key key = makeKey(txid, index, signature);
+    Shard& shard = shardOf(key);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    if (!shard.keys.insert(key).second) {
+        return;
+    }
+    shard.order.push_back(key);
+    if (shard.order.size() > _shardCapacity) {
+        shard.keys.erase(shard.order.front());
+        shard.order.pop_front();
+    }
+}
+
+void SignatureCache::clear()
+{
+    for (Shard& shard : _shards) {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        shard.keys.clear();
+        shard.order.clear();
+    }
+}
+
+size_t SignatureCache::size() const
+{
+    size_t count = 0;
+    for (const Shard& shard : _shards) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        count += shard.keys.size();
+    }
+    return count;
+}
+
+size_t SignatureCache::memoryUsage() const
+{
+    size_t bytes = 0;
+    for (const Shard& shard : _shards) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        bytes += dynamicUsage(shard.keys) + dynamicUsage(shard.order);
+    }
+    return bytes;
+}
+
+// -----------------------------------------------------------------------------
+//  verifyTransactionSignatures()
+//  The signature hash is only computed when an input misses the cache.
+// -----------------------------------------------------------------------------
+bool verifyTransactionSignatures(const Transaction& tx, const std::vector<const TxOut*>& spent,
+                                 SignatureCache* cache, bool store)
+{
+    const std::vector<TxIn>& inputs = tx.getInputs();
+    if (spent.size() != inputs.size()) {
+        return false;
+    }
+    std::string signatureHash;
+    for (uint32_t i = 0; i < inputs.size(); ++i) {
+        const TxIn& input = inputs[i];
+        if (input.isCoinbase()) {
+            continue;
+        }
+        if (!spent[i]) {
+            return false;
+        }
+        if (cache && cache->contains(tx.getTxid(), i, input.signature)) {
+            // The signature is known to be valid; only the owner is checked
+            if (Transaction::hashPublicKey(input.publicKey) != spent[i]->publicKeyHash) {
+                return false;
+            }
+            continue;
+        }
+        if (signatureHash.empty()) {
+            signatureHash = tx.getSignatureHash();
+        }
+        if (!tx.verifyInput(i, *spent[i], signatureHash)) {
+            return false;
+        }
+        if (cache && store) {
+            cache->insert(tx.getTxid(), i, input.signature);
+        }
+    }
+    return true;
+}
+
+void cacheInputSignatures(const Transaction& tx, SignatureCache& cache)
+{
+    std::string signatureHash;
+    for (uint32_t i = 0; i < tx.getInputs().size(); ++i) {
+        const TxIn& input = tx.getInputs()[i];
+        if (input.isCoinbase() || input.signature.empty()) {
+            continue;
+        }
+        if (signatureHash.empty()) {
+            signatureHash = tx.getSignatureHash();
+        }
+        if (tx.verifyInputSignature(i, signatureHash)) {
+            cache.insert(tx.getTxid(), i, input.signature);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+//  verifyBlockSignatures()
+//  The undo data lists the outputs spent by the non-coinbase inputs in block
+//  order, so each transaction finds its own from a prefix sum.
+// -----------------------------------------------------------------------------
+bool verifyBlockSignatures(const Block& block, const BlockUndo& undo, SignatureCache* cache,
+                           ThreadPool& pool)
+{
+    TRACE_SCOPE("verifyBlockSignatures");
+    const std::vector<Transaction>& transactions = block.getTransactions();
+    std::vector<size_t> undoStart(transactions.size() + 1, 0);
+    for (size_t t = 0; t < transactions.size(); ++t) {
+        size_t spending = 0;
+        for (const auto& input : transactions[t].getInputs()) {
+            spending += input.isCoinbase() ? 0 : 1;
+        }
+        undoStart[t + 1] = undoStart[t] + spending;
+    }
+    if (undoStart.back() != undo.spentOutputs.size()) {
+        return false;
+    }
+
+    std::atomic<bool> valid(true);
+    pool.parallelFor(0, transactions.size(), [&](size_t t) {
+        if (!valid.load(std::memory_order_relaxed)) {
+            return;
+        }
+        const Transaction& tx = transactions[t];
+        std::vector<const TxOut*> spent(tx.getInputs().size(), nullptr);
+        size_t next = undoStart[t];
+        for (size_t i = 0; i < spent.size(); ++i) {
+            if (!tx.getInputs()[i].isCoinbase()) {
+                spent[i] = &undo.spentOutputs[next++].second;
+            }
+        }
+        if (!verifyTransactionSignatures(tx, spent, cache, false)) {
+            valid.store(false, std::memory_order_relaxed);
+        }
+    }, TaskPriority::High);
+    return valid.load();
+}
@@ -0,0 +1,124 @@
+#ifndef SIGNATURECACHE_H
+#define SIGNATURECACHE_H
+
+#include "ThreadPool.h"
+#include "UTXOSet.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @file SignatureCache.h
+ * @brief Definition of the SignatureCache class, the set of signatures already verified.
+ * @details Checking an ECDSA signature costs far more than everything else done
+ *          for an input. A transaction is verified when it enters the mempool
+ *          and again when it is confirmed by a block, so the mempool records
+ *          every (txid, input index, signature) triple it verified and block
+ *          acceptance skips the inputs it finds. Triples are stored as their
+ *          SHA-256, in shards each guarded by its own lock, so that the threads
+ *          checking a block look them up concurrently. The cache holds at most
+ *          maxEntries triples; the oldest ones of a shard make room for new ones.
+ *          A hit only proves the signature is valid for the transaction; the
+ *          caller still checks the public key against the spent output, which
+ *          may differ between the mempool and the block's chain.
+ */
+class SignatureCache {
+public:
+
+    static const size_t DefaultMaxEntries = 1 << 20;
+
+    explicit SignatureCache(size_t maxEntries = DefaultMaxEntries);
+
+    SignatureCache(const SignatureCache&) = delete;
+    SignatureCache& operator=(const SignatureCache&) = delete;
+
+    /**
+     * Returns true if the signature of input index of the transaction was
+     * recorded as valid.
+     */
+    bool contains(const TXID& txid, uint32_t index, const std::string& signature) const;
+
+    /**
+     * Records a verified signature, evicting the oldest entry of its shard if
+     * the cache is full.
+     */
+    void insert(const TXID& txid, uint32_t index, const std::string& signature);
+
+    void clear();
+
+    /**
+     * Number of signatures recorded.
+     */
+    size_t size() const;
+
+    size_t maxEntries() const { return _maxEntries; }
+
+    /**
+     * Heap bytes held by the shards, counted from container capacities
+     * (see MemoryUsage.h).
+     */
+    size_t memoryUsage() const;
+
+    /**
+     * Number of contains() calls that found the signature, and that didn't.
+     */
+    uint64_t hits() const { return _hits.load(std::memory_order_relaxed); }
+    uint64_t misses() const { return _misses.load(std::memory_order_relaxed); }
+
+private:
+    static const size_t ShardCount = 16;
+
+    typedef std::array<uint64_t, 4> Key;
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const { return static_cast<size_t>(key[0]); }
+    };
+
+    struct Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_set<Key, KeyHash> keys;
+        // Insertion order, for eviction
+        std::deque<Key> order;
+    };
+
+    static Key makeKey(const TXID& txid, uint32_t index, const std::string& signature);
+    Shard& shardOf(const Key& key) const { return _shards[key[1] % ShardCount]; }
+
+    size_t _maxEntries;
+    size_t _shardCapacity;
+    mutable std::array<Shard, ShardCount> _shards;
+    mutable std::atomic<uint64_t> _hits;
+    mutable std::atomic<uint64_t> _misses;
+};
+
+/**
+ * Verifies the signatures of tx, whose input i spends *spent[i] (nullptr for
+ * a coinbase input). Inputs found in cache are not verified again, and the
+ * ones verified are recorded in it when store is set. cache may be nullptr.
+ */
+bool verifyTransactionSignatures(const Transaction& tx, const std::vector<const TxOut*>& spent,
+                                 SignatureCache* cache, bool store = true);
+
+/**
+ * Verifies the signed inputs of tx with the keys they carry, before their
+ * spent outputs are known, and records the valid signatures in cache. The
+ * later verifyTransactionSignatures() finds them and only checks that the
+ * keys own the spent outputs; invalid signatures are left for it to reject.
+ */
+void cacheInputSignatures(const Transaction& tx, SignatureCache& cache);
+
+/**
+ * Verifies the signatures of a block connected with undo, the transactions
+ * in parallel. Inputs found in cache are skipped; the others are verified
+ * but not recorded, since a confirmed transaction is not seen again.
+ */
+bool verifyBlockSignatures(const Block& block, const BlockUndo& undo, SignatureCache* cache,
+                           ThreadPool& pool = ThreadPool::instance());
+
+#endif // SIGNATURECACHE_H
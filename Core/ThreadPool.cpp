@@ -0,0 +1,138 @@
+#include "ThreadPool.h"
+
+namespace {
+// Identifies the pool worker running on the current thread, if any
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local size_t currentWorker = 0;
+}
+
+ThreadPool::ThreadPool(unsigned threadCount)
+    : _nextWorker(0), _pending(0), _stopping(false)
+{
+    threadCount = std::max(1u, threadCount);
+    for (unsigned i = 0; i < threadCount; ++i) {
+        _workers.push_back(std::make_unique<Worker>());
+    }
+    // Start the threads once every worker exists, since they steal from each other
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        _workers[i]->thread = std::thread(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_sleepMutex);
+        _stopping = true;
+    }
+    _wake.notify_all();
+    for (auto& worker : _workers) {
+        worker->thread.join();
+    }
+}
+
+ThreadPool& ThreadPool::instance()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+// -----------------------------------------------------------------------------
+//  post()
+//  A worker pushes to its own deque, where it will find the task first; other
+//  threads spread their tasks over the workers in turn.
+// -----------------------------------------------------------------------------
+void ThreadPool::post(std::function<void()> task, TaskPriority priority)
+{
+    const size_t index = currentPool == this
+        ? currentWorker
+        : _nextWorker.fetch_add(1, std::memory_order_relaxed) % _workers.size();
+
+    Worker& worker = *_workers[index];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.queues[static_cast<size_t>(priority)].push_back(std::move(task));
+    }
+    _pending.fetch_add(1, std::memory_order_release);
+
+    // Taking the lock orders the wake-up after a worker's predicate check
+    { std::lock_guard<std::mutex> lock(_sleepMutex); }
+    _wake.notify_one();
+}
+
+// -----------------------------------------------------------------------------
+//  findTask()
+//  For each priority level, the worker's own deque is tried first (newest
+//  task, still warm in cache), then the other deques (oldest task).
+// -----------------------------------------------------------------------------
+bool ThreadPool::findTask(size_t index, Task& task)
+{
+    const size_t workerCount = _workers.size();
+
+    for (size_t priority = 0; priority < PriorityCount; ++priority) {
+        if (index < workerCount) {
+            Worker& own = *_workers[index];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            auto& queue = own.queues[priority];
+            if (!queue.empty()) {
+                task = std::move(queue.back());
+                queue.pop_back();
+                _pending.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        for (size_t offset = 1; offset <= workerCount; ++offset) {
+            const size_t victimIndex = (index + offset) % workerCount;
+            if (victimIndex == index) {
+                continue;
+            }
+            Worker& victim = *_workers[victimIndex];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            auto& queue = victim.queues[priority];
+            if (!queue.empty()) {
+                task = std::move(queue.front());
+                queue.pop_front();
+                _pending.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::runPendingTask()
+{
+    if (_pending.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+    Task task;
+    const size_t index = currentPool == this ? currentWorker : _workers.size();
+    if (!findTask(index, task)) {
+        return false;
+    }
+    task();
+    return true;
+}
+
+void ThreadPool::workerLoop(size_t index)
+{
+    currentPool = this;
+    currentWorker = index;
+
+    for (;;) {
+        Task task;
+        if (findTask(index, task)) {
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_sleepMutex);
+        _wake.wait(lock, [this] {
+            return _stopping || _pending.load(std::memory_order_acquire) > 0;
+        });
+        if (_stopping && _pending.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,170 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @file ThreadPool.h
+ * @brief Definition of the ThreadPool class, the shared work-stealing scheduler.
+ * @details Parallel work in Core (mining, Merkle hashing, signature checks, block
+ *          validation) runs on one pool instead of private threads. Every worker
+ *          owns one deque per priority: it pops its own tasks from the back and
+ *          steals from the front of the other workers' deques when it runs dry.
+ *          A worker always looks for a higher-priority task, in its own deques and
+ *          then in the others', before a lower-priority one, so a High task never
+ *          waits behind more than the Background tasks already running.
+ *          Tasks are not interrupted: long Background work (mining) is expected
+ *          to run in short slices.
+ */
+
+enum class TaskPriority {
+    High = 0,       // Block validation and connection
+    Normal = 1,     // Default for Core work
+    Background = 2, // Mining and other work that can always wait
+};
+
+class ThreadPool {
+public:
+
+    /**
+     * Starts threadCount workers (at least one).
+     */
+    explicit ThreadPool(unsigned threadCount = std::thread::hardware_concurrency());
+
+    /**
+     * Runs the queued tasks and joins the workers.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Pool shared by all Core operations, sized to the hardware.
+     */
+    static ThreadPool& instance();
+
+    /**
+     * Queues a task without a result.
+     */
+    void post(std::function<void()> task, TaskPriority priority = TaskPriority::Normal);
+
+    /**
+     * Queues a task and returns a future for its result.
+     */
+    template <class F>
+    auto submit(F&& function, TaskPriority priority = TaskPriority::Normal)
+        -> std::future<typename std::invoke_result<F>::type>
+    {
+        using Result = typename std::invoke_result<F>::type;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(function));
+        std::future<Result> result = task->get_future();
+        post([task]() { (*task)(); }, priority);
+        return result;
+    }
+
+    /**
+     * Calls body(i) for every i in [begin, end) and returns when all calls are
+     * done. The range is cut in chunks of grain indices (0 picks a grain that
+     * gives a few chunks per worker). The calling thread runs chunks too, so
+     * parallelFor can be nested inside pool tasks.
+     */
+    template <class F>
+    void parallelFor(size_t begin, size_t end, F&& body,
+                     TaskPriority priority = TaskPriority::Normal, size_t grain = 0);
+
+    /**
+     * Number of worker threads.
+     */
+    unsigned threadCount() const { return static_cast<unsigned>(_workers.size()); }
+
+private:
+    using Task = std::function<void()>;
+    static constexpr size_t PriorityCount = 3;
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> queues[PriorityCount];
+        std::thread thread;
+    };
+
+    void workerLoop(size_t index);
+
+    // Pops the highest-priority task visible from worker index (or from an
+    // external thread when index is out of range)
+    bool findTask(size_t index, Task& task);
+
+    // Runs one queued task on the calling thread, if any
+    bool runPendingTask();
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    // Round-robin target for tasks posted from outside the pool
+    std::atomic<size_t> _nextWorker;
+    // Number of queued tasks
+    std::atomic<size_t> _pending;
+    std::mutex _sleepMutex;
+    std::condition_variable _wake;
+    bool _stopping;
+};
+
+// -----------------------------------------------------------------------------
+//  parallelFor()
+//  Chunks are claimed from a shared counter, so workers and the caller balance
+//  the load among themselves whatever the cost of each index.
+// -----------------------------------------------------------------------------
+template <class F>
+void ThreadPool::parallelFor(size_t begin, size_t end, F&& body,
+                             TaskPriority priority, size_t grain)
+{
+    if (begin >= end) {
+        return;
+    }
+    const size_t count = end - begin;
+    if (grain == 0) {
+        grain = std::max<size_t>(1, count / (static_cast<size_t>(threadCount()) * 4));
+    }
+    const size_t chunks = (count + grain - 1) / grain;
+
+    struct Loop {
+        std::atomic<size_t> nextChunk{0};
+        std::atomic<size_t> doneChunks{0};
+    };
+    auto loop = std::make_shared<Loop>();
+
+    auto runChunks = [loop, begin, end, grain, chunks, &body]() {
+        for (size_t chunk = loop->nextChunk.fetch_add(1); chunk < chunks;
+             chunk = loop->nextChunk.fetch_add(1)) {
+            const size_t first = begin + chunk * grain;
+            const size_t last = std::min(end, first + grain);
+            for (size_t i = first; i < last; ++i) {
+                body(i);
+            }
+            loop->doneChunks.fetch_add(1, std::memory_order_release);
+        }
+    };
+
+    const size_t helpers = std::min<size_t>(chunks - 1, threadCount());
+    for (size_t i = 0; i < helpers; ++i) {
+        post(runChunks, priority);
+    }
+    runChunks();
+
+    // Help with other queued work while the last chunks finish elsewhere
+    while (loop->doneChunks.load(std::memory_order_acquire) < chunks) {
+        if (!runPendingTask()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+#endif // THREADPOOL_H
@@ -0,0 +1,227 @@
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+// Fields are atomics so that collect() may read a slot being overwritten;
+// such reads are detected and dropped
+struct Slot {
+    std::atomic<const char*> name;
+    std::atomic<uint64_t> start;
+    std::atomic<uint64_t> duration;
+    std::atomic<uint32_t> thread;
+};
+
+struct Buffer {
+    std::unique_ptr<Slot[]> slots;
+    // Spans started and spans written; only the owning thread writes them
+    std::atomic<uint64_t> claimed;
+    std::atomic<uint64_t> written;
+    // Spans before this one were cleared
+    std::atomic<uint64_t> first;
+    uint32_t thread;
+
+    Buffer() : slots(new Slot[Trace::BufferSize]), claimed(0), written(0), first(0), thread(0) {}
+};
+
+// Buffers outlive their threads, so that their spans can still be exported;
+// the buffer of a thread that exited is given to the next new thread
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Buffer>> buffers;
+    std::vector<Buffer*> released;
+    uint32_t threads = 0;
+};
+
+// Never destroyed: threads may exit after static destructors ran
+Registry& registry()
+{
+    static Registry* instance = new Registry();
+    return *instance;
+}
+
+Buffer* acquireBuffer()
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    Buffer* buffer;
+    if (r.released.empty()) {
+        r.buffers.emplace_back(new Buffer());
+        buffer = r.buffers.back().get();
+    } else {
+        buffer = r.released.back();
+        r.released.pop_back();
+    }
+    buffer->thread = ++r.threads;
+    return buffer;
+}
+
+struct ThreadBuffer {
+    Buffer* buffer = nullptr;
+
+    ~ThreadBuffer() {
+        if (buffer) {
+            Registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.released.push_back(buffer);
+        }
+    }
+};
+
+thread_local ThreadBuffer threadBuffer;
+
+// Oldest span of buffer still available
+uint64_t firstAvailable(const Buffer& buffer, uint64_t end)
+{
+    const uint64_t oldest = end > Trace::BufferSize ? end - Trace::BufferSize : 0;
+    return std::max(oldest, buffer.first.load(std::memory_order_relaxed));
+}
+
+void writeEscaped(std::ostream& out, const char* text)
+{
+    for (; *text; ++text) {
+        if (*text == '"' || *text == '\\') {
+            out << '\\';
+        }
+        out << *text;
+    }
+}
+
+// Nanoseconds as microseconds with three decimals
+void writeMicroseconds(std::ostream& out, uint64_t nanoseconds)
+{
+    char text[32];
+    std::snprintf(text, sizeof(text), "%llu.%03u", static_cast<unsigned long long>(nanoseconds / 1000),
+                  static_cast<unsigned>(nanoseconds % 1000));
+    out << text;
+}
+
+} // namespace
+
+const size_t Trace::BufferSize;
+
+uint64_t Trace::now()
+{
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+}
+
+// -----------------------------------------------------------------------------
+//  record()
+//  A sequence lock without the lock: the slot is claimed before it is
+//  written, so a reader finding a claim past its slot knows the slot may
+//  hold a newer span.
+// -----------------------------------------------------------------------------
+void Trace::record(const char* name, uint64_t start, uint64_t end)
+{
+    Buffer* buffer = threadBuffer.buffer;
+    if (!buffer) {
+        buffer = threadBuffer.buffer = acquireBuffer();
+    }
+    const uint64_t index = buffer->claimed.load(std::memory_order_relaxed);
+    buffer->claimed.store(index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    Slot& slot = buffer->slots[index % BufferSize];
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.duration.store(end > start ? end - start : 0, std::memory_order_relaxed);
+    slot.thread.store(buffer->thread, std::memory_order_relaxed);
+    buffer->written.store(index + 1, std::memory_order_release);
+}
+
+std::vector<TraceEvent> Trace::collect()
+{
+    std::vector<TraceEvent> events;
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (const auto& buffer : r.buffers) {
+        const uint64_t written = buffer->written.load(std::memory_order_acquire);
+        const size_t begin = events.size();
+        const uint64_t first = firstAvailable(*buffer, written);
+        for (uint64_t index = first; index < written; ++index) {
+            const Slot& slot = buffer->slots[index % BufferSize];
+            events.push_back(TraceEvent{slot.name.load(std::memory_order_relaxed),
+                                        slot.start.load(std::memory_order_relaxed),
+                                        slot.duration.load(std::memory_order_relaxed),
+                                        slot.thread.load(std::memory_order_relaxed)});
+        }
+        // Slots the owner started to overwrite meanwhile are dropped
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t claimed = buffer->claimed.load(std::memory_order_relaxed);
+        const uint64_t overwritten = claimed > BufferSize ? claimed - BufferSize : 0;
+        if (overwritten > first) {
+            const size_t stale = static_cast<size_t>(std::min(overwritten, written) - first);
+            events.erase(events.begin() + begin, events.begin() + begin + stale);
+        }
+    }
+    std::sort(events.begin(), events.end(),
+              [](const TraceEvent& a, const TraceEvent& b) { return a.start < b.start; });
+    return events;
+}
+
+uint64_t Trace::dropped()
+{
+    uint64_t count = 0;
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (const auto& buffer : r.buffers) {
+        const uint64_t written = buffer->written.load(std::memory_order_acquire);
+        const uint64_t first = buffer->first.load(std::memory_order_relaxed);
+        if (written > first + BufferSize) {
+            count += written - first - BufferSize;
+        }
+    }
+    return count;
+}
+
+void Trace::clear()
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (const auto& buffer : r.buffers) {
+        buffer->first.store(buffer->written.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+}
+
+// -----------------------------------------------------------------------------
+//  exportJson()
+//  Complete events ("ph":"X") with times in microseconds, as the format
+//  expects; one process, one track per thread.
+// -----------------------------------------------------------------------------
+bool Trace::exportJson(std::ostream& out)
+{
+    const std::vector<TraceEvent> events = collect();
+    out << "{\"traceEvents\":[";
+    for (size_t i = 0; i < events.size(); ++i) {
+        const TraceEvent& event = events[i];
+        out << (i ? ",\n" : "\n") << "{\"name\":\"";
+        writeEscaped(out, event.name);
+        out << "\",\"cat\":\"blockchain\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":";
+        writeMicroseconds(out, event.start);
+        out << ",\"dur\":";
+        writeMicroseconds(out, event.duration);
+        out << "}";
+    }
+    out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    out.flush();
+    return out.good();
+}
+
+bool Trace::exportJson(const std::string& path)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out || !exportJson(out)) {
+        std::cerr << "Error: cannot write the trace to " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,96 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @file Trace.h
+ * @brief Span profiling of block processing, exported as Chrome trace events.
+ * @details TRACE_SCOPE("name") records the time spent in the rest of the
+ *          enclosing scope as a span of the calling thread. Each thread writes
+ *          its spans to a ring buffer of its own, without locks; once a buffer
+ *          is full the oldest spans are overwritten. exportJson() writes every
+ *          buffered span in the Chrome trace-event format, which chrome://tracing
+ *          and Perfetto open, one track per thread.
+ *          Spans are only compiled in when BLOCKCHAIN_ENABLE_TRACING is defined
+ *          (CMake option of the same name); otherwise TRACE_SCOPE expands to
+ *          nothing and instrumented code is unchanged.
+ */
+
+struct TraceEvent {
+    const char* name;
+    // Nanoseconds since the first call to Trace::now()
+    uint64_t start;
+    uint64_t duration;
+    // Numbered from 1 in the order threads record their first span
+    uint32_t thread;
+};
+
+class Trace {
+public:
+
+    // Spans kept per thread
+    static const size_t BufferSize = 1 << 15;
+
+    /**
+     * Nanoseconds on the steady clock since the first call.
+     */
+    static uint64_t now();
+
+    /**
+     * Records a span of the calling thread; name must outlive the trace,
+     * like a string literal.
+     */
+    static void record(const char* name, uint64_t start, uint64_t end);
+
+    /**
+     * Spans buffered by every thread, by start time. Spans being recorded
+     * concurrently may be missed.
+     */
+    static std::vector<TraceEvent> collect();
+
+    /**
+     * Spans overwritten because their buffer was full.
+     */
+    static uint64_t dropped();
+
+    /**
+     * Forgets the spans recorded so far.
+     */
+    static void clear();
+
+    /**
+     * Writes the buffered spans as a Chrome trace-event JSON object.
+     * Returns false, with an error on std::cerr for a path, if writing fails.
+     */
+    static bool exportJson(std::ostream& out);
+    static bool exportJson(const std::string& path);
+};
+
+// Records the lifetime of the object as a span
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : _name(name), _start(Trace::now()) {}
+    ~TraceScope() { Trace::record(_name, _start, Trace::now()); }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* _name;
+    uint64_t _start;
+};
+
+#ifdef BLOCKCHAIN_ENABLE_TRACING
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name) static_cast<void>(0)
+#endif
+
+#endif // TRACE_H
@@ -1,24 +1,91 @@
 #include "Transaction.h"
-#include <sstream>
-#include <iomanip>
+#include "Encoding.h"
+#include "Hex.h"
+#include "MemoryUsage.h"
+#include "Trace.h"
+#include <openssl/x509.h>
+#include <charconv>
 #include <chrono>
+#include <thread>
 
 Transaction::Transaction()
-    : timestamp(std::chrono::duration_cast<std::chrono::milliseconds>(
+    : _timestamp(std::chrono::duration_cast<std::chrono::milliseconds>(
                     std::chrono::system_clock::now().time_since_epoch()).count()),
-    txsignature("")
+    _txsignature(""),
+    _txidState(TxidEmpty),
+    _encodedSize(0)
 {
-    computeHash();
 }
 
 Transaction::Transaction(const std::vector<TxIn>& ins,
                          const std::vector<TxOut>& outs)
-    : inputs(ins), outputs(outs),
-      timestamp(std::chrono::duration_cast<std::chrono::milliseconds>(
+    : _inputs(ins), _outputs(outs),
+      _timestamp(std::chrono::duration_cast<std::chrono::milliseconds>(
                     std::chrono::system_clock::now().time_since_epoch()).count()),
-    txsignature("")
+    _txsignature(""),
+    _txidState(TxidEmpty),
+    _encodedSize(0)
 {
-    computeHash();
+}
+
+// -----------------------------------------------------------------------------
+//  Copies keep the cached txid only when it is complete.
+// -----------------------------------------------------------------------------
+Transaction::Transaction(const Transaction& other)
+    : _inputs(other._inputs),
+      _outputs(other._outputs),
+      _timestamp(other._timestamp),
+      _txsignature(other._txsignature),
+      _txidState(TxidEmpty),
+      _encodedSize(other._encodedSize.load(std::memory_order_relaxed))
+{
+    if (other._txidState.load(std::memory_order_acquire) == TxidReady) {
+        _txid = other._txid;
+        _txidState.store(TxidReady, std::memory_order_relaxed);
+    }
+}
+
+Transaction::Transaction(Transaction&& other) noexcept
+    : _inputs(std::move(other._inputs)),
+      _outputs(std::move(other._outputs)),
+      _timestamp(other._timestamp),
+      _txsignature(std::move(other._txsignature)),
+      _txidState(TxidEmpty),
+      _encodedSize(other._encodedSize.load(std::memory_order_relaxed))
+{
+    if (other._txidState.load(std::memory_order_acquire) == TxidReady) {
+        _txid = std::move(other._txid);
+        _txidState.store(TxidReady, std::memory_order_relaxed);
+    }
+    other.invalidateTxid();
+}
+
+Transaction& Transaction::operator=(const Transaction& other)
+{
+    if (this != &other) {
+        *this = Transaction(other);
+    }
+    return *this;
+}
+
+Transaction& Transaction::operator=(Transaction&& other) noexcept
+{
+    if (this != &other) {
+        _inputs = std::move(other._inputs);
+        _outputs = std::move(other._outputs);
+        _timestamp = other._timestamp;
+        _txsignature = std::move(other._txsignature);
+        _encodedSize.store(other._encodedSize.load(std::memory_order_relaxed),
+                           std::memory_order_relaxed);
+        if (other._txidState.load(std::memory_order_acquire) == TxidReady) {
+            _txid = std::move(other._txid);
+            _txidState.store(TxidReady, std::memory_order_relaxed);
+        } else {
+            invalidateTxid();
+        }
+        other.invalidateTxid();
+    }
+    return *this;
 }
 
 // -----------------------------------------------------------------------------
@@ -27,11 +94,11 @@ Transaction::Transaction(const std::vector<TxIn>& ins,
 bool Transaction::validate() const
 {
     // Basic checks
-    if (inputs.empty() || outputs.empty()) {
+    if (_inputs.empty() || _outputs.empty()) {
         return false; // A valid transaction must have at least one input and one output
     }
 
-    for (const auto& output : outputs) {
+    for (const auto& output : _outputs) {
         if (output.amount == 0) {
             return false; // Outputs must have a non-zero amount
         }
@@ -43,47 +110,226 @@ bool Transaction::validate() const
 }
 
 // -----------------------------------------------------------------------------
-//  computeHash()
-//  Produces the TXID by hashing the serialized transaction.
+//  hashHex()
+//  Hex SHA-256 of the serialized transaction.
 // -----------------------------------------------------------------------------
-void Transaction::computeHash()
+static TXID hashHex(const std::string& data)
 {
-    // Converts a Transaction object into a single, deterministic
-    // sequence of bytes (or a string) that can be hashed
-    std::string data = serialize();
     unsigned char hash[SHA256_DIGEST_LENGTH];
     SHA256(reinterpret_cast<const unsigned char*>(data.c_str()), data.size(), hash);
-    // Convert the hash to a hex string
-    std::ostringstream oss;
-    for (int i = 0; i < SHA256_DIGEST_LENGTH; ++i) {
-        oss << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(hash[i]);
+    return toHex(hash, SHA256_DIGEST_LENGTH);
+}
+
+const TXID& Transaction::getTxid() const
+{
+    if (_txidState.load(std::memory_order_acquire) == TxidReady) {
+        return _txid;
     }
-    txid = oss.str();
+    thread_local std::string buffer;
+    return getTxid(buffer);
+}
+
+// -----------------------------------------------------------------------------
+//  getTxid()
+//  Threads that find no cached txid all hash the transaction; the first one
+//  to claim the cache publishes its result and the others wait for it, which
+//  only lasts as long as a string copy.
+// -----------------------------------------------------------------------------
+const TXID& Transaction::getTxid(std::string& buffer) const
+{
+    if (_txidState.load(std::memory_order_acquire) == TxidReady) {
+        return _txid;
+    }
+
+    TRACE_SCOPE("Transaction::getTxid");
+    serialize(buffer);
+    TXID computed = hashHex(buffer);
+    uint8_t expected = TxidEmpty;
+    if (_txidState.compare_exchange_strong(expected, TxidComputing, std::memory_order_acquire)) {
+        _txid = std::move(computed);
+        _txidState.store(TxidReady, std::memory_order_release);
+        return _txid;
+    }
+    while (_txidState.load(std::memory_order_acquire) != TxidReady) {
+        std::this_thread::yield();
+    }
+    return _txid;
+}
+
+// -----------------------------------------------------------------------------
+//  computeHash()
+//  Produces the TXID by hashing the serialized transaction.
+// -----------------------------------------------------------------------------
+void Transaction::computeHash()
+{
+    TRACE_SCOPE("Transaction::computeHash");
+    _txid = hashHex(serialize());
+    _txidState.store(TxidReady, std::memory_order_release);
 }
 
 // -----------------------------------------------------------------------------
 //  serialize()
-//  Produces a canonical string describing the transaction.
+//  Produces a canonical string describing the transaction: the fields
+//  concatenated, numbers in decimal.
 // -----------------------------------------------------------------------------
 std::string Transaction::serialize() const
 {
-    std::ostringstream oss;
-    oss << timestamp;
+    std::string output;
+    serialize(output);
+    return output;
+}
+
+// Appends the decimal form of value
+static void appendNumber(std::string& output, uint64_t value)
+{
+    char digits[20];
+    char* end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+    output.append(digits, end);
+}
+
+void Transaction::serialize(std::string& output) const
+{
+    output.clear();
+    appendNumber(output, _timestamp);
 
-    for (const auto& input : inputs) {
-        oss << input.prevTxID << input.outputIndex
-            << input.signature << input.publicKey;
+    for (const auto& input : _inputs) {
+        output += input.prevTxID;
+        appendNumber(output, input.outputIndex);
+        output += input.signature;
+        output += input.publicKey;
     }
 
-    for (const auto& output : outputs) {
-        oss << output.amount << output.publicKeyHash;
+    for (const auto& out : _outputs) {
+        appendNumber(output, out.amount);
+        output += out.publicKeyHash;
+    }
+}
+
+// -----------------------------------------------------------------------------
+//  getEncodedSize()
+//  Mirrors encode() field by field. Concurrent first calls compute the same
+//  value, so a plain store publishes it.
+// -----------------------------------------------------------------------------
+uint64_t Transaction::getEncodedSize() const
+{
+    uint64_t size = _encodedSize.load(std::memory_order_relaxed);
+    if (size != 0) {
+        return size;
     }
 
-    return oss.str();
+    size = 8 + ByteWriter::varIntSize(_inputs.size());
+    for (const auto& input : _inputs) {
+        size += ByteWriter::stringSize(input.prevTxID) + 4 +
+                ByteWriter::stringSize(input.signature) +
+                ByteWriter::stringSize(input.publicKey);
+    }
+    size += ByteWriter::varIntSize(_outputs.size());
+    for (const auto& out : _outputs) {
+        size += 8 + ByteWriter::stringSize(out.publicKeyHash);
+    }
+    size += ByteWriter::stringSize(_txsignature);
+
+    _encodedSize.store(size, std::memory_order_relaxed);
+    return size;
+}
+
+size_t Transaction::memoryUsage() const
+{
+    size_t bytes = dynamicUsage(_inputs) + dynamicUsage(_outputs) + dynamicUsage(_txsignature);
+    for (const auto& input : _inputs) {
+        bytes += dynamicUsage(input.prevTxID) + dynamicUsage(input.signature) +
+                 dynamicUsage(input.publicKey);
+    }
+    for (const auto& output : _outputs) {
+        bytes += dynamicUsage(output.publicKeyHash);
+    }
+    // The txid is only read once written
+    if (_txidState.load(std::memory_order_acquire) == TxidReady) {
+        bytes += dynamicUsage(_txid);
+    }
+    return bytes;
+}
+
+// -----------------------------------------------------------------------------
+//  encode()
+//  Binary form: timestamp, inputs, outputs and transaction signature. The
+//  txid is not stored; it is derived from the other fields.
+// -----------------------------------------------------------------------------
+void Transaction::encode(std::string& output) const
+{
+    ByteWriter writer(output);
+    writer.writeU64(_timestamp);
+
+    writer.writeVarInt(_inputs.size());
+    for (const auto& input : _inputs) {
+        writer.writeString(input.prevTxID);
+        writer.writeU32(input.outputIndex);
+        writer.writeString(input.signature);
+        writer.writeString(input.publicKey);
+    }
+
+    writer.writeVarInt(_outputs.size());
+    for (const auto& out : _outputs) {
+        writer.writeU64(out.amount);
+        writer.writeString(out.publicKeyHash);
+    }
+
+    writer.writeString(_txsignature);
+}
+
+bool Transaction::decode(ByteReader& reader, Transaction& tx)
+{
+    const size_t start = reader.remaining();
+    uint64_t ts, inputCount, outputCount;
+    if (!reader.readU64(ts) || !reader.readVarInt(inputCount)) {
+        return false;
+    }
+
+    // Every input takes at least 7 bytes, every output at least 9
+    std::vector<TxIn> ins;
+    if (inputCount > reader.remaining() / 7) {
+        return false;
+    }
+    ins.reserve(static_cast<size_t>(inputCount));
+    for (uint64_t i = 0; i < inputCount; ++i) {
+        std::string prevTxID, signature, publicKey;
+        uint32_t outputIndex;
+        if (!reader.readString(prevTxID) || !reader.readU32(outputIndex) ||
+            !reader.readString(signature) || !reader.readString(publicKey)) {
+            return false;
+        }
+        ins.emplace_back(prevTxID, outputIndex, signature, publicKey);
+    }
+
+    if (!reader.readVarInt(outputCount) || outputCount > reader.remaining() / 9) {
+        return false;
+    }
+    std::vector<TxOut> outs;
+    outs.reserve(static_cast<size_t>(outputCount));
+    for (uint64_t i = 0; i < outputCount; ++i) {
+        uint64_t amount;
+        std::string publicKeyHash;
+        if (!reader.readU64(amount) || !reader.readString(publicKeyHash)) {
+            return false;
+        }
+        outs.emplace_back(amount, publicKeyHash);
+    }
+
+    std::string signature;
+    if (!reader.readString(signature)) {
+        return false;
+    }
+
+    // The txid is left to the first getTxid()
+    tx = Transaction(std::move(ins), std::move(outs), ts);
+    tx._txsignature = std::move(signature);
+    tx._encodedSize.store(start - reader.remaining(), std::memory_order_relaxed);
+    return true;
 }
 
 void Transaction::sign(EVP_PKEY *pkey)
 {
+    TRACE_SCOPE("Transaction::sign");
     const EVP_MD *md = EVP_sha256();
     EVP_MD_CTX *md_ctx = EVP_MD_CTX_new();
     if (!md || !md_ctx)
@@ -99,6 +345,7 @@ void Transaction::sign(EVP_PKEY *pkey)
         ERR_print_errors_fp(stderr);
         abort();
     }
+    const TXID& txid = getTxid();
     EVP_DigestSignUpdate(md_ctx, txid.c_str(), txid.length());
     size_t sig_len;
     EVP_DigestSignFinal(md_ctx, NULL, &sig_len);
@@ -108,5 +355,114 @@ void Transaction::sign(EVP_PKEY *pkey)
         ERR_print_errors_fp(stderr);
         abort();
     }
-    txsignature = std::string(reinterpret_cast<char*>(signature.data()), sig_len);
+    invalidateSize();
+    _txsignature = std::string(reinterpret_cast<char*>(signature.data()), sig_len);
+}
+
+// -----------------------------------------------------------------------------
+//  getSignatureHash()
+//  Same fields as serialize() without the input signatures.
+// -----------------------------------------------------------------------------
+std::string Transaction::getSignatureHash() const
+{
+    std::string data;
+    appendNumber(data, _timestamp);
+    for (const auto& input : _inputs) {
+        data += input.prevTxID;
+        appendNumber(data, input.outputIndex);
+        data += input.publicKey;
+    }
+    for (const auto& out : _outputs) {
+        appendNumber(data, out.amount);
+        data += out.publicKeyHash;
+    }
+    return hashHex(data);
+}
+
+std::string Transaction::hashPublicKey(const std::string& publicKey)
+{
+    return hashHex(publicKey);
+}
+
+bool Transaction::signInput(size_t index, EVP_PKEY* pkey)
+{
+    return signInput(index, pkey, getSignatureHash());
+}
+
+bool Transaction::signInput(size_t index, EVP_PKEY* pkey, const std::string& signatureHash)
+{
+    TRACE_SCOPE("Transaction::signInput");
+    if (index >= _inputs.size()) {
+        return false;
+    }
+    EVP_MD_CTX* md_ctx = EVP_MD_CTX_new();
+    if (!md_ctx) {
+        return false;
+    }
+    size_t sig_len = 0;
+    std::vector<unsigned char> signature;
+    bool ok = EVP_DigestSignInit(md_ctx, NULL, EVP_sha256(), NULL, pkey) == 1 &&
+                   EVP_DigestSignUpdate(md_ctx, signatureHash.data(), signatureHash.size()) == 1 &&
+                   EVP_DigestSignFinal(md_ctx, NULL, &sig_len) == 1;
+    if (ok) {
+        signature.resize(sig_len);
+        ok = EVP_DigestSignFinal(md_ctx, signature.data(), &sig_len) == 1;
+    }
+    EVP_MD_CTX_free(md_ctx);
+    if (!ok) {
+        ERR_print_errors_fp(stderr);
+        return false;
+    }
+    invalidateTxid();
+    _inputs[index].signature.assign(reinterpret_cast<const char*>(signature.data()), sig_len);
+    return true;
+}
+
+bool Transaction::verifyInput(size_t index, const TxOut& spent) const
+{
+    return verifyInput(index, spent, getSignatureHash());
+}
+
+bool Transaction::verifyInput(size_t index, const TxOut& spent, const std::string& signatureHash) const
+{
+    return index < _inputs.size() &&
+           hashPublicKey(_inputs[index].publicKey) == spent.publicKeyHash &&
+           verifyInputSignature(index, signatureHash);
+}
+
+// -----------------------------------------------------------------------------
+//  verifyInputSignature()
+//  The public key is decoded from its DER form on every call; the expensive
+//  part is the signature check itself, which SignatureCache lets callers skip.
+// -----------------------------------------------------------------------------
+bool Transaction::verifyInputSignature(size_t index, const std::string& signatureHash) const
+{
+    TRACE_SCOPE("Transaction::verifyInputSignature");
+    if (index >= _inputs.size()) {
+        return false;
+    }
+    const TxIn& input = _inputs[index];
+    if (input.signature.empty()) {
+        return false;
+    }
+
+    const unsigned char* der = reinterpret_cast<const unsigned char*>(input.publicKey.data());
+    EVP_PKEY* pkey = d2i_PUBKEY(NULL, &der, static_cast<long>(input.publicKey.size()));
+    if (!pkey) {
+        ERR_clear_error();
+        return false;
+    }
+    EVP_MD_CTX* md_ctx = EVP_MD_CTX_new();
+    bool valid = md_ctx &&
+                 EVP_DigestVerifyInit(md_ctx, NULL, EVP_sha256(), NULL, pkey) == 1 &&
+                 EVP_DigestVerifyUpdate(md_ctx, signatureHash.data(), signatureHash.size()) == 1 &&
+                 EVP_DigestVerifyFinal(md_ctx,
+                                       reinterpret_cast<const unsigned char*>(input.signature.data()),
+                                       input.signature.size()) == 1;
+    EVP_MD_CTX_free(md_ctx);
+    EVP_PKEY_free(pkey);
+    if (!valid) {
+        ERR_clear_error();
+    }
+    return valid;
 }
@@ -3,11 +3,14 @@
 
 #include "CoreObject.h"
 #include <vector>
+#include <atomic>
 #include <cstdint>
 #include <openssl/pem.h>
 #include <openssl/sha.h>
 #include <openssl/err.h>
 
+class ByteReader;
+
 /**
  * @file Transaction.h
  * @brief Definition of the Transaction class representing a blockchain transaction.
@@ -31,7 +34,12 @@ struct TxIn {
         : prevTxID(prevTxID),
         outputIndex(outputIndex),
         signature(signature),
-        publicKey(publicKey) {}
+        publicKey(pubKey) {}
+
+    // A coinbase input references no previous output (all-zero prevTxID).
+    bool isCoinbase() const {
+        return !prevTxID.empty() && prevTxID.find_first_not_of('0') == std::string::npos;
+    }
 };
 
 // Output of a transaction. Makes the output spendable only by the owner of the corresponding private key.
@@ -49,40 +57,136 @@ TxOut(uint64_t amount, const std::string& publicKeyHash)
 class Transaction : public CoreObject {
 public:
 
-    std::string txid;
-    std::string txsignature;
-    std::vector<TxIn> inputs;
-    std::vector<TxOut> outputs;
-    uint64_t timestamp;
-
     Transaction();
 
-    Transaction(std::string id,
-                    std::vector<TxIn> in,
-                    std::vector<TxOut> out,
-                    uint64_t ts) :
-            txid(std::move(id)),
-            inputs(std::move(in)),
-            outputs(std::move(out)),
-            timestamp(ts) {}
+    Transaction(std::vector<TxIn> in,
+                std::vector<TxOut> out,
+                uint64_t ts) :
+            _inputs(std::move(in)),
+            _outputs(std::move(out)),
+            _timestamp(ts),
+            _txidState(TxidEmpty),
+            _encodedSize(0) {}
 
     Transaction(const std::vector<TxIn>& ins,
                     const std::vector<TxOut>& outs);
 
+    Transaction(const Transaction& other);
+    Transaction(Transaction&& other) noexcept;
+    Transaction& operator=(const Transaction& other);
+    Transaction& operator=(Transaction&& other) noexcept;
+
+    /**
+     * Identifier of the transaction: the hash of its serialization.
+     * Computed on first access and cached until the transaction is modified.
+     * Concurrent calls on a transaction that is not being modified are safe.
+     */
+    const TXID& getTxid() const;
+
+    /**
+     * Same as getTxid(), serializing into buffer, so that callers hashing
+     * many transactions reuse a single allocation.
+     */
+    const TXID& getTxid(std::string& buffer) const;
+
     /**
-     * Computes the hash of the Transaction.
+     * Computes the hash of the Transaction now rather than on first access.
      */
     void computeHash();
 
+    // Accessors
+    const std::vector<TxIn>& getInputs() const { return _inputs; }
+    const std::vector<TxOut>& getOutputs() const { return _outputs; }
+    uint64_t getTimestamp() const { return _timestamp; }
+    const std::string& getSignature() const { return _txsignature; }
+
+    // Mutators; every write goes through them, so that the cached txid and
+    // size are invalidated and no reference can change the fields later
+    void setInput(size_t index, const TxIn& input) { invalidateTxid(); _inputs.at(index) = input; }
+    void setOutput(size_t index, const TxOut& output) { invalidateTxid(); _outputs.at(index) = output; }
+    void addInput(const TxIn& input) { invalidateTxid(); _inputs.push_back(input); }
+    void addOutput(const TxOut& output) { invalidateTxid(); _outputs.push_back(output); }
+    void setTimestamp(uint64_t ts) { invalidateTxid(); _timestamp = ts; }
+
+    // The transaction signature is not part of the txid
+    void setSignature(const std::string& signature) { invalidateSize(); _txsignature = signature; }
+
+    /**
+     * Number of bytes written by encode(), computed from the field lengths
+     * on first access and cached until the transaction is modified.
+     */
+    uint64_t getEncodedSize() const;
+
+    /**
+     * Heap bytes held by the inputs, outputs, signature and cached txid,
+     * counted from their capacities (see MemoryUsage.h).
+     */
+    size_t memoryUsage() const;
+
     // Sign the transaction
     void sign(EVP_PKEY *pkey);
 
+    // Hash signed by every input: the hash of the serialization with the input
+    // signatures left out, so that signing an input doesn't change it
+    std::string getSignatureHash() const;
+
+    // Signs input index with pkey, whose DER public key the input must hold;
+    // callers signing several inputs can compute the signature hash once
+    bool signInput(size_t index, EVP_PKEY* pkey);
+    bool signInput(size_t index, EVP_PKEY* pkey, const std::string& signatureHash);
+
+    // Verifies input index against the output it spends: the input's public key
+    // must hash to the output's publicKeyHash and its signature must cover the
+    // signature hash, which callers checking several inputs can compute once
+    bool verifyInput(size_t index, const TxOut& spent) const;
+    bool verifyInput(size_t index, const TxOut& spent, const std::string& signatureHash) const;
+
+    // Verifies only the signature of input index with the public key it holds,
+    // which doesn't need the spent output
+    bool verifyInputSignature(size_t index, const std::string& signatureHash) const;
+
+    // Hex SHA-256 of a DER public key, the publicKeyHash of the outputs it owns
+    static std::string hashPublicKey(const std::string& publicKey);
+
     // Validate transaction structure
     bool validate() const;
 
+    // A coinbase transaction creates new coins from a single coinbase input
+    bool isCoinbase() const { return _inputs.size() == 1 && _inputs[0].isCoinbase(); }
+
     // Serialize the transaction into a deterministic string
     std::string serialize() const override;
 
+    // Replace the content of output with serialize()
+    void serialize(std::string& output) const;
+
+    // Append the binary encoding of the transaction to output
+    void encode(std::string& output) const;
+
+    // Read a transaction written by encode(); returns false on malformed input
+    static bool decode(ByteReader& reader, Transaction& tx);
+
+private:
+    // States of the cached txid
+    enum : uint8_t { TxidEmpty, TxidComputing, TxidReady };
+
+    void invalidateTxid() {
+        _txidState.store(TxidEmpty, std::memory_order_relaxed);
+        invalidateSize();
+    }
+    void invalidateSize() { _encodedSize.store(0, std::memory_order_relaxed); }
+
+    std::vector<TxIn> _inputs;
+    std::vector<TxOut> _outputs;
+    uint64_t _timestamp;
+    std::string _txsignature;
+
+    // Written once by the thread that wins the Empty -> Computing transition
+    mutable TXID _txid;
+    mutable std::atomic<uint8_t> _txidState;
+    // 0 until computed; an encoding is never empty
+    mutable std::atomic<uint64_t> _encodedSize;
+
 };
 
 #endif // TRANSACTION_H
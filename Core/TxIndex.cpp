@@ -0,0 +1,574 @@
+#include "TxIndex.h"
+#include "Hex.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// File header: format, number of slots used, state, then the chain the
+// table was written for
+const char Magic[8] = {'T', 'X', 'I', 'N', 'D', 'E', 'X', '1'};
+const size_t CountOffset = 8;
+const size_t StateOffset = 16;
+const size_t BuiltToOffset = 24;
+const size_t TipHeightOffset = 32;
+const size_t TipHashOffset = 64;
+const size_t TipHashSize = 64;
+const size_t FileHeaderSize = 128;
+
+// The state is Dirty while the index is open: a file left so by a crash
+// may not match the chain, and is rebuilt
+const uint64_t Dirty = 0;
+const uint64_t Clean = 1;
+
+// Slot layout; a key of 0 marks an empty slot
+const size_t SlotSize = 16;
+const size_t HeightOffset = 8;
+const size_t PositionOffset = 12;
+
+// Smallest table, in slots; always a power of two
+const uint64_t MinCapacity = 1024;
+
+uint32_t loadU32(const unsigned char* p)
+{
+    return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+           static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+}
+
+void storeU32(unsigned char* p, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i) {
+        p[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+uint64_t loadU64(const unsigned char* p)
+{
+    return static_cast<uint64_t>(loadU32(p)) | static_cast<uint64_t>(loadU32(p + 4)) << 32;
+}
+
+void storeU64(unsigned char* p, uint64_t value)
+{
+    storeU32(p, static_cast<uint32_t>(value));
+    storeU32(p + 4, static_cast<uint32_t>(value >> 32));
+}
+
+bool isPowerOfTwo(uint64_t value)
+{
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+}
+
+TxIndex::TxIndex(const std::string& path)
+    : _path(path),
+      _chain(nullptr),
+      _stopBuilding(false),
+      _building(false),
+      _builtTo(0),
+      _buildEnd(0),
+      _count(0),
+      _capacity(0),
+      _base(nullptr),
+      _mappedBytes(0),
+#ifdef _WIN32
+      _fileHandle(INVALID_HANDLE_VALUE),
+      _mapping(nullptr)
+#else
+      _fd(-1)
+#endif
+{
+}
+
+TxIndex::~TxIndex()
+{
+    close();
+}
+
+// -----------------------------------------------------------------------------
+//  open()
+//  The table of a file closed cleanly, on a tip still in the active chain,
+//  holds every block up to that tip that its build reached; the build goes
+//  on from there, and indexing a block again adds nothing. Any other file is
+//  rebuilt from the genesis block.
+// -----------------------------------------------------------------------------
+bool TxIndex::open(Blockchain& chain)
+{
+    if (_chain) {
+        return false;
+    }
+
+    uint64_t fileSize = 0;
+    if (!_path.empty()) {
+#ifdef _WIN32
+        _fileHandle = CreateFileA(_path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+                                  OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        LARGE_INTEGER size;
+        if (_fileHandle == INVALID_HANDLE_VALUE || !GetFileSizeEx(_fileHandle, &size)) {
+            std::cerr << "Error: can't open txid index " << _path << "\n";
+            unmap();
+            return false;
+        }
+        fileSize = static_cast<uint64_t>(size.QuadPart);
+#else
+        _fd = ::open(_path.c_str(), O_RDWR | O_CREAT, 0644);
+        struct stat status;
+        if (_fd < 0 || fstat(_fd, &status) != 0) {
+            std::cerr << "Error: can't open txid index " << _path << "\n";
+            unmap();
+            return false;
+        }
+        fileSize = static_cast<uint64_t>(status.st_size);
+#endif
+    }
+
+    const uint64_t capacity = fileSize == 0 ? MinCapacity : (fileSize - FileHeaderSize) / SlotSize;
+    if (fileSize != 0 && (fileSize < FileHeaderSize || (fileSize - FileHeaderSize) % SlotSize != 0 ||
+                          !isPowerOfTwo(capacity))) {
+        std::cerr << "Error: " << _path << " is not a txid index\n";
+        unmap();
+        return false;
+    }
+    if (!map(capacity)) {
+        std::cerr << "Error: can't map txid index " << _path << "\n";
+        unmap();
+        return false;
+    }
+    if (fileSize != 0 && (std::memcmp(_base, Magic, sizeof(Magic)) != 0 ||
+                          loadU64(_base + CountOffset) > capacity)) {
+        std::cerr << "Error: " << _path << " is not a txid index\n";
+        unmap();
+        return false;
+    }
+
+    bool reuse = fileSize != 0 && loadU64(_base + StateOffset) == Clean;
+    if (reuse) {
+        const uint64_t tipHeight = loadU64(_base + TipHeightOffset);
+        const std::string tipHash(reinterpret_cast<const char*>(_base + TipHashOffset), TipHashSize);
+        reuse = tipHeight <= chain.getHeight() && chain.getBlock(tipHeight).getHash() == tipHash &&
+                loadU64(_base + BuiltToOffset) <= tipHeight + 1;
+    }
+    if (reuse) {
+        _count = loadU64(_base + CountOffset);
+        _builtTo = loadU64(_base + BuiltToOffset);
+    } else {
+        reset(_capacity);
+        _builtTo = 0;
+    }
+    storeU64(_base + StateOffset, Dirty);
+    if (!sync()) {
+        std::cerr << "Error: can't write txid index " << _path << "\n";
+        unmap();
+        return false;
+    }
+
+    _chain = &chain;
+    _buildEnd = chain.getHeight() + 1;
+    _stopBuilding = false;
+    chain.addListener(this);
+    if (_builtTo < _buildEnd) {
+        // Blocks are never freed, so the builder can keep their addresses
+        std::vector<const Block*> blocks;
+        blocks.reserve(_buildEnd - _builtTo);
+        for (uint64_t height = _builtTo; height < _buildEnd; ++height) {
+            blocks.push_back(&chain.getBlock(height));
+        }
+        _building = true;
+        _builder = std::thread(&TxIndex::build, this, std::move(blocks), _builtTo);
+    }
+    return true;
+}
+
+void TxIndex::close()
+{
+    if (!_chain) {
+        return;
+    }
+    stopBuild();
+    _chain->removeListener(this);
+
+    const uint64_t tipHeight = _chain->getHeight();
+    const std::string& tipHash = _chain->getLatestBlock().getHash();
+    storeU64(_base + CountOffset, _count);
+    storeU64(_base + BuiltToOffset, _builtTo >= _buildEnd ? tipHeight + 1 : _builtTo);
+    storeU64(_base + TipHeightOffset, tipHeight);
+    std::memset(_base + TipHashOffset, 0, TipHashSize);
+    std::memcpy(_base + TipHashOffset, tipHash.data(), std::min(tipHash.size(), TipHashSize));
+    storeU64(_base + StateOffset, Clean);
+    if (!sync()) {
+        std::cerr << "Error: can't write txid index " << _path << "\n";
+    }
+    unmap();
+    _chain = nullptr;
+    _count = 0;
+    _builtTo = 0;
+    _buildEnd = 0;
+}
+
+// -----------------------------------------------------------------------------
+//  build()
+//  Txids are hashed outside the lock; a block is only indexed if it is still
+//  below _buildEnd, which a disconnection lowers. A snapshot keeps the body
+//  from being freed while it is read; a pruned block has nothing to index.
+// -----------------------------------------------------------------------------
+void TxIndex::build(std::vector<const Block*> blocks, uint64_t first)
+{
+    for (size_t i = 0; i < blocks.size() && !_stopBuilding.load(std::memory_order_relaxed); ++i) {
+        const uint64_t height = first + i;
+        std::vector<uint64_t> keys;
+        {
+            const ChainSnapshot snapshot = _chain->snapshot();
+            if (snapshot.getBlock(height) == blocks[i]) {
+                keys = keysOf(*blocks[i]);
+            }
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (height >= _buildEnd) {
+            break;
+        }
+        insertBlock(keys, height);
+        _builtTo = height + 1;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    _building = false;
+    _buildDone.notify_all();
+}
+
+void TxIndex::stopBuild()
+{
+    _stopBuilding = true;
+    if (_builder.joinable()) {
+        _builder.join();
+    }
+}
+
+void TxIndex::waitForBuild()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _buildDone.wait(lock, [this] { return !_building; });
+}
+
+bool TxIndex::isBuilt() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _chain && _builtTo >= _buildEnd;
+}
+
+// -----------------------------------------------------------------------------
+//  find()
+//  Every slot with the truncated key is a candidate; the chain tells which
+//  ones hold this txid.
+// -----------------------------------------------------------------------------
+bool TxIndex::find(const TXID& txid, TxLocation& location) const
+{
+    const uint64_t key = keyOf(txid);
+    std::vector<TxLocation> candidates;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_chain) {
+            return false;
+        }
+        const uint64_t mask = _capacity - 1;
+        for (uint64_t i = key & mask;; i = (i + 1) & mask) {
+            const unsigned char* s = slot(i);
+            const uint64_t slotKey = loadU64(s);
+            if (slotKey == 0) {
+                break;
+            }
+            if (slotKey == key) {
+                candidates.emplace_back();
+                candidates.back().height = loadU32(s + HeightOffset);
+                candidates.back().position = loadU32(s + PositionOffset);
+            }
+        }
+    }
+
+    bool found = false;
+    for (const TxLocation& candidate : candidates) {
+        if (candidate.height > _chain->getHeight() || (found && candidate.height < location.height)) {
+            continue;
+        }
+        const std::vector<Transaction>& transactions = _chain->getBlock(candidate.height).getTransactions();
+        if (candidate.position < transactions.size() &&
+            transactions[candidate.position].getTxid() == txid) {
+            location = candidate;
+            found = true;
+        }
+    }
+    return found;
+}
+
+const Transaction* TxIndex::findTransaction(const TXID& txid) const
+{
+    TxLocation location;
+    if (!find(txid, location)) {
+        return nullptr;
+    }
+    return &_chain->getBlock(location.height).getTransactions()[location.position];
+}
+
+uint64_t TxIndex::size() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _count;
+}
+
+size_t TxIndex::mappedBytes() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _mappedBytes;
+}
+
+void TxIndex::blockConnected(const Block& block, const BlockUndo&, uint64_t height)
+{
+    const std::vector<uint64_t> keys = keysOf(block);
+    std::lock_guard<std::mutex> lock(_mutex);
+    insertBlock(keys, height);
+}
+
+void TxIndex::blockDisconnected(const Block& block, const BlockUndo&, uint64_t height)
+{
+    const std::vector<uint64_t> keys = keysOf(block);
+    std::lock_guard<std::mutex> lock(_mutex);
+    // The builder must not index the block, nor count it as indexed
+    _buildEnd = std::min(_buildEnd, height);
+    _builtTo = std::min(_builtTo, height);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        remove(keys[i], static_cast<uint32_t>(height), static_cast<uint32_t>(i));
+    }
+}
+
+void TxIndex::insertBlock(const std::vector<uint64_t>& keys, uint64_t height)
+{
+    for (size_t i = 0; i < keys.size(); ++i) {
+        insert(keys[i], static_cast<uint32_t>(height), static_cast<uint32_t>(i));
+    }
+}
+
+// -----------------------------------------------------------------------------
+//  insert()
+//  Linear probing. A slot equal to the new one means the block was already
+//  indexed, by a build resumed on a file that had it.
+// -----------------------------------------------------------------------------
+void TxIndex::insert(uint64_t key, uint32_t height, uint32_t position)
+{
+    if ((_count + 1) * 10 > _capacity * 7 && !grow()) {
+        std::cerr << "Error: can't grow txid index " << _path << "\n";
+        return;
+    }
+    const uint64_t mask = _capacity - 1;
+    for (uint64_t i = key & mask;; i = (i + 1) & mask) {
+        unsigned char* s = slot(i);
+        const uint64_t slotKey = loadU64(s);
+        if (slotKey == 0) {
+            storeU64(s, key);
+            storeU32(s + HeightOffset, height);
+            storeU32(s + PositionOffset, position);
+            ++_count;
+            return;
+        }
+        if (slotKey == key && loadU32(s + HeightOffset) == height &&
+            loadU32(s + PositionOffset) == position) {
+            return;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+//  remove()
+//  Backward-shift deletion: the slots after the hole that may move back
+//  toward their home slot do, so probes never stop at a stale hole.
+// -----------------------------------------------------------------------------
+void TxIndex::remove(uint64_t key, uint32_t height, uint32_t position)
+{
+    const uint64_t mask = _capacity - 1;
+    uint64_t hole = key & mask;
+    for (;; hole = (hole + 1) & mask) {
+        const unsigned char* s = slot(hole);
+        const uint64_t slotKey = loadU64(s);
+        if (slotKey == 0) {
+            return;
+        }
+        if (slotKey == key && loadU32(s + HeightOffset) == height &&
+            loadU32(s + PositionOffset) == position) {
+            break;
+        }
+    }
+    for (uint64_t next = (hole + 1) & mask;; next = (next + 1) & mask) {
+        const unsigned char* s = slot(next);
+        const uint64_t slotKey = loadU64(s);
+        if (slotKey == 0) {
+            break;
+        }
+        // The slot stays if its home is cyclically in (hole, next]
+        const uint64_t home = slotKey & mask;
+        const bool stays = hole <= next ? (home > hole && home <= next) : (home > hole || home <= next);
+        if (!stays) {
+            std::memcpy(slot(hole), s, SlotSize);
+            hole = next;
+        }
+    }
+    std::memset(slot(hole), 0, SlotSize);
+    --_count;
+}
+
+bool TxIndex::reset(uint64_t capacity)
+{
+    if (capacity != _capacity && !map(capacity)) {
+        return false;
+    }
+    std::memset(_base, 0, _mappedBytes);
+    std::memcpy(_base, Magic, sizeof(Magic));
+    _count = 0;
+    return true;
+}
+
+bool TxIndex::grow()
+{
+    const std::vector<unsigned char> slots(slot(0), slot(_capacity));
+    if (!map(_capacity * 2)) {
+        return false;
+    }
+    std::memset(slot(0), 0, _capacity * SlotSize);
+    _count = 0;
+    for (size_t offset = 0; offset < slots.size(); offset += SlotSize) {
+        const unsigned char* s = &slots[offset];
+        const uint64_t key = loadU64(s);
+        if (key != 0) {
+            insert(key, loadU32(s + HeightOffset), loadU32(s + PositionOffset));
+        }
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+//  map()
+//  A file mapping grows with the file; an anonymous one is copied to a
+//  bigger one.
+// -----------------------------------------------------------------------------
+bool TxIndex::map(uint64_t capacity)
+{
+    const size_t bytes = static_cast<size_t>(FileHeaderSize + capacity * SlotSize);
+#ifdef _WIN32
+    HANDLE file = _path.empty() ? INVALID_HANDLE_VALUE : static_cast<HANDLE>(_fileHandle);
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE,
+                                        static_cast<DWORD>(static_cast<uint64_t>(bytes) >> 32),
+                                        static_cast<DWORD>(bytes), nullptr);
+    if (!mapping) {
+        return false;
+    }
+    unsigned char* base = static_cast<unsigned char*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes));
+    if (!base) {
+        CloseHandle(mapping);
+        return false;
+    }
+    if (_base) {
+        if (_path.empty()) {
+            std::memcpy(base, _base, _mappedBytes);
+        }
+        UnmapViewOfFile(_base);
+        CloseHandle(static_cast<HANDLE>(_mapping));
+    }
+    _mapping = mapping;
+#else
+    void* address;
+    if (_path.empty()) {
+        address = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    } else {
+        if (ftruncate(_fd, static_cast<off_t>(bytes)) != 0) {
+            return false;
+        }
+        address = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    }
+    if (address == MAP_FAILED) {
+        return false;
+    }
+    unsigned char* base = static_cast<unsigned char*>(address);
+    if (_base) {
+        if (_path.empty()) {
+            std::memcpy(base, _base, _mappedBytes);
+        }
+        munmap(_base, _mappedBytes);
+    }
+#endif
+    _base = base;
+    _mappedBytes = bytes;
+    _capacity = capacity;
+    return true;
+}
+
+void TxIndex::unmap()
+{
+#ifdef _WIN32
+    if (_base) {
+        UnmapViewOfFile(_base);
+        CloseHandle(static_cast<HANDLE>(_mapping));
+        _mapping = nullptr;
+    }
+    if (_fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(static_cast<HANDLE>(_fileHandle));
+        _fileHandle = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (_base) {
+        munmap(_base, _mappedBytes);
+    }
+    if (_fd >= 0) {
+        ::close(_fd);
+        _fd = -1;
+    }
+#endif
+    _base = nullptr;
+    _mappedBytes = 0;
+    _capacity = 0;
+}
+
+bool TxIndex::sync()
+{
+    if (!_base || _path.empty()) {
+        return true;
+    }
+#ifdef _WIN32
+    return FlushViewOfFile(_base, _mappedBytes) && FlushFileBuffers(static_cast<HANDLE>(_fileHandle));
+#else
+    return msync(_base, _mappedBytes, MS_SYNC) == 0;
+#endif
+}
+
+unsigned char* TxIndex::slot(uint64_t i) const
+{
+    return _base + FileHeaderSize + i * SlotSize;
+}
+
+// The first 8 bytes of the txid; 0 is kept for empty slots
+uint64_t TxIndex::keyOf(const TXID& txid)
+{
+    unsigned char bytes[8];
+    uint64_t key;
+    if (txid.size() == 64 && hexDecode(txid.data(), sizeof(bytes), bytes)) {
+        key = loadU64(bytes);
+    } else {
+        key = std::hash<std::string>()(txid);
+    }
+    return key == 0 ? 1 : key;
+}
+
+std::vector<uint64_t> TxIndex::keysOf(const Block& block)
+{
+    std::vector<uint64_t> keys;
+    keys.reserve(block.getTransactions().size());
+    for (const auto& tx : block.getTransactions()) {
+        keys.push_back(keyOf(tx.getTxid()));
+    }
+    return keys;
+}
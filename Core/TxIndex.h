@@ -0,0 +1,162 @@
+#ifndef TXINDEX_H
+#define TXINDEX_H
+
+#include "Blockchain.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @file TxIndex.h
+ * @brief Definition of the TxIndex class, the location of each confirmed transaction.
+ * @details Maps the txid of every transaction of the active chain to the height
+ *          of its block and its position in the block, so a lookup costs a
+ *          hash probe instead of a walk over every block. The index is an
+ *          open-addressing table of 16-byte slots:
+ *
+ *            key              8 bytes, the first 8 bytes of the binary txid
+ *            height           4 bytes
+ *            position         4 bytes
+ *
+ *          Keys are truncated, so two txids may share one: every slot with
+ *          the key is a candidate, and a candidate is only returned once the
+ *          transaction it points to has the full txid. The table lives in a
+ *          memory-mapped file and is reused on restart when the tip it was
+ *          written for is still on the active chain.
+ *          An optional ChainListener, it follows connected and disconnected
+ *          blocks; the blocks already in the chain when it opens are indexed
+ *          by a background thread, and lookups work meanwhile, finding the
+ *          transactions indexed so far. The build reads each block through
+ *          a chain snapshot, so pruning can run meanwhile.
+ */
+
+// Where a transaction is in the active chain
+struct TxLocation {
+    uint64_t height;
+    uint32_t position;
+
+    TxLocation() : height(0), position(0) {}
+};
+
+class TxIndex : public ChainListener {
+public:
+
+    /**
+     * Creates an index in the file at path, or in anonymous memory if path
+     * is empty.
+     */
+    explicit TxIndex(const std::string& path = std::string());
+
+    ~TxIndex() override;
+
+    TxIndex(const TxIndex&) = delete;
+    TxIndex& operator=(const TxIndex&) = delete;
+
+    /**
+     * Maps the file, creating it if needed, starts following chain and
+     * indexes the blocks missing from the file in the background. chain
+     * must outlive the index or call close() first.
+     * Returns false if the file can't be read or written or is not a txid
+     * index.
+     */
+    bool open(Blockchain& chain);
+
+    /**
+     * Stops the background build and following the chain, writes the table
+     * back to the file and unmaps it. A build stopped early resumes on the
+     * next open().
+     */
+    void close();
+
+    /**
+     * Blocks until the background build is over.
+     */
+    void waitForBuild();
+
+    /**
+     * Returns true once every block of the chain is indexed.
+     */
+    bool isBuilt() const;
+
+    /**
+     * Finds the transaction with this txid on the active chain. When the
+     * txid appears more than once, the highest location is returned.
+     * Transactions of pruned blocks are not found.
+     */
+    bool find(const TXID& txid, TxLocation& location) const;
+
+    /**
+     * Same as find(), returning the transaction itself, or nullptr.
+     */
+    const Transaction* findTransaction(const TXID& txid) const;
+
+    /**
+     * Number of transactions indexed.
+     */
+    uint64_t size() const;
+
+    /**
+     * Bytes of the mapped table.
+     */
+    size_t mappedBytes() const;
+
+    // ChainListener
+    void blockConnected(const Block& block, const BlockUndo& undo, uint64_t height) override;
+    void blockDisconnected(const Block& block, const BlockUndo& undo, uint64_t height) override;
+
+private:
+    // Maps capacity slots; the previous mapping is released
+    bool map(uint64_t capacity);
+    void unmap();
+    bool sync();
+
+    unsigned char* slot(uint64_t i) const;
+    // Empties a table of capacity slots
+    bool reset(uint64_t capacity);
+    // Doubles the capacity and reinserts every slot
+    bool grow();
+
+    void insert(uint64_t key, uint32_t height, uint32_t position);
+    void remove(uint64_t key, uint32_t height, uint32_t position);
+    // Indexes the transactions of block at height, under the lock
+    void insertBlock(const std::vector<uint64_t>& keys, uint64_t height);
+
+    // Indexes the snapshot from _builtTo to _buildEnd
+    void build(std::vector<const Block*> blocks, uint64_t first);
+    void stopBuild();
+
+    static uint64_t keyOf(const TXID& txid);
+    static std::vector<uint64_t> keysOf(const Block& block);
+
+    std::string _path;
+    Blockchain* _chain;
+
+    // Guards the table and the build range
+    mutable std::mutex _mutex;
+    std::condition_variable _buildDone;
+    std::thread _builder;
+    std::atomic<bool> _stopBuilding;
+    bool _building;
+    // Heights below _builtTo are indexed; the builder stops at _buildEnd,
+    // above which the index follows the chain
+    uint64_t _builtTo;
+    uint64_t _buildEnd;
+
+    uint64_t _count;
+    uint64_t _capacity;
+    // Start of the mapping: the file header, then the slots
+    unsigned char* _base;
+    size_t _mappedBytes;
+#ifdef _WIN32
+    void* _fileHandle;
+    void* _mapping;
+#else
+    int _fd;
+#endif
+};
+
+#endif // TXINDEX_H
@@ -0,0 +1,195 @@
+#include "UTXOSet.h"
+#include "BlockValidator.h"
+#include "Trace.h"
+
+// -----------------------------------------------------------------------------
+//  connectBlock()
+//  Once the validator has resolved every input, applying the block only moves
+//  outputs: the lookups and checks are not repeated. With a single worker the
+//  validator would only add work, so the block goes through the sequential
+//  pass.
+// -----------------------------------------------------------------------------
+bool UTXOSet::connectBlock(const Block& block, BlockUndo& undo)
+{
+    return connectBlock(block, undo, ThreadPool::instance());
+}
+
+bool UTXOSet::connectBlock(const Block& block, BlockUndo& undo, ThreadPool& pool)
+{
+    TRACE_SCOPE("UTXOSet::connectBlock");
+    const std::vector<Transaction>& transactions = block.getTransactions();
+    if (transactions.size() < MinParallelTransactions || pool.threadCount() < 2) {
+        return connectBlockSequential(block, undo);
+    }
+
+    BlockValidator validator(*this, pool);
+    switch (validator.check(block)) {
+    case BlockValidator::Result::Invalid:
+        return false;
+    case BlockValidator::Result::Unsupported:
+        return connectBlockSequential(block, undo);
+    case BlockValidator::Result::Valid:
+        break;
+    }
+
+    const std::vector<const TxOut*>& spentOutputs = validator.getSpentOutputs();
+    auto& spent = undo.spentOutputs;
+    size_t g = 0;
+    for (const auto& tx : transactions) {
+        for (const auto& input : tx.getInputs()) {
+            const TxOut* output = spentOutputs[g++];
+            if (!output) {
+                continue;
+            }
+            OutPoint outPoint(input.prevTxID, input.outputIndex);
+            // Copy before the erase frees an output of the set
+            spent.emplace_back(outPoint, *output);
+            removeOutput(outPoint);
+        }
+        for (uint32_t i = 0; i < tx.getOutputs().size(); ++i) {
+            addOutput(OutPoint(tx.getTxid(), i), tx.getOutputs()[i]);
+        }
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+//  connectBlockSequential()
+//  Spends the inputs and creates the outputs of every transaction, in block
+//  order, so a transaction may spend an output created earlier in the block.
+// -----------------------------------------------------------------------------
+bool UTXOSet::connectBlockSequential(const Block& block, BlockUndo& undo)
+{
+    const std::vector<Transaction>& transactions = block.getTransactions();
+    auto& spent = undo.spentOutputs;
+    const size_t undoStart = spent.size();
+
+    for (size_t t = 0; t < transactions.size(); ++t) {
+        const Transaction& tx = transactions[t];
+        const size_t txUndoStart = spent.size();
+        uint64_t valueIn = 0;
+        uint64_t valueOut = 0;
+        bool valid = true;
+
+        for (const auto& input : tx.getInputs()) {
+            if (input.isCoinbase()) {
+                continue;
+            }
+            auto it = _outputs.find(OutPoint(input.prevTxID, input.outputIndex));
+            if (it == _outputs.end()) {
+                // Missing or already spent output
+                valid = false;
+                break;
+            }
+            valueIn += it->second.amount;
+            spent.emplace_back(it->first, it->second);
+            removeOutput(it);
+        }
+
+        for (const auto& output : tx.getOutputs()) {
+            valueOut += output.amount;
+        }
+
+        // A regular transaction cannot create value
+        if (valid && !tx.isCoinbase() && valueOut > valueIn) {
+            valid = false;
+        }
+
+        uint32_t created = 0;
+        for (; valid && created < tx.getOutputs().size(); ++created) {
+            // An unspent output with the same outpoint must not be overwritten
+            if (!addOutput(OutPoint(tx.getTxid(), created), tx.getOutputs()[created])) {
+                valid = false;
+                break;
+            }
+        }
+
+        if (!valid) {
+            // Undo the partial work of this transaction, then the whole prefix
+            for (uint32_t i = 0; i < created; ++i) {
+                removeOutput(OutPoint(tx.getTxid(), i));
+            }
+            for (size_t i = spent.size(); i > txUndoStart; --i) {
+                addOutput(spent[i - 1].first, spent[i - 1].second);
+            }
+            rollback(block, t, undo, txUndoStart);
+            spent.erase(spent.begin() + undoStart, spent.end());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+//  disconnectBlock()
+// -----------------------------------------------------------------------------
+void UTXOSet::disconnectBlock(const Block& block, const BlockUndo& undo)
+{
+    rollback(block, block.getTransactions().size(), undo, undo.spentOutputs.size());
+}
+
+// -----------------------------------------------------------------------------
+//  rollback()
+//  Walks the transactions backwards, removing the outputs each one created and
+//  restoring the outputs it spent, so that outputs created and spent within
+//  the same block end up removed.
+// -----------------------------------------------------------------------------
+void UTXOSet::rollback(const Block& block, size_t txCount,
+                       const BlockUndo& undo, size_t spentEnd)
+{
+    const std::vector<Transaction>& transactions = block.getTransactions();
+    const auto& spent = undo.spentOutputs;
+
+    for (size_t t = txCount; t > 0; --t) {
+        const Transaction& tx = transactions[t - 1];
+        for (uint32_t i = 0; i < tx.getOutputs().size(); ++i) {
+            removeOutput(OutPoint(tx.getTxid(), i));
+        }
+        for (size_t i = tx.getInputs().size(); i > 0; --i) {
+            if (tx.getInputs()[i - 1].isCoinbase()) {
+                continue;
+            }
+            --spentEnd;
+            addOutput(spent[spentEnd].first, spent[spentEnd].second);
+        }
+    }
+}
+
+const TxOut* UTXOSet::find(const OutPoint& outPoint) const
+{
+    auto it = _outputs.find(outPoint);
+    return it == _outputs.end() ? nullptr : &it->second;
+}
+
+bool UTXOSet::addOutput(const OutPoint& outPoint, const TxOut& output)
+{
+    if (!_outputs.emplace(outPoint, output).second) {
+        return false;
+    }
+    _entryBytes += entryUsage(outPoint, output);
+    return true;
+}
+
+void UTXOSet::removeOutput(Outputs::iterator it)
+{
+    _entryBytes -= entryUsage(it->first, it->second);
+    _outputs.erase(it);
+}
+
+void UTXOSet::removeOutput(const OutPoint& outPoint)
+{
+    auto it = _outputs.find(outPoint);
+    if (it != _outputs.end()) {
+        removeOutput(it);
+    }
+}
+
+size_t BlockUndo::memoryUsage() const
+{
+    size_t bytes = dynamicUsage(spentOutputs);
+    for (const auto& spent : spentOutputs) {
+        bytes += dynamicUsage(spent.first.txid) + dynamicUsage(spent.second.publicKeyHash);
+    }
+    return bytes;
+}
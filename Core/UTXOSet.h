@@ -0,0 +1,129 @@
+#ifndef UTXOSET_H
+#define UTXOSET_H
+
+#include "Block.h"
+#include "MemoryUsage.h"
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class ThreadPool;
+
+/**
+ * @file UTXOSet.h
+ * @brief Definition of the unspent transaction output set and its undo data.
+ * @details The UTXO set is the chain state: every output created by a connected
+ *          block and not yet spent by a later one. Connecting a block spends its
+ *          inputs and creates its outputs; the spent outputs are recorded in a
+ *          BlockUndo so the block can later be disconnected without replaying
+ *          the chain from genesis.
+ * https://en.bitcoin.it/wiki/Unspent_transaction_output
+ */
+
+// Reference to a single transaction output: (txid, output index).
+struct OutPoint {
+    TXID txid;
+    uint32_t index;
+
+    OutPoint(const TXID& txid, uint32_t index) : txid(txid), index(index) {}
+
+    bool operator==(const OutPoint& other) const {
+        return index == other.index && txid == other.txid;
+    }
+};
+
+struct OutPointHash {
+    size_t operator()(const OutPoint& outPoint) const {
+        return std::hash<std::string>()(outPoint.txid) ^
+               (static_cast<size_t>(outPoint.index) * 0x9e3779b97f4a7c15ULL);
+    }
+};
+
+// Per-block undo data: the outputs spent by the block, in spending order.
+struct BlockUndo {
+    std::vector<std::pair<OutPoint, TxOut>> spentOutputs;
+
+    // Heap bytes held by the spent outputs
+    size_t memoryUsage() const;
+};
+
+class UTXOSet {
+public:
+
+    UTXOSet() : _entryBytes(0) {}
+
+    /**
+     * Applies a block: spends its inputs and adds its outputs.
+     * Spent outputs are appended to undo. On failure the set is left unchanged.
+     * Blocks of MinParallelTransactions or more are checked in parallel by a
+     * BlockValidator before they are applied, when the shared ThreadPool has
+     * several workers.
+     */
+    bool connectBlock(const Block& block, BlockUndo& undo);
+
+    /**
+     * Same as connectBlock(), validating on the given pool.
+     */
+    bool connectBlock(const Block& block, BlockUndo& undo, ThreadPool& pool);
+
+    /**
+     * Same as connectBlock(), processing the transactions one by one.
+     */
+    bool connectBlockSequential(const Block& block, BlockUndo& undo);
+
+    static const size_t MinParallelTransactions = 64;
+
+    /**
+     * Reverts a block previously applied with connectBlock().
+     */
+    void disconnectBlock(const Block& block, const BlockUndo& undo);
+
+    /**
+     * Returns the unspent output referenced by outPoint, or nullptr.
+     */
+    const TxOut* find(const OutPoint& outPoint) const;
+
+    /**
+     * Number of unspent outputs.
+     */
+    size_t size() const { return _outputs.size(); }
+
+    /**
+     * Heap bytes held by the set: its hash table and the strings of its
+     * entries, which are kept up to date as outputs come and go.
+     */
+    size_t memoryUsage() const { return _entryBytes + dynamicUsage(_outputs); }
+
+    /**
+     * Calls visitor(outPoint, output) on every unspent output, in no order.
+     */
+    template <class F>
+    void forEach(F&& visitor) const {
+        for (const auto& entry : _outputs) {
+            visitor(entry.first, entry.second);
+        }
+    }
+
+private:
+    typedef std::unordered_map<OutPoint, TxOut, OutPointHash> Outputs;
+
+    static size_t entryUsage(const OutPoint& outPoint, const TxOut& output) {
+        return dynamicUsage(outPoint.txid) + dynamicUsage(output.publicKeyHash);
+    }
+
+    // Every change of _outputs goes through these, which keep _entryBytes
+    bool addOutput(const OutPoint& outPoint, const TxOut& output);
+    void removeOutput(Outputs::iterator it);
+    void removeOutput(const OutPoint& outPoint);
+
+    // Reverts the first txCount transactions of the block, whose spent outputs
+    // are the undo entries ending at spentEnd.
+    void rollback(const Block& block, size_t txCount,
+                  const BlockUndo& undo, size_t spentEnd);
+
+    Outputs _outputs;
+    // Heap bytes of the strings of the entries
+    size_t _entryBytes;
+};
+
+#endif // UTXOSET_H
@@ -0,0 +1,431 @@
+#include "Wallet.h"
+#include "MemoryUsage.h"
+#include <openssl/ec.h>
+#include <openssl/x509.h>
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+WalletConfig::WalletConfig()
+    : changeTolerance(0),
+      maxCandidates(1000),
+      maxTries(50000)
+{
+}
+
+Wallet::Wallet(Blockchain& chain, Mempool* mempool, const WalletConfig& config)
+    : _chain(chain),
+      _mempool(mempool),
+      _config(config),
+      _balance(0),
+      _entryMemory(0)
+{
+    _chain.addListener(this);
+    if (_mempool) {
+        _mempool->addListener(this);
+    }
+}
+
+Wallet::~Wallet()
+{
+    if (_mempool) {
+        _mempool->removeListener(this);
+    }
+    _chain.removeListener(this);
+    for (WalletKey& key : _keys) {
+        EVP_PKEY_free(key.pkey);
+    }
+}
+
+std::string Wallet::encodePublicKey(EVP_PKEY* pkey)
+{
+    unsigned char* der = nullptr;
+    const int length = i2d_PUBKEY(pkey, &der);
+    if (length <= 0) {
+        return std::string();
+    }
+    std::string publicKey(reinterpret_cast<const char*>(der), length);
+    OPENSSL_free(der);
+    return publicKey;
+}
+
+const WalletKey* Wallet::generateKey()
+{
+    EVP_PKEY* pkey = EVP_EC_gen("secp256k1");
+    if (!pkey) {
+        ERR_print_errors_fp(stderr);
+        return nullptr;
+    }
+    const WalletKey* key = addKey(pkey);
+    EVP_PKEY_free(pkey);
+    return key;
+}
+
+// -----------------------------------------------------------------------------
+//  addKey()
+//  The outputs of the key are collected from the UTXO set, and the pooled
+//  transactions spending some of them lock them.
+// -----------------------------------------------------------------------------
+const WalletKey* Wallet::addKey(EVP_PKEY* pkey)
+{
+    const std::string publicKey = encodePublicKey(pkey);
+    if (publicKey.empty()) {
+        std::cerr << "Error: cannot encode the public key of a wallet key" << std::endl;
+        return nullptr;
+    }
+    const std::string publicKeyHash = Transaction::hashPublicKey(publicKey);
+    auto found = _keyByHash.find(publicKeyHash);
+    if (found != _keyByHash.end()) {
+        return &_keys[found->second];
+    }
+    EVP_PKEY_up_ref(pkey);
+    const uint32_t index = static_cast<uint32_t>(_keys.size());
+    _keys.push_back(WalletKey{pkey, publicKey, publicKeyHash});
+    _keyByHash.emplace(publicKeyHash, index);
+
+    _chain.getUTXOSet().forEach([this, index](const OutPoint& outPoint, const TxOut& output) {
+        if (output.publicKeyHash == _keys[index].publicKeyHash) {
+            addCoin(Coin(output.amount, outPoint, index));
+        }
+    });
+    if (_mempool) {
+        _mempool->forEach([this, index](const Transaction& tx) { lockInputs(tx, index); });
+    }
+    return &_keys.back();
+}
+
+const WalletKey* Wallet::findKey(const std::string& publicKeyHash) const
+{
+    auto it = _keyByHash.find(publicKeyHash);
+    return it == _keyByHash.end() ? nullptr : &_keys[it->second];
+}
+
+int64_t Wallet::ownerOf(const TxOut& output) const
+{
+    auto it = _keyByHash.find(output.publicKeyHash);
+    return it == _keyByHash.end() ? -1 : static_cast<int64_t>(it->second);
+}
+
+// -----------------------------------------------------------------------------
+//  selectCoins()
+//  Past the changeless search, every step is a lookup in the ordered set:
+//  the smallest output covering what is left is taken as soon as one exists
+//  among the outputs not taken yet, which are the ones up to the largest.
+// -----------------------------------------------------------------------------
+bool Wallet::selectCoins(uint64_t amount, std::vector<Coin>& coins) const
+{
+    coins.clear();
+    if (amount == 0 || amount > _balance) {
+        return false;
+    }
+    if (selectChangeless(amount, coins)) {
+        return true;
+    }
+
+    uint64_t total = 0;
+    auto largest = _spendable.end();
+    while (largest != _spendable.begin()) {
+        --largest;
+        auto fit = _spendable.lower_bound(Coin(amount - total, OutPoint(TXID(), 0), 0));
+        if (fit != _spendable.end() && !CoinOrder()(*largest, *fit)) {
+            coins.push_back(*fit);
+            return true;
+        }
+        coins.push_back(*largest);
+        total += largest->amount;
+    }
+    coins.clear();
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+//  selectChangeless()
+//  Depth-first search over the candidates, largest first: each one is taken,
+//  then left out once every selection taking it was tried. A branch stops
+//  when its sum passes amount + changeTolerance or can't reach amount with
+//  all the candidates left. After leaving a candidate out, the next ones of
+//  the same amount are left out too, as taking them gives the same sums.
+//  The search keeps the selection with the least excess, and stops at an
+//  exact one or after maxTries steps.
+// -----------------------------------------------------------------------------
+bool Wallet::selectChangeless(uint64_t amount, std::vector<Coin>& coins) const
+{
+    const uint64_t tolerance = std::min(_config.changeTolerance, std::numeric_limits<uint64_t>::max() - amount);
+    const uint64_t upper = amount + tolerance;
+
+    std::vector<const Coin*> candidates;
+    auto it = upper == std::numeric_limits<uint64_t>::max()
+                  ? _spendable.end()
+                  : _spendable.lower_bound(Coin(upper + 1, OutPoint(TXID(), 0), 0));
+    while (it != _spendable.begin() && candidates.size() < _config.maxCandidates) {
+        --it;
+        candidates.push_back(&*it);
+    }
+    const size_t count = candidates.size();
+    // remaining[i]: sum of the candidates from i on
+    std::vector<uint64_t> remaining(count + 1, 0);
+    for (size_t i = count; i-- > 0;) {
+        remaining[i] = remaining[i + 1] + candidates[i]->amount;
+    }
+    if (remaining[0] < amount) {
+        return false;
+    }
+
+    std::vector<size_t> selected;
+    std::vector<size_t> best;
+    uint64_t bestExcess = std::numeric_limits<uint64_t>::max();
+    uint64_t sum = 0;
+    size_t next = 0;
+    for (size_t tries = 0; tries < _config.maxTries; ++tries) {
+        bool backtrack = false;
+        if (sum + remaining[next] < amount || sum > upper) {
+            backtrack = true;
+        } else if (sum >= amount) {
+            if (sum - amount < bestExcess) {
+                best = selected;
+                bestExcess = sum - amount;
+                if (bestExcess == 0) {
+                    break;
+                }
+            }
+            backtrack = true;
+        }
+        if (backtrack) {
+            if (selected.empty()) {
+                break;
+            }
+            next = selected.back();
+            selected.pop_back();
+            sum -= candidates[next]->amount;
+            ++next;
+            while (next < count && candidates[next]->amount == candidates[next - 1]->amount) {
+                ++next;
+            }
+            continue;
+        }
+        // sum < amount <= sum + remaining[next], so a candidate is left
+        sum += candidates[next]->amount;
+        selected.push_back(next++);
+    }
+    if (best.empty()) {
+        return false;
+    }
+    for (size_t index : best) {
+        coins.push_back(*candidates[index]);
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+//  createTransaction()
+//  Inputs don't sign each other's signatures, so the signature hash is the
+//  same for all of them and computed once.
+// -----------------------------------------------------------------------------
+bool Wallet::createTransaction(const std::string& publicKeyHash, uint64_t amount, Transaction& tx) const
+{
+    std::vector<Coin> coins;
+    if (!selectCoins(amount, coins)) {
+        return false;
+    }
+    std::vector<TxIn> inputs;
+    inputs.reserve(coins.size());
+    uint64_t total = 0;
+    for (const Coin& coin : coins) {
+        inputs.emplace_back(coin.outPoint.txid, coin.outPoint.index, "", _keys[coin.key].publicKey);
+        total += coin.amount;
+    }
+    std::vector<TxOut> outputs = {TxOut(amount, publicKeyHash)};
+    if (total - amount > _config.changeTolerance) {
+        outputs.emplace_back(total - amount, _keys[coins[0].key].publicKeyHash);
+    }
+
+    tx = Transaction(inputs, outputs);
+    const std::string signatureHash = tx.getSignatureHash();
+    for (size_t i = 0; i < coins.size(); ++i) {
+        if (!tx.signInput(i, _keys[coins[i].key].pkey, signatureHash)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t Wallet::memoryUsage() const
+{
+    size_t bytes = _entryMemory + dynamicUsage(_keys) + dynamicUsage(_keyByHash) + dynamicUsage(_spendable) +
+                   dynamicUsage(_locks) + dynamicUsage(_locked) + dynamicUsage(_lockedBy);
+    for (const WalletKey& key : _keys) {
+        // The hash is held by _keyByHash too
+        bytes += dynamicUsage(key.publicKey) + 2 * dynamicUsage(key.publicKeyHash);
+    }
+    return bytes;
+}
+
+// -----------------------------------------------------------------------------
+//  addCoin() / removeCoin()
+//  An output spent by a pooled transaction goes to _locked instead of the
+//  spendable set; it may be locked before the wallet sees it when a
+//  disconnected block returns its spender to the pool first.
+// -----------------------------------------------------------------------------
+void Wallet::addCoin(const Coin& coin)
+{
+    if (_locks.count(coin.outPoint)) {
+        if (!_locked.emplace(coin.outPoint, coin).second) {
+            return;
+        }
+    } else {
+        if (!_spendable.insert(coin).second) {
+            return;
+        }
+        _balance += coin.amount;
+    }
+    _entryMemory += dynamicUsage(coin.outPoint.txid);
+}
+
+void Wallet::removeCoin(const Coin& coin)
+{
+    if (_spendable.erase(coin)) {
+        _balance -= coin.amount;
+    } else if (!_locked.erase(coin.outPoint)) {
+        return;
+    }
+    _entryMemory -= dynamicUsage(coin.outPoint.txid);
+}
+
+void Wallet::lock(const Coin& coin)
+{
+    auto inserted = _locks.emplace(coin.outPoint, 0);
+    ++inserted.first->second;
+    if (!inserted.second) {
+        return;
+    }
+    _entryMemory += dynamicUsage(coin.outPoint.txid);
+    if (_spendable.erase(coin)) {
+        _balance -= coin.amount;
+        _locked.emplace(coin.outPoint, coin);
+    }
+}
+
+void Wallet::unlock(const OutPoint& outPoint)
+{
+    auto it = _locks.find(outPoint);
+    if (it == _locks.end() || --it->second > 0) {
+        return;
+    }
+    _entryMemory -= dynamicUsage(it->first.txid);
+    _locks.erase(it);
+    auto locked = _locked.find(outPoint);
+    if (locked != _locked.end()) {
+        _spendable.insert(locked->second);
+        _balance += locked->second.amount;
+        _locked.erase(locked);
+    }
+}
+
+// -----------------------------------------------------------------------------
+//  lockInputs()
+//  Outputs of pooled parents are locked too, so that they are not spendable
+//  once the parent confirms before the child.
+// -----------------------------------------------------------------------------
+void Wallet::lockInputs(const Transaction& tx, int64_t key)
+{
+    std::vector<OutPoint> spent;
+    for (const TxIn& input : tx.getInputs()) {
+        if (input.isCoinbase()) {
+            continue;
+        }
+        const OutPoint outPoint(input.prevTxID, input.outputIndex);
+        const TxOut* output = _chain.getUTXOSet().find(outPoint);
+        if (!output && _mempool) {
+            const Transaction* parent = _mempool->find(input.prevTxID);
+            if (parent && input.outputIndex < parent->getOutputs().size()) {
+                output = &parent->getOutputs()[input.outputIndex];
+            }
+        }
+        const int64_t owner = output ? ownerOf(*output) : -1;
+        if (owner < 0 || (key >= 0 && owner != key)) {
+            continue;
+        }
+        lock(Coin(output->amount, outPoint, static_cast<uint32_t>(owner)));
+        spent.push_back(outPoint);
+    }
+    if (spent.empty()) {
+        return;
+    }
+
+    auto inserted = _lockedBy.try_emplace(tx.getTxid());
+    std::vector<OutPoint>& outPoints = inserted.first->second;
+    if (inserted.second) {
+        _entryMemory += dynamicUsage(inserted.first->first);
+    } else {
+        _entryMemory -= dynamicUsage(outPoints);
+    }
+    for (const OutPoint& outPoint : spent) {
+        outPoints.push_back(outPoint);
+        _entryMemory += dynamicUsage(outPoint.txid);
+    }
+    _entryMemory += dynamicUsage(outPoints);
+}
+
+// -----------------------------------------------------------------------------
+//  blockConnected()
+//  Outputs are added before the spent ones are removed, as the undo data
+//  also lists the outputs spent within the block.
+// -----------------------------------------------------------------------------
+void Wallet::blockConnected(const Block& block, const BlockUndo& undo, uint64_t)
+{
+    for (const auto& tx : block.getTransactions()) {
+        const std::vector<TxOut>& outputs = tx.getOutputs();
+        for (size_t i = 0; i < outputs.size(); ++i) {
+            const int64_t owner = ownerOf(outputs[i]);
+            if (owner >= 0) {
+                addCoin(Coin(outputs[i].amount, OutPoint(tx.getTxid(), static_cast<uint32_t>(i)),
+                             static_cast<uint32_t>(owner)));
+            }
+        }
+    }
+    for (const auto& spent : undo.spentOutputs) {
+        const int64_t owner = ownerOf(spent.second);
+        if (owner >= 0) {
+            removeCoin(Coin(spent.second.amount, spent.first, static_cast<uint32_t>(owner)));
+        }
+    }
+}
+
+void Wallet::blockDisconnected(const Block& block, const BlockUndo& undo, uint64_t)
+{
+    for (const auto& spent : undo.spentOutputs) {
+        const int64_t owner = ownerOf(spent.second);
+        if (owner >= 0) {
+            addCoin(Coin(spent.second.amount, spent.first, static_cast<uint32_t>(owner)));
+        }
+    }
+    for (const auto& tx : block.getTransactions()) {
+        const std::vector<TxOut>& outputs = tx.getOutputs();
+        for (size_t i = 0; i < outputs.size(); ++i) {
+            const int64_t owner = ownerOf(outputs[i]);
+            if (owner >= 0) {
+                removeCoin(Coin(outputs[i].amount, OutPoint(tx.getTxid(), static_cast<uint32_t>(i)),
+                                static_cast<uint32_t>(owner)));
+            }
+        }
+    }
+}
+
+void Wallet::transactionAdded(const Transaction& tx)
+{
+    lockInputs(tx);
+}
+
+void Wallet::transactionRemoved(const TXID& txid)
+{
+    auto it = _lockedBy.find(txid);
+    if (it == _lockedBy.end()) {
+        return;
+    }
+    _entryMemory -= dynamicUsage(it->first) + dynamicUsage(it->second);
+    for (const OutPoint& outPoint : it->second) {
+        _entryMemory -= dynamicUsage(outPoint.txid);
+        unlock(outPoint);
+    }
+    _lockedBy.erase(it);
+}
@@ -0,0 +1,192 @@
+#ifndef WALLET_H
+#define WALLET_H
+
+#include "Blockchain.h"
+#include "Mempool.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @file Wallet.h
+ * @brief Definition of the Wallet class, the keys of a user and the outputs they can spend.
+ * @details Each key keeps its DER public key and its publicKeyHash, computed
+ *          once when the key is added. The wallet follows the chain and keeps
+ *          the confirmed outputs paid to its keys in a set ordered by amount,
+ *          so coin selection looks amounts up in logarithmic time instead of
+ *          sorting every output on each payment. With a mempool attached, the
+ *          outputs spent by pooled transactions are locked until those leave
+ *          the pool; the outputs of pooled transactions are not spendable
+ *          before they confirm.
+ *          Coin selection first runs a bounded branch and bound search for
+ *          inputs summing to the amount, within changeTolerance, which needs
+ *          no change output. Failing that, it takes the smallest output
+ *          covering the amount or, if none does, the largest outputs until the
+ *          rest is covered by one, and pays the difference back as change.
+ *          Like the mempool the wallet is not thread-safe.
+ */
+
+struct WalletConfig {
+    // Excess over the amount a selection may leave out of the outputs
+    // instead of paying it back as change
+    uint64_t changeTolerance;
+    // Largest outputs the branch and bound search considers, and its steps
+    size_t maxCandidates;
+    size_t maxTries;
+
+    WalletConfig();
+};
+
+// A key pair with its DER public key and the publicKeyHash of its outputs
+struct WalletKey {
+    EVP_PKEY* pkey;
+    std::string publicKey;
+    std::string publicKeyHash;
+};
+
+class Wallet : public ChainListener, public MempoolListener {
+public:
+
+    // A spendable output of one of the keys
+    struct Coin {
+        uint64_t amount;
+        OutPoint outPoint;
+        uint32_t key;
+
+        Coin(uint64_t amount, const OutPoint& outPoint, uint32_t key)
+            : amount(amount), outPoint(outPoint), key(key) {}
+    };
+
+    /**
+     * Follows chain and, if mempool is given, its pooled transactions; both
+     * must outlive the wallet.
+     */
+    explicit Wallet(Blockchain& chain, Mempool* mempool = nullptr,
+                    const WalletConfig& config = WalletConfig());
+
+    ~Wallet() override;
+
+    Wallet(const Wallet&) = delete;
+    Wallet& operator=(const Wallet&) = delete;
+
+    /**
+     * Creates a secp256k1 key pair and adds it. Returns nullptr if OpenSSL
+     * fails.
+     */
+    const WalletKey* generateKey();
+
+    /**
+     * Adds a key pair, taking a reference of its own, and collects its
+     * unspent outputs from the UTXO set. Returns nullptr if the public key
+     * can't be encoded; a key already in the wallet is returned as is.
+     */
+    const WalletKey* addKey(EVP_PKEY* pkey);
+
+    /**
+     * Keys in the order they were added; their addresses don't change.
+     */
+    const std::deque<WalletKey>& getKeys() const { return _keys; }
+
+    /**
+     * Key whose outputs pay to publicKeyHash, or nullptr.
+     */
+    const WalletKey* findKey(const std::string& publicKeyHash) const;
+
+    /**
+     * Sum and number of the outputs that can be spent now.
+     */
+    uint64_t getBalance() const { return _balance; }
+    size_t coinCount() const { return _spendable.size(); }
+
+    /**
+     * Chooses spendable outputs summing to at least amount (see the file
+     * comment). Returns false, leaving coins empty, if amount is 0 or the
+     * balance is short.
+     */
+    bool selectCoins(uint64_t amount, std::vector<Coin>& coins) const;
+
+    /**
+     * Builds a transaction paying amount to publicKeyHash, with change to
+     * the key of its first input, and signs every input. The outputs stay
+     * spendable until the transaction enters the attached mempool.
+     * Returns false if the balance is short or signing fails.
+     */
+    bool createTransaction(const std::string& publicKeyHash, uint64_t amount, Transaction& tx) const;
+
+    /**
+     * Heap bytes held by the keys' strings, the outputs and the locks,
+     * counted from container capacities (see MemoryUsage.h).
+     */
+    size_t memoryUsage() const;
+
+    /**
+     * DER encoding of the public key of pkey, as held by TxIn::publicKey.
+     * Returns an empty string on failure.
+     */
+    static std::string encodePublicKey(EVP_PKEY* pkey);
+
+    // ChainListener
+    void blockConnected(const Block& block, const BlockUndo& undo, uint64_t height) override;
+    void blockDisconnected(const Block& block, const BlockUndo& undo, uint64_t height) override;
+
+    // MempoolListener
+    void transactionAdded(const Transaction& tx) override;
+    void transactionRemoved(const TXID& txid) override;
+
+private:
+    // Amount first, so that lower_bound() finds the smallest output covering one
+    struct CoinOrder {
+        bool operator()(const Coin& a, const Coin& b) const {
+            if (a.amount != b.amount) {
+                return a.amount < b.amount;
+            }
+            if (a.outPoint.index != b.outPoint.index) {
+                return a.outPoint.index < b.outPoint.index;
+            }
+            return a.outPoint.txid < b.outPoint.txid;
+        }
+    };
+
+    typedef std::unordered_map<OutPoint, uint32_t, OutPointHash> LockCounts;
+
+    // Branch and bound over the largest outputs not above amount + changeTolerance
+    bool selectChangeless(uint64_t amount, std::vector<Coin>& coins) const;
+
+    // Output owned by a key, or -1
+    int64_t ownerOf(const TxOut& output) const;
+
+    // Every change of the outputs goes through these, which keep the balance,
+    // the locks and _entryMemory
+    void addCoin(const Coin& coin);
+    void removeCoin(const Coin& coin);
+    void lock(const Coin& coin);
+    void unlock(const OutPoint& outPoint);
+
+    // Locks the outputs of the wallet tx spends, only the ones of key if it
+    // isn't -1
+    void lockInputs(const Transaction& tx, int64_t key = -1);
+
+    Blockchain& _chain;
+    Mempool* _mempool;
+    WalletConfig _config;
+
+    std::deque<WalletKey> _keys;
+    std::unordered_map<std::string, uint32_t> _keyByHash;
+
+    std::set<Coin, CoinOrder> _spendable;
+    uint64_t _balance;
+    // Outputs spent by pooled transactions, with the number of spenders, and
+    // the ones of them the wallet holds
+    LockCounts _locks;
+    std::unordered_map<OutPoint, Coin, OutPointHash> _locked;
+    // Outputs of the wallet locked by each pooled transaction
+    std::unordered_map<TXID, std::vector<OutPoint>> _lockedBy;
+    // Heap bytes of the txids of the entries above
+    size_t _entryMemory;
+};
+
+#endif // WALLET_H
@@ -0,0 +1,63 @@
+#include "Message.h"
+#include "Encoding.h"
+
+std::string encodeFrame(MessageType type, const std::string& payload)
+{
+    std::string frame;
+    frame.reserve(FrameHeaderSize + payload.size());
+    ByteWriter writer(frame);
+    writer.writeU32(static_cast<uint32_t>(payload.size()));
+    writer.writeU8(static_cast<uint8_t>(type));
+    frame.append(payload);
+    return frame;
+}
+
+bool decodeFrameHeader(const char* data, uint32_t& payloadSize, MessageType& type)
+{
+    ByteReader reader(data, FrameHeaderSize);
+    uint8_t rawType;
+    reader.readU32(payloadSize);
+    reader.readU8(rawType);
+    if (payloadSize > MaxPayloadSize ||
+        rawType < static_cast<uint8_t>(MessageType::Inventory) ||
+        rawType > static_cast<uint8_t>(MessageType::Tx)) {
+        return false;
+    }
+    type = static_cast<MessageType>(rawType);
+    return true;
+}
+
+std::string encodeInventory(const std::vector<InventoryItem>& items)
+{
+    std::string payload;
+    ByteWriter writer(payload);
+    writer.writeVarInt(items.size());
+    for (const auto& item : items) {
+        writer.writeU8(static_cast<uint8_t>(item.type));
+        writer.writeString(item.hash);
+    }
+    return payload;
+}
+
+bool decodeInventory(const std::string& payload, std::vector<InventoryItem>& items)
+{
+    ByteReader reader(payload);
+    uint64_t count;
+    // An item takes at least 2 bytes
+    if (!reader.readVarInt(count) || count > reader.remaining() / 2) {
+        return false;
+    }
+    items.clear();
+    items.reserve(static_cast<size_t>(count));
+    for (uint64_t i = 0; i < count; ++i) {
+        uint8_t type;
+        std::string hash;
+        if (!reader.readU8(type) || !reader.readString(hash) ||
+            type < static_cast<uint8_t>(InventoryType::Block) ||
+            type > static_cast<uint8_t>(InventoryType::Tx)) {
+            return false;
+        }
+        items.emplace_back(static_cast<InventoryType>(type), hash);
+    }
+    return reader.atEnd();
+}
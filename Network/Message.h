@@ -0,0 +1,53 @@
+#ifndef MESSAGE_H
+#define MESSAGE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @file Message.h
+ * @brief Definition of the peer-to-peer wire messages and their framing.
+ * @details Every message is sent as a frame: a 4-byte little-endian payload
+ *          length, a 1-byte message type, then the payload. Block and Tx payloads
+ *          are the binary encodings of Block and Transaction; Inventory and
+ *          GetData payloads are lists of (item type, hash).
+ * https://en.bitcoin.it/wiki/Protocol_documentation#Message_types
+ */
+
+enum class MessageType : uint8_t {
+    Inventory = 1,  // Announces blocks or transactions the sender has
+    GetData = 2,    // Requests blocks or transactions announced earlier
+    Block = 3,
+    Tx = 4,
+};
+
+enum class InventoryType : uint8_t {
+    Block = 1,
+    Tx = 2,
+};
+
+struct InventoryItem {
+    InventoryType type;
+    std::string hash;
+
+    InventoryItem(InventoryType type, const std::string& hash) : type(type), hash(hash) {}
+};
+
+// Size of the frame header: payload length and message type
+const size_t FrameHeaderSize = 5;
+
+// Frames announcing a larger payload are rejected
+const uint32_t MaxPayloadSize = 32 * 1024 * 1024;
+
+// Builds a complete frame
+std::string encodeFrame(MessageType type, const std::string& payload);
+
+// Reads a frame header. Returns false if the frame is invalid.
+bool decodeFrameHeader(const char* data, uint32_t& payloadSize, MessageType& type);
+
+// Inventory and GetData payloads
+std::string encodeInventory(const std::vector<InventoryItem>& items);
+bool decodeInventory(const std::string& payload, std::vector<InventoryItem>& items);
+
+#endif // MESSAGE_H
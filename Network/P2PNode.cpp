@@ -0,0 +1,490 @@
+#include "P2PNode.h"
+#include <algorithm>
+#include <deque>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+// Bytes read from a socket per recv() call
+const size_t ReadChunkSize = 256 * 1024;
+// Frames written per writev() call
+const int MaxIovecs = 64;
+const int MaxEvents = 256;
+
+bool setNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+}
+
+// Anything registered in an epoll set
+struct P2PNode::Pollable {
+    enum class Kind { Wake, Listener, Peer };
+    Kind kind;
+    int fd;
+
+    Pollable(Kind kind, int fd) : kind(kind), fd(fd) {}
+    virtual ~Pollable() = default;
+};
+
+struct P2PNode::Peer : P2PNode::Pollable {
+    PeerId id;
+    IoThread* thread;
+    // Received bytes not yet cut into frames; only touched by the I/O thread
+    std::string readBuffer;
+
+    // Guards everything below
+    std::mutex mutex;
+    std::deque<std::shared_ptr<const std::string>> sendQueue;
+    // Bytes of the front frame already written
+    size_t sendOffset;
+    size_t queuedBytes;
+    size_t maxQueuedBytes;
+    bool registered;
+    bool writeInterest;
+    bool closed;
+
+    Peer(int fd, PeerId id, IoThread* thread, size_t maxQueuedBytes)
+        : Pollable(Kind::Peer, fd), id(id), thread(thread), sendOffset(0), queuedBytes(0),
+          maxQueuedBytes(maxQueuedBytes), registered(false), writeInterest(false), closed(false) {}
+};
+
+struct P2PNode::IoThread {
+    int epollFd;
+    Pollable wake;
+    std::thread thread;
+    std::vector<char> scratch;
+
+    IoThread() : epollFd(epoll_create1(EPOLL_CLOEXEC)),
+                 wake(Pollable::Kind::Wake, eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+                 scratch(ReadChunkSize) {}
+};
+
+P2PConfig::P2PConfig()
+    : ioThreads(2),
+      maxSendQueueBytes(64 * 1024 * 1024)
+{
+}
+
+P2PNode::P2PNode(const P2PConfig& config)
+    : _config(config),
+      _nextThread(0),
+      _stopping(false),
+      _listeningPort(0),
+      _nextPeerId(1)
+{
+    _config.ioThreads = std::max(1u, _config.ioThreads);
+    for (unsigned i = 0; i < _config.ioThreads; ++i) {
+        auto thread = std::make_unique<IoThread>();
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.ptr = &thread->wake;
+        epoll_ctl(thread->epollFd, EPOLL_CTL_ADD, thread->wake.fd, &event);
+        _threads.push_back(std::move(thread));
+    }
+    for (auto& thread : _threads) {
+        IoThread* ioThread = thread.get();
+        thread->thread = std::thread([this, ioThread]() { ioLoop(*ioThread); });
+    }
+}
+
+P2PNode::~P2PNode()
+{
+    stop();
+
+    for (auto& entry : _peers) {
+        std::lock_guard<std::mutex> lock(entry.second->mutex);
+        entry.second->closed = true;
+        close(entry.second->fd);
+    }
+    if (_listener) {
+        close(_listener->fd);
+    }
+    for (auto& thread : _threads) {
+        close(thread->wake.fd);
+        close(thread->epollFd);
+    }
+}
+
+void P2PNode::stop()
+{
+    _stopping = true;
+    for (auto& thread : _threads) {
+        uint64_t one = 1;
+        ssize_t ignored = write(thread->wake.fd, &one, sizeof(one));
+        (void)ignored;
+    }
+    for (auto& thread : _threads) {
+        if (thread->thread.joinable()) {
+            thread->thread.join();
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+//  listen()
+//  The listening socket is served by the first I/O thread.
+// -----------------------------------------------------------------------------
+bool P2PNode::listen(uint16_t port, const std::string& address)
+{
+    if (_listener) {
+        return false;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    socklen_t length = sizeof(addr);
+    if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1 ||
+        bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(fd, SOMAXCONN) != 0 ||
+        getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &length) != 0) {
+        close(fd);
+        return false;
+    }
+    _listeningPort = ntohs(addr.sin_port);
+
+    _listener = std::make_unique<Pollable>(Pollable::Kind::Listener, fd);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.ptr = _listener.get();
+    epoll_ctl(_threads[0]->epollFd, EPOLL_CTL_ADD, fd, &event);
+    return true;
+}
+
+PeerId P2PNode::connect(const std::string& address, uint16_t port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return 0;
+    }
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1 ||
+        ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        !setNonBlocking(fd)) {
+        close(fd);
+        return 0;
+    }
+    return registerPeer(fd);
+}
+
+void P2PNode::acceptPeers()
+{
+    for (;;) {
+        int fd = accept4(_listener->fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            // EAGAIN once the backlog is empty; other errors (EMFILE) drop the attempt
+            return;
+        }
+        registerPeer(fd);
+    }
+}
+
+// -----------------------------------------------------------------------------
+//  registerPeer()
+//  The connect handler runs before the socket joins an epoll set, so it sees
+//  the peer before any of its messages. Frames it sends are written directly
+//  or stay queued until registration arms EPOLLOUT.
+// -----------------------------------------------------------------------------
+PeerId P2PNode::registerPeer(int fd)
+{
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    IoThread* thread = _threads[_nextThread.fetch_add(1) % _threads.size()].get();
+    const PeerId id = _nextPeerId.fetch_add(1);
+    auto peer = std::make_shared<Peer>(fd, id, thread, _config.maxSendQueueBytes);
+    {
+        std::lock_guard<std::mutex> lock(_peersMutex);
+        _peers.emplace(id, peer);
+    }
+
+    if (_onConnect) {
+        _onConnect(id);
+    }
+
+    std::lock_guard<std::mutex> lock(peer->mutex);
+    peer->registered = true;
+    peer->writeInterest = !peer->sendQueue.empty();
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLET | (peer->writeInterest ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+    event.data.ptr = static_cast<Pollable*>(peer.get());
+    epoll_ctl(thread->epollFd, EPOLL_CTL_ADD, fd, &event);
+    return id;
+}
+
+void P2PNode::ioLoop(IoThread& thread)
+{
+    epoll_event events[MaxEvents];
+
+    while (!_stopping) {
+        int count = epoll_wait(thread.epollFd, events, MaxEvents, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            Pollable* pollable = static_cast<Pollable*>(events[i].data.ptr);
+            switch (pollable->kind) {
+            case Pollable::Kind::Wake:
+                break;
+            case Pollable::Kind::Listener:
+                acceptPeers();
+                break;
+            case Pollable::Kind::Peer: {
+                Peer& peer = static_cast<Peer&>(*pollable);
+                bool open = true;
+                if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                    open = readPeer(thread, peer);
+                }
+                if (open && (events[i].events & EPOLLOUT)) {
+                    std::lock_guard<std::mutex> lock(peer.mutex);
+                    open = flushLocked(peer);
+                    if (open && peer.sendQueue.empty()) {
+                        setWriteInterest(peer, false);
+                    }
+                }
+                if (!open) {
+                    closePeer(thread, peer);
+                }
+                break;
+            }
+            }
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+//  readPeer()
+//  Edge-triggered: the socket is drained until EAGAIN. Complete frames are
+//  dispatched as soon as they are buffered. Returns false when the peer has
+//  to be closed (end of stream, error or malformed frame).
+// -----------------------------------------------------------------------------
+bool P2PNode::readPeer(IoThread& thread, Peer& peer)
+{
+    for (;;) {
+        ssize_t received = recv(peer.fd, thread.scratch.data(), thread.scratch.size(), 0);
+        if (received == 0) {
+            return false;
+        }
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        peer.readBuffer.append(thread.scratch.data(), static_cast<size_t>(received));
+
+        size_t offset = 0;
+        const std::string& buffer = peer.readBuffer;
+        while (buffer.size() - offset >= FrameHeaderSize) {
+            uint32_t payloadSize;
+            MessageType type;
+            if (!decodeFrameHeader(buffer.data() + offset, payloadSize, type)) {
+                return false;
+            }
+            if (buffer.size() - offset - FrameHeaderSize < payloadSize) {
+                break;
+            }
+            std::string payload = buffer.substr(offset + FrameHeaderSize, payloadSize);
+            offset += FrameHeaderSize + payloadSize;
+            if (_onMessage) {
+                _onMessage(peer.id, type, payload);
+            }
+        }
+        peer.readBuffer.erase(0, offset);
+    }
+}
+
+void P2PNode::closePeer(IoThread& thread, Peer& peer)
+{
+    const PeerId id = peer.id;
+    std::shared_ptr<Peer> keepAlive;
+    {
+        std::lock_guard<std::mutex> lock(_peersMutex);
+        auto it = _peers.find(id);
+        if (it == _peers.end()) {
+            return;
+        }
+        keepAlive = it->second;
+        _peers.erase(it);
+    }
+    {
+        std::lock_guard<std::mutex> lock(peer.mutex);
+        peer.closed = true;
+        epoll_ctl(thread.epollFd, EPOLL_CTL_DEL, peer.fd, nullptr);
+        close(peer.fd);
+        peer.sendQueue.clear();
+        peer.queuedBytes = 0;
+    }
+    if (_onDisconnect) {
+        _onDisconnect(id);
+    }
+}
+
+std::shared_ptr<P2PNode::Peer> P2PNode::findPeer(PeerId peer) const
+{
+    std::lock_guard<std::mutex> lock(_peersMutex);
+    auto it = _peers.find(peer);
+    return it == _peers.end() ? nullptr : it->second;
+}
+
+bool P2PNode::send(PeerId peer, MessageType type, const std::string& payload)
+{
+    return sendFrame(peer, std::make_shared<const std::string>(encodeFrame(type, payload)));
+}
+
+bool P2PNode::sendFrame(PeerId peer, const std::shared_ptr<const std::string>& frame)
+{
+    std::shared_ptr<Peer> target = findPeer(peer);
+    return target && queueFrame(*target, frame);
+}
+
+size_t P2PNode::broadcast(MessageType type, const std::string& payload, PeerId except)
+{
+    auto frame = std::make_shared<const std::string>(encodeFrame(type, payload));
+    std::vector<std::shared_ptr<Peer>> targets;
+    {
+        std::lock_guard<std::mutex> lock(_peersMutex);
+        targets.reserve(_peers.size());
+        for (const auto& entry : _peers) {
+            if (entry.first != except) {
+                targets.push_back(entry.second);
+            }
+        }
+    }
+
+    size_t queued = 0;
+    for (const auto& peer : targets) {
+        queued += queueFrame(*peer, frame) ? 1 : 0;
+    }
+    return queued;
+}
+
+// -----------------------------------------------------------------------------
+//  queueFrame()
+//  When nothing is pending the frame is written right away from the calling
+//  thread; whatever the socket does not take is left to the I/O thread.
+// -----------------------------------------------------------------------------
+bool P2PNode::queueFrame(Peer& peer, const std::shared_ptr<const std::string>& frame)
+{
+    std::lock_guard<std::mutex> lock(peer.mutex);
+    if (peer.closed || peer.queuedBytes + frame->size() > peer.maxQueuedBytes) {
+        return false;
+    }
+    peer.sendQueue.push_back(frame);
+    peer.queuedBytes += frame->size();
+
+    if (peer.writeInterest) {
+        return true;
+    }
+    if (!flushLocked(peer)) {
+        // Let the I/O thread notice the failure and close the peer
+        shutdown(peer.fd, SHUT_RDWR);
+        return false;
+    }
+    if (!peer.sendQueue.empty() && peer.registered) {
+        setWriteInterest(peer, true);
+    }
+    return true;
+}
+
+bool P2PNode::flushLocked(Peer& peer)
+{
+    while (!peer.sendQueue.empty()) {
+        iovec iov[MaxIovecs];
+        int count = 0;
+        size_t offset = peer.sendOffset;
+        for (auto it = peer.sendQueue.begin(); it != peer.sendQueue.end() && count < MaxIovecs; ++it) {
+            iov[count].iov_base = const_cast<char*>((*it)->data() + offset);
+            iov[count].iov_len = (*it)->size() - offset;
+            offset = 0;
+            ++count;
+        }
+
+        ssize_t written = writev(peer.fd, iov, count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+
+        size_t remaining = static_cast<size_t>(written);
+        peer.queuedBytes -= remaining;
+        while (remaining > 0) {
+            const size_t frameLeft = peer.sendQueue.front()->size() - peer.sendOffset;
+            if (remaining < frameLeft) {
+                peer.sendOffset += remaining;
+                break;
+            }
+            remaining -= frameLeft;
+            peer.sendQueue.pop_front();
+            peer.sendOffset = 0;
+        }
+    }
+    return true;
+}
+
+void P2PNode::setWriteInterest(Peer& peer, bool enabled)
+{
+    if (peer.writeInterest == enabled || peer.closed) {
+        return;
+    }
+    peer.writeInterest = enabled;
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLET | (enabled ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+    event.data.ptr = static_cast<Pollable*>(&peer);
+    epoll_ctl(peer.thread->epollFd, EPOLL_CTL_MOD, peer.fd, &event);
+}
+
+void P2PNode::disconnect(PeerId peer)
+{
+    std::shared_ptr<Peer> target = findPeer(peer);
+    if (target) {
+        std::lock_guard<std::mutex> lock(target->mutex);
+        if (!target->closed) {
+            // The owning I/O thread sees the hang-up and closes the peer
+            shutdown(target->fd, SHUT_RDWR);
+        }
+    }
+}
+
+size_t P2PNode::peerCount() const
+{
+    std::lock_guard<std::mutex> lock(_peersMutex);
+    return _peers.size();
+}
+
+std::vector<PeerId> P2PNode::peers() const
+{
+    std::lock_guard<std::mutex> lock(_peersMutex);
+    std::vector<PeerId> ids;
+    ids.reserve(_peers.size());
+    for (const auto& entry : _peers) {
+        ids.push_back(entry.first);
+    }
+    return ids;
+}
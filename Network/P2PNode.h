@@ -0,0 +1,152 @@
+#ifndef P2PNODE_H
+#define P2PNODE_H
+
+#include "Message.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @file P2PNode.h
+ * @brief Definition of the P2PNode class, the non-blocking TCP transport between nodes.
+ * @details A fixed number of I/O threads each run an edge-triggered epoll loop over
+ *          their share of the peer sockets. Incoming bytes are cut into frames
+ *          (see Message.h) and handed to the message handler on the I/O thread
+ *          that owns the peer. Outgoing frames go through a per-peer send queue
+ *          bounded in bytes: send() writes directly when the socket accepts the
+ *          data, queues the rest for the I/O thread, and returns false when the
+ *          queue is full so that callers can drop or throttle a slow peer.
+ *          Frames are reference-counted, so broadcasting a block to thousands of
+ *          peers encodes and stores it only once.
+ *          Linux only (epoll).
+ */
+
+using PeerId = uint64_t;
+
+struct P2PConfig {
+    // Number of I/O threads
+    unsigned ioThreads;
+    // Maximum number of bytes waiting in the send queue of a peer
+    size_t maxSendQueueBytes;
+
+    P2PConfig();
+};
+
+class P2PNode {
+public:
+    using MessageHandler = std::function<void(PeerId peer, MessageType type, const std::string& payload)>;
+    using PeerHandler = std::function<void(PeerId peer)>;
+
+    explicit P2PNode(const P2PConfig& config = P2PConfig());
+
+    /**
+     * Closes every connection and joins the I/O threads.
+     */
+    ~P2PNode();
+
+    /**
+     * Joins the I/O threads; no handler is called once it returns.
+     * Connections stay open until destruction.
+     */
+    void stop();
+
+    P2PNode(const P2PNode&) = delete;
+    P2PNode& operator=(const P2PNode&) = delete;
+
+    /**
+     * Handlers are called on I/O threads. They must be set before the first
+     * listen() or connect().
+     */
+    void setMessageHandler(MessageHandler handler) { _onMessage = std::move(handler); }
+    void setConnectHandler(PeerHandler handler) { _onConnect = std::move(handler); }
+    void setDisconnectHandler(PeerHandler handler) { _onDisconnect = std::move(handler); }
+
+    /**
+     * Accepts incoming connections on address:port. Port 0 picks a free port,
+     * see listeningPort().
+     */
+    bool listen(uint16_t port, const std::string& address = "127.0.0.1");
+
+    /**
+     * Port accepted connections arrive on, or 0 when not listening.
+     */
+    uint16_t listeningPort() const { return _listeningPort; }
+
+    /**
+     * Opens a connection. Returns the new peer id, or 0 on failure.
+     */
+    PeerId connect(const std::string& address, uint16_t port);
+
+    /**
+     * Queues a message for a peer. Returns false if the peer is unknown or
+     * its send queue is full.
+     */
+    bool send(PeerId peer, MessageType type, const std::string& payload);
+
+    /**
+     * Queues an already framed message for a peer.
+     */
+    bool sendFrame(PeerId peer, const std::shared_ptr<const std::string>& frame);
+
+    /**
+     * Queues a message for every peer except one. Returns the number of
+     * peers the message was queued for.
+     */
+    size_t broadcast(MessageType type, const std::string& payload, PeerId except = 0);
+
+    /**
+     * Closes a connection. The disconnect handler is called once it is closed.
+     */
+    void disconnect(PeerId peer);
+
+    /**
+     * Number of open connections.
+     */
+    size_t peerCount() const;
+
+    /**
+     * Identifiers of the open connections.
+     */
+    std::vector<PeerId> peers() const;
+
+private:
+    struct Pollable;
+    struct Peer;
+    struct IoThread;
+
+    void ioLoop(IoThread& thread);
+    void acceptPeers();
+    PeerId registerPeer(int fd);
+    bool readPeer(IoThread& thread, Peer& peer);
+    void closePeer(IoThread& thread, Peer& peer);
+    std::shared_ptr<Peer> findPeer(PeerId peer) const;
+    bool queueFrame(Peer& peer, const std::shared_ptr<const std::string>& frame);
+
+    // Writes as much of the send queue as the socket accepts; peer mutex held
+    static bool flushLocked(Peer& peer);
+    // Enables or disables EPOLLOUT notifications; peer mutex held
+    static void setWriteInterest(Peer& peer, bool enabled);
+
+    P2PConfig _config;
+    std::vector<std::unique_ptr<IoThread>> _threads;
+    std::atomic<size_t> _nextThread;
+    std::atomic<bool> _stopping;
+
+    std::unique_ptr<Pollable> _listener;
+    uint16_t _listeningPort;
+
+    mutable std::mutex _peersMutex;
+    std::unordered_map<PeerId, std::shared_ptr<Peer>> _peers;
+    std::atomic<PeerId> _nextPeerId;
+
+    MessageHandler _onMessage;
+    PeerHandler _onConnect;
+    PeerHandler _onDisconnect;
+};
+
+#endif // P2PNODE_H
@@ -0,0 +1,291 @@
+#include "Relay.h"
+#include "Encoding.h"
+
+Relay::Relay(Blockchain& chain, Mempool& mempool, P2PNode& node)
+    : _chain(chain),
+      _mempool(mempool),
+      _node(node),
+      _known(chain, mempool),
+      _orphanCount(0)
+{
+    _node.setMessageHandler([this](PeerId peer, MessageType type, const std::string& payload) {
+        handleMessage(peer, type, payload);
+    });
+    _node.setConnectHandler([this](PeerId peer) { handleConnect(peer); });
+    _node.setDisconnectHandler([this](PeerId peer) { handleDisconnect(peer); });
+}
+
+Relay::~Relay()
+{
+    _node.stop();
+}
+
+bool Relay::submitBlock(const Block& block)
+{
+    std::vector<std::string> accepted;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_chain.hasBlock(block.getHash())) {
+            return false;
+        }
+        accepted = acceptBlock(block);
+    }
+    for (const auto& hash : accepted) {
+        announce(InventoryType::Block, hash, 0);
+    }
+    return !accepted.empty();
+}
+
+bool Relay::submitTransaction(const Transaction& tx)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_known.isConfirmed(tx.getTxid()) || !_mempool.addTransaction(tx)) {
+            return false;
+        }
+    }
+    announce(InventoryType::Tx, tx.getTxid(), 0);
+    return true;
+}
+
+uint64_t Relay::getHeight() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _chain.getHeight();
+}
+
+std::string Relay::getTipHash() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _chain.getLatestBlock().getHash();
+}
+
+bool Relay::hasBlock(const std::string& hash) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _chain.hasBlock(hash);
+}
+
+bool Relay::hasTransaction(const TXID& txid) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _mempool.contains(txid);
+}
+
+size_t Relay::orphanCount() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _orphanCount;
+}
+
+void Relay::handleMessage(PeerId peer, MessageType type, const std::string& payload)
+{
+    switch (type) {
+    case MessageType::Inventory:
+        handleInventory(peer, payload);
+        break;
+    case MessageType::GetData:
+        handleGetData(peer, payload);
+        break;
+    case MessageType::Block:
+        handleBlock(peer, payload);
+        break;
+    case MessageType::Tx:
+        handleTransaction(peer, payload);
+        break;
+    }
+}
+
+// -----------------------------------------------------------------------------
+//  handleConnect()
+//  Announcing the tip is enough for a peer that is behind: it requests the
+//  tip, finds its parent missing and walks back from there.
+// -----------------------------------------------------------------------------
+void Relay::handleConnect(PeerId peer)
+{
+    std::string tip = getTipHash();
+    _node.send(peer, MessageType::Inventory,
+               encodeInventory({InventoryItem(InventoryType::Block, tip)}));
+}
+
+void Relay::handleDisconnect(PeerId peer)
+{
+    // Items requested from this peer can be requested again from others
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto it = _requested.begin(); it != _requested.end();) {
+        if (it->second == peer) {
+            it = _requested.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void Relay::handleInventory(PeerId peer, const std::string& payload)
+{
+    std::vector<InventoryItem> items;
+    if (!decodeInventory(payload, items)) {
+        _node.disconnect(peer);
+        return;
+    }
+
+    std::vector<InventoryItem> wanted;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (const auto& item : items) {
+            const bool known = item.type == InventoryType::Block
+                ? _chain.hasBlock(item.hash)
+                : _known.isKnown(item.hash);
+            if (!known && _requested.emplace(item.hash, peer).second) {
+                wanted.push_back(item);
+            }
+        }
+    }
+
+    if (!wanted.empty()) {
+        _node.send(peer, MessageType::GetData, encodeInventory(wanted));
+    }
+}
+
+void Relay::handleGetData(PeerId peer, const std::string& payload)
+{
+    std::vector<InventoryItem> items;
+    if (!decodeInventory(payload, items)) {
+        _node.disconnect(peer);
+        return;
+    }
+
+    for (const auto& item : items) {
+        std::string data;
+        MessageType type;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (item.type == InventoryType::Block) {
+                const Block* block = _chain.findBlock(item.hash);
+                if (!block) {
+                    continue;
+                }
+                block->encode(data);
+                type = MessageType::Block;
+            } else {
+                const Transaction* tx = _mempool.find(item.hash);
+                if (!tx) {
+                    continue;
+                }
+                tx->encode(data);
+                type = MessageType::Tx;
+            }
+        }
+        _node.send(peer, type, data);
+    }
+}
+
+// -----------------------------------------------------------------------------
+//  handleBlock()
+//  The announced hash is checked against the block content and its proof of
+//  work before the block reaches the chain. The difficulty in the header is
+//  chosen by the sender, so it must be at least the one the chain expects,
+//  that of the tip as in Blockchain::createBlock().
+// -----------------------------------------------------------------------------
+void Relay::handleBlock(PeerId peer, const std::string& payload)
+{
+    ByteReader reader(payload);
+    Block block("");
+    if (!Block::decode(reader, block) || !reader.atEnd()) {
+        _node.disconnect(peer);
+        return;
+    }
+
+    uint32_t expectedDifficulty;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        expectedDifficulty = _chain.getLatestBlock().getHeader().difficulty;
+    }
+    const uint32_t difficulty = block.getHeader().difficulty;
+    Block check = block;
+    check.computeHash();
+    if (check.getHash() != block.getHash() || difficulty < expectedDifficulty ||
+        !block.validateBlock(difficulty)) {
+        _node.disconnect(peer);
+        return;
+    }
+
+    std::vector<std::string> accepted;
+    bool requestParent = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _requested.erase(block.getHash());
+        if (_chain.hasBlock(block.getHash())) {
+            return;
+        }
+
+        if (!_chain.hasBlock(block.getPreviousHash())) {
+            if (_orphanCount >= MaxOrphans) {
+                _orphans.clear();
+                _orphanCount = 0;
+            }
+            _orphans[block.getPreviousHash()].push_back(block);
+            ++_orphanCount;
+            requestParent = _requested.emplace(block.getPreviousHash(), peer).second;
+        } else {
+            accepted = acceptBlock(block);
+        }
+    }
+
+    if (requestParent) {
+        _node.send(peer, MessageType::GetData,
+                   encodeInventory({InventoryItem(InventoryType::Block, block.getPreviousHash())}));
+    }
+    for (const auto& hash : accepted) {
+        announce(InventoryType::Block, hash, peer);
+    }
+}
+
+void Relay::handleTransaction(PeerId peer, const std::string& payload)
+{
+    ByteReader reader(payload);
+    Transaction tx;
+    if (!Transaction::decode(reader, tx) || !reader.atEnd()) {
+        _node.disconnect(peer);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _requested.erase(tx.getTxid());
+        if (_known.isConfirmed(tx.getTxid()) || !_mempool.addTransaction(tx)) {
+            return;
+        }
+    }
+    announce(InventoryType::Tx, tx.getTxid(), peer);
+}
+
+std::vector<std::string> Relay::acceptBlock(const Block& block)
+{
+    std::vector<std::string> accepted;
+    std::vector<Block> pending = {block};
+
+    while (!pending.empty()) {
+        Block next = std::move(pending.back());
+        pending.pop_back();
+        if (_chain.hasBlock(next.getHash()) || !_chain.addBlock(next)) {
+            continue;
+        }
+        accepted.push_back(next.getHash());
+
+        auto it = _orphans.find(next.getHash());
+        if (it != _orphans.end()) {
+            _orphanCount -= it->second.size();
+            for (auto& orphan : it->second) {
+                pending.push_back(std::move(orphan));
+            }
+            _orphans.erase(it);
+        }
+    }
+    return accepted;
+}
+
+void Relay::announce(InventoryType type, const std::string& hash, PeerId except)
+{
+    _node.broadcast(MessageType::Inventory, encodeInventory({InventoryItem(type, hash)}), except);
+}
@@ -0,0 +1,108 @@
+#ifndef RELAY_H
+#define RELAY_H
+
+#include "Blockchain.h"
+#include "KnownTxids.h"
+#include "Mempool.h"
+#include "P2PNode.h"
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @file Relay.h
+ * @brief Definition of the Relay class, the block and transaction relay of a node.
+ * @details The relay connects a Blockchain and a Mempool to a P2PNode. New blocks
+ *          and transactions are announced with an inventory message; peers
+ *          request what they don't know with getdata and receive the full
+ *          objects. A block whose parent is unknown is kept as an orphan and its
+ *          parent is requested from the peer that sent it, which also lets a
+ *          new peer catch up from the tip it is announced on connection.
+ *          Messages are handled on the I/O threads of the node, so once a relay
+ *          is attached the chain and the mempool must only be used through it.
+ * https://en.bitcoin.it/wiki/Network#Standard_relaying
+ */
+class Relay {
+public:
+
+    /**
+     * Installs the message and connection handlers of the node, which must
+     * not be listening or connected yet.
+     */
+    Relay(Blockchain& chain, Mempool& mempool, P2PNode& node);
+
+    /**
+     * Stops the node, whose handlers refer to the relay.
+     */
+    ~Relay();
+
+    Relay(const Relay&) = delete;
+    Relay& operator=(const Relay&) = delete;
+
+    /**
+     * Adds a locally produced block to the chain and announces it.
+     */
+    bool submitBlock(const Block& block);
+
+    /**
+     * Adds a locally produced transaction to the mempool and announces it.
+     */
+    bool submitTransaction(const Transaction& tx);
+
+    /**
+     * Height and hash of the active chain tip.
+     */
+    uint64_t getHeight() const;
+    std::string getTipHash() const;
+
+    /**
+     * Returns true if the block is known.
+     */
+    bool hasBlock(const std::string& hash) const;
+
+    /**
+     * Returns true if the transaction is in the mempool.
+     */
+    bool hasTransaction(const TXID& txid) const;
+
+    /**
+     * Number of blocks waiting for their parent.
+     */
+    size_t orphanCount() const;
+
+private:
+    void handleMessage(PeerId peer, MessageType type, const std::string& payload);
+    void handleConnect(PeerId peer);
+    void handleDisconnect(PeerId peer);
+
+    void handleInventory(PeerId peer, const std::string& payload);
+    void handleGetData(PeerId peer, const std::string& payload);
+    void handleBlock(PeerId peer, const std::string& payload);
+    void handleTransaction(PeerId peer, const std::string& payload);
+
+    // Adds a block and then the orphans waiting for it; mutex held.
+    // Returns the hashes of the blocks that were accepted.
+    std::vector<std::string> acceptBlock(const Block& block);
+
+    void announce(InventoryType type, const std::string& hash, PeerId except);
+
+    // Orphans kept at most; reaching the limit drops them all
+    static const size_t MaxOrphans = 1000;
+
+    Blockchain& _chain;
+    Mempool& _mempool;
+    P2PNode& _node;
+    // Confirmed and pending txids; announced or received transactions
+    // that are already known are neither requested nor added to the pool
+    KnownTxids _known;
+
+    mutable std::mutex _mutex;
+    // Orphan blocks by the hash of their missing parent
+    std::unordered_map<std::string, std::vector<Block>> _orphans;
+    size_t _orphanCount;
+    // Items requested with getdata and not received yet, with the peer asked
+    std::unordered_map<std::string, PeerId> _requested;
+};
+
+#endif // RELAY_H
@@ -0,0 +1,393 @@
+#include "NetworkSimulator.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Size of a GetBlock request: a block hash plus framing
+const size_t GetBlockMessageSize = 72;
+
+const std::string NullTxID(64, '0');
+}
+
+SimulationConfig::SimulationConfig()
+    : nodeCount(16),
+      peersPerNode(4),
+      duration(3600),
+      blockInterval(10),
+      transactionRate(10),
+      maxBlockTransactions(2000),
+      difficulty(1),
+      link{0.05, 1.25e6, 0.0},
+      seed(1)
+{
+}
+
+NetworkSimulator::NetworkSimulator(const SimulationConfig& config)
+    : _config(config),
+      _random(config.seed),
+      _nextSequence(0),
+      _now(0),
+      _report()
+{
+    _config.nodeCount = std::max(1u, _config.nodeCount);
+
+    // Every node starts from the same genesis block
+    Block genesis(NullTxID);
+    genesis.setHeader(BlockHeader(1, NullTxID, "", 0, 0, _config.difficulty));
+    genesis.mine();
+
+    for (unsigned i = 0; i < _config.nodeCount; ++i) {
+        auto node = std::make_unique<Node>();
+        node->chain = std::make_unique<Blockchain>(genesis);
+        node->chain->addListener(&node->mempool);
+        _nodes.push_back(std::move(node));
+    }
+    buildTopology();
+}
+
+NetworkSimulator::~NetworkSimulator() = default;
+
+// -----------------------------------------------------------------------------
+//  buildTopology()
+//  A ring keeps the graph connected; the remaining peers are drawn at random.
+// -----------------------------------------------------------------------------
+void NetworkSimulator::buildTopology()
+{
+    const unsigned count = _config.nodeCount;
+    auto connected = [this](unsigned a, unsigned b) {
+        for (const Link& link : _nodes[a]->links) {
+            if (link.peer == b) {
+                return true;
+            }
+        }
+        return false;
+    };
+    auto connect = [this](unsigned a, unsigned b) {
+        _nodes[a]->links.push_back(Link{b, 0});
+        _nodes[b]->links.push_back(Link{a, 0});
+    };
+
+    if (count < 2) {
+        return;
+    }
+    for (unsigned i = 0; i < count; ++i) {
+        unsigned next = (i + 1) % count;
+        if (!connected(i, next)) {
+            connect(i, next);
+        }
+    }
+
+    const unsigned peers = std::min(_config.peersPerNode, count - 1);
+    for (unsigned i = 0; i < count; ++i) {
+        // Bounded number of draws, for small or dense networks
+        for (unsigned attempt = 0; attempt < 8 * count && _nodes[i]->links.size() < peers; ++attempt) {
+            unsigned peer = static_cast<unsigned>(_random() % count);
+            if (peer != i && !connected(i, peer)) {
+                connect(i, peer);
+            }
+        }
+    }
+}
+
+double NetworkSimulator::uniform()
+{
+    // 53 random bits, the precision of a double
+    return static_cast<double>(_random() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+double NetworkSimulator::exponential(double rate)
+{
+    return -std::log(1.0 - uniform()) / rate;
+}
+
+uint64_t NetworkSimulator::timestamp() const
+{
+    return static_cast<uint64_t>(_now * 1000.0);
+}
+
+void NetworkSimulator::schedule(double time, EventType type, unsigned node, unsigned from,
+                                std::shared_ptr<const Message> message)
+{
+    _events.push(Event{time, _nextSequence++, type, node, from, std::move(message)});
+}
+
+// -----------------------------------------------------------------------------
+//  run()
+//  Blocks and transactions are produced until the configured duration, then
+//  the in-flight messages are delivered so that the network settles.
+// -----------------------------------------------------------------------------
+SimulationReport NetworkSimulator::run()
+{
+    const unsigned count = _config.nodeCount;
+    if (_config.blockInterval > 0) {
+        schedule(exponential(1.0 / _config.blockInterval), EventType::MineBlock,
+                 static_cast<unsigned>(_random() % count));
+    }
+    if (_config.transactionRate > 0) {
+        schedule(exponential(_config.transactionRate), EventType::NewTransaction,
+                 static_cast<unsigned>(_random() % count));
+    }
+
+    while (!_events.empty()) {
+        Event event = _events.top();
+        _events.pop();
+        _now = event.time;
+
+        switch (event.type) {
+        case EventType::MineBlock: {
+            mineBlock(event.node);
+            double next = _now + exponential(1.0 / _config.blockInterval);
+            if (next < _config.duration) {
+                schedule(next, EventType::MineBlock, static_cast<unsigned>(_random() % count));
+            }
+            break;
+        }
+        case EventType::NewTransaction: {
+            generateTransaction(event.node);
+            double next = _now + exponential(_config.transactionRate);
+            if (next < _config.duration) {
+                schedule(next, EventType::NewTransaction, static_cast<unsigned>(_random() % count));
+            }
+            break;
+        }
+        case EventType::Deliver:
+            deliver(event.node, event.from, *event.message);
+            break;
+        }
+    }
+
+    return buildReport();
+}
+
+// -----------------------------------------------------------------------------
+//  mineBlock()
+//  The winning node builds a block from its mempool on top of its own tip.
+// -----------------------------------------------------------------------------
+void NetworkSimulator::mineBlock(unsigned nodeIndex)
+{
+    Node& node = *_nodes[nodeIndex];
+    const uint64_t sequence = _report.blocksMined++;
+    const std::string miner = "node" + std::to_string(nodeIndex);
+
+    std::vector<Transaction> transactions;
+    transactions.reserve(_config.maxBlockTransactions + 1);
+    Transaction coinbase({TxIn(NullTxID, 0, "block" + std::to_string(sequence), "")},
+                         {TxOut(50, miner)}, timestamp());
+    transactions.push_back(coinbase);
+    for (auto& tx : node.mempool.getTransactions(_config.maxBlockTransactions)) {
+        transactions.push_back(std::move(tx));
+    }
+
+    const std::string& prevHash = node.chain->getLatestBlock().getHash();
+    Block block(transactions, prevHash);
+    block.setHeader(BlockHeader(1, prevHash, "", timestamp(), 0, _config.difficulty));
+    block.computeMerkleRoot();
+    block.mine();
+
+    auto minedBlock = std::make_shared<const Block>(std::move(block));
+    _blockStats[minedBlock->getHash()].minedAt = _now;
+    receiveBlock(nodeIndex, nodeIndex, minedBlock);
+}
+
+void NetworkSimulator::generateTransaction(unsigned nodeIndex)
+{
+    const uint64_t sequence = _report.transactionsGenerated++;
+    Transaction tx({TxIn(NullTxID, 0, "tx" + std::to_string(sequence), "")},
+                   {TxOut(1, "node" + std::to_string(nodeIndex))}, timestamp());
+    receiveTransaction(nodeIndex, nodeIndex, std::make_shared<const Transaction>(std::move(tx)));
+}
+
+void NetworkSimulator::deliver(unsigned nodeIndex, unsigned from, const Message& message)
+{
+    switch (message.type) {
+    case MessageType::Block:
+        receiveBlock(nodeIndex, from, message.block);
+        break;
+    case MessageType::Transaction:
+        receiveTransaction(nodeIndex, from, message.tx);
+        break;
+    case MessageType::GetBlock: {
+        Node& node = *_nodes[nodeIndex];
+        auto it = node.blocks.find(message.hash);
+        if (it != node.blocks.end()) {
+            send(nodeIndex, from, blockMessage(it->second));
+        }
+        break;
+    }
+    }
+}
+
+// -----------------------------------------------------------------------------
+//  receiveBlock()
+// -----------------------------------------------------------------------------
+void NetworkSimulator::receiveBlock(unsigned nodeIndex, unsigned from,
+                                    const std::shared_ptr<const Block>& block)
+{
+    Node& node = *_nodes[nodeIndex];
+    if (!node.blocks.emplace(block->getHash(), block).second) {
+        return;
+    }
+    _blockStats[block->getHash()].receivedAt.push_back(_now);
+
+    if (!node.chain->hasBlock(block->getPreviousHash())) {
+        // Keep it until the parent arrives, and ask the sender for the parent
+        node.orphans.emplace(block->getPreviousHash(), block);
+        _report.orphansReceived++;
+        if (from != nodeIndex) {
+            auto request = std::make_shared<Message>();
+            request->type = MessageType::GetBlock;
+            request->hash = block->getPreviousHash();
+            request->size = GetBlockMessageSize;
+            send(nodeIndex, from, request);
+        }
+        return;
+    }
+
+    acceptBlock(nodeIndex, from, block);
+}
+
+void NetworkSimulator::acceptBlock(unsigned nodeIndex, unsigned from,
+                                   const std::shared_ptr<const Block>& block)
+{
+    Node& node = *_nodes[nodeIndex];
+    std::vector<std::pair<unsigned, std::shared_ptr<const Block>>> pending = {{from, block}};
+
+    while (!pending.empty()) {
+        auto current = pending.back();
+        pending.pop_back();
+
+        if (!node.chain->addBlock(*current.second)) {
+            continue;
+        }
+        relay(nodeIndex, current.first, blockMessage(current.second));
+
+        // Orphans waiting for this block can now be connected
+        auto range = node.orphans.equal_range(current.second->getHash());
+        for (auto it = range.first; it != range.second; ++it) {
+            pending.emplace_back(nodeIndex, it->second);
+        }
+        node.orphans.erase(range.first, range.second);
+    }
+}
+
+void NetworkSimulator::receiveTransaction(unsigned nodeIndex, unsigned from,
+                                          const std::shared_ptr<const Transaction>& tx)
+{
+    Node& node = *_nodes[nodeIndex];
+    if (!node.seenTransactions.insert(tx->getTxid()).second) {
+        return;
+    }
+    // Already confirmed by a block that arrived first
+    if (node.chain->getUTXOSet().find(OutPoint(tx->getTxid(), 0))) {
+        return;
+    }
+    node.mempool.addTransaction(*tx);
+
+    auto message = std::make_shared<Message>();
+    message->type = MessageType::Transaction;
+    message->tx = tx;
+    message->size = tx->getEncodedSize();
+    relay(nodeIndex, from, message);
+}
+
+// -----------------------------------------------------------------------------
+//  send()
+//  Messages on a link are transmitted one after the other at the link
+//  bandwidth, then travel for the link latency. A lost message still uses
+//  the link.
+// -----------------------------------------------------------------------------
+void NetworkSimulator::send(unsigned from, unsigned to, std::shared_ptr<const Message> message)
+{
+    for (Link& link : _nodes[from]->links) {
+        if (link.peer != to) {
+            continue;
+        }
+        const double start = std::max(_now, link.busyUntil);
+        link.busyUntil = start + static_cast<double>(message->size) / _config.link.bandwidth;
+
+        _report.messagesSent++;
+        _report.bytesSent += message->size;
+        if (uniform() < _config.link.lossRate) {
+            _report.messagesLost++;
+            return;
+        }
+        schedule(link.busyUntil + _config.link.latency, EventType::Deliver, to, from, std::move(message));
+        return;
+    }
+}
+
+void NetworkSimulator::relay(unsigned from, unsigned except,
+                             const std::shared_ptr<const Message>& message)
+{
+    for (const Link& link : _nodes[from]->links) {
+        if (link.peer != except) {
+            send(from, link.peer, message);
+        }
+    }
+}
+
+std::shared_ptr<const NetworkSimulator::Message>
+NetworkSimulator::blockMessage(const std::shared_ptr<const Block>& block)
+{
+    auto& message = _blockMessages[block->getHash()];
+    if (!message) {
+        auto created = std::make_shared<Message>();
+        created->type = MessageType::Block;
+        created->block = block;
+        created->size = block->getEncodedSize();
+        message = created;
+    }
+    return message;
+}
+
+// -----------------------------------------------------------------------------
+//  buildReport()
+//  Chain measurements are taken on the node with the most work. Lossy links
+//  may keep blocks from some nodes, so no node is assumed to have them all;
+//  every block of the best chain but genesis was mined, and the others are
+//  stale.
+// -----------------------------------------------------------------------------
+SimulationReport NetworkSimulator::buildReport() const
+{
+    SimulationReport report = _report;
+    const Blockchain* best = _nodes[0]->chain.get();
+    for (const auto& node : _nodes) {
+        if (node->chain->getChainWork() > best->getChainWork()) {
+            best = node->chain.get();
+        }
+    }
+    const Blockchain& chain = *best;
+
+    const uint64_t height = chain.getHeight();
+    report.staleBlocks = report.blocksMined - std::min<uint64_t>(report.blocksMined, height);
+    report.orphanRate = report.blocksMined
+        ? static_cast<double>(report.staleBlocks) / report.blocksMined : 0;
+
+    for (uint64_t h = 1; h <= height; ++h) {
+        report.transactionsConfirmed += chain.getBlock(h).getTransactions().size() - 1;
+    }
+    report.transactionsPerSecond = _config.duration > 0
+        ? report.transactionsConfirmed / _config.duration : 0;
+
+    // Average, over the blocks that got that far, of the time to reach a share of the nodes
+    auto meanTimeToReach = [this](double share) {
+        const size_t needed = static_cast<size_t>(std::ceil(share * _config.nodeCount));
+        double total = 0;
+        size_t blocks = 0;
+        for (const auto& entry : _blockStats) {
+            std::vector<double> times = entry.second.receivedAt;
+            if (times.size() < needed || needed == 0) {
+                continue;
+            }
+            std::sort(times.begin(), times.end());
+            total += times[needed - 1] - entry.second.minedAt;
+            blocks++;
+        }
+        return blocks ? total / blocks : 0;
+    };
+    report.propagation50 = meanTimeToReach(0.5);
+    report.propagation90 = meanTimeToReach(0.9);
+    report.propagation100 = meanTimeToReach(1.0);
+
+    return report;
+}
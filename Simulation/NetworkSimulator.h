@@ -0,0 +1,173 @@
+#ifndef NETWORKSIMULATOR_H
+#define NETWORKSIMULATOR_H
+
+#include "Blockchain.h"
+#include "Mempool.h"
+#include <memory>
+#include <queue>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @file NetworkSimulator.h
+ * @brief Definition of the NetworkSimulator class, an in-process multi-node network.
+ * @details Runs many nodes in one process, each with its own Blockchain and Mempool,
+ *          connected by simulated links with latency, bandwidth and message loss.
+ *          The simulation is a discrete-event loop on a virtual clock driven by a
+ *          seeded random generator, so a given configuration always produces the
+ *          same run, independently of the host speed.
+ *
+ *          Blocks are found by a Poisson process (equal hash power on every node)
+ *          and relayed by flooding. A node receiving a block whose parent it does
+ *          not know keeps it as an orphan and asks the sender for the parent.
+ *          Generated transactions carry a single null input, so they need no
+ *          funding and are always valid.
+ */
+
+// Characteristics of every simulated link
+struct LinkConfig {
+    // One-way propagation delay, in seconds
+    double latency;
+    // Throughput of each direction, in bytes per second
+    double bandwidth;
+    // Probability that a message is dropped
+    double lossRate;
+};
+
+struct SimulationConfig {
+    unsigned nodeCount;
+    // Peers each node connects to; links are bidirectional
+    unsigned peersPerNode;
+    // Simulated seconds during which blocks and transactions are produced
+    double duration;
+    // Mean number of seconds between blocks, over the whole network
+    double blockInterval;
+    // Transactions per second, over the whole network
+    double transactionRate;
+    size_t maxBlockTransactions;
+    uint32_t difficulty;
+    LinkConfig link;
+    uint64_t seed;
+
+    SimulationConfig();
+};
+
+struct SimulationReport {
+    uint64_t blocksMined;
+    // Mined blocks that did not end up in the final best chain
+    uint64_t staleBlocks;
+    double orphanRate;
+    // Blocks received before their parent, over all nodes
+    uint64_t orphansReceived;
+    // Mean time, in seconds, for a block to reach 50%, 90% and 100% of the nodes
+    double propagation50;
+    double propagation90;
+    double propagation100;
+    uint64_t transactionsGenerated;
+    uint64_t transactionsConfirmed;
+    double transactionsPerSecond;
+    uint64_t messagesSent;
+    uint64_t messagesLost;
+    uint64_t bytesSent;
+};
+
+class NetworkSimulator {
+public:
+
+    explicit NetworkSimulator(const SimulationConfig& config);
+    ~NetworkSimulator();
+
+    /**
+     * Runs the simulation until every message has been delivered and
+     * returns its measurements. Can only be called once.
+     */
+    SimulationReport run();
+
+private:
+    enum class MessageType { Block, Transaction, GetBlock };
+
+    struct Message {
+        MessageType type;
+        std::shared_ptr<const Block> block;
+        std::shared_ptr<const Transaction> tx;
+        // Requested block for GetBlock
+        std::string hash;
+        size_t size;
+    };
+
+    enum class EventType { MineBlock, NewTransaction, Deliver };
+
+    struct Event {
+        double time;
+        // Breaks ties between events at the same time, in scheduling order
+        uint64_t sequence;
+        EventType type;
+        unsigned node;
+        unsigned from;
+        std::shared_ptr<const Message> message;
+
+        bool operator>(const Event& other) const {
+            return time != other.time ? time > other.time : sequence > other.sequence;
+        }
+    };
+
+    struct Link {
+        unsigned peer;
+        // Time at which the link finishes sending its queued messages
+        double busyUntil;
+    };
+
+    struct Node {
+        std::unique_ptr<Blockchain> chain;
+        Mempool mempool;
+        std::vector<Link> links;
+        // Every block received, to answer GetBlock requests
+        std::unordered_map<std::string, std::shared_ptr<const Block>> blocks;
+        // Blocks waiting for their parent, by parent hash
+        std::unordered_multimap<std::string, std::shared_ptr<const Block>> orphans;
+        std::unordered_set<TXID> seenTransactions;
+    };
+
+    struct BlockStats {
+        double minedAt;
+        std::vector<double> receivedAt;
+    };
+
+    void buildTopology();
+    void schedule(double time, EventType type, unsigned node, unsigned from = 0,
+                  std::shared_ptr<const Message> message = nullptr);
+
+    void mineBlock(unsigned node);
+    void generateTransaction(unsigned node);
+    void deliver(unsigned node, unsigned from, const Message& message);
+
+    void receiveBlock(unsigned node, unsigned from, const std::shared_ptr<const Block>& block);
+    void acceptBlock(unsigned node, unsigned from, const std::shared_ptr<const Block>& block);
+    void receiveTransaction(unsigned node, unsigned from, const std::shared_ptr<const Transaction>& tx);
+
+    void send(unsigned from, unsigned to, std::shared_ptr<const Message> message);
+    void relay(unsigned from, unsigned except, const std::shared_ptr<const Message>& message);
+    std::shared_ptr<const Message> blockMessage(const std::shared_ptr<const Block>& block);
+
+    // Uniform value in [0, 1)
+    double uniform();
+    // Delay until the next event of a Poisson process with this rate
+    double exponential(double rate);
+    uint64_t timestamp() const;
+
+    SimulationReport buildReport() const;
+
+    SimulationConfig _config;
+    std::mt19937_64 _random;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> _events;
+    uint64_t _nextSequence;
+    double _now;
+    std::vector<std::unique_ptr<Node>> _nodes;
+    std::unordered_map<std::string, BlockStats> _blockStats;
+    std::unordered_map<std::string, std::shared_ptr<const Message>> _blockMessages;
+    SimulationReport _report;
+};
+
+#endif // NETWORKSIMULATOR_H
@@ -0,0 +1,105 @@
+#include "NetworkSimulator.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Runs the network simulator over every combination of node count and
+// transaction rate given on the command line and prints one line per run.
+
+static std::vector<double> parseList(const char* text) {
+    std::vector<double> values;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        values.push_back(std::atof(item.c_str()));
+    }
+    return values;
+}
+
+static void printUsage() {
+    std::printf(
+        "Usage: netsim [options]\n"
+        "  --nodes N[,N...]         Node counts to simulate (default 8,16,32)\n"
+        "  --tx-rate R[,R...]       Transactions per second (default 10,100)\n"
+        "  --peers N                Peers per node (default 4)\n"
+        "  --duration S             Simulated seconds (default 3600)\n"
+        "  --block-interval S       Mean seconds between blocks (default 10)\n"
+        "  --max-block-tx N         Transactions per block (default 2000)\n"
+        "  --latency-ms MS          One-way link latency (default 50)\n"
+        "  --bandwidth-mbps MBPS    Link bandwidth (default 10)\n"
+        "  --loss P                 Message loss probability (default 0)\n"
+        "  --seed N                 Random seed (default 1)\n");
+}
+
+int main(int argc, char* argv[]) {
+    SimulationConfig config;
+    std::vector<double> nodeCounts = {8, 16, 32};
+    std::vector<double> transactionRates = {10, 100};
+
+    for (int i = 1; i < argc; ++i) {
+        const char* option = argv[i];
+        if (std::strcmp(option, "--help") == 0) {
+            printUsage();
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            printUsage();
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (std::strcmp(option, "--nodes") == 0) {
+            nodeCounts = parseList(value);
+        } else if (std::strcmp(option, "--tx-rate") == 0) {
+            transactionRates = parseList(value);
+        } else if (std::strcmp(option, "--peers") == 0) {
+            config.peersPerNode = static_cast<unsigned>(std::atoi(value));
+        } else if (std::strcmp(option, "--duration") == 0) {
+            config.duration = std::atof(value);
+        } else if (std::strcmp(option, "--block-interval") == 0) {
+            config.blockInterval = std::atof(value);
+        } else if (std::strcmp(option, "--max-block-tx") == 0) {
+            config.maxBlockTransactions = static_cast<size_t>(std::atoll(value));
+        } else if (std::strcmp(option, "--latency-ms") == 0) {
+            config.link.latency = std::atof(value) / 1000.0;
+        } else if (std::strcmp(option, "--bandwidth-mbps") == 0) {
+            config.link.bandwidth = std::atof(value) * 1e6 / 8.0;
+        } else if (std::strcmp(option, "--loss") == 0) {
+            config.link.lossRate = std::atof(value);
+        } else if (std::strcmp(option, "--seed") == 0) {
+            config.seed = std::strtoull(value, nullptr, 10);
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    std::printf("%6s %8s %7s %6s %8s %9s %9s %10s %9s %10s %8s\n",
+                "nodes", "tx/s", "blocks", "stale", "orphan%", "prop50ms", "prop90ms",
+                "prop100ms", "orphRecv", "conf tx/s", "lost");
+
+    for (double nodes : nodeCounts) {
+        for (double rate : transactionRates) {
+            config.nodeCount = static_cast<unsigned>(nodes);
+            config.transactionRate = rate;
+
+            NetworkSimulator simulator(config);
+            SimulationReport report = simulator.run();
+
+            std::printf("%6u %8.1f %7llu %6llu %8.2f %9.1f %9.1f %10.1f %9llu %10.2f %8llu\n",
+                        config.nodeCount, rate,
+                        static_cast<unsigned long long>(report.blocksMined),
+                        static_cast<unsigned long long>(report.staleBlocks),
+                        report.orphanRate * 100.0,
+                        report.propagation50 * 1e3,
+                        report.propagation90 * 1e3,
+                        report.propagation100 * 1e3,
+                        static_cast<unsigned long long>(report.orphansReceived),
+                        report.transactionsPerSecond,
+                        static_cast<unsigned long long>(report.messagesLost));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,282 @@
+#include "gtest/gtest.h"
+#include "AddressIndex.h"
+#include <filesystem>
+
+// Helper: coinbase transaction paying `amount` to `owner`
+static Transaction makeCoinbase(const std::string& owner, uint64_t amount = 50) {
+    TxIn in(std::string(64, '0'), 0, "coinbase_" + owner, "");
+    TxOut out(amount, owner);
+    return Transaction({in}, {out});
+}
+
+// Helper: mined block at difficulty 1 on top of prevHash
+static Block makeBlock(const std::string& prevHash, const std::vector<Transaction>& txs) {
+    Block block(txs, prevHash);
+    block.setHeader(BlockHeader(1, prevHash, "", 0, 0, 1));
+    block.computeMerkleRoot();
+    block.mine();
+    return block;
+}
+
+// Helper: index path in the temporary directory, removed on destruction
+struct TempIndex {
+    std::string path;
+
+    explicit TempIndex(const std::string& name)
+        : path((std::filesystem::temp_directory_path() / name).string()) {
+        std::filesystem::remove(path);
+    }
+    ~TempIndex() { std::filesystem::remove(path); }
+};
+
+// ====================================================================
+//  Incremental Update Tests
+// ====================================================================
+
+TEST(AddressIndexTest, ListsOutputsAndTheirSpends) {
+    Blockchain chain;
+    AddressIndex index;
+    ASSERT_TRUE(index.open(chain));
+
+    Transaction cb = makeCoinbase("alice");
+    Block b1 = makeBlock(chain.getLatestBlock().getHash(), {cb});
+    ASSERT_TRUE(chain.addBlock(b1));
+    // alice pays bob, and bob spends it in the same block
+    Transaction pay({TxIn(cb.getTxid(), 0, "sig", "pk")}, {TxOut(30, "bob"), TxOut(20, "alice")});
+    Transaction forward({TxIn(pay.getTxid(), 0, "sig", "pk")}, {TxOut(30, "carol")});
+    ASSERT_TRUE(chain.addBlock(makeBlock(b1.getHash(), {makeCoinbase("miner"), pay, forward})));
+
+    std::vector<AddressOutput> alice = index.getHistory("alice");
+    ASSERT_EQ(alice.size(), 2u);
+    EXPECT_EQ(alice[0].outPoint, OutPoint(cb.getTxid(), 0));
+    EXPECT_EQ(alice[0].height, 1u);
+    EXPECT_TRUE(alice[0].isSpent());
+    EXPECT_EQ(alice[0].spentBy, pay.getTxid());
+    EXPECT_EQ(alice[0].spentHeight, 2u);
+    EXPECT_EQ(alice[1].outPoint, OutPoint(pay.getTxid(), 1));
+    EXPECT_EQ(alice[1].amount, 20u);
+    EXPECT_FALSE(alice[1].isSpent());
+
+    std::vector<AddressOutput> bob = index.getHistory("bob");
+    ASSERT_EQ(bob.size(), 1u);
+    EXPECT_EQ(bob[0].spentBy, forward.getTxid());
+    EXPECT_EQ(index.outputCount("carol"), 1u);
+    EXPECT_TRUE(index.getHistory("nobody").empty());
+}
+
+TEST(AddressIndexTest, ReorgRemovesDisconnectedEntries) {
+    Blockchain chain;
+    AddressIndex index;
+    ASSERT_TRUE(index.open(chain));
+    const std::string genesis = chain.getLatestBlock().getHash();
+
+    Transaction cb = makeCoinbase("alice");
+    Block a1 = makeBlock(genesis, {cb});
+    Transaction pay({TxIn(cb.getTxid(), 0, "sig", "pk")}, {TxOut(50, "bob")});
+    Block a2 = makeBlock(a1.getHash(), {makeCoinbase("miner_a2"), pay});
+    ASSERT_TRUE(chain.addBlock(a1));
+    ASSERT_TRUE(chain.addBlock(a2));
+    EXPECT_TRUE(index.getHistory("alice")[0].isSpent());
+
+    // A branch replacing a2 only
+    Block b2 = makeBlock(a1.getHash(), {makeCoinbase("miner_b2")});
+    Block b3 = makeBlock(b2.getHash(), {makeCoinbase("miner_b3")});
+    ASSERT_TRUE(chain.addBlock(b2));
+    ASSERT_TRUE(chain.addBlock(b3));
+
+    ASSERT_EQ(index.outputCount("alice"), 1u);
+    EXPECT_FALSE(index.getHistory("alice")[0].isSpent());
+    EXPECT_EQ(index.outputCount("bob"), 0u);
+    EXPECT_EQ(index.outputCount("miner_a2"), 0u);
+    EXPECT_EQ(index.outputCount("miner_b3"), 1u);
+    EXPECT_EQ(index.addressCount(), 3u);
+}
+
+TEST(AddressIndexTest, PagesOfHistoryAndSpendsOfOldOutputs) {
+    Blockchain chain;
+    AddressIndex index;
+    ASSERT_TRUE(index.open(chain));
+
+    // alice receives one output per block, then spends the first and the
+    // fourth, and receives change after them
+    std::vector<Transaction> coinbases;
+    for (int i = 0; i < 6; ++i) {
+        coinbases.push_back(makeCoinbase("alice", 10 + i));
+        ASSERT_TRUE(chain.addBlock(makeBlock(chain.getLatestBlock().getHash(), {coinbases.back()})));
+    }
+    const std::string before = chain.getLatestBlock().getHash();
+    Transaction pay({TxIn(coinbases[0].getTxid(), 0, "sig", "pk"), TxIn(coinbases[3].getTxid(), 0, "sig", "pk")},
+                    {TxOut(20, "bob"), TxOut(3, "alice")});
+    Block spend = makeBlock(before, {makeCoinbase("miner"), pay});
+    ASSERT_TRUE(chain.addBlock(spend));
+
+    const std::vector<AddressOutput> history = index.getHistory("alice");
+    ASSERT_EQ(history.size(), 7u);
+    EXPECT_EQ(history[0].spentBy, pay.getTxid());
+    EXPECT_EQ(history[0].spentInput, 0u);
+    EXPECT_EQ(history[3].spentBy, pay.getTxid());
+    EXPECT_EQ(history[3].spentInput, 1u);
+    EXPECT_FALSE(history[1].isSpent());
+    EXPECT_EQ(history[6].outPoint, OutPoint(pay.getTxid(), 1));
+
+    // Pages put together give the whole history
+    std::vector<AddressOutput> paged;
+    for (uint64_t first = 0; first < 7; first += 3) {
+        std::vector<AddressOutput> page = index.getHistory("alice", first, 3);
+        EXPECT_EQ(page.size(), first + 3 <= 7 ? 3u : 7u - first);
+        paged.insert(paged.end(), page.begin(), page.end());
+    }
+    ASSERT_EQ(paged.size(), history.size());
+    for (size_t i = 0; i < paged.size(); ++i) {
+        EXPECT_EQ(paged[i].outPoint, history[i].outPoint);
+        EXPECT_EQ(paged[i].spentBy, history[i].spentBy);
+    }
+    EXPECT_TRUE(index.getHistory("alice", 7, 3).empty());
+
+    // Replacing the spending block unspends both outputs, which can then
+    // be spent again
+    Block other = makeBlock(before, {makeCoinbase("miner_b")});
+    Block next = makeBlock(other.getHash(), {makeCoinbase("miner_c")});
+    ASSERT_TRUE(chain.addBlock(other));
+    ASSERT_TRUE(chain.addBlock(next));
+    ASSERT_EQ(index.outputCount("alice"), 6u);
+    EXPECT_FALSE(index.getHistory("alice", 0, 1)[0].isSpent());
+    EXPECT_FALSE(index.getHistory("alice", 3, 1)[0].isSpent());
+
+    Transaction again({TxIn(coinbases[3].getTxid(), 0, "sig", "pk")}, {TxOut(13, "carol")});
+    ASSERT_TRUE(chain.addBlock(makeBlock(next.getHash(), {makeCoinbase("miner_d"), again})));
+    EXPECT_EQ(index.getHistory("alice", 3, 1)[0].spentBy, again.getTxid());
+    EXPECT_FALSE(index.getHistory("alice", 0, 1)[0].isSpent());
+}
+
+// ====================================================================
+//  Storage Tests
+// ====================================================================
+
+TEST(AddressIndexTest, LongHistoriesReadTheSameWithOrWithoutCache) {
+    TempIndex file("test_address_index_pages.log");
+    Blockchain chain;
+    AddressIndex cached(file.path);
+    AddressIndex uncached("", 0);
+    ASSERT_TRUE(cached.open(chain));
+    ASSERT_TRUE(uncached.open(chain));
+    EXPECT_TRUE(std::filesystem::exists(file.path + ".entries"));
+
+    // 150 outputs fill the small pages and two of 64 entries
+    std::vector<Transaction> coinbases;
+    for (int i = 0; i < 150; ++i) {
+        coinbases.push_back(makeCoinbase("alice", 100 + i));
+        ASSERT_TRUE(chain.addBlock(makeBlock(chain.getLatestBlock().getHash(), {coinbases.back()})));
+    }
+    const std::string before = chain.getLatestBlock().getHash();
+    const uint64_t entryBytes = cached.entryBytes();
+    Transaction pay({TxIn(coinbases[0].getTxid(), 0, "sig", "pk"), TxIn(coinbases[70].getTxid(), 0, "sig", "pk"),
+                     TxIn(coinbases[149].getTxid(), 0, "sig", "pk")},
+                    {TxOut(300, "bob"), TxOut(19, "alice")});
+    ASSERT_TRUE(chain.addBlock(makeBlock(before, {makeCoinbase("miner"), pay})));
+
+    const std::vector<AddressOutput> history = cached.getHistory("alice");
+    ASSERT_EQ(history.size(), 151u);
+    EXPECT_EQ(history[70].outPoint, OutPoint(coinbases[70].getTxid(), 0));
+    EXPECT_EQ(history[70].spentInput, 1u);
+    EXPECT_EQ(history[149].spentBy, pay.getTxid());
+    EXPECT_FALSE(history[148].isSpent());
+    EXPECT_GT(cached.cacheUsage(), 0u);
+    EXPECT_LE(cached.cacheUsage(), AddressIndex::DefaultCacheBytes);
+
+    const std::vector<AddressOutput> read = uncached.getHistory("alice");
+    EXPECT_EQ(uncached.cacheUsage(), 0u);
+    ASSERT_EQ(read.size(), history.size());
+    for (size_t i = 0; i < read.size(); ++i) {
+        EXPECT_EQ(read[i].outPoint, history[i].outPoint);
+        EXPECT_EQ(read[i].amount, history[i].amount);
+        EXPECT_EQ(read[i].spentBy, history[i].spentBy);
+    }
+    const std::vector<AddressOutput> page = uncached.getHistory("alice", 60, 10);
+    ASSERT_EQ(page.size(), 10u);
+    EXPECT_EQ(page[0].outPoint, history[60].outPoint);
+    EXPECT_EQ(page[9].outPoint, history[69].outPoint);
+
+    // The reorg frees the pages of the replaced block before the branch
+    // takes one for each of its miners
+    Block other = makeBlock(before, {makeCoinbase("miner_b")});
+    ASSERT_TRUE(chain.addBlock(other));
+    ASSERT_TRUE(chain.addBlock(makeBlock(other.getHash(), {makeCoinbase("miner_c")})));
+    EXPECT_EQ(cached.entryBytes(), entryBytes + 2 * 88);
+    EXPECT_EQ(uncached.entryBytes(), entryBytes + 2 * 88);
+    for (AddressIndex* index : {&cached, &uncached}) {
+        ASSERT_EQ(index->outputCount("alice"), 150u);
+        EXPECT_FALSE(index->getHistory("alice", 0, 1)[0].isSpent());
+        EXPECT_FALSE(index->getHistory("alice", 70, 1)[0].isSpent());
+        EXPECT_FALSE(index->getHistory("alice")[149].isSpent());
+        EXPECT_EQ(index->outputCount("miner"), 0u);
+    }
+
+    cached.close();
+    EXPECT_FALSE(std::filesystem::exists(file.path + ".entries"));
+    EXPECT_EQ(cached.addressCount(), 0u);
+}
+
+// ====================================================================
+//  Log Tests
+// ====================================================================
+
+TEST(AddressIndexTest, ReopenLoadsLogAndIndexesNewBlocks) {
+    TempIndex file("test_address_index_reopen.log");
+    Blockchain chain;
+    Transaction cb = makeCoinbase("alice");
+    Block b1 = makeBlock(chain.getLatestBlock().getHash(), {cb});
+    {
+        AddressIndex index(file.path);
+        ASSERT_TRUE(index.open(chain));
+        ASSERT_TRUE(chain.addBlock(b1));
+    }
+
+    // Connected while the index is closed
+    Transaction pay({TxIn(cb.getTxid(), 0, "sig", "pk")}, {TxOut(50, "bob")});
+    ASSERT_TRUE(chain.addBlock(makeBlock(b1.getHash(), {makeCoinbase("miner"), pay})));
+
+    AddressIndex index(file.path);
+    ASSERT_TRUE(index.open(chain));
+    EXPECT_EQ(index.loadedBlocks(), 2u);
+    ASSERT_EQ(index.outputCount("alice"), 1u);
+    EXPECT_EQ(index.getHistory("alice")[0].spentBy, pay.getTxid());
+    EXPECT_EQ(index.outputCount("bob"), 1u);
+}
+
+TEST(AddressIndexTest, StaleAndTornRecordsAreDropped) {
+    TempIndex file("test_address_index_stale.log");
+    Blockchain chain;
+    const std::string genesis = chain.getLatestBlock().getHash();
+    Block a1 = makeBlock(genesis, {makeCoinbase("alice")});
+    Block a2 = makeBlock(a1.getHash(), {makeCoinbase("alice_2")});
+    {
+        AddressIndex index(file.path);
+        ASSERT_TRUE(index.open(chain));
+        ASSERT_TRUE(chain.addBlock(a1));
+        ASSERT_TRUE(chain.addBlock(a2));
+    }
+    {
+        // The log ends in the middle of the record of a2
+        std::filesystem::resize_file(file.path, std::filesystem::file_size(file.path) - 3);
+        AddressIndex index(file.path);
+        ASSERT_TRUE(index.open(chain));
+        EXPECT_EQ(index.loadedBlocks(), 2u);
+        EXPECT_EQ(index.outputCount("alice_2"), 1u);
+    }
+
+    // a1 and a2 are replaced while the index is closed
+    Block b1 = makeBlock(genesis, {makeCoinbase("bob")});
+    Block b2 = makeBlock(b1.getHash(), {makeCoinbase("bob_2")});
+    Block b3 = makeBlock(b2.getHash(), {makeCoinbase("bob_3")});
+    ASSERT_TRUE(chain.addBlock(b1));
+    ASSERT_TRUE(chain.addBlock(b2));
+    ASSERT_TRUE(chain.addBlock(b3));
+
+    AddressIndex index(file.path);
+    ASSERT_TRUE(index.open(chain));
+    EXPECT_EQ(index.loadedBlocks(), 1u);
+    EXPECT_EQ(index.outputCount("alice"), 0u);
+    EXPECT_EQ(index.outputCount("bob_3"), 1u);
+    EXPECT_EQ(index.addressCount(), 3u);
+}
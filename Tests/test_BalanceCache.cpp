@@ -0,0 +1,106 @@
+#include "gtest/gtest.h"
+#include "BalanceCache.h"
+
+// Helper: coinbase transaction paying `amount` to `owner`
+static Transaction makeCoinbase(const std::string& owner, uint64_t amount = 50) {
+    TxIn in(std::string(64, '0'), 0, "coinbase_" + owner, "");
+    TxOut out(amount, owner);
+    return Transaction({in}, {out});
+}
+
+// Helper: mined block at difficulty 1 on top of prevHash
+static Block makeBlock(const std::string& prevHash, const std::vector<Transaction>& txs) {
+    Block block(txs, prevHash);
+    block.setHeader(BlockHeader(1, prevHash, "", 0, 0, 1));
+    block.computeMerkleRoot();
+    block.mine();
+    return block;
+}
+
+// ====================================================================
+//  Confirmed Balance Tests
+// ====================================================================
+
+TEST(BalanceCacheTest, FollowsConnectedBlocks) {
+    Blockchain chain;
+    BalanceCache balances(chain);
+
+    Transaction cb = makeCoinbase("alice");
+    Block b1 = makeBlock(chain.getLatestBlock().getHash(), {cb});
+    ASSERT_TRUE(chain.addBlock(b1));
+    EXPECT_EQ(balances.getBalance("alice"), 50u);
+
+    Transaction pay({TxIn(cb.getTxid(), 0, "sig", "pk")}, {TxOut(30, "bob"), TxOut(20, "alice")});
+    ASSERT_TRUE(chain.addBlock(makeBlock(b1.getHash(), {makeCoinbase("bob", 10), pay})));
+
+    EXPECT_EQ(balances.getBalance("alice"), 20u);
+    EXPECT_EQ(balances.getBalance("bob"), 40u);
+    EXPECT_EQ(balances.getBalance("nobody"), 0u);
+    EXPECT_EQ(balances.addressCount(), 2u);
+}
+
+TEST(BalanceCacheTest, ReorgRevertsDeltasAndMatchesRebuild) {
+    Blockchain chain;
+    BalanceCache balances(chain);
+    const std::string genesis = chain.getLatestBlock().getHash();
+
+    Transaction cb = makeCoinbase("alice");
+    Block a1 = makeBlock(genesis, {cb});
+    Transaction pay({TxIn(cb.getTxid(), 0, "sig", "pk")}, {TxOut(50, "bob")});
+    Block a2 = makeBlock(a1.getHash(), {makeCoinbase("miner"), pay});
+    ASSERT_TRUE(chain.addBlock(a1));
+    ASSERT_TRUE(chain.addBlock(a2));
+    EXPECT_EQ(balances.getBalance("alice"), 0u);
+
+    Block b2 = makeBlock(a1.getHash(), {makeCoinbase("carol")});
+    Block b3 = makeBlock(b2.getHash(), {makeCoinbase("dave", 70)});
+    ASSERT_TRUE(chain.addBlock(b2));
+    ASSERT_TRUE(chain.addBlock(b3));
+
+    EXPECT_EQ(balances.getBalance("alice"), 50u);
+    EXPECT_EQ(balances.getBalance("bob"), 0u);
+    EXPECT_EQ(balances.getBalance("miner"), 0u);
+    EXPECT_EQ(balances.getBalance("carol"), 50u);
+    EXPECT_EQ(balances.getBalance("dave"), 70u);
+
+    // A cache built from the UTXO set agrees
+    BalanceCache rebuilt(chain);
+    for (const char* owner : {"alice", "bob", "miner", "carol", "dave"}) {
+        EXPECT_EQ(rebuilt.getBalance(owner), balances.getBalance(owner)) << owner;
+    }
+    EXPECT_EQ(rebuilt.addressCount(), balances.addressCount());
+}
+
+// ====================================================================
+//  Mempool Overlay Tests
+// ====================================================================
+
+TEST(BalanceCacheTest, OverlayTracksPendingTransactions) {
+    Blockchain chain;
+    Mempool pool;
+    chain.addListener(&pool);
+    Transaction cb = makeCoinbase("alice");
+    Block b1 = makeBlock(chain.getLatestBlock().getHash(), {cb});
+    ASSERT_TRUE(chain.addBlock(b1));
+
+    // Pending chain: alice pays bob, bob pays carol
+    Transaction pay({TxIn(cb.getTxid(), 0, "sig", "pk")}, {TxOut(30, "bob"), TxOut(20, "alice")});
+    pool.addTransaction(pay);
+    BalanceCache balances(chain, &pool);
+    Transaction forward({TxIn(pay.getTxid(), 0, "sig", "pk")}, {TxOut(30, "carol")});
+    pool.addTransaction(forward);
+
+    EXPECT_EQ(balances.getBalance("alice"), 50u);
+    EXPECT_EQ(balances.getPendingDelta("alice"), -30);
+    EXPECT_EQ(balances.getUnconfirmedBalance("alice"), 20);
+    EXPECT_EQ(balances.getPendingDelta("bob"), 0);
+    EXPECT_EQ(balances.getUnconfirmedBalance("carol"), 30);
+
+    // Confirmation moves the deltas from the overlay to the balances
+    ASSERT_TRUE(chain.addBlock(makeBlock(b1.getHash(), {makeCoinbase("miner"), pay, forward})));
+    EXPECT_EQ(balances.getBalance("alice"), 20u);
+    EXPECT_EQ(balances.getBalance("carol"), 30u);
+    EXPECT_EQ(balances.getPendingDelta("alice"), 0);
+    EXPECT_EQ(balances.getPendingDelta("carol"), 0);
+    chain.removeListener(&pool);
+}
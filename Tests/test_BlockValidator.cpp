@@ -0,0 +1,202 @@
+#include "gtest/gtest.h"
+#include "BlockValidator.h"
+#include <random>
+
+// Helper: transaction spending outPoints into outputs of the given amounts
+static Transaction makeTx(const std::vector<OutPoint>& spent, const std::vector<uint64_t>& amounts,
+                          uint64_t timestamp) {
+    std::vector<TxIn> ins;
+    for (const auto& outPoint : spent) {
+        ins.emplace_back(outPoint.txid, outPoint.index, "sig", "pk");
+    }
+    std::vector<TxOut> outs;
+    for (uint64_t amount : amounts) {
+        outs.emplace_back(amount, "owner");
+    }
+    return Transaction(ins, outs, timestamp);
+}
+
+// Helper: coinbase with count outputs of 100
+static Transaction makeCoinbase(size_t count, uint64_t timestamp) {
+    std::vector<TxOut> outs(count, TxOut(100, "owner"));
+    return Transaction({TxIn(std::string(64, '0'), 0, "coinbase", "")}, outs, timestamp);
+}
+
+// Helper: set holding the outputs of a coinbase with count outputs
+static UTXOSet makeFundedSet(Transaction& funding, size_t count) {
+    funding = makeCoinbase(count, 1);
+    UTXOSet utxos;
+    BlockUndo undo;
+    EXPECT_TRUE(utxos.connectBlockSequential(Block({funding}, "0"), undo));
+    return utxos;
+}
+
+static void expectSameSets(const UTXOSet& actual, const UTXOSet& expected) {
+    ASSERT_EQ(actual.size(), expected.size());
+    expected.forEach([&](const OutPoint& outPoint, const TxOut& output) {
+        const TxOut* found = actual.find(outPoint);
+        ASSERT_NE(found, nullptr);
+        EXPECT_EQ(found->amount, output.amount);
+    });
+}
+
+// Connects block to a copy of utxos both ways and checks the results agree
+static bool connectBothWays(const UTXOSet& utxos, const Block& block) {
+    // Several workers, whatever the hardware, so the parallel path runs
+    static ThreadPool pool(4);
+    UTXOSet parallel = utxos;
+    UTXOSet sequential = utxos;
+    BlockUndo parallelUndo, sequentialUndo;
+    const bool accepted = parallel.connectBlock(block, parallelUndo, pool);
+    EXPECT_EQ(accepted, sequential.connectBlockSequential(block, sequentialUndo));
+    expectSameSets(parallel, sequential);
+    EXPECT_EQ(parallelUndo.spentOutputs.size(), sequentialUndo.spentOutputs.size());
+    for (size_t i = 0; i < parallelUndo.spentOutputs.size() && i < sequentialUndo.spentOutputs.size(); ++i) {
+        EXPECT_EQ(parallelUndo.spentOutputs[i].first, sequentialUndo.spentOutputs[i].first);
+    }
+    return accepted;
+}
+
+// ====================================================================
+//  Spend Graph Tests
+// ====================================================================
+
+TEST(BlockValidatorTest, AcceptsChainsOfSpendsWithinBlock) {
+    Transaction funding;
+    UTXOSet utxos = makeFundedSet(funding, 100);
+
+    // 100 chains of 5 transactions, each spending the previous one
+    std::vector<Transaction> txs;
+    for (uint32_t chain = 0; chain < 100; ++chain) {
+        OutPoint spent(funding.getTxid(), chain);
+        for (uint64_t link = 0; link < 5; ++link) {
+            txs.push_back(makeTx({spent}, {100}, 1000 * chain + link + 10));
+            spent = OutPoint(txs.back().getTxid(), 0);
+        }
+    }
+    Block block(txs, "0");
+
+    BlockValidator validator(utxos);
+    ASSERT_EQ(validator.check(block), BlockValidator::Result::Valid);
+    EXPECT_EQ(validator.getSpentOutputs().size(), txs.size());
+    EXPECT_TRUE(connectBothWays(utxos, block));
+}
+
+TEST(BlockValidatorTest, RejectsDoubleSpendWithinBlock) {
+    Transaction funding;
+    UTXOSet utxos = makeFundedSet(funding, 100);
+
+    std::vector<Transaction> txs;
+    for (uint32_t i = 0; i < 80; ++i) {
+        txs.push_back(makeTx({OutPoint(funding.getTxid(), i)}, {100}, i + 10));
+    }
+    // Spends the output already spent by transaction 7
+    txs.push_back(makeTx({OutPoint(funding.getTxid(), 7)}, {50}, 500));
+    Block block(txs, "0");
+
+    BlockValidator validator(utxos);
+    ASSERT_EQ(validator.check(block), BlockValidator::Result::Invalid);
+    EXPECT_EQ(validator.getFirstInvalid(), 80u);
+    EXPECT_FALSE(connectBothWays(utxos, block));
+}
+
+TEST(BlockValidatorTest, RejectsSpendOfLaterTransaction) {
+    Transaction funding;
+    UTXOSet utxos = makeFundedSet(funding, 100);
+
+    std::vector<Transaction> txs;
+    for (uint32_t i = 0; i < 80; ++i) {
+        txs.push_back(makeTx({OutPoint(funding.getTxid(), i)}, {100}, i + 10));
+    }
+    // Transaction 3 spends the output of transaction 50
+    txs[3] = makeTx({OutPoint(txs[50].getTxid(), 0)}, {100}, 600);
+    Block block(txs, "0");
+
+    BlockValidator validator(utxos);
+    ASSERT_EQ(validator.check(block), BlockValidator::Result::Invalid);
+    EXPECT_EQ(validator.getFirstInvalid(), 3u);
+    EXPECT_FALSE(connectBothWays(utxos, block));
+}
+
+TEST(BlockValidatorTest, RepeatedTxidIsLeftToSequentialPass) {
+    Transaction funding;
+    UTXOSet utxos = makeFundedSet(funding, 100);
+
+    std::vector<Transaction> txs;
+    for (uint32_t i = 0; i < 80; ++i) {
+        txs.push_back(makeTx({OutPoint(funding.getTxid(), i)}, {100}, i + 10));
+    }
+    // Spending the output of transaction 5 lets a copy of it be created again
+    txs.push_back(makeTx({OutPoint(txs[5].getTxid(), 0)}, {100}, 700));
+    txs.push_back(txs[5]);
+    Block block(txs, "0");
+
+    BlockValidator validator(utxos);
+    EXPECT_EQ(validator.check(block), BlockValidator::Result::Unsupported);
+    // connectBlock() falls back to the sequential pass, which rejects the
+    // copy because its input is already spent
+    EXPECT_FALSE(connectBothWays(utxos, block));
+}
+
+// ====================================================================
+//  Equivalence Tests
+// ====================================================================
+
+TEST(BlockValidatorTest, MatchesSequentialPassOnRandomBlocks) {
+    Transaction funding;
+    UTXOSet utxos = makeFundedSet(funding, 2000);
+    std::mt19937_64 random(7);
+    size_t accepted = 0;
+    ThreadPool pool(4);
+
+    for (int round = 0; round < 40; ++round) {
+        // Outputs transactions may spend: funding outputs and outputs created
+        // earlier in the block, plus a few that don't exist
+        std::vector<std::pair<OutPoint, uint64_t>> spendable;
+        for (uint32_t i = 0; i < 2000; ++i) {
+            spendable.emplace_back(OutPoint(funding.getTxid(), i), 100);
+        }
+        std::vector<std::pair<OutPoint, uint64_t>> alreadySpent;
+        std::vector<Transaction> txs;
+        for (int t = 0; t < 200; ++t) {
+            std::vector<OutPoint> spent;
+            uint64_t valueIn = 0;
+            const size_t inputs = 1 + random() % 3;
+            for (size_t i = 0; i < inputs; ++i) {
+                // Mostly recent outputs, so chains form; a rare reuse is a
+                // double-spend
+                std::pair<OutPoint, uint64_t> pick = spendable.back();
+                if (!alreadySpent.empty() && random() % 1000 == 0) {
+                    pick = alreadySpent[random() % alreadySpent.size()];
+                } else {
+                    const size_t index = spendable.size() - 1 - random() % std::min<size_t>(spendable.size(), 50);
+                    pick = spendable[index];
+                    spendable.erase(spendable.begin() + index);
+                    alreadySpent.push_back(pick);
+                }
+                spent.push_back(pick.first);
+                valueIn += pick.second;
+                if (random() % 4000 == 0) {
+                    spent.back() = OutPoint(std::string(64, 'e'), 0);
+                }
+            }
+            // Rarely spend more than the inputs
+            const uint64_t valueOut = random() % 3000 == 0 ? valueIn + 1 : valueIn;
+            txs.push_back(makeTx(spent, {valueOut / 2, valueOut - valueOut / 2},
+                                 100000 * round + t + 10));
+            for (uint32_t i = 0; i < 2; ++i) {
+                spendable.emplace_back(OutPoint(txs.back().getTxid(), i), txs.back().getOutputs()[i].amount);
+            }
+        }
+        const Block block(txs, "0");
+        BlockValidator validator(utxos, pool);
+        const bool valid = validator.check(block) == BlockValidator::Result::Valid;
+        EXPECT_EQ(valid, connectBothWays(utxos, block));
+        if (valid) {
+            ++accepted;
+        }
+    }
+    // Both outcomes are covered
+    EXPECT_GT(accepted, 0u);
+    EXPECT_LT(accepted, 40u);
+}
@@ -0,0 +1,358 @@
+#include "gtest/gtest.h"
+#include "Blockchain.h"
+#include "Checksum.h"
+#include "Encoding.h"
+#include <cstdio>
+#include <sstream>
+#include <vector>
+
+// Helper: coinbase transaction paying `amount` to `owner`
+static Transaction makeCoinbase(const std::string& owner, uint64_t amount = 50) {
+    TxIn in(std::string(64, '0'), 0, "coinbase_" + owner, "");
+    TxOut out(amount, owner);
+    return Transaction({in}, {out});
+}
+
+// Helper: mined block at difficulty 1 on top of prevHash
+static Block makeBlock(const std::string& prevHash, const std::vector<Transaction>& txs) {
+    Block block(txs, prevHash);
+    block.setHeader(BlockHeader(1, prevHash, "", 0, 0, 1));
+    block.computeMerkleRoot();
+    block.mine();
+    return block;
+}
+
+// ====================================================================
+//  Chain Extension Tests
+// ====================================================================
+
+TEST(BlockchainTest, StartsWithGenesisBlock) {
+    Blockchain chain;
+
+    EXPECT_EQ(chain.getHeight(), 0);
+    EXPECT_TRUE(chain.isInActiveChain(chain.getLatestBlock().getHash()));
+}
+
+TEST(BlockchainTest, AddBlockExtendsTip) {
+    Blockchain chain;
+    Block block = makeBlock(chain.getLatestBlock().getHash(), {makeCoinbase("alice")});
+
+    ASSERT_TRUE(chain.addBlock(block));
+
+    EXPECT_EQ(chain.getHeight(), 1);
+    EXPECT_EQ(chain.getLatestBlock().getHash(), block.getHash());
+    EXPECT_NE(chain.getUTXOSet().find(OutPoint(block.getTransactions()[0].getTxid(), 0)), nullptr);
+}
+
+TEST(BlockchainTest, RejectsUnknownParentAndDuplicates) {
+    Blockchain chain;
+    Block orphan = makeBlock(std::string(64, 'f'), {makeCoinbase("alice")});
+    Block block = makeBlock(chain.getLatestBlock().getHash(), {makeCoinbase("bob")});
+
+    EXPECT_FALSE(chain.addBlock(orphan));
+    EXPECT_TRUE(chain.addBlock(block));
+    EXPECT_FALSE(chain.addBlock(block));
+    EXPECT_EQ(chain.getHeight(), 1);
+}
+
+TEST(BlockchainTest, RejectsUnprovenWorkAndWrongMerkleRoot) {
+    Blockchain chain;
+    const std::string genesis = chain.getLatestBlock().getHash();
+
+    // Claims 16^15 hashes of work without being mined
+    Block heavy({makeCoinbase("heavy")}, genesis);
+    heavy.setHeader(BlockHeader(1, genesis, "", 0, 0, 15));
+    heavy.computeMerkleRoot();
+    heavy.computeHash();
+    Blockchain::AddResult result = chain.addBlock(heavy);
+    EXPECT_FALSE(result.accepted);
+    EXPECT_FALSE(result.tipChanged);
+    EXPECT_FALSE(chain.hasBlock(heavy.getHash()));
+
+    // Mined, but the hash no longer matches the content
+    Block altered = makeBlock(genesis, {makeCoinbase("altered")});
+    altered.setNonce(altered.getHeader().nonce + 1);
+    EXPECT_FALSE(chain.addBlock(altered));
+
+    // Mined over a Merkle root that is not the one of its transactions
+    Block wrongRoot({makeCoinbase("root")}, genesis);
+    wrongRoot.setHeader(BlockHeader(1, genesis, std::string(64, 'e'), 0, 0, 1));
+    wrongRoot.mine();
+    EXPECT_FALSE(chain.addBlock(wrongRoot));
+
+    EXPECT_EQ(chain.getLatestBlock().getHash(), genesis);
+    Block block = makeBlock(genesis, {makeCoinbase("alice")});
+    EXPECT_TRUE(chain.addBlock(block).tipChanged);
+}
+
+TEST(BlockchainTest, RejectsSpendOfMissingOutput) {
+    Blockchain chain;
+    Transaction spend({TxIn(std::string(64, 'a'), 0, "sig", "pk")}, {TxOut(10, "bob")});
+    Block block = makeBlock(chain.getLatestBlock().getHash(), {spend});
+
+    EXPECT_FALSE(chain.addBlock(block));
+    EXPECT_EQ(chain.getHeight(), 0);
+}
+
+// ====================================================================
+//  Fork Choice Tests
+// ====================================================================
+
+TEST(BlockchainTest, SideBranchWithEqualWorkIsKeptButNotActive) {
+    Blockchain chain;
+    const std::string genesis = chain.getLatestBlock().getHash();
+    Block a1 = makeBlock(genesis, {makeCoinbase("a1")});
+    Block b1 = makeBlock(genesis, {makeCoinbase("b1")});
+
+    ASSERT_TRUE(chain.addBlock(a1));
+    ASSERT_TRUE(chain.addBlock(b1));
+
+    EXPECT_TRUE(chain.hasBlock(b1.getHash()));
+    EXPECT_TRUE(chain.isInActiveChain(a1.getHash()));
+    EXPECT_FALSE(chain.isInActiveChain(b1.getHash()));
+}
+
+TEST(BlockchainTest, ReorganizesToHeavierBranchAndRestoresState) {
+    Blockchain chain;
+    const std::string genesis = chain.getLatestBlock().getHash();
+
+    // Branch A: a coinbase, then a block spending it
+    Transaction cbA = makeCoinbase("a1");
+    Block a1 = makeBlock(genesis, {cbA});
+    Transaction spendA({TxIn(cbA.getTxid(), 0, "sig", "pk")}, {TxOut(50, "carol")});
+    Block a2 = makeBlock(a1.getHash(), {makeCoinbase("a2"), spendA});
+    ASSERT_TRUE(chain.addBlock(a1));
+    ASSERT_TRUE(chain.addBlock(a2));
+    EXPECT_EQ(chain.getUTXOSet().find(OutPoint(cbA.getTxid(), 0)), nullptr);
+
+    // Branch B overtakes A
+    Block b1 = makeBlock(genesis, {makeCoinbase("b1")});
+    Block b2 = makeBlock(b1.getHash(), {makeCoinbase("b2")});
+    Block b3 = makeBlock(b2.getHash(), {makeCoinbase("b3")});
+    ASSERT_TRUE(chain.addBlock(b1));
+    ASSERT_TRUE(chain.addBlock(b2));
+    EXPECT_TRUE(chain.isInActiveChain(a2.getHash()));
+    ASSERT_TRUE(chain.addBlock(b3));
+
+    EXPECT_EQ(chain.getHeight(), 3);
+    EXPECT_EQ(chain.getLatestBlock().getHash(), b3.getHash());
+    EXPECT_FALSE(chain.isInActiveChain(a1.getHash()));
+    EXPECT_EQ(chain.getUTXOSet().find(OutPoint(spendA.getTxid(), 0)), nullptr);
+    EXPECT_EQ(chain.getUTXOSet().size(), 3u);
+
+    // Branch A comes back
+    Block a3 = makeBlock(a2.getHash(), {makeCoinbase("a3")});
+    Block a4 = makeBlock(a3.getHash(), {makeCoinbase("a4")});
+    ASSERT_TRUE(chain.addBlock(a3));
+    ASSERT_TRUE(chain.addBlock(a4));
+
+    EXPECT_EQ(chain.getLatestBlock().getHash(), a4.getHash());
+    EXPECT_EQ(chain.getUTXOSet().find(OutPoint(cbA.getTxid(), 0)), nullptr);
+    EXPECT_NE(chain.getUTXOSet().find(OutPoint(spendA.getTxid(), 0)), nullptr);
+    EXPECT_EQ(chain.getUTXOSet().size(), 4u);
+}
+
+TEST(BlockchainTest, InvalidHeavierBranchDoesNotReplaceActiveChain) {
+    Blockchain chain;
+    const std::string genesis = chain.getLatestBlock().getHash();
+
+    Block a1 = makeBlock(genesis, {makeCoinbase("a1")});
+    ASSERT_TRUE(chain.addBlock(a1));
+
+    Transaction badSpend({TxIn(std::string(64, 'b'), 0, "sig", "pk")}, {TxOut(1, "eve")});
+    Block b1 = makeBlock(genesis, {makeCoinbase("b1")});
+    Block b2 = makeBlock(b1.getHash(), {badSpend});
+    ASSERT_TRUE(chain.addBlock(b1));
+    Blockchain::AddResult result = chain.addBlock(b2);
+    EXPECT_FALSE(result.accepted);
+    EXPECT_FALSE(result.tipChanged);
+
+    EXPECT_EQ(chain.getLatestBlock().getHash(), a1.getHash());
+    EXPECT_NE(chain.getUTXOSet().find(OutPoint(a1.getTransactions()[0].getTxid(), 0)), nullptr);
+
+    // Nothing can be built on the invalid block
+    Block b3 = makeBlock(b2.getHash(), {makeCoinbase("b3")});
+    EXPECT_FALSE(chain.addBlock(b3));
+}
+
+// ====================================================================
+//  Pruning Tests
+// ====================================================================
+
+TEST(BlockchainTest, PruningDropsDeepBodiesAndKeepsValidating) {
+    Blockchain chain;
+    chain.enablePruning(2);
+
+    // a1 pays alice; its output is spent four blocks later
+    Transaction cb = makeCoinbase("alice");
+    std::vector<Block> blocks = {makeBlock(chain.getLatestBlock().getHash(), {cb})};
+    ASSERT_TRUE(chain.addBlock(blocks.back()));
+    for (int i = 2; i <= 4; ++i) {
+        blocks.push_back(makeBlock(blocks.back().getHash(), {makeCoinbase("miner" + std::to_string(i))}));
+        ASSERT_TRUE(chain.addBlock(blocks.back()));
+    }
+    EXPECT_TRUE(chain.isPruned(blocks[0].getHash()));
+    EXPECT_TRUE(chain.getBlock(1).getTransactions().empty());
+    EXPECT_EQ(chain.findBlock(blocks[0].getHash()), nullptr);
+    EXPECT_FALSE(chain.isPruned(blocks[1].getHash()));
+    EXPECT_NE(chain.findBlock(blocks[3].getHash()), nullptr);
+
+    // The UTXO set still validates spends of outputs from pruned blocks
+    Transaction spend({TxIn(cb.getTxid(), 0, "sig", "pk")}, {TxOut(50, "bob")});
+    ASSERT_TRUE(chain.addBlock(makeBlock(blocks.back().getHash(), {makeCoinbase("miner5"), spend})));
+    EXPECT_EQ(chain.getUTXOSet().find(OutPoint(cb.getTxid(), 0)), nullptr);
+    Transaction doubleSpend({TxIn(cb.getTxid(), 0, "sig", "pk")}, {TxOut(50, "eve")});
+    EXPECT_FALSE(chain.addBlock(makeBlock(chain.getLatestBlock().getHash(), {doubleSpend})));
+    EXPECT_EQ(chain.getHeight(), 5u);
+}
+
+TEST(BlockchainTest, PruningRejectsReorgBelowPrunedBlocks) {
+    Blockchain chain;
+    const std::string genesis = chain.getLatestBlock().getHash();
+    chain.enablePruning(1);
+
+    Block a1 = makeBlock(genesis, {makeCoinbase("a1")});
+    Block a2 = makeBlock(a1.getHash(), {makeCoinbase("a2")});
+    Block a3 = makeBlock(a2.getHash(), {makeCoinbase("a3")});
+    ASSERT_TRUE(chain.addBlock(a1));
+    ASSERT_TRUE(chain.addBlock(a2));
+    ASSERT_TRUE(chain.addBlock(a3));
+    ASSERT_TRUE(chain.isPruned(a1.getHash()));
+
+    // A heavier branch forking at genesis would have to disconnect a1
+    std::vector<Block> branch = {makeBlock(genesis, {makeCoinbase("b1")})};
+    for (int i = 2; i <= 4; ++i) {
+        branch.push_back(makeBlock(branch.back().getHash(), {makeCoinbase("b" + std::to_string(i))}));
+    }
+    for (const auto& block : branch) {
+        chain.addBlock(block);
+    }
+    EXPECT_EQ(chain.getLatestBlock().getHash(), a3.getHash());
+
+    // Reorgs above the pruned blocks still work
+    Block c3 = makeBlock(a2.getHash(), {makeCoinbase("c3")});
+    Block c4 = makeBlock(c3.getHash(), {makeCoinbase("c4")});
+    ASSERT_TRUE(chain.addBlock(c3));
+    ASSERT_TRUE(chain.addBlock(c4));
+    EXPECT_EQ(chain.getLatestBlock().getHash(), c4.getHash());
+}
+
+TEST(BlockchainTest, PruningKeepsBodiesWithinBudget) {
+    Blockchain chain;
+    Block block = makeBlock(chain.getLatestBlock().getHash(), {makeCoinbase("miner-a")});
+    ASSERT_TRUE(chain.addBlock(block));
+    const uint64_t blockBytes = chain.getBodyBytes();
+
+    // Room for three blocks, however deep
+    chain.enablePruning(1000, 3 * blockBytes);
+    for (int i = 2; i <= 10; ++i) {
+        // Owners of the same length keep every block the same size
+        block = makeBlock(block.getHash(), {makeCoinbase(std::string("miner-") + char('a' + i))});
+        ASSERT_TRUE(chain.addBlock(block));
+        EXPECT_LE(chain.getBodyBytes(), 3 * blockBytes);
+    }
+    EXPECT_FALSE(chain.isPruned(chain.getBlock(8).getHash()));
+    EXPECT_TRUE(chain.isPruned(chain.getBlock(7).getHash()));
+}
+
+// ====================================================================
+//  Block Template Tests
+// ====================================================================
+
+TEST(BlockchainTest, CreateBlockFillsByteBudget) {
+    Blockchain chain;
+    Transaction small = makeCoinbase("small");
+    Transaction large = makeCoinbase(std::string(500, 'l'));
+    Transaction child({TxIn(large.getTxid(), 0, "sig", "pk")}, {TxOut(50, "carol")});
+    Transaction last = makeCoinbase("last");
+    const uint64_t budget = small.getEncodedSize() + child.getEncodedSize() + last.getEncodedSize();
+
+    // The large transaction doesn't fit, and its child can't go without it
+    Block block = chain.createBlock({small, large, child, last}, budget);
+    ASSERT_EQ(block.getTransactions().size(), 2u);
+    EXPECT_EQ(block.getTransactions()[0].getTxid(), small.getTxid());
+    EXPECT_EQ(block.getTransactions()[1].getTxid(), last.getTxid());
+    EXPECT_LE(block.getTransactionBytes(), budget);
+
+    std::string encoded;
+    block.encode(encoded);
+    EXPECT_EQ(block.getEncodedSize(), encoded.size());
+    EXPECT_EQ(chain.createBlock({small, large, child, last}).getTransactions().size(), 4u);
+}
+
+// ====================================================================
+//  Export Tests
+// ====================================================================
+
+// Helper: chain of count blocks on top of the genesis block
+static void extendChain(Blockchain& chain, int count) {
+    for (int i = 0; i < count; ++i) {
+        Block block = makeBlock(chain.getLatestBlock().getHash(),
+                                {makeCoinbase(std::string("miner-") + char('a' + i))});
+        ASSERT_TRUE(chain.addBlock(block));
+    }
+}
+
+TEST(BlockchainTest, BinaryExportOfRangeDecodesToSameBlocks) {
+    Blockchain chain;
+    extendChain(chain, 4);
+
+    std::ostringstream out;
+    ASSERT_TRUE(chain.exportBlocks(out, Blockchain::ExportFormat::Binary, 2, 3));
+    const std::string exported = out.str();
+    ASSERT_EQ(exported.compare(0, 8, Blockchain::BinaryExportMagic), 0);
+
+    ByteReader reader(exported.data() + 8, exported.size() - 8);
+    for (uint64_t height = 2; height <= 3; ++height) {
+        uint32_t size, crc;
+        ASSERT_TRUE(reader.readU32(size) && reader.readU32(crc));
+        ASSERT_LE(size, reader.remaining());
+        const char* record = exported.data() + exported.size() - reader.remaining();
+        EXPECT_EQ(crc32(record, size), crc);
+        Block block("");
+        ASSERT_TRUE(Block::decode(reader, block));
+        EXPECT_EQ(block.getHash(), chain.getBlock(height).getHash());
+        EXPECT_EQ(block.getTransactions().size(), 1u);
+    }
+    EXPECT_TRUE(reader.atEnd());
+    // The streamed serialization matches the string one
+    std::ostringstream serialized;
+    chain.serialize(serialized);
+    EXPECT_EQ(serialized.str(), chain.serialize());
+}
+
+TEST(BlockchainTest, TextExportToFileDescriptor) {
+    Blockchain chain;
+    extendChain(chain, 3);
+    FILE* file = std::tmpfile();
+    ASSERT_NE(file, nullptr);
+
+    // The range is capped at the tip
+    ASSERT_TRUE(chain.exportBlocks(fileno(file), Blockchain::ExportFormat::Text, 2));
+    std::rewind(file);
+    std::string text;
+    char buffer[4096];
+    size_t read;
+    while ((read = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        text.append(buffer, read);
+    }
+    std::fclose(file);
+
+    EXPECT_EQ(text.find("Height: 1\n"), std::string::npos);
+    EXPECT_NE(text.find("Height: 2\n"), std::string::npos);
+    EXPECT_NE(text.find("Height: 3\n"), std::string::npos);
+    EXPECT_NE(text.find(chain.getBlock(3).getTransactions()[0].getTxid()), std::string::npos);
+}
+
+TEST(BlockchainTest, BinaryExportStopsAtPrunedBlocks) {
+    Blockchain chain;
+    extendChain(chain, 4);
+    chain.enablePruning(2);
+
+    std::ostringstream out;
+    EXPECT_TRUE(chain.exportBlocks(out, Blockchain::ExportFormat::Binary, 3));
+    EXPECT_FALSE(chain.exportBlocks(out, Blockchain::ExportFormat::Binary, 1));
+    std::ostringstream text;
+    EXPECT_TRUE(chain.exportBlocks(text, Blockchain::ExportFormat::Text));
+    EXPECT_NE(text.str().find("Transactions: pruned"), std::string::npos);
+}
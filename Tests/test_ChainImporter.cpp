@@ -0,0 +1,157 @@
+#include "gtest/gtest.h"
+#include "ChainImporter.h"
+#include "Checksum.h"
+#include "Encoding.h"
+#include "SignatureCache.h"
+#include <openssl/ec.h>
+#include <openssl/x509.h>
+#include <sstream>
+#include <vector>
+
+// Helper: coinbase transaction paying `amount` to `owner`
+static Transaction makeCoinbase(const std::string& owner, uint64_t amount = 50) {
+    TxIn in(std::string(64, '0'), 0, "coinbase_" + owner, "");
+    TxOut out(amount, owner);
+    return Transaction({in}, {out});
+}
+
+// Helper: mined block at difficulty 1 on top of prevHash
+static Block makeBlock(const std::string& prevHash, const std::vector<Transaction>& txs) {
+    Block block(txs, prevHash);
+    block.setHeader(BlockHeader(1, prevHash, "", 0, 0, 1));
+    block.computeMerkleRoot();
+    block.mine();
+    return block;
+}
+
+// Helper: chain of count blocks, each spending the previous coinbase
+static void extendChain(Blockchain& chain, int count) {
+    for (int i = 0; i < count; ++i) {
+        std::vector<Transaction> txs{makeCoinbase("miner-" + std::to_string(i))};
+        if (i > 0) {
+            const Transaction& prev = chain.getLatestBlock().getTransactions()[0];
+            txs.push_back(Transaction({TxIn(prev.getTxid(), 0, "sig", "pk")}, {TxOut(50, "carol")}));
+        }
+        ASSERT_TRUE(chain.addBlock(makeBlock(chain.getLatestBlock().getHash(), txs)));
+    }
+}
+
+// Helper: binary export record of block
+static std::string makeRecord(const Block& block) {
+    std::string encoded, record;
+    block.encode(encoded);
+    ByteWriter writer(record);
+    writer.writeU32(static_cast<uint32_t>(encoded.size()));
+    writer.writeU32(crc32(encoded.data(), encoded.size()));
+    return record + encoded;
+}
+
+// Small queues and several threads per stage, so blocks wait and reorder
+static ImportConfig smallConfig() {
+    ImportConfig config;
+    config.hashThreads = 3;
+    config.signatureThreads = 3;
+    config.queueDepth = 2;
+    config.maxBlocksInFlight = 4;
+    return config;
+}
+
+// ====================================================================
+//  Import Tests
+// ====================================================================
+
+TEST(ChainImporterTest, ImportsExportedChainIntoFreshChain) {
+    Blockchain source;
+    extendChain(source, 30);
+    std::stringstream file;
+    ASSERT_TRUE(source.exportBlocks(file, Blockchain::ExportFormat::Binary));
+
+    Blockchain chain(source.getBlock(0));
+    ChainImporter importer(chain, nullptr, smallConfig());
+    ASSERT_TRUE(importer.import(file));
+
+    EXPECT_EQ(importer.getBlocksConnected(), 30u);
+    EXPECT_EQ(importer.getBlocksSkipped(), 1u);
+    EXPECT_EQ(importer.getBytesRead(), file.str().size());
+    EXPECT_EQ(chain.getHeight(), 30u);
+    EXPECT_EQ(chain.getLatestBlock().getHash(), source.getLatestBlock().getHash());
+    EXPECT_EQ(chain.getUTXOSet().size(), source.getUTXOSet().size());
+}
+
+TEST(ChainImporterTest, StopsAtCorruptRecordAfterEarlierBlocks) {
+    Blockchain source;
+    extendChain(source, 10);
+    std::stringstream exported;
+    ASSERT_TRUE(source.exportBlocks(exported, Blockchain::ExportFormat::Binary));
+
+    // Damage the payload of block 6
+    std::string bytes = exported.str();
+    size_t offset = 8;
+    for (int height = 0; height < 6; ++height) {
+        ByteReader reader(bytes.data() + offset, 4);
+        uint32_t size;
+        ASSERT_TRUE(reader.readU32(size));
+        offset += 8 + size;
+    }
+    bytes[offset + 8 + 10] ^= 0x01;
+    std::stringstream file(bytes);
+
+    Blockchain chain(source.getBlock(0));
+    ChainImporter importer(chain, nullptr, smallConfig());
+    EXPECT_FALSE(importer.import(file));
+    EXPECT_EQ(chain.getHeight(), 5u);
+}
+
+TEST(ChainImporterTest, RejectsBlockNotMatchingItsMerkleRoot) {
+    Blockchain source;
+    extendChain(source, 2);
+    Block bad(std::vector<Transaction>{makeCoinbase("bad")}, source.getLatestBlock().getHash());
+    bad.setHeader(BlockHeader(1, source.getLatestBlock().getHash(), std::string(64, 'e'), 0, 0, 1));
+    bad.mine();
+    Block after = makeBlock(bad.getHash(), {makeCoinbase("after")});
+
+    std::stringstream file;
+    ASSERT_TRUE(source.exportBlocks(file, Blockchain::ExportFormat::Binary));
+    file << makeRecord(bad) << makeRecord(after);
+
+    Blockchain chain(source.getBlock(0));
+    ChainImporter importer(chain, nullptr, smallConfig());
+    EXPECT_FALSE(importer.import(file));
+    EXPECT_EQ(chain.getHeight(), 2u);
+    EXPECT_FALSE(chain.hasBlock(bad.getHash()));
+}
+
+TEST(ChainImporterTest, SignatureStageFillsTheChainsCache) {
+    EVP_PKEY* key = EVP_EC_gen("secp256k1");
+    unsigned char* der = nullptr;
+    int length = i2d_PUBKEY(key, &der);
+    const std::string publicKey(reinterpret_cast<char*>(der), length);
+    OPENSSL_free(der);
+    const std::string owner = Transaction::hashPublicKey(publicKey);
+
+    // Every block spends the previous block's coinbase with a signature
+    Blockchain source;
+    for (int i = 0; i < 8; ++i) {
+        std::vector<Transaction> txs{makeCoinbase(owner + std::to_string(i))};
+        txs[0].setOutput(0, TxOut(txs[0].getOutputs()[0].amount, owner));
+        if (i > 0) {
+            const Transaction& prev = source.getLatestBlock().getTransactions()[0];
+            txs.push_back(Transaction({TxIn(prev.getTxid(), 0, "", publicKey)}, {TxOut(50, "carol")}));
+            ASSERT_TRUE(txs.back().signInput(0, key));
+        }
+        ASSERT_TRUE(source.addBlock(makeBlock(source.getLatestBlock().getHash(), txs)));
+    }
+    EVP_PKEY_free(key);
+    std::stringstream file;
+    ASSERT_TRUE(source.exportBlocks(file, Blockchain::ExportFormat::Binary));
+
+    SignatureCache cache;
+    Blockchain chain(source.getBlock(0));
+    chain.enableSignatureChecks(&cache);
+    ChainImporter importer(chain, &cache, smallConfig());
+    ASSERT_TRUE(importer.import(file));
+    EXPECT_EQ(chain.getHeight(), 8u);
+    EXPECT_EQ(cache.size(), 7u);
+    EXPECT_EQ(cache.hits(), 7u);
+    EXPECT_EQ(cache.misses(), 0u);
+}
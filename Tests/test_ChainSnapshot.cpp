@@ -0,0 +1,141 @@
+#include "gtest/gtest.h"
+#include "Blockchain.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Helper: coinbase transaction paying `amount` to `owner`
+static Transaction makeCoinbase(const std::string& owner, uint64_t amount = 50) {
+    TxIn in(std::string(64, '0'), 0, "coinbase_" + owner, "");
+    TxOut out(amount, owner);
+    return Transaction({in}, {out});
+}
+
+// Helper: mined block at difficulty 1 on top of prevHash
+static Block makeBlock(const std::string& prevHash, const std::string& owner) {
+    Block block({makeCoinbase(owner)}, prevHash);
+    block.setHeader(BlockHeader(1, prevHash, "", 0, 0, 1));
+    block.computeMerkleRoot();
+    block.mine();
+    return block;
+}
+
+// ====================================================================
+//  Epoch Tests
+// ====================================================================
+
+TEST(EpochManagerTest, ReclaimWaitsForEarlierReaders) {
+    EpochManager epochs;
+    int reclaimed = 0;
+
+    const size_t early = epochs.pin();
+    epochs.retire([&] { ++reclaimed; });
+    // Pinned after the retirement: can't hold what was retired
+    const size_t late = epochs.pin();
+    EXPECT_EQ(epochs.collect(), 0u);
+    EXPECT_EQ(epochs.pending(), 1u);
+
+    epochs.unpin(early);
+    EXPECT_EQ(epochs.collect(), 1u);
+    EXPECT_EQ(reclaimed, 1);
+    epochs.unpin(late);
+}
+
+// ====================================================================
+//  Snapshot Tests
+// ====================================================================
+
+TEST(ChainSnapshotTest, SnapshotIgnoresLaterBlocks) {
+    Blockchain chain;
+    ASSERT_TRUE(chain.addBlock(makeBlock(chain.getLatestBlock().getHash(), "a1")));
+    const ChainSnapshot before = chain.snapshot();
+    ASSERT_TRUE(chain.addBlock(makeBlock(chain.getLatestBlock().getHash(), "a2")));
+
+    EXPECT_EQ(before.getHeight(), 1u);
+    EXPECT_EQ(before.getTipHash(), chain.getBlock(1).getHash());
+    EXPECT_EQ(before.getBlock(2), nullptr);
+    EXPECT_EQ(before.getChainWork(), chain.getChainWork() - 16);
+
+    const ChainSnapshot after = chain.snapshot();
+    EXPECT_EQ(after.getHeight(), 2u);
+    EXPECT_EQ(after.getBlock(2), &chain.getBlock(2));
+    EXPECT_EQ(after.getHeader(0).hashPrevBlock, chain.getBlock(0).getHeader().hashPrevBlock);
+}
+
+TEST(ChainSnapshotTest, SnapshotKeepsReorganizedBranch) {
+    Blockchain chain;
+    const std::string genesis = chain.getLatestBlock().getHash();
+    Block a1 = makeBlock(genesis, "a1");
+    ASSERT_TRUE(chain.addBlock(a1));
+    const ChainSnapshot before = chain.snapshot();
+
+    Block b1 = makeBlock(genesis, "b1");
+    ASSERT_TRUE(chain.addBlock(b1));
+    ASSERT_TRUE(chain.addBlock(makeBlock(b1.getHash(), "b2")));
+
+    EXPECT_EQ(before.getTipHash(), a1.getHash());
+    ASSERT_NE(before.getBlock(1), nullptr);
+    EXPECT_EQ(before.getBlock(1)->getTransactions()[0].getOutputs()[0].publicKeyHash, "a1");
+    const ChainSnapshot after = chain.snapshot();
+    EXPECT_EQ(after.getBlock(1)->getHash(), b1.getHash());
+    EXPECT_EQ(after.getHeight(), 2u);
+}
+
+TEST(ChainSnapshotTest, PrunedBodiesOutliveEarlierSnapshots) {
+    Blockchain chain;
+    ASSERT_TRUE(chain.addBlock(makeBlock(chain.getLatestBlock().getHash(), "a1")));
+    {
+        const ChainSnapshot before = chain.snapshot();
+        chain.enablePruning(1);
+        ASSERT_TRUE(chain.addBlock(makeBlock(chain.getLatestBlock().getHash(), "a2")));
+        ASSERT_TRUE(chain.addBlock(makeBlock(chain.getLatestBlock().getHash(), "a3")));
+
+        // Block 1 is pruned for new snapshots, still readable by the old one
+        EXPECT_EQ(chain.snapshot().getBlock(1), nullptr);
+        EXPECT_EQ(chain.snapshot().getPrunedHeight(), 2u);
+        ASSERT_NE(before.getBlock(1), nullptr);
+        EXPECT_EQ(before.getBlock(1)->getTransactions().size(), 1u);
+    }
+    // Freed by the next change once the old snapshot is gone
+    ASSERT_TRUE(chain.addBlock(makeBlock(chain.getLatestBlock().getHash(), "a4")));
+    EXPECT_TRUE(chain.getBlock(1).getTransactions().empty());
+    EXPECT_TRUE(chain.isPruned(chain.getBlock(1).getHash()));
+}
+
+TEST(ChainSnapshotTest, ReadersSeeConsistentChainsDuringAppends) {
+    Blockchain chain;
+    std::vector<Block> blocks;
+    std::string prevHash = chain.getLatestBlock().getHash();
+    for (int i = 0; i < 300; ++i) {
+        blocks.push_back(makeBlock(prevHash, "miner_" + std::to_string(i)));
+        prevHash = blocks.back().getHash();
+    }
+
+    std::atomic<bool> done(false);
+    std::atomic<int> inconsistent(0);
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&] {
+            uint64_t lastHeight = 0;
+            while (!done.load()) {
+                const ChainSnapshot snapshot = chain.snapshot();
+                const uint64_t height = snapshot.getHeight();
+                if (height < lastHeight ||
+                    (height > 0 && snapshot.getHeader(height).hashPrevBlock !=
+                                       snapshot.getBlock(height - 1)->getHash())) {
+                    ++inconsistent;
+                }
+                lastHeight = height;
+            }
+        });
+    }
+    for (const Block& block : blocks) {
+        ASSERT_TRUE(chain.addBlock(block));
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(inconsistent.load(), 0);
+    EXPECT_EQ(chain.snapshot().getHeight(), 300u);
+}
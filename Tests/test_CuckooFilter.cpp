@@ -0,0 +1,170 @@
+#include "gtest/gtest.h"
+#include "Encoding.h"
+#include "KnownTxids.h"
+#include <random>
+
+// Helper: transaction with a null input, valid without funding
+static Transaction makeTransaction(const std::string& tag) {
+    TxIn in(std::string(64, '0'), 0, tag, "");
+    TxOut out(1, "dest_" + tag);
+    return Transaction({in}, {out}, 1000);
+}
+
+// Helper: mined block at difficulty 1 on top of prevHash
+static Block makeBlock(const std::string& prevHash, const std::vector<Transaction>& txs) {
+    Block block(txs, prevHash);
+    block.setHeader(BlockHeader(1, prevHash, "", 0, 0, 1));
+    block.computeMerkleRoot();
+    block.mine();
+    return block;
+}
+
+// ====================================================================
+//  Cuckoo Filter Tests
+// ====================================================================
+
+TEST(CuckooFilterTest, NoFalseNegativesAndFewFalsePositives) {
+    CuckooFilter filter(100000);
+    std::mt19937_64 random(1);
+    std::vector<uint64_t> keys(100000);
+    for (auto& key : keys) {
+        key = random();
+        ASSERT_TRUE(filter.insert(key));
+    }
+    for (uint64_t key : keys) {
+        EXPECT_TRUE(filter.contains(key));
+    }
+
+    size_t falsePositives = 0;
+    for (int i = 0; i < 1000000; ++i) {
+        falsePositives += filter.contains(random());
+    }
+    // About 8 / 65536 at full load
+    EXPECT_LT(falsePositives, 500u);
+    EXPECT_EQ(filter.size(), keys.size());
+}
+
+TEST(CuckooFilterTest, EraseRemovesOneCopy) {
+    CuckooFilter filter;
+    filter.insert(42);
+    filter.insert(42);
+
+    EXPECT_TRUE(filter.erase(42));
+    EXPECT_TRUE(filter.contains(42));
+    EXPECT_TRUE(filter.erase(42));
+    EXPECT_FALSE(filter.contains(42));
+    EXPECT_FALSE(filter.erase(42));
+    EXPECT_EQ(filter.size(), 0u);
+}
+
+TEST(CuckooFilterTest, FullFilterKeepsEveryKey) {
+    CuckooFilter filter(64);
+    std::mt19937_64 random(2);
+    std::vector<uint64_t> keys;
+    while (keys.size() < 1000) {
+        keys.push_back(random());
+        if (!filter.insert(keys.back())) {
+            break;
+        }
+    }
+
+    EXPECT_TRUE(filter.full());
+    EXPECT_LT(keys.size(), 1000u);
+    for (uint64_t key : keys) {
+        EXPECT_TRUE(filter.contains(key));
+    }
+    // The key kept aside is erased like the others
+    for (uint64_t key : keys) {
+        EXPECT_TRUE(filter.erase(key));
+    }
+    EXPECT_FALSE(filter.full());
+    EXPECT_EQ(filter.size(), 0u);
+}
+
+TEST(CuckooFilterTest, EncodingRoundTrip) {
+    CuckooFilter filter(1000);
+    for (uint64_t key = 1; key <= 500; ++key) {
+        filter.insert(key * 0x9e3779b97f4a7c15ULL);
+    }
+    std::string data;
+    filter.encode(data);
+
+    CuckooFilter decoded;
+    ByteReader reader(data);
+    ASSERT_TRUE(CuckooFilter::decode(reader, decoded));
+    EXPECT_TRUE(reader.atEnd());
+    EXPECT_EQ(decoded.size(), filter.size());
+    for (uint64_t key = 1; key <= 500; ++key) {
+        EXPECT_TRUE(decoded.contains(key * 0x9e3779b97f4a7c15ULL));
+    }
+
+    ByteReader truncated(data.data(), data.size() - 1);
+    EXPECT_FALSE(CuckooFilter::decode(truncated, decoded));
+}
+
+// ====================================================================
+//  Known Txids Tests
+// ====================================================================
+
+TEST(KnownTxidsTest, FollowsPoolChainAndReorgs) {
+    Blockchain chain;
+    Mempool pool;
+    chain.addListener(&pool);
+    KnownTxids known(chain, pool);
+    const std::string genesis = chain.getLatestBlock().getHash();
+
+    Transaction tx = makeTransaction("payment");
+    EXPECT_FALSE(known.isKnown(tx.getTxid()));
+    pool.addTransaction(tx);
+    EXPECT_TRUE(known.isKnown(tx.getTxid()));
+    EXPECT_FALSE(known.isConfirmed(tx.getTxid()));
+
+    Block a1 = makeBlock(genesis, {makeTransaction("coinbase_a1"), tx});
+    ASSERT_TRUE(chain.addBlock(a1));
+    EXPECT_TRUE(known.isConfirmed(tx.getTxid()));
+    EXPECT_TRUE(known.isConfirmed(a1.getTransactions()[0].getTxid()));
+
+    // The payment returns to the pool, the coinbase of a1 is forgotten
+    Block b1 = makeBlock(genesis, {makeTransaction("coinbase_b1")});
+    Block b2 = makeBlock(b1.getHash(), {makeTransaction("coinbase_b2")});
+    ASSERT_TRUE(chain.addBlock(b1));
+    ASSERT_TRUE(chain.addBlock(b2));
+
+    EXPECT_FALSE(known.isConfirmed(tx.getTxid()));
+    EXPECT_TRUE(known.isKnown(tx.getTxid()));
+    EXPECT_FALSE(known.isKnown(a1.getTransactions()[0].getTxid()));
+    EXPECT_TRUE(known.isConfirmed(b2.getTransactions()[0].getTxid()));
+    // The genesis block has no transactions
+    EXPECT_EQ(known.getFilter().size(), 3u);
+    chain.removeListener(&pool);
+}
+
+TEST(KnownTxidsTest, GrowsAndRestoresSavedState) {
+    Blockchain chain;
+    Mempool pool;
+    KnownTxids known(chain, pool);
+    const size_t slots = known.getFilter().slotCount();
+    for (int i = 0; i < 5000; ++i) {
+        pool.addTransaction(makeTransaction("tx" + std::to_string(i)));
+    }
+    EXPECT_GT(known.getFilter().slotCount(), slots);
+    Block b1 = makeBlock(chain.getLatestBlock().getHash(), {makeTransaction("coinbase")});
+    ASSERT_TRUE(chain.addBlock(b1));
+
+    std::string data;
+    known.encode(data);
+
+    // A restarted node with the same chain and an empty pool
+    Mempool emptyPool;
+    KnownTxids restored(chain, emptyPool);
+    ByteReader reader(data);
+    ASSERT_TRUE(restored.decode(reader));
+    EXPECT_TRUE(restored.isConfirmed(b1.getTransactions()[0].getTxid()));
+    EXPECT_FALSE(restored.isKnown(makeTransaction("tx0").getTxid()));
+    EXPECT_EQ(restored.getFilter().size(), 1u);
+
+    // State saved at another tip is rejected
+    ASSERT_TRUE(chain.addBlock(makeBlock(b1.getHash(), {makeTransaction("coinbase2")})));
+    ByteReader stale(data);
+    EXPECT_FALSE(restored.decode(stale));
+}
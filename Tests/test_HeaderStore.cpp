@@ -0,0 +1,170 @@
+#include "gtest/gtest.h"
+#include "HeaderStore.h"
+#include "Hex.h"
+#include <filesystem>
+#include <random>
+
+// Helper: random 64-digit hex hash
+static std::string randomHash(std::mt19937_64& rng) {
+    unsigned char bytes[32];
+    for (auto& byte : bytes) {
+        byte = static_cast<unsigned char>(rng());
+    }
+    return toHex(bytes, sizeof(bytes));
+}
+
+// Helper: chain of count headers linked by their hashes, one every few seconds
+static std::vector<BlockHeader> makeHeaders(size_t count, uint64_t seed = 1) {
+    std::mt19937_64 rng(seed);
+    std::vector<BlockHeader> headers;
+    std::string prevHash = "0";
+    uint64_t timestamp = 1700000000000ULL;
+    for (size_t i = 0; i < count; ++i) {
+        BlockHeader header(1, prevHash, randomHash(rng), timestamp,
+                           static_cast<uint32_t>(rng()), 3);
+        header.blockHash = randomHash(rng);
+        headers.push_back(header);
+        prevHash = header.blockHash;
+        timestamp += 1000 + rng() % 5000;
+    }
+    return headers;
+}
+
+static void expectSameHeader(const BlockHeader& actual, const BlockHeader& expected) {
+    EXPECT_EQ(actual.version, expected.version);
+    EXPECT_EQ(actual.hashPrevBlock, expected.hashPrevBlock);
+    EXPECT_EQ(actual.hashMerkleRoot, expected.hashMerkleRoot);
+    EXPECT_EQ(actual.timestamp, expected.timestamp);
+    EXPECT_EQ(actual.nonce, expected.nonce);
+    EXPECT_EQ(actual.difficulty, expected.difficulty);
+    EXPECT_EQ(actual.blockHash, expected.blockHash);
+}
+
+// Helper: store path in the temporary directory, removed on destruction
+struct TempStore {
+    std::string path;
+
+    explicit TempStore(const std::string& name)
+        : path((std::filesystem::temp_directory_path() / name).string()) {
+        remove();
+    }
+    ~TempStore() { remove(); }
+
+    void remove() {
+        std::filesystem::remove(path);
+        std::filesystem::remove(path + ".exc");
+    }
+};
+
+// ====================================================================
+//  Encoding Tests
+// ====================================================================
+
+TEST(HeaderStoreTest, StoresLinkedHeadersInPackedRecords) {
+    HeaderStore store;
+    ASSERT_TRUE(store.open());
+    const auto headers = makeHeaders(1000);
+    for (const auto& header : headers) {
+        ASSERT_TRUE(store.append(header));
+    }
+
+    ASSERT_EQ(store.size(), headers.size());
+    // Only the first header, with no previous record, is an exception
+    EXPECT_EQ(store.exceptionCount(), 1u);
+    EXPECT_LT(store.memoryUsage(), headers.size() * HeaderStore::RecordSize + 1024);
+    for (size_t i = 0; i < headers.size(); ++i) {
+        expectSameHeader(store.get(i), headers[i]);
+        EXPECT_EQ(store.getTimestamp(i), headers[i].timestamp);
+    }
+}
+
+TEST(HeaderStoreTest, ScanMatchesRandomAccess) {
+    HeaderStore store;
+    ASSERT_TRUE(store.open());
+    const auto headers = makeHeaders(700);
+    for (const auto& header : headers) {
+        ASSERT_TRUE(store.append(header));
+    }
+
+    uint64_t next = 300;
+    store.forEach([&](uint64_t height, const BlockHeader& header) {
+        ASSERT_EQ(height, next++);
+        expectSameHeader(header, headers[height]);
+    }, 300);
+    EXPECT_EQ(next, headers.size());
+}
+
+TEST(HeaderStoreTest, KeepsHeadersThatDoNotPackAsExceptions) {
+    HeaderStore store;
+    ASSERT_TRUE(store.open());
+    auto headers = makeHeaders(8);
+    headers[2].timestamp = headers[1].timestamp + (1ULL << 40);  // far ahead
+    headers[3].timestamp = headers[2].timestamp - 5;             // backwards, fits
+    headers[4].version = 1ULL << 40;
+    headers[5].hashMerkleRoot = "0x" + headers[5].hashMerkleRoot;
+    headers[6].hashPrevBlock = "not the previous hash";
+    for (auto& header : headers) {
+        ASSERT_TRUE(store.append(header));
+    }
+
+    EXPECT_EQ(store.exceptionCount(), 5u);
+    for (size_t i = 0; i < headers.size(); ++i) {
+        expectSameHeader(store.get(i), headers[i]);
+    }
+}
+
+// ====================================================================
+//  Persistence Tests
+// ====================================================================
+
+TEST(HeaderStoreTest, ReopensFromFile) {
+    TempStore file("test_headerstore.hdr");
+    auto headers = makeHeaders(5000);
+    headers[4100].timestamp = 1;
+    {
+        HeaderStore store(file.path);
+        ASSERT_TRUE(store.open());
+        for (const auto& header : headers) {
+            ASSERT_TRUE(store.append(header));
+        }
+    }
+    EXPECT_EQ(std::filesystem::file_size(file.path), 16 + headers.size() * HeaderStore::RecordSize);
+
+    HeaderStore store(file.path);
+    ASSERT_TRUE(store.open());
+    ASSERT_EQ(store.size(), headers.size());
+    EXPECT_EQ(store.exceptionCount(), 3u);
+    store.forEach([&](uint64_t height, const BlockHeader& header) {
+        expectSameHeader(header, headers[height]);
+    });
+}
+
+TEST(HeaderStoreTest, TruncateDropsHeadersAndTheirExceptions) {
+    TempStore file("test_headerstore_truncate.hdr");
+    auto headers = makeHeaders(600);
+    headers[500].version = 1ULL << 40;
+    auto branch = makeHeaders(50, 2);
+    branch[0].hashPrevBlock = headers[399].blockHash;
+    {
+        HeaderStore store(file.path);
+        ASSERT_TRUE(store.open());
+        for (const auto& header : headers) {
+            ASSERT_TRUE(store.append(header));
+        }
+        store.truncate(400);
+        EXPECT_EQ(store.exceptionCount(), 1u);
+        for (const auto& header : branch) {
+            ASSERT_TRUE(store.append(header));
+        }
+    }
+
+    HeaderStore store(file.path);
+    ASSERT_TRUE(store.open());
+    ASSERT_EQ(store.size(), 450u);
+    // The branch header is packed: its timestamp is a delta from height 399
+    EXPECT_EQ(store.exceptionCount(), 1u);
+    expectSameHeader(store.get(399), headers[399]);
+    for (size_t i = 0; i < branch.size(); ++i) {
+        expectSameHeader(store.get(400 + i), branch[i]);
+    }
+}
@@ -0,0 +1,87 @@
+#include "gtest/gtest.h"
+#include "Hex.h"
+#include <algorithm>
+#include <vector>
+
+// Helper: implementations the CPU can run
+static std::vector<HexImpl> supportedImpls() {
+    std::vector<HexImpl> impls;
+    for (HexImpl impl : {HexImpl::Scalar, HexImpl::SSSE3, HexImpl::AVX2}) {
+        if (hexImplSupported(impl)) {
+            impls.push_back(impl);
+        }
+    }
+    return impls;
+}
+
+// Helper: deterministic pseudo-random bytes
+static std::vector<unsigned char> makeBytes(size_t size) {
+    std::vector<unsigned char> bytes(size);
+    uint32_t state = 12345;
+    for (auto& byte : bytes) {
+        state = state * 1103515245u + 12345u;
+        byte = static_cast<unsigned char>(state >> 16);
+    }
+    return bytes;
+}
+
+// ====================================================================
+//  Encoding Tests
+// ====================================================================
+
+TEST(HexTest, EncodesKnownValues) {
+    const unsigned char data[] = {0x00, 0x01, 0x7f, 0x80, 0xab, 0xff};
+    EXPECT_EQ(toHex(data, sizeof(data)), "00017f80abff");
+    EXPECT_EQ(toHex(data, 0), "");
+}
+
+TEST(HexTest, AllImplementationsAgreeOnEveryLength) {
+    // Lengths around the 16 and 32 byte steps exercise the scalar tails
+    std::vector<unsigned char> bytes = makeBytes(100);
+    for (size_t size = 0; size <= bytes.size(); ++size) {
+        std::string expected(2 * size, '\0');
+        hexEncode(HexImpl::Scalar, bytes.data(), size, &expected[0]);
+
+        for (HexImpl impl : supportedImpls()) {
+            std::string hex(2 * size, '\0');
+            hexEncode(impl, bytes.data(), size, &hex[0]);
+            EXPECT_EQ(hex, expected) << "size " << size;
+
+            std::vector<unsigned char> decoded(size);
+            ASSERT_TRUE(hexDecode(impl, hex.data(), size, decoded.data()));
+            EXPECT_TRUE(std::equal(decoded.begin(), decoded.end(), bytes.begin()));
+        }
+    }
+}
+
+// ====================================================================
+//  Decoding Tests
+// ====================================================================
+
+TEST(HexTest, DecodeAcceptsUpperCase) {
+    std::string hex = "00ABcdEF" + std::string(56, 'F');
+    for (HexImpl impl : supportedImpls()) {
+        unsigned char bytes[32];
+        ASSERT_TRUE(hexDecode(impl, hex.data(), 32, bytes));
+        EXPECT_EQ(bytes[0], 0x00);
+        EXPECT_EQ(bytes[1], 0xab);
+        EXPECT_EQ(bytes[2], 0xcd);
+        EXPECT_EQ(bytes[3], 0xef);
+        EXPECT_EQ(bytes[31], 0xff);
+    }
+}
+
+TEST(HexTest, DecodeRejectsNonHexCharacters) {
+    const std::string valid(64, 'a');
+    for (HexImpl impl : supportedImpls()) {
+        for (size_t position : {0u, 17u, 40u, 63u}) {
+            for (char bad : {'g', 'G', '/', ':', '@', '`', ' ', '\xe1'}) {
+                std::string hex = valid;
+                hex[position] = bad;
+                unsigned char bytes[32];
+                EXPECT_FALSE(hexDecode(impl, hex.data(), 32, bytes))
+                    << "position " << position << " char " << static_cast<int>(bad);
+            }
+        }
+    }
+}
@@ -0,0 +1,276 @@
+#include "gtest/gtest.h"
+#include "Blockchain.h"
+#include "IngestQueue.h"
+#include "Mempool.h"
+#include "SignatureCache.h"
+#include <openssl/ec.h>
+#include <openssl/x509.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Helper: secp256k1 key with its DER public key
+struct Key {
+    EVP_PKEY* pkey;
+    std::string publicKey;
+
+    Key() : pkey(EVP_EC_gen("secp256k1")) {
+        unsigned char* der = nullptr;
+        int len = i2d_PUBKEY(pkey, &der);
+        publicKey.assign(reinterpret_cast<char*>(der), len);
+        OPENSSL_free(der);
+    }
+    ~Key() { EVP_PKEY_free(pkey); }
+
+    std::string owner() const { return Transaction::hashPublicKey(publicKey); }
+};
+
+// Helper: coinbase transaction tagged `tag`, paying `amount` to each owner
+static Transaction makeCoinbase(const std::string& tag, const std::vector<std::string>& owners,
+                                uint64_t amount = 50) {
+    TxIn in(std::string(64, '0'), 0, "coinbase_" + tag, "");
+    std::vector<TxOut> outs;
+    for (const auto& owner : owners) {
+        outs.emplace_back(amount, owner);
+    }
+    return Transaction({in}, outs);
+}
+
+// Helper: transaction spending output index of prev, signed by key
+static Transaction makeSpend(const Transaction& prev, uint32_t index, const Key& key,
+                             const std::string& to, uint64_t amount = 50) {
+    Transaction tx({TxIn(prev.getTxid(), index, "", key.publicKey)}, {TxOut(amount, to)});
+    EXPECT_TRUE(tx.signInput(0, key.pkey));
+    return tx;
+}
+
+// Helper: drains queue into mempool until every submitted transaction is in
+static void drainAll(IngestQueue& queue, Mempool& mempool) {
+    while (!queue.empty()) {
+        if (queue.drain(mempool) == 0) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+// ====================================================================
+//  Lock-Free Queue Tests
+// ====================================================================
+
+TEST(MPMCQueueTest, KeepsOrderAndRefusesWhenFull) {
+    MPMCQueue<int> queue(3);
+    ASSERT_EQ(queue.capacity(), 4u);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(queue.tryPush(i));
+    }
+    EXPECT_FALSE(queue.tryPush(4));
+    EXPECT_EQ(queue.sizeApprox(), 4u);
+
+    int value = -1;
+    ASSERT_TRUE(queue.tryPop(value));
+    EXPECT_EQ(value, 0);
+    EXPECT_TRUE(queue.tryPush(4));
+
+    std::vector<int> batch;
+    EXPECT_EQ(queue.tryPopBatch(batch, 3), 3u);
+    EXPECT_EQ(batch, std::vector<int>({1, 2, 3}));
+    EXPECT_EQ(queue.tryPopBatch(batch, 3), 1u);
+    EXPECT_EQ(batch.back(), 4);
+    EXPECT_FALSE(queue.tryPop(value));
+    EXPECT_EQ(queue.pushCount(), 5u);
+}
+
+TEST(MPMCQueueTest, ProducersAndConsumersLoseNothing) {
+    const int producerCount = 4;
+    const int perProducer = 20000;
+    MPMCQueue<uint64_t> queue(256);
+    std::atomic<int> producersDone(0);
+    std::atomic<uint64_t> sum(0);
+    std::atomic<uint64_t> count(0);
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producerCount; ++p) {
+        threads.emplace_back([&, p] {
+            for (int i = 0; i < perProducer; ++i) {
+                while (!queue.tryPush(static_cast<uint64_t>(p) * perProducer + i)) {
+                    std::this_thread::yield();
+                }
+            }
+            ++producersDone;
+        });
+    }
+    for (int c = 0; c < 2; ++c) {
+        threads.emplace_back([&] {
+            std::vector<uint64_t> batch;
+            for (;;) {
+                batch.clear();
+                if (queue.tryPopBatch(batch, 32) == 0) {
+                    if (producersDone.load() == producerCount && queue.sizeApprox() == 0) {
+                        break;
+                    }
+                    std::this_thread::yield();
+                    continue;
+                }
+                for (uint64_t value : batch) {
+                    sum += value;
+                }
+                count += batch.size();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    const uint64_t total = producerCount * perProducer;
+    EXPECT_EQ(count.load(), total);
+    EXPECT_EQ(sum.load(), total * (total - 1) / 2);
+}
+
+// ====================================================================
+//  Ingest Tests
+// ====================================================================
+
+TEST(IngestQueueTest, DrainAddsTransactionsOfEveryProducer) {
+    ThreadPool pool(2);
+    IngestConfig config;
+    config.capacity = 64;
+    config.maxTasks = 1;
+    config.batchSize = 16;
+    IngestQueue queue(nullptr, config, pool);
+    Mempool mempool;
+
+    const int producerCount = 4;
+    const int perProducer = 250;
+    std::vector<std::thread> producers;
+    for (int p = 0; p < producerCount; ++p) {
+        producers.emplace_back([&, p] {
+            for (int i = 0; i < perProducer; ++i) {
+                Transaction tx = makeCoinbase(std::to_string(p) + "_" + std::to_string(i), {"owner"});
+                while (!queue.submit(std::move(tx))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    // The mempool is only touched by this thread
+    while (mempool.size() < producerCount * perProducer) {
+        if (queue.drain(mempool) == 0) {
+            std::this_thread::yield();
+        }
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.getAccepted(), static_cast<uint64_t>(producerCount * perProducer));
+
+    // One task keeps the order of each producer
+    std::vector<int> next(producerCount, 0);
+    mempool.forEach([&](const Transaction& tx) {
+        const std::string& tag = tx.getInputs()[0].signature;
+        const int p = tag[9] - '0';
+        EXPECT_EQ(tag, "coinbase_" + std::to_string(p) + "_" + std::to_string(next[p]));
+        ++next[p];
+    });
+
+    // Already pooled
+    EXPECT_TRUE(queue.submit(mempool.getTransactions(1)[0]));
+    drainAll(queue, mempool);
+    EXPECT_EQ(queue.getRejected(), 1u);
+}
+
+TEST(IngestQueueTest, RefusesWhenFullUntilDrained) {
+    ThreadPool pool(1);
+    IngestConfig config;
+    config.capacity = 4;
+    config.maxTasks = 1;
+    config.batchSize = 2;
+    IngestQueue queue(nullptr, config, pool);
+    Mempool mempool;
+
+    // Four staged and at most four prepared
+    int submitted = 0;
+    for (int i = 0; i < 100; ++i) {
+        if (queue.submit(makeCoinbase(std::to_string(i), {"owner"}))) {
+            ++submitted;
+        }
+    }
+    EXPECT_LE(submitted, 8);
+    EXPECT_EQ(queue.getRefused(), static_cast<uint64_t>(100 - submitted));
+    EXPECT_EQ(queue.sizeApprox(), static_cast<size_t>(submitted));
+
+    drainAll(queue, mempool);
+    EXPECT_EQ(mempool.size(), static_cast<size_t>(submitted));
+    EXPECT_TRUE(queue.submit(makeCoinbase("after", {"owner"})));
+}
+
+TEST(IngestQueueTest, SignaturesAreVerifiedBeforeTheMempool) {
+    Key alice, bob;
+    SignatureCache cache;
+    Blockchain chain;
+    Mempool mempool;
+    mempool.enableSignatureChecks(chain.getUTXOSet(), &cache);
+    chain.addListener(&mempool);
+
+    Transaction coinbase = makeCoinbase("a", {alice.owner(), alice.owner()});
+    Block block({coinbase}, chain.getLatestBlock().getHash());
+    block.setHeader(BlockHeader(1, chain.getLatestBlock().getHash(), "", 0, 0, 1));
+    block.computeMerkleRoot();
+    block.mine();
+    ASSERT_TRUE(chain.addBlock(block));
+
+    ThreadPool pool(2);
+    IngestQueue queue(&cache, IngestConfig(), pool);
+    Transaction spend = makeSpend(coinbase, 0, alice, bob.owner());
+    // Valid signature, but not by the owner of the output
+    Transaction theft = makeSpend(coinbase, 1, bob, bob.owner());
+    ASSERT_TRUE(queue.submit(spend));
+    ASSERT_TRUE(queue.submit(theft));
+    drainAll(queue, mempool);
+
+    EXPECT_EQ(cache.size(), 2u);
+    EXPECT_EQ(cache.hits(), 2u);
+    EXPECT_EQ(cache.misses(), 0u);
+    EXPECT_TRUE(mempool.contains(spend.getTxid()));
+    EXPECT_FALSE(mempool.contains(theft.getTxid()));
+    EXPECT_EQ(queue.getRejected(), 1u);
+}
+
+TEST(IngestQueueTest, ChildrenAreAddedAfterTheirParents) {
+    Key alice;
+    SignatureCache cache;
+    Blockchain chain;
+    Mempool mempool;
+    mempool.enableSignatureChecks(chain.getUTXOSet(), &cache);
+    chain.addListener(&mempool);
+
+    const int pairCount = 200;
+    Transaction coinbase = makeCoinbase("a", std::vector<std::string>(pairCount, alice.owner()));
+    Block block({coinbase}, chain.getLatestBlock().getHash());
+    block.setHeader(BlockHeader(1, chain.getLatestBlock().getHash(), "", 0, 0, 1));
+    block.computeMerkleRoot();
+    block.mine();
+    ASSERT_TRUE(chain.addBlock(block));
+
+    std::vector<Transaction> txs;
+    for (int i = 0; i < pairCount; ++i) {
+        txs.push_back(makeSpend(coinbase, static_cast<uint32_t>(i), alice, alice.owner()));
+        txs.push_back(makeSpend(txs.back(), 0, alice, alice.owner()));
+    }
+
+    // Single-transaction batches, prepared by several tasks at once
+    ThreadPool pool(4);
+    IngestConfig config;
+    config.maxTasks = 4;
+    config.batchSize = 1;
+    IngestQueue queue(&cache, config, pool);
+    for (const auto& tx : txs) {
+        ASSERT_TRUE(queue.submit(tx));
+    }
+    drainAll(queue, mempool);
+
+    EXPECT_EQ(queue.getRejected(), 0u);
+    EXPECT_EQ(queue.getAccepted(), static_cast<uint64_t>(2 * pairCount));
+    EXPECT_EQ(mempool.size(), static_cast<size_t>(2 * pairCount));
+}
@@ -0,0 +1,201 @@
+#include "gtest/gtest.h"
+#include "AddressIndex.h"
+#include "BalanceCache.h"
+#include "Blockchain.h"
+#include "KnownTxids.h"
+#include "MemoryUsage.h"
+#include "Mempool.h"
+#include "SignatureCache.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Helper: coinbase transaction tagged `tag` paying `amount` to `owner`
+static Transaction makeCoinbase(const std::string& tag, const std::string& owner, uint64_t amount = 50) {
+    TxIn in(std::string(64, '0'), 0, "coinbase_" + tag, "");
+    return Transaction({in}, {TxOut(amount, owner)});
+}
+
+// Helper: unsigned transaction spending output index of prev
+static Transaction makeSpend(const Transaction& prev, uint32_t index, const std::string& to,
+                             uint64_t amount = 50) {
+    return Transaction({TxIn(prev.getTxid(), index, "", "")}, {TxOut(amount, to)});
+}
+
+// Helper: mined block at difficulty 1 on top of prevHash
+static Block makeBlock(const std::string& prevHash, const std::vector<Transaction>& txs) {
+    Block block(txs, prevHash);
+    block.setHeader(BlockHeader(1, prevHash, "", 0, 0, 1));
+    block.computeMerkleRoot();
+    block.mine();
+    return block;
+}
+
+// Helper: heap bytes of the transactions of block
+static uint64_t bodyUsage(const Block& block) {
+    return block.memoryUsage() - block.getHeader().memoryUsage();
+}
+
+// Helper: what the chain should report for its bodies and undo data,
+// recounted block by block; offChain are the bodies kept off the active chain
+static void expectRecount(const Blockchain& chain, uint64_t offChain = 0) {
+    uint64_t transactions = offChain;
+    uint64_t undo = 0;
+    for (uint64_t height = 0; height <= chain.getHeight(); ++height) {
+        transactions += bodyUsage(chain.getBlock(height));
+        undo += chain.getBlockUndo(height).memoryUsage();
+    }
+    const Blockchain::MemoryUsage usage = chain.getMemoryUsage();
+    EXPECT_EQ(usage.transactions, transactions);
+    EXPECT_EQ(usage.undo, undo);
+    EXPECT_EQ(usage.utxos, chain.getUTXOSet().memoryUsage());
+}
+
+// ====================================================================
+//  Accounting Helper Tests
+// ====================================================================
+
+TEST(MemoryUsageTest, ContainersAreCountedByCapacity) {
+    EXPECT_EQ(mallocUsage(0), 0u);
+    EXPECT_EQ(mallocUsage(1), 32u);
+    EXPECT_EQ(mallocUsage(24), 32u);
+    EXPECT_EQ(mallocUsage(25), 48u);
+
+    std::vector<uint64_t> values(10);
+    const size_t used = dynamicUsage(values);
+    values.reserve(1000);
+    EXPECT_GE(dynamicUsage(values), 8000u);
+    EXPECT_GT(dynamicUsage(values), used);
+
+    // Short strings need no allocation
+    EXPECT_EQ(dynamicUsage(std::string("abc")), 0u);
+    EXPECT_GE(dynamicUsage(std::string(64, 'a')), 65u);
+}
+
+TEST(MemoryUsageTest, BlockCountsItsTransactions) {
+    Block block("prev");
+    const size_t empty = block.memoryUsage();
+    const Transaction tx = makeCoinbase("a", std::string(64, 'a'));
+    block.addTransaction(tx);
+    EXPECT_GE(block.memoryUsage(), empty + tx.memoryUsage() + sizeof(Transaction));
+
+    block.pruneTransactions();
+    EXPECT_EQ(block.memoryUsage(), block.getHeader().memoryUsage());
+}
+
+// ====================================================================
+//  Chain Tests
+// ====================================================================
+
+TEST(MemoryUsageTest, ChainFollowsBlocksReorgsAndPruning) {
+    Blockchain chain;
+    const std::string genesis = chain.getLatestBlock().getHash();
+    const Blockchain::MemoryUsage start = chain.getMemoryUsage();
+
+    Transaction coinbase = makeCoinbase("a1", std::string(64, 'a'));
+    Block a1 = makeBlock(genesis, {coinbase});
+    ASSERT_TRUE(chain.addBlock(a1));
+    Block a2 = makeBlock(a1.getHash(), {makeCoinbase("a2", std::string(64, 'a')),
+                                        makeSpend(coinbase, 0, std::string(64, 'b'))});
+    ASSERT_TRUE(chain.addBlock(a2));
+    const Blockchain::MemoryUsage grown = chain.getMemoryUsage();
+    EXPECT_GT(grown.headers, start.headers);
+    EXPECT_GT(grown.transactions, start.transactions);
+    EXPECT_GT(grown.undo, 0u);
+    EXPECT_GT(grown.snapshots, 0u);
+    expectRecount(chain);
+
+    // A longer branch without the spend replaces it
+    Block b1 = makeBlock(genesis, {makeCoinbase("b1", std::string(64, 'c'))});
+    Block b2 = makeBlock(b1.getHash(), {makeCoinbase("b2", std::string(64, 'c'))});
+    ASSERT_TRUE(chain.addBlock(b1));
+    ASSERT_TRUE(chain.addBlock(b2));
+    ASSERT_TRUE(chain.addBlock(makeBlock(b2.getHash(), {makeCoinbase("b3", std::string(64, 'c'))})));
+    ASSERT_EQ(chain.getBlock(1).getHash(), b1.getHash());
+    EXPECT_EQ(chain.getMemoryUsage().undo, 0u);
+    expectRecount(chain, bodyUsage(a1) + bodyUsage(a2));
+
+    // Bodies below the tip are freed on both branches
+    const uint64_t beforePruning = chain.getMemoryUsage().transactions;
+    chain.enablePruning(1);
+    EXPECT_LT(chain.getMemoryUsage().transactions, beforePruning);
+    expectRecount(chain, bodyUsage(a2));
+}
+
+TEST(MemoryUsageTest, ChainUsageIsReadableDuringAppends) {
+    Blockchain chain;
+    std::vector<Block> blocks;
+    std::string prevHash = chain.getLatestBlock().getHash();
+    for (int i = 0; i < 200; ++i) {
+        blocks.push_back(makeBlock(prevHash, {makeCoinbase(std::to_string(i), std::string(64, 'a'))}));
+        prevHash = blocks.back().getHash();
+    }
+
+    std::atomic<bool> done(false);
+    std::atomic<int> shrunk(0);
+    std::thread poller([&] {
+        uint64_t last = 0;
+        while (!done.load()) {
+            const uint64_t headers = chain.getMemoryUsage().headers;
+            if (headers < last) {
+                ++shrunk;
+            }
+            last = headers;
+        }
+    });
+    for (const Block& block : blocks) {
+        ASSERT_TRUE(chain.addBlock(block));
+    }
+    done = true;
+    poller.join();
+    EXPECT_EQ(shrunk.load(), 0);
+    expectRecount(chain);
+}
+
+// ====================================================================
+//  Mempool, Index and Cache Tests
+// ====================================================================
+
+TEST(MemoryUsageTest, PoolIndexesAndCachesFollowTheirContent) {
+    Blockchain chain;
+    Mempool mempool;
+    AddressIndex addresses;
+    ASSERT_TRUE(addresses.open(chain));
+    BalanceCache balances(chain, &mempool);
+    KnownTxids known(chain, mempool);
+    SignatureCache signatures;
+
+    const size_t addressesBefore = addresses.memoryUsage();
+    const size_t balancesBefore = balances.memoryUsage();
+    const size_t knownBefore = known.memoryUsage();
+    Transaction coinbase = makeCoinbase("a1", std::string(64, 'a'));
+    ASSERT_TRUE(chain.addBlock(makeBlock(chain.getLatestBlock().getHash(), {coinbase})));
+    EXPECT_GT(addresses.memoryUsage(), addressesBefore);
+    EXPECT_GT(balances.memoryUsage(), balancesBefore);
+    EXPECT_GT(known.memoryUsage(), knownBefore);
+
+    // Removing the transactions frees at least their own heap bytes
+    const size_t poolBefore = mempool.memoryUsage();
+    size_t transactions = 0;
+    std::vector<Transaction> pooled;
+    for (int i = 0; i < 100; ++i) {
+        pooled.push_back(makeSpend(coinbase, 0, std::string(64, 'b' + i % 4), 50 - i % 10));
+        pooled.back().setTimestamp(i);
+        ASSERT_TRUE(mempool.addTransaction(pooled.back()));
+        transactions += pooled.back().memoryUsage();
+    }
+    const size_t poolFull = mempool.memoryUsage();
+    EXPECT_GE(poolFull, poolBefore + transactions);
+    const size_t balancesFull = balances.memoryUsage();
+    for (const auto& tx : pooled) {
+        ASSERT_TRUE(mempool.removeTransaction(tx.getTxid()));
+    }
+    EXPECT_LE(mempool.memoryUsage() + transactions, poolFull);
+    EXPECT_LT(balances.memoryUsage(), balancesFull);
+
+    const size_t signaturesEmpty = signatures.memoryUsage();
+    for (uint32_t i = 0; i < 1000; ++i) {
+        signatures.insert(coinbase.getTxid(), i, "signature");
+    }
+    EXPECT_GE(signatures.memoryUsage(), signaturesEmpty + 1000 * 32);
+}
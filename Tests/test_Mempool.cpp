@@ -0,0 +1,78 @@
+#include "gtest/gtest.h"
+#include "Blockchain.h"
+#include "Mempool.h"
+
+// Helper: transaction with a null input, valid without funding
+static Transaction makeTransaction(const std::string& tag) {
+    TxIn in(std::string(64, '0'), 0, tag, "");
+    TxOut out(1, "dest_" + tag);
+    return Transaction({in}, {out});
+}
+
+// Helper: mined block at difficulty 1 on top of prevHash
+static Block makeBlock(const std::string& prevHash, const std::vector<Transaction>& txs) {
+    Block block(txs, prevHash);
+    block.setHeader(BlockHeader(1, prevHash, "", 0, 0, 1));
+    block.computeMerkleRoot();
+    block.mine();
+    return block;
+}
+
+// ====================================================================
+//  Pool Management Tests
+// ====================================================================
+
+TEST(MempoolTest, AddRejectsDuplicates) {
+    Mempool pool;
+    Transaction tx = makeTransaction("a");
+
+    EXPECT_TRUE(pool.addTransaction(tx));
+    EXPECT_FALSE(pool.addTransaction(tx));
+    EXPECT_EQ(pool.size(), 1u);
+    EXPECT_TRUE(pool.contains(tx.getTxid()));
+}
+
+TEST(MempoolTest, TransactionsKeepArrivalOrder) {
+    Mempool pool;
+    Transaction a = makeTransaction("a");
+    Transaction b = makeTransaction("b");
+    Transaction c = makeTransaction("c");
+    pool.addTransaction(a);
+    pool.addTransaction(b);
+    pool.addTransaction(c);
+    pool.removeTransaction(b.getTxid());
+
+    std::vector<Transaction> txs = pool.getTransactions();
+
+    ASSERT_EQ(txs.size(), 2u);
+    EXPECT_EQ(txs[0].getTxid(), a.getTxid());
+    EXPECT_EQ(txs[1].getTxid(), c.getTxid());
+    EXPECT_EQ(pool.getTransactions(1).size(), 1u);
+}
+
+// ====================================================================
+//  Chain Notification Tests
+// ====================================================================
+
+TEST(MempoolTest, ConfirmedTransactionsLeaveAndReorgBringsThemBack) {
+    Blockchain chain;
+    Mempool pool;
+    chain.addListener(&pool);
+    const std::string genesis = chain.getLatestBlock().getHash();
+
+    Transaction tx = makeTransaction("payment");
+    pool.addTransaction(tx);
+    Block a1 = makeBlock(genesis, {makeTransaction("coinbase_a1"), tx});
+    ASSERT_TRUE(chain.addBlock(a1));
+    EXPECT_FALSE(pool.contains(tx.getTxid()));
+
+    // A heavier branch without the payment returns it to the pool
+    Block b1 = makeBlock(genesis, {makeTransaction("coinbase_b1")});
+    Block b2 = makeBlock(b1.getHash(), {makeTransaction("coinbase_b2")});
+    ASSERT_TRUE(chain.addBlock(b1));
+    ASSERT_TRUE(chain.addBlock(b2));
+
+    EXPECT_TRUE(pool.contains(tx.getTxid()));
+    EXPECT_FALSE(pool.contains(a1.getTransactions()[0].getTxid()));
+    chain.removeListener(&pool);
+}
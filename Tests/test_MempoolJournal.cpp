@@ -0,0 +1,233 @@
+#include "gtest/gtest.h"
+#include "MempoolJournal.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#ifndef _WIN32
+#include <csignal>
+#include <sys/resource.h>
+#endif
+
+// Helper: transaction with a null input, valid without funding
+static Transaction makeTransaction(const std::string& tag) {
+    TxIn in(std::string(64, '0'), 0, tag, "");
+    TxOut out(1, "dest_" + tag);
+    return Transaction({in}, {out}, 1000);
+}
+
+// Helper: journal path in the temporary directory, removed on destruction
+struct TempJournal {
+    std::string path;
+
+    explicit TempJournal(const std::string& name)
+        : path((std::filesystem::temp_directory_path() / name).string()) {
+        std::filesystem::remove(path);
+    }
+    ~TempJournal() {
+        std::filesystem::remove(path);
+        std::filesystem::remove(path + ".tmp");
+    }
+};
+
+static std::vector<TXID> txids(const Mempool& pool) {
+    std::vector<TXID> result;
+    pool.forEach([&](const Transaction& tx) { result.push_back(tx.getTxid()); });
+    return result;
+}
+
+// ====================================================================
+//  Replay Tests
+// ====================================================================
+
+TEST(MempoolJournalTest, ReplayRestoresPoolInOrder) {
+    TempJournal file("test_journal_replay.log");
+    std::vector<TXID> expected;
+    {
+        Mempool pool;
+        MempoolJournal journal(file.path);
+        ASSERT_TRUE(journal.open(pool));
+        for (int i = 0; i < 5; ++i) {
+            pool.addTransaction(makeTransaction("tx" + std::to_string(i)));
+        }
+        pool.removeTransaction(makeTransaction("tx1").getTxid());
+        pool.removeTransaction(makeTransaction("tx3").getTxid());
+        // A removed transaction coming back is appended at the end
+        pool.addTransaction(makeTransaction("tx1"));
+        expected = txids(pool);
+    }
+
+    Mempool restored;
+    MempoolJournal journal(file.path);
+    ASSERT_TRUE(journal.open(restored));
+
+    EXPECT_EQ(txids(restored), expected);
+    EXPECT_EQ(journal.replayedRecords(), 8u);
+    EXPECT_EQ(journal.truncatedBytes(), 0u);
+}
+
+TEST(MempoolJournalTest, TornRecordIsCutOff) {
+    TempJournal file("test_journal_torn.log");
+    {
+        Mempool pool;
+        MempoolJournal journal(file.path);
+        ASSERT_TRUE(journal.open(pool));
+        pool.addTransaction(makeTransaction("a"));
+        pool.addTransaction(makeTransaction("b"));
+    }
+    // A crash in the middle of the last record
+    const uintmax_t size = std::filesystem::file_size(file.path);
+    std::filesystem::resize_file(file.path, size - 5);
+
+    Mempool pool;
+    {
+        MempoolJournal journal(file.path);
+        ASSERT_TRUE(journal.open(pool));
+        EXPECT_EQ(pool.size(), 1u);
+        EXPECT_TRUE(pool.contains(makeTransaction("a").getTxid()));
+        EXPECT_GT(journal.truncatedBytes(), 0u);
+
+        // New records follow the last complete one
+        pool.addTransaction(makeTransaction("c"));
+    }
+
+    Mempool restored;
+    MempoolJournal journal(file.path);
+    ASSERT_TRUE(journal.open(restored));
+    EXPECT_EQ(txids(restored), txids(pool));
+    EXPECT_EQ(journal.truncatedBytes(), 0u);
+}
+
+TEST(MempoolJournalTest, CorruptedRecordEndsReplay) {
+    TempJournal file("test_journal_corrupt.log");
+    {
+        Mempool pool;
+        MempoolJournal journal(file.path);
+        ASSERT_TRUE(journal.open(pool));
+        pool.addTransaction(makeTransaction("a"));
+        pool.addTransaction(makeTransaction("b"));
+    }
+    // Flip a byte in the last record
+    {
+        std::fstream stream(file.path, std::ios::in | std::ios::out | std::ios::binary);
+        stream.seekp(-3, std::ios::end);
+        stream.put('\x7f');
+    }
+
+    Mempool pool;
+    MempoolJournal journal(file.path);
+    ASSERT_TRUE(journal.open(pool));
+    EXPECT_EQ(pool.size(), 1u);
+    EXPECT_EQ(journal.replayedRecords(), 1u);
+}
+
+TEST(MempoolJournalTest, RejectsForeignFile) {
+    TempJournal file("test_journal_foreign.log");
+    {
+        std::ofstream stream(file.path, std::ios::binary);
+        stream << "not a journal";
+    }
+
+    Mempool pool;
+    MempoolJournal journal(file.path);
+    EXPECT_FALSE(journal.open(pool));
+}
+
+// ====================================================================
+//  Commit and Compaction Tests
+// ====================================================================
+
+TEST(MempoolJournalTest, SyncMakesRecordsDurable) {
+    TempJournal file("test_journal_sync.log");
+    JournalConfig config;
+    config.commitInterval = std::chrono::milliseconds(10000);
+
+    Mempool pool;
+    MempoolJournal journal(file.path, config);
+    ASSERT_TRUE(journal.open(pool));
+    for (int i = 0; i < 100; ++i) {
+        pool.addTransaction(makeTransaction("tx" + std::to_string(i)));
+    }
+    EXPECT_TRUE(journal.sync());
+
+    // All records share one batch, and a second reader sees them
+    EXPECT_EQ(journal.batchCount(), 1u);
+    Mempool copy;
+    TempJournal copyFile("test_journal_sync_copy.log");
+    std::filesystem::copy_file(file.path, copyFile.path);
+    MempoolJournal reader(copyFile.path);
+    ASSERT_TRUE(reader.open(copy));
+    EXPECT_EQ(copy.size(), 100u);
+}
+
+TEST(MempoolJournalTest, CompactionKeepsOnlyLiveTransactions) {
+    TempJournal file("test_journal_compact.log");
+    JournalConfig config;
+    config.minCompactRecords = 50;
+    config.compactRatio = 2.0;
+
+    std::vector<TXID> expected;
+    {
+        Mempool pool;
+        MempoolJournal journal(file.path, config);
+        ASSERT_TRUE(journal.open(pool));
+        for (int i = 0; i < 40; ++i) {
+            pool.addTransaction(makeTransaction("tx" + std::to_string(i)));
+        }
+        for (int i = 0; i < 30; ++i) {
+            pool.removeTransaction(makeTransaction("tx" + std::to_string(i)).getTxid());
+        }
+
+        // Compaction ran after the 14th removal (54 records, 26 live) and the
+        // 16 later removals were appended to the compacted journal
+        EXPECT_EQ(journal.recordCount(), 42u);
+        expected = txids(pool);
+    }
+
+    Mempool restored;
+    MempoolJournal journal(file.path, config);
+    ASSERT_TRUE(journal.open(restored));
+    EXPECT_EQ(txids(restored), expected);
+    EXPECT_EQ(restored.size(), 10u);
+    EXPECT_EQ(journal.replayedRecords(), 42u);
+}
+
+#ifndef _WIN32
+TEST(MempoolJournalTest, FailedWriteIsReportedBySyncAndClose) {
+    TempJournal file("test_journal_failed.log");
+    Mempool pool;
+    MempoolJournal journal(file.path);
+    ASSERT_TRUE(journal.open(pool));
+    pool.addTransaction(makeTransaction("durable"));
+    ASSERT_TRUE(journal.sync());
+
+    // Writes past the file size limit fail with EFBIG instead of raising SIGXFSZ
+    const uintmax_t size = std::filesystem::file_size(file.path);
+    std::signal(SIGXFSZ, SIG_IGN);
+    rlimit saved;
+    ASSERT_EQ(getrlimit(RLIMIT_FSIZE, &saved), 0);
+    rlimit limit = saved;
+    limit.rlim_cur = size + 10;
+    ASSERT_EQ(setrlimit(RLIMIT_FSIZE, &limit), 0);
+
+    pool.addTransaction(makeTransaction("lost"));
+    const bool synced = journal.sync();
+    pool.addTransaction(makeTransaction("dropped"));
+    const bool syncedAfter = journal.sync();
+    setrlimit(RLIMIT_FSIZE, &saved);
+    std::signal(SIGXFSZ, SIG_DFL);
+
+    EXPECT_FALSE(synced);
+    EXPECT_FALSE(syncedAfter);
+    EXPECT_TRUE(journal.failed());
+    EXPECT_EQ(journal.batchCount(), 1u);
+    EXPECT_FALSE(journal.close());
+
+    // Only the record synced before the failure is replayed
+    Mempool restored;
+    MempoolJournal reader(file.path);
+    ASSERT_TRUE(reader.open(restored));
+    EXPECT_EQ(restored.size(), 1u);
+    EXPECT_TRUE(restored.contains(makeTransaction("durable").getTxid()));
+    EXPECT_TRUE(reader.close());
+}
+#endif
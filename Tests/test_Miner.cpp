@@ -0,0 +1,92 @@
+#include "gtest/gtest.h"
+#include "Miner.h"
+#include <atomic>
+#include <chrono>
+#include <limits>
+
+// Helper: block template with a single transaction at the given difficulty
+static Block makeTemplate(const std::string& prevHash, uint32_t difficulty, uint32_t nonce = 0) {
+    TxIn in(std::string(64, '0'), 0, "coinbase", "");
+    TxOut out(50, "miner");
+    Block block({Transaction({in}, {out})}, prevHash);
+    block.setHeader(BlockHeader(1, prevHash, "", 0, nonce, difficulty));
+    block.computeMerkleRoot();
+    return block;
+}
+
+// ====================================================================
+//  Asynchronous Mining Tests
+// ====================================================================
+
+TEST(MinerTest, MinedBlockMeetsDifficulty) {
+    Miner miner(2);
+    MiningHandle handle = miner.mine(makeTemplate("prev", 2));
+
+    std::optional<Block> block = handle.get();
+
+    ASSERT_TRUE(block.has_value());
+    EXPECT_TRUE(block->validateBlock(2));
+    EXPECT_EQ(block->getPreviousHash(), "prev");
+    EXPECT_TRUE(handle.isDone());
+    EXPECT_GT(handle.hashesDone(), 0u);
+}
+
+TEST(MinerTest, CancelStopsSearchWithoutResult) {
+    Miner miner(2);
+    // Practically impossible target
+    MiningHandle handle = miner.mine(makeTemplate("prev", 60));
+
+    handle.cancel();
+
+    ASSERT_TRUE(handle.waitFor(std::chrono::seconds(5)));
+    EXPECT_FALSE(handle.get().has_value());
+}
+
+TEST(MinerTest, NewSearchCancelsPreviousOne) {
+    Miner miner(2);
+    MiningHandle first = miner.mine(makeTemplate("first", 60));
+    MiningHandle second = miner.mine(makeTemplate("second", 1));
+
+    EXPECT_FALSE(first.get().has_value());
+    std::optional<Block> block = second.get();
+    ASSERT_TRUE(block.has_value());
+    EXPECT_EQ(block->getPreviousHash(), "second");
+}
+
+TEST(MinerTest, UpdatedTemplateIsMinedInsteadOfStaleOne) {
+    Miner miner(2);
+    MiningHandle handle = miner.mine(makeTemplate("stale", 60));
+
+    handle.updateTemplate(makeTemplate("fresh", 2));
+
+    std::optional<Block> block = handle.get();
+    ASSERT_TRUE(block.has_value());
+    EXPECT_EQ(block->getPreviousHash(), "fresh");
+    EXPECT_TRUE(block->validateBlock(2));
+}
+
+TEST(MinerTest, ProgressCallbackReportsHashes) {
+    Miner miner(2);
+    std::atomic<uint64_t> reported(0);
+    MiningHandle handle = miner.mine(makeTemplate("prev", 60),
+                                     [&](uint64_t hashes) { reported = hashes; },
+                                     1);
+
+    while (reported.load() == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    handle.cancel();
+
+    EXPECT_GT(reported.load(), 0u);
+    EXPECT_FALSE(handle.get().has_value());
+}
+
+TEST(MinerTest, ExhaustedNonceSpaceEndsSearchWithoutResult) {
+    Miner miner(2);
+    // Each lane has 500 nonces left before the end of the nonce space
+    MiningHandle handle = miner.mine(makeTemplate("prev", 60, std::numeric_limits<uint32_t>::max() - 999));
+
+    ASSERT_TRUE(handle.waitFor(std::chrono::seconds(5)));
+    EXPECT_FALSE(handle.get().has_value());
+    EXPECT_EQ(handle.hashesDone(), 1000u);
+}
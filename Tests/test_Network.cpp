@@ -0,0 +1,213 @@
+#include "gtest/gtest.h"
+#include "Encoding.h"
+#include "Message.h"
+#include "P2PNode.h"
+#include "Relay.h"
+#include <arpa/inet.h>
+#include <chrono>
+#include <condition_variable>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+// Helper: transaction with a null input, valid without funding
+static Transaction makeTransaction(const std::string& tag) {
+    TxIn in(std::string(64, '0'), 0, tag, "");
+    TxOut out(1, "dest_" + tag);
+    return Transaction({in}, {out});
+}
+
+// Helper: mined block on top of prevHash, at the difficulty of the genesis block
+static Block makeBlock(const std::string& prevHash, const std::vector<Transaction>& txs,
+                       uint32_t difficulty = 3) {
+    Block block(txs, prevHash);
+    block.setHeader(BlockHeader(1, prevHash, "", 0, 0, difficulty));
+    block.computeMerkleRoot();
+    block.mine();
+    return block;
+}
+
+// Helper: polls a condition for up to two seconds
+template <typename Condition>
+static bool waitUntil(Condition condition) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (condition()) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return condition();
+}
+
+// ====================================================================
+//  Encoding Tests
+// ====================================================================
+
+TEST(NetworkTest, FrameAndInventoryRoundTrip) {
+    std::vector<InventoryItem> items = {InventoryItem(InventoryType::Block, "abc"),
+                                        InventoryItem(InventoryType::Tx, std::string(64, 'f'))};
+    std::string frame = encodeFrame(MessageType::GetData, encodeInventory(items));
+
+    uint32_t payloadSize;
+    MessageType type;
+    ASSERT_TRUE(decodeFrameHeader(frame.data(), payloadSize, type));
+    EXPECT_EQ(type, MessageType::GetData);
+    ASSERT_EQ(payloadSize, frame.size() - FrameHeaderSize);
+
+    std::vector<InventoryItem> decoded;
+    ASSERT_TRUE(decodeInventory(frame.substr(FrameHeaderSize), decoded));
+    ASSERT_EQ(decoded.size(), 2u);
+    EXPECT_EQ(decoded[1].type, InventoryType::Tx);
+    EXPECT_EQ(decoded[1].hash, items[1].hash);
+
+    // Unknown message type
+    frame[4] = 9;
+    EXPECT_FALSE(decodeFrameHeader(frame.data(), payloadSize, type));
+}
+
+TEST(NetworkTest, BlockEncodingRoundTrip) {
+    Block block = makeBlock(std::string(64, '0'), {makeTransaction("a"), makeTransaction("b")});
+    std::string encoded;
+    block.encode(encoded);
+
+    ByteReader reader(encoded);
+    Block decoded("");
+    ASSERT_TRUE(Block::decode(reader, decoded));
+    EXPECT_TRUE(reader.atEnd());
+    EXPECT_EQ(decoded.serialize(), block.serialize());
+    EXPECT_EQ(decoded.getHash(), block.getHash());
+    ASSERT_EQ(decoded.getTransactions().size(), 2u);
+    EXPECT_EQ(decoded.getTransactions()[1].getTxid(), block.getTransactions()[1].getTxid());
+
+    // Truncated input
+    ByteReader truncated(encoded.data(), encoded.size() - 1);
+    EXPECT_FALSE(Block::decode(truncated, decoded));
+}
+
+// ====================================================================
+//  Transport Tests
+// ====================================================================
+
+TEST(NetworkTest, NodesExchangeMessagesOnLoopback) {
+    std::mutex mutex;
+    std::vector<std::string> received;
+    P2PNode server;
+    server.setMessageHandler([&](PeerId, MessageType type, const std::string& payload) {
+        std::lock_guard<std::mutex> lock(mutex);
+        EXPECT_EQ(type, MessageType::Tx);
+        received.push_back(payload);
+    });
+    ASSERT_TRUE(server.listen(0));
+
+    P2PNode client;
+    PeerId peer = client.connect("127.0.0.1", server.listeningPort());
+    ASSERT_NE(peer, 0u);
+
+    // Large enough to take several reads
+    std::string large(3 * 1024 * 1024, 'x');
+    EXPECT_TRUE(client.send(peer, MessageType::Tx, "small"));
+    EXPECT_TRUE(client.send(peer, MessageType::Tx, large));
+
+    ASSERT_TRUE(waitUntil([&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return received.size() == 2;
+    }));
+    EXPECT_EQ(received[0], "small");
+    EXPECT_EQ(received[1], large);
+    EXPECT_EQ(server.peerCount(), 1u);
+
+    client.disconnect(peer);
+    EXPECT_TRUE(waitUntil([&]() { return server.peerCount() == 0 && client.peerCount() == 0; }));
+}
+
+TEST(NetworkTest, SendQueueIsBounded) {
+    P2PConfig config;
+    config.maxSendQueueBytes = 1024 * 1024;
+    P2PNode node(config);
+
+    // A raw socket that never reads
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(addr);
+    ASSERT_EQ(bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    ASSERT_EQ(listen(listener, 1), 0);
+    getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &length);
+
+    PeerId peer = node.connect("127.0.0.1", ntohs(addr.sin_port));
+    ASSERT_NE(peer, 0u);
+
+    // Kernel buffers absorb some frames, then the queue fills up
+    std::string payload(64 * 1024, 'x');
+    bool rejected = false;
+    for (int i = 0; i < 10000 && !rejected; ++i) {
+        rejected = !node.send(peer, MessageType::Block, payload);
+    }
+    EXPECT_TRUE(rejected);
+    EXPECT_EQ(node.peerCount(), 1u);
+    close(listener);
+}
+
+// ====================================================================
+//  Relay Tests
+// ====================================================================
+
+TEST(NetworkTest, RelayPropagatesBlocksAndTransactions) {
+    Blockchain chainA;
+    Blockchain chainB(chainA.getBlock(0));
+    Mempool poolA;
+    Mempool poolB;
+    P2PNode nodeA;
+    P2PNode nodeB;
+    Relay relayA(chainA, poolA, nodeA);
+    Relay relayB(chainB, poolB, nodeB);
+    ASSERT_TRUE(nodeA.listen(0));
+
+    // A is two blocks ahead before B connects; B catches up from the tip
+    const std::string genesis = chainA.getLatestBlock().getHash();
+    Block a1 = makeBlock(genesis, {makeTransaction("coinbase_1")});
+    Block a2 = makeBlock(a1.getHash(), {makeTransaction("coinbase_2")});
+    ASSERT_TRUE(relayA.submitBlock(a1));
+    ASSERT_TRUE(relayA.submitBlock(a2));
+
+    ASSERT_NE(nodeB.connect("127.0.0.1", nodeA.listeningPort()), 0u);
+    ASSERT_TRUE(waitUntil([&]() { return relayB.getTipHash() == a2.getHash(); }));
+    EXPECT_EQ(relayB.getHeight(), 2u);
+    EXPECT_EQ(relayB.orphanCount(), 0u);
+
+    // New blocks and transactions flow both ways
+    Block b3 = makeBlock(a2.getHash(), {makeTransaction("coinbase_3")});
+    ASSERT_TRUE(relayB.submitBlock(b3));
+    Transaction tx = makeTransaction("payment");
+    ASSERT_TRUE(relayA.submitTransaction(tx));
+
+    EXPECT_TRUE(waitUntil([&]() { return relayA.getTipHash() == b3.getHash(); }));
+    EXPECT_TRUE(waitUntil([&]() { return relayB.hasTransaction(tx.getTxid()); }));
+}
+
+TEST(NetworkTest, RelayRefusesBlocksBelowChainDifficulty) {
+    Blockchain chain;
+    Mempool pool;
+    P2PNode node;
+    Relay relay(chain, pool, node);
+    ASSERT_TRUE(node.listen(0));
+
+    P2PNode sender;
+    PeerId peer = sender.connect("127.0.0.1", node.listeningPort());
+    ASSERT_NE(peer, 0u);
+    ASSERT_TRUE(waitUntil([&]() { return node.peerCount() == 1; }));
+
+    // Valid proof of work for the difficulty it declares, below the chain's
+    const std::string genesis = chain.getLatestBlock().getHash();
+    Block easy = makeBlock(genesis, {makeTransaction("coinbase_easy")}, 0);
+    std::string encoded;
+    easy.encode(encoded);
+    ASSERT_TRUE(sender.send(peer, MessageType::Block, encoded));
+
+    EXPECT_TRUE(waitUntil([&]() { return sender.peerCount() == 0; }));
+    EXPECT_FALSE(relay.hasBlock(easy.getHash()));
+    EXPECT_EQ(relay.getTipHash(), genesis);
+}
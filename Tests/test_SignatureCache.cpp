@@ -0,0 +1,173 @@
+#include "gtest/gtest.h"
+#include "Blockchain.h"
+#include "Mempool.h"
+#include "SignatureCache.h"
+#include <openssl/ec.h>
+#include <openssl/x509.h>
+#include <thread>
+#include <vector>
+
+// Helper: secp256k1 key with its DER public key
+struct Key {
+    EVP_PKEY* pkey;
+    std::string publicKey;
+
+    Key() : pkey(EVP_EC_gen("secp256k1")) {
+        unsigned char* der = nullptr;
+        int len = i2d_PUBKEY(pkey, &der);
+        publicKey.assign(reinterpret_cast<char*>(der), len);
+        OPENSSL_free(der);
+    }
+    ~Key() { EVP_PKEY_free(pkey); }
+
+    std::string owner() const { return Transaction::hashPublicKey(publicKey); }
+};
+
+// Helper: coinbase transaction paying one output of `amount` to each owner
+static Transaction makeCoinbase(const std::string& tag, const std::vector<std::string>& owners,
+                                uint64_t amount = 50) {
+    TxIn in(std::string(64, '0'), 0, "coinbase_" + tag, "");
+    std::vector<TxOut> outs;
+    for (const auto& owner : owners) {
+        outs.emplace_back(amount, owner);
+    }
+    return Transaction({in}, outs);
+}
+
+// Helper: transaction spending output index of prev, signed by key
+static Transaction makeSpend(const Transaction& prev, uint32_t index, const Key& key,
+                             const std::string& to, uint64_t amount = 50) {
+    Transaction tx({TxIn(prev.getTxid(), index, "", key.publicKey)}, {TxOut(amount, to)});
+    EXPECT_TRUE(tx.signInput(0, key.pkey));
+    return tx;
+}
+
+// Helper: mined block at difficulty 1 on top of prevHash
+static Block makeBlock(const std::string& prevHash, const std::vector<Transaction>& txs) {
+    Block block(txs, prevHash);
+    block.setHeader(BlockHeader(1, prevHash, "", 0, 0, 1));
+    block.computeMerkleRoot();
+    block.mine();
+    return block;
+}
+
+// ====================================================================
+//  Input Signature Tests
+// ====================================================================
+
+TEST(SignatureCacheTest, SignedInputVerifiesAgainstItsOwner) {
+    Key alice, bob;
+    Transaction coinbase = makeCoinbase("a", {alice.owner()});
+    Transaction spend = makeSpend(coinbase, 0, alice, bob.owner());
+    const TxOut& spent = coinbase.getOutputs()[0];
+
+    EXPECT_TRUE(spend.verifyInput(0, spent));
+    // Output owned by someone else
+    EXPECT_FALSE(spend.verifyInput(0, TxOut(50, bob.owner())));
+
+    // Any change to the signed fields breaks the signature
+    Transaction tampered = spend;
+    tampered.setOutput(0, TxOut(49, spend.getOutputs()[0].publicKeyHash));
+    EXPECT_FALSE(tampered.verifyInput(0, spent));
+
+    // Alice's public key with Bob's signature
+    Transaction forged({TxIn(coinbase.getTxid(), 0, "", alice.publicKey)}, {TxOut(50, bob.owner())});
+    ASSERT_TRUE(forged.signInput(0, bob.pkey));
+    EXPECT_FALSE(forged.verifyInput(0, spent));
+}
+
+// ====================================================================
+//  Cache Tests
+// ====================================================================
+
+TEST(SignatureCacheTest, KeepsTheNewestEntriesWithinItsBound) {
+    SignatureCache cache(64);
+    const TXID txid(64, 'a');
+    for (uint32_t i = 0; i < 1000; ++i) {
+        cache.insert(txid, i, "sig");
+    }
+
+    EXPECT_LE(cache.size(), 64u);
+    EXPECT_GT(cache.size(), 0u);
+    EXPECT_TRUE(cache.contains(txid, 999, "sig"));
+    EXPECT_FALSE(cache.contains(txid, 0, "sig"));
+    // The signature is part of the entry
+    EXPECT_FALSE(cache.contains(txid, 999, "other"));
+    EXPECT_EQ(cache.hits(), 1u);
+    EXPECT_EQ(cache.misses(), 2u);
+}
+
+TEST(SignatureCacheTest, ConcurrentInsertsAndLookups) {
+    SignatureCache cache(1 << 16);
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < 4; ++t) {
+        threads.emplace_back([&cache, t] {
+            const TXID txid(64, static_cast<char>('a' + t));
+            for (uint32_t i = 0; i < 2000; ++i) {
+                cache.insert(txid, i, "sig");
+                EXPECT_TRUE(cache.contains(txid, i, "sig"));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(cache.size(), 8000u);
+}
+
+// ====================================================================
+//  Acceptance Tests
+// ====================================================================
+
+TEST(SignatureCacheTest, BlockWithInvalidSignatureIsRejected) {
+    Key alice, bob;
+    Blockchain chain;
+    chain.enableSignatureChecks();
+    Transaction coinbase = makeCoinbase("a", {alice.owner(), alice.owner()});
+    ASSERT_TRUE(chain.addBlock(makeBlock(chain.getLatestBlock().getHash(), {coinbase})));
+
+    // Bob signs for Alice's output
+    Transaction theft({TxIn(coinbase.getTxid(), 0, "", alice.publicKey)}, {TxOut(50, bob.owner())});
+    ASSERT_TRUE(theft.signInput(0, bob.pkey));
+    Block bad = makeBlock(chain.getLatestBlock().getHash(), {makeCoinbase("b", {bob.owner()}), theft});
+    EXPECT_FALSE(chain.addBlock(bad));
+    EXPECT_EQ(chain.getHeight(), 1u);
+    EXPECT_NE(chain.getUTXOSet().find(OutPoint(coinbase.getTxid(), 0)), nullptr);
+
+    Transaction spend = makeSpend(coinbase, 1, alice, bob.owner());
+    Block good = makeBlock(chain.getLatestBlock().getHash(), {makeCoinbase("c", {bob.owner()}), spend});
+    EXPECT_TRUE(chain.addBlock(good));
+    EXPECT_EQ(chain.getHeight(), 2u);
+}
+
+TEST(SignatureCacheTest, BlockSkipsSignaturesVerifiedByTheMempool) {
+    Key alice, bob;
+    SignatureCache cache;
+    Blockchain chain;
+    Mempool mempool;
+    chain.enableSignatureChecks(&cache);
+    mempool.enableSignatureChecks(chain.getUTXOSet(), &cache);
+    chain.addListener(&mempool);
+
+    Transaction coinbase = makeCoinbase("a", {alice.owner(), alice.owner()});
+    ASSERT_TRUE(chain.addBlock(makeBlock(chain.getLatestBlock().getHash(), {coinbase})));
+
+    // A pooled parent and its child, and a transaction spending nothing known
+    Transaction parent = makeSpend(coinbase, 0, alice, bob.owner());
+    Transaction child = makeSpend(parent, 0, bob, alice.owner());
+    Transaction orphan = makeSpend(child, 0, alice, bob.owner());
+    Transaction forged = makeSpend(coinbase, 1, bob, bob.owner());
+    EXPECT_TRUE(mempool.addTransaction(parent));
+    EXPECT_TRUE(mempool.addTransaction(child));
+    EXPECT_FALSE(mempool.addTransaction(forged));
+    mempool.removeTransaction(child.getTxid());
+    EXPECT_FALSE(mempool.addTransaction(orphan));
+    EXPECT_EQ(cache.size(), 2u);
+
+    const uint64_t hits = cache.hits();
+    Block block = makeBlock(chain.getLatestBlock().getHash(),
+                            {makeCoinbase("b", {bob.owner()}), parent, child});
+    EXPECT_TRUE(chain.addBlock(block));
+    EXPECT_EQ(cache.hits() - hits, 2u);
+    EXPECT_EQ(mempool.size(), 0u);
+}
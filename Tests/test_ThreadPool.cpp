@@ -0,0 +1,77 @@
+#include "gtest/gtest.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+// ====================================================================
+//  Task Submission Tests
+// ====================================================================
+
+TEST(ThreadPoolTest, SubmitReturnsResult) {
+    ThreadPool pool(2);
+
+    std::future<int> result = pool.submit([]() { return 6 * 7; });
+
+    EXPECT_EQ(result.get(), 42);
+}
+
+TEST(ThreadPoolTest, HighPriorityRunsBeforeQueuedBackgroundWork) {
+    ThreadPool pool(1);
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::mutex mutex;
+    std::vector<int> order;
+
+    // Keep the only worker busy while the other tasks are queued
+    pool.post([released]() { released.wait(); });
+    std::vector<std::future<void>> done;
+    for (int i = 0; i < 3; ++i) {
+        done.push_back(pool.submit([&]() { std::lock_guard<std::mutex> lock(mutex); order.push_back(2); },
+                                   TaskPriority::Background));
+    }
+    done.push_back(pool.submit([&]() { std::lock_guard<std::mutex> lock(mutex); order.push_back(0); },
+                               TaskPriority::High));
+    release.set_value();
+    for (auto& future : done) {
+        future.get();
+    }
+
+    ASSERT_EQ(order.size(), 4u);
+    EXPECT_EQ(order.front(), 0);
+}
+
+// ====================================================================
+//  parallelFor Tests
+// ====================================================================
+
+TEST(ThreadPoolTest, ParallelForVisitsEveryIndexOnce) {
+    ThreadPool pool(4);
+    std::vector<std::atomic<int>> visits(10007);
+
+    pool.parallelFor(0, visits.size(), [&](size_t i) { visits[i].fetch_add(1); });
+
+    for (const auto& count : visits) {
+        EXPECT_EQ(count.load(), 1);
+    }
+}
+
+TEST(ThreadPoolTest, ParallelForEmptyRangeDoesNothing) {
+    ThreadPool pool(2);
+    std::atomic<int> calls(0);
+
+    pool.parallelFor(5, 5, [&](size_t) { calls++; });
+
+    EXPECT_EQ(calls.load(), 0);
+}
+
+TEST(ThreadPoolTest, NestedParallelForCompletes) {
+    ThreadPool pool(2);
+    std::atomic<size_t> sum(0);
+
+    pool.parallelFor(0, 8, [&](size_t i) {
+        pool.parallelFor(0, 100, [&](size_t j) { sum += i * 100 + j; }, TaskPriority::Normal, 10);
+    }, TaskPriority::Normal, 1);
+
+    EXPECT_EQ(sum.load(), 799u * 800u / 2u);
+}
@@ -0,0 +1,126 @@
+#include "gtest/gtest.h"
+#include "Blockchain.h"
+#include "Trace.h"
+#include <openssl/ec.h>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Built with BLOCKCHAIN_ENABLE_TRACING, so that Core records its spans
+
+// Helper: names of the collected spans, with their counts
+static std::map<std::string, size_t> countByName() {
+    std::map<std::string, size_t> counts;
+    for (const TraceEvent& event : Trace::collect()) {
+        ++counts[event.name];
+    }
+    return counts;
+}
+
+// ====================================================================
+//  Recording Tests
+// ====================================================================
+
+TEST(TraceTest, ScopesRecordNestedSpans) {
+    Trace::clear();
+    {
+        TRACE_SCOPE("outer");
+        {
+            TRACE_SCOPE("inner");
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    const std::vector<TraceEvent> events = Trace::collect();
+    ASSERT_EQ(events.size(), 2u);
+    EXPECT_STREQ(events[0].name, "outer");
+    EXPECT_STREQ(events[1].name, "inner");
+    EXPECT_GE(events[1].duration, 1000000u);
+    EXPECT_LE(events[0].start, events[1].start);
+    EXPECT_GE(events[0].start + events[0].duration, events[1].start + events[1].duration);
+    EXPECT_EQ(events[0].thread, events[1].thread);
+}
+
+TEST(TraceTest, ThreadsRecordOnTracksOfTheirOwn) {
+    Trace::clear();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([] {
+            for (int i = 0; i < 100; ++i) {
+                TRACE_SCOPE("work");
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::map<uint32_t, size_t> perThread;
+    for (const TraceEvent& event : Trace::collect()) {
+        ++perThread[event.thread];
+    }
+    ASSERT_EQ(perThread.size(), 4u);
+    for (const auto& entry : perThread) {
+        EXPECT_EQ(entry.second, 100u);
+    }
+    EXPECT_EQ(Trace::dropped(), 0u);
+}
+
+TEST(TraceTest, FullBufferKeepsTheNewestSpans) {
+    Trace::clear();
+    std::thread([] {
+        for (uint64_t i = 0; i < Trace::BufferSize + 10; ++i) {
+            Trace::record("span", i, i + 1);
+        }
+    }).join();
+
+    const std::vector<TraceEvent> events = Trace::collect();
+    ASSERT_EQ(events.size(), Trace::BufferSize);
+    EXPECT_EQ(events.front().start, 10u);
+    EXPECT_EQ(events.back().start, Trace::BufferSize + 9);
+    EXPECT_EQ(Trace::dropped(), 10u);
+}
+
+// ====================================================================
+//  Instrumentation and Export Tests
+// ====================================================================
+
+TEST(TraceTest, BlockProcessingIsInstrumented) {
+    Blockchain chain;
+    Trace::clear();
+
+    Transaction tx({TxIn(std::string(64, '0'), 0, "coinbase_a", "")}, {TxOut(50, "owner")});
+    tx.computeHash();
+    EVP_PKEY* key = EVP_EC_gen("secp256k1");
+    tx.sign(key);
+    EVP_PKEY_free(key);
+
+    Block block({tx}, chain.getLatestBlock().getHash());
+    block.setHeader(BlockHeader(1, chain.getLatestBlock().getHash(), "", 0, 0, 1));
+    block.computeMerkleRoot();
+    block.mine();
+    ASSERT_TRUE(chain.addBlock(block));
+
+    const std::map<std::string, size_t> counts = countByName();
+    for (const char* name : {"Transaction::computeHash", "Transaction::sign", "Block::computeMerkleRoot",
+                             "Block::mine", "Blockchain::addBlock", "UTXOSet::connectBlock"}) {
+        EXPECT_EQ(counts.count(name), 1u) << name;
+    }
+}
+
+TEST(TraceTest, ExportsChromeTraceEvents) {
+    Trace::clear();
+    Trace::record("quoted \"name\"", 1500, 4000);
+    std::ostringstream out;
+    ASSERT_TRUE(Trace::exportJson(out));
+
+    const std::string json = out.str();
+    EXPECT_EQ(json.rfind("{\"traceEvents\":[", 0), 0u);
+    EXPECT_NE(json.find("\"name\":\"quoted \\\"name\\\"\",\"cat\":\"blockchain\",\"ph\":\"X\""), std::string::npos);
+    EXPECT_NE(json.find("\"ts\":1.500,\"dur\":2.500}"), std::string::npos);
+    EXPECT_NE(json.find("],\"displayTimeUnit\":\"ns\"}"), std::string::npos);
+
+    EXPECT_FALSE(Trace::exportJson(std::string("/nonexistent/trace.json")));
+}
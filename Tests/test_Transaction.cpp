@@ -1,5 +1,7 @@
 #include "gtest/gtest.h"
 #include "Transaction.h"
+#include "BatchHash.h"
+#include "Encoding.h"
 #include <chrono>
 #include <thread>
 #include <openssl/evp.h>
@@ -22,8 +24,8 @@ TEST(TransactionTest, ConstructorSetsTimestamp) {
     uint64_t after  = std::chrono::duration_cast<std::chrono::milliseconds>(
                         std::chrono::system_clock::now().time_since_epoch()).count();
 
-    EXPECT_GE(tx.timestamp, before);
-    EXPECT_LE(tx.timestamp, after);
+    EXPECT_GE(tx.getTimestamp(), before);
+    EXPECT_LE(tx.getTimestamp(), after);
 }
 
 TEST(TransactionTest, ParameterizedConstructorSetsTimestamp) {
@@ -36,10 +38,10 @@ TEST(TransactionTest, ParameterizedConstructorSetsTimestamp) {
     uint64_t after = std::chrono::duration_cast<std::chrono::milliseconds>(
                         std::chrono::system_clock::now().time_since_epoch()).count();
 
-    EXPECT_GE(tx.timestamp, before);
-    EXPECT_LE(tx.timestamp, after);
-    EXPECT_EQ(tx.inputs.size(), 1);
-    EXPECT_EQ(tx.outputs.size(), 1);
+    EXPECT_GE(tx.getTimestamp(), before);
+    EXPECT_LE(tx.getTimestamp(), after);
+    EXPECT_EQ(tx.getInputs().size(), 1);
+    EXPECT_EQ(tx.getOutputs().size(), 1);
 }
 
 TEST(TransactionTest, IDComputedAutomaticallyAndDeterministically) {
@@ -47,11 +49,11 @@ TEST(TransactionTest, IDComputedAutomaticallyAndDeterministically) {
     TxOut out1(50, "alice");
 
     Transaction tx({in1}, {out1});
-    TXID id1 = tx.txid;
+    TXID id1 = tx.getTxid();
     tx.computeHash();
 
     ASSERT_FALSE(id1.empty());
-    EXPECT_EQ(id1, tx.txid);  // ID must match the hash
+    EXPECT_EQ(id1, tx.getTxid());  // ID must match the hash
 }
 
 // ------------------------------------------------------------
@@ -67,7 +69,7 @@ TEST(TransactionTest, SerializeIncludesTimestamp) {
     std::string ser = tx.serialize();
 
     // Timestamp must appear as decimal text
-    EXPECT_NE(ser.find(std::to_string(tx.timestamp)), std::string::npos);
+    EXPECT_NE(ser.find(std::to_string(tx.getTimestamp())), std::string::npos);
 }
 
 TEST(TransactionTest, SerializeIncludesInputsAndOutputs) {
@@ -99,8 +101,8 @@ TEST(TransactionTest, SameDataSameHash) {
     tx2.computeHash();
 
     // Because timestamps differ, hashes MUST differ
-    EXPECT_NE(tx1.timestamp, tx2.timestamp);
-    EXPECT_NE(tx1.txid, tx2.txid);
+    EXPECT_NE(tx1.getTimestamp(), tx2.getTimestamp());
+    EXPECT_NE(tx1.getTxid(), tx2.getTxid());
 }
 
 TEST(TransactionTest, IdenticalTimestampYieldsIdenticalHashes) {
@@ -111,13 +113,13 @@ TEST(TransactionTest, IdenticalTimestampYieldsIdenticalHashes) {
     Transaction tx2({in}, {out});
 
     // Force tx2 timestamp to match tx1
-    tx2.timestamp = tx1.timestamp;
+    tx2.setTimestamp(tx1.getTimestamp());
 
     tx1.computeHash();
     tx2.computeHash();
 
     EXPECT_EQ(tx1.serialize(), tx2.serialize());
-    EXPECT_EQ(tx1.txid, tx2.txid);
+    EXPECT_EQ(tx1.getTxid(), tx2.getTxid());
 }
 
 // ------------------------------------------------------------
@@ -127,7 +129,7 @@ TEST(TransactionTest, IdenticalTimestampYieldsIdenticalHashes) {
 TEST(TransactionTest, EmptyInputsOrOutputsAllowedButHashValid) {
     Transaction tx({}, {});
     tx.computeHash();
-    EXPECT_FALSE(tx.txid.empty());
+    EXPECT_FALSE(tx.getTxid().empty());
 }
 
 TEST(TransactionTest, MultipleInputsOutputsSerializeCorrectly) {
@@ -159,12 +161,112 @@ TEST(TransactionTest, IDStableAfterInitialComputation) {
     TxOut out(77, "dest");
 
     Transaction tx({in}, {out});
-    TXID idFirst = tx.txid;
+    TXID idFirst = tx.getTxid();
     tx.computeHash();
-    TXID idSecond = tx.txid;
+    TXID idSecond = tx.getTxid();
 
     EXPECT_EQ(idFirst, idSecond); // ID stored must match computed hash
 }
+
+TEST(TransactionTest, MutationInvalidatesCachedID) {
+    TxIn in("aaa", 5, "sig", "pk");
+    TxOut out(77, "dest");
+
+    Transaction tx({in}, {out});
+    TXID before = tx.getTxid();
+    Transaction copy = tx;
+
+    tx.setOutput(0, TxOut(78, "dest"));
+    EXPECT_NE(tx.getTxid(), before);
+    EXPECT_EQ(copy.getTxid(), before); // Copies keep their own cache
+
+    tx.setOutput(0, out);
+    EXPECT_EQ(tx.getTxid(), before);
+
+    tx.setInput(0, TxIn("aaa", 6, "sig", "pk"));
+    EXPECT_NE(tx.getTxid(), before);
+    tx.setInput(0, in);
+    EXPECT_EQ(tx.getTxid(), before);
+
+    // The transaction signature is not part of the ID
+    tx.setSignature("signed");
+    EXPECT_EQ(tx.getTxid(), before);
+}
+
+TEST(TransactionTest, ConcurrentFirstAccessYieldsSameID) {
+    TxIn in("aaa", 5, "sig", "pk");
+    TxOut out(77, "dest");
+
+    Transaction reference({in}, {out}, 1234);
+    const TXID expected = reference.getTxid();
+
+    for (int round = 0; round < 50; ++round) {
+        Transaction tx({in}, {out}, 1234);
+        std::vector<std::thread> threads;
+        std::vector<TXID> ids(4);
+        for (size_t t = 0; t < ids.size(); ++t) {
+            threads.emplace_back([&tx, &ids, t]() { ids[t] = tx.getTxid(); });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        for (const auto& id : ids) {
+            EXPECT_EQ(id, expected);
+        }
+    }
+}
+
+TEST(TransactionTest, BatchHashingMatchesIndividualHashing) {
+    // Large enough to be spread over the thread pool
+    std::vector<Transaction> batch;
+    for (uint64_t i = 0; i < 500; ++i) {
+        batch.emplace_back(std::vector<TxIn>{TxIn("prev" + std::to_string(i), 0, "sig", "pk")},
+                           std::vector<TxOut>{TxOut(i + 1, "dest")}, 1000 + i);
+    }
+    hashTransactions(batch);
+
+    for (const auto& tx : batch) {
+        EXPECT_EQ(tx.getTxid(), Transaction(tx.getInputs(), tx.getOutputs(), tx.getTimestamp()).getTxid());
+    }
+    EXPECT_NE(batch[0].getTxid(), batch[1].getTxid());
+}
+
+TEST(TransactionTest, EncodingRoundTripKeepsID) {
+    TxIn in("prev", 2, "sig", "pk");
+    TxOut out(500, "carol");
+
+    Transaction tx({in}, {out});
+    tx.setSignature("txsig");
+    std::string encoded;
+    tx.encode(encoded);
+
+    ByteReader reader(encoded);
+    Transaction decoded;
+    ASSERT_TRUE(Transaction::decode(reader, decoded));
+    EXPECT_TRUE(reader.atEnd());
+    EXPECT_EQ(decoded.getSignature(), "txsig");
+    EXPECT_EQ(decoded.getTxid(), tx.getTxid());
+}
+
+TEST(TransactionTest, EncodedSizeFollowsChanges) {
+    Transaction tx({TxIn("prev", 2, "sig", "pk")}, {TxOut(500, "carol")});
+    auto encodedSize = [](const Transaction& t) {
+        std::string encoded;
+        t.encode(encoded);
+        return encoded.size();
+    };
+    EXPECT_EQ(tx.getEncodedSize(), encodedSize(tx));
+
+    // The cached size is dropped by every change to an encoded field
+    tx.addOutput(TxOut(7, "dave"));
+    EXPECT_EQ(tx.getEncodedSize(), encodedSize(tx));
+    tx.addInput(TxIn("prev", 3, std::string(100, 'x'), "pk"));
+    EXPECT_EQ(tx.getEncodedSize(), encodedSize(tx));
+    tx.setSignature(std::string(300, 's'));
+    EXPECT_EQ(tx.getEncodedSize(), encodedSize(tx));
+    Transaction copy = tx;
+    EXPECT_EQ(copy.getEncodedSize(), encodedSize(tx));
+}
 // ------------------------------------------------------------
 //  Signing Tests
 // ------------------------------------------------------------
@@ -210,12 +312,12 @@ TEST(TransactionTest, SignatureGeneratedSuccessfully) {
     ASSERT_NE(pkey, nullptr) << "Failed to generate test key pair";
 
     // Before signing, signature should be empty
-    EXPECT_EQ(tx.txsignature, "");
+    EXPECT_EQ(tx.getSignature(), "");
 
     tx.sign(pkey);
 
     // After signing, signature should not be empty
-    EXPECT_NE(tx.txsignature, "");
+    EXPECT_NE(tx.getSignature(), "");
 
     EVP_PKEY_free(pkey);
 }
@@ -238,7 +340,7 @@ TEST(TransactionTest, DifferentTransactionsDifferentSignatures) {
 
     // Different transactions should produce different signatures
     // (with extremely high probability for RSA signatures)
-    EXPECT_NE(tx1.txsignature, tx2.txsignature);
+    EXPECT_NE(tx1.getSignature(), tx2.getSignature());
 
     EVP_PKEY_free(pkey);
 }
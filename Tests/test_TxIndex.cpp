@@ -0,0 +1,178 @@
+#include "gtest/gtest.h"
+#include "TxIndex.h"
+#include <filesystem>
+
+// Helper: coinbase transaction paying `amount` to `owner`
+static Transaction makeCoinbase(const std::string& owner, uint64_t amount = 50) {
+    TxIn in(std::string(64, '0'), 0, "coinbase_" + owner, "");
+    TxOut out(amount, owner);
+    return Transaction({in}, {out});
+}
+
+// Helper: mined block at difficulty 1 on top of prevHash
+static Block makeBlock(const std::string& prevHash, const std::vector<Transaction>& txs) {
+    Block block(txs, prevHash);
+    block.setHeader(BlockHeader(1, prevHash, "", 0, 0, 1));
+    block.computeMerkleRoot();
+    block.mine();
+    return block;
+}
+
+// Helper: adds count blocks of txPerBlock coinbase transactions to chain
+static std::vector<Transaction> extendChain(Blockchain& chain, size_t count, size_t txPerBlock,
+                                            const std::string& tag) {
+    std::vector<Transaction> added;
+    for (size_t b = 0; b < count; ++b) {
+        std::vector<Transaction> txs;
+        for (size_t t = 0; t < txPerBlock; ++t) {
+            txs.push_back(makeCoinbase(tag + "_" + std::to_string(b) + "_" + std::to_string(t)));
+        }
+        EXPECT_TRUE(chain.addBlock(makeBlock(chain.getLatestBlock().getHash(), txs)));
+        added.insert(added.end(), txs.begin(), txs.end());
+    }
+    return added;
+}
+
+// Helper: index path in the temporary directory, removed on destruction
+struct TempIndex {
+    std::string path;
+
+    explicit TempIndex(const std::string& name)
+        : path((std::filesystem::temp_directory_path() / name).string()) {
+        std::filesystem::remove(path);
+    }
+    ~TempIndex() { std::filesystem::remove(path); }
+};
+
+// ====================================================================
+//  Lookup Tests
+// ====================================================================
+
+TEST(TxIndexTest, FindsTransactionsOfConnectedBlocks) {
+    Blockchain chain;
+    TxIndex index;
+    ASSERT_TRUE(index.open(chain));
+
+    Transaction cb = makeCoinbase("alice");
+    Transaction pay({TxIn(cb.getTxid(), 0, "sig", "pk")}, {TxOut(50, "bob")});
+    ASSERT_TRUE(chain.addBlock(makeBlock(chain.getLatestBlock().getHash(), {cb})));
+    ASSERT_TRUE(chain.addBlock(makeBlock(chain.getLatestBlock().getHash(), {makeCoinbase("miner"), pay})));
+
+    TxLocation location;
+    ASSERT_TRUE(index.find(pay.getTxid(), location));
+    EXPECT_EQ(location.height, 2u);
+    EXPECT_EQ(location.position, 1u);
+    ASSERT_TRUE(index.find(cb.getTxid(), location));
+    EXPECT_EQ(location.height, 1u);
+    EXPECT_EQ(location.position, 0u);
+
+    const Transaction* found = index.findTransaction(pay.getTxid());
+    ASSERT_NE(found, nullptr);
+    EXPECT_EQ(found->getOutputs()[0].publicKeyHash, "bob");
+    EXPECT_EQ(index.findTransaction(std::string(64, 'f')), nullptr);
+}
+
+TEST(TxIndexTest, SharedTruncatedKeyIsNotAMatch) {
+    Blockchain chain;
+    TxIndex index;
+    ASSERT_TRUE(index.open(chain));
+    std::vector<Transaction> txs = extendChain(chain, 1, 3, "key");
+
+    // Same first 8 bytes as an indexed txid, so the same slot key
+    TXID lookalike = txs[1].getTxid();
+    lookalike.back() = lookalike.back() == '0' ? '1' : '0';
+    TxLocation location;
+    EXPECT_FALSE(index.find(lookalike, location));
+    EXPECT_TRUE(index.find(txs[1].getTxid(), location));
+}
+
+TEST(TxIndexTest, ReorgRemovesDisconnectedTransactions) {
+    Blockchain chain;
+    TxIndex index;
+    ASSERT_TRUE(index.open(chain));
+    const std::string genesis = chain.getLatestBlock().getHash();
+
+    Transaction a1cb = makeCoinbase("a1");
+    Transaction a2cb = makeCoinbase("a2");
+    Block a1 = makeBlock(genesis, {a1cb});
+    ASSERT_TRUE(chain.addBlock(a1));
+    ASSERT_TRUE(chain.addBlock(makeBlock(a1.getHash(), {a2cb})));
+
+    // A longer branch replacing a2
+    Transaction b2cb = makeCoinbase("b2");
+    Block b2 = makeBlock(a1.getHash(), {b2cb});
+    ASSERT_TRUE(chain.addBlock(b2));
+    ASSERT_TRUE(chain.addBlock(makeBlock(b2.getHash(), {makeCoinbase("b3")})));
+
+    TxLocation location;
+    EXPECT_FALSE(index.find(a2cb.getTxid(), location));
+    ASSERT_TRUE(index.find(b2cb.getTxid(), location));
+    EXPECT_EQ(location.height, 2u);
+    EXPECT_TRUE(index.find(a1cb.getTxid(), location));
+    EXPECT_EQ(index.size(), chain.getBlock(0).getTransactions().size() + 3);
+}
+
+// ====================================================================
+//  Build Tests
+// ====================================================================
+
+TEST(TxIndexTest, BuildsExistingChainInBackground) {
+    Blockchain chain;
+    // Enough transactions to grow the table past its first capacity
+    std::vector<Transaction> txs = extendChain(chain, 40, 50, "old");
+
+    TxIndex index;
+    ASSERT_TRUE(index.open(chain));
+    // Blocks connected during the build are indexed by the listener
+    std::vector<Transaction> recent = extendChain(chain, 2, 3, "new");
+    index.waitForBuild();
+    EXPECT_TRUE(index.isBuilt());
+
+    TxLocation location;
+    for (size_t i = 0; i < txs.size(); ++i) {
+        ASSERT_TRUE(index.find(txs[i].getTxid(), location)) << i;
+        EXPECT_EQ(location.height, i / 50 + 1);
+        EXPECT_EQ(location.position, i % 50);
+    }
+    for (const auto& tx : recent) {
+        EXPECT_TRUE(index.find(tx.getTxid(), location));
+    }
+    EXPECT_EQ(index.size(), chain.getBlock(0).getTransactions().size() + txs.size() + recent.size());
+}
+
+TEST(TxIndexTest, ReopenedFileResumesOrRebuilds) {
+    TempIndex file("test_txindex_reopen.idx");
+    Blockchain chain;
+    std::vector<Transaction> first = extendChain(chain, 3, 2, "first");
+    {
+        TxIndex index(file.path);
+        ASSERT_TRUE(index.open(chain));
+        index.waitForBuild();
+    }
+
+    // Connected while the index is closed
+    std::vector<Transaction> second = extendChain(chain, 2, 2, "second");
+    {
+        TxIndex index(file.path);
+        ASSERT_TRUE(index.open(chain));
+        index.waitForBuild();
+        TxLocation location;
+        ASSERT_TRUE(index.find(first[0].getTxid(), location));
+        EXPECT_EQ(location.height, 1u);
+        ASSERT_TRUE(index.find(second[3].getTxid(), location));
+        EXPECT_EQ(location.height, 5u);
+        EXPECT_EQ(index.size(), chain.getBlock(0).getTransactions().size() + 10);
+    }
+
+    // The tip of the file is not on the active chain of another node
+    Blockchain other;
+    std::vector<Transaction> fork = extendChain(other, 6, 1, "fork");
+    TxIndex index(file.path);
+    ASSERT_TRUE(index.open(other));
+    index.waitForBuild();
+    TxLocation location;
+    EXPECT_FALSE(index.find(first[0].getTxid(), location));
+    ASSERT_TRUE(index.find(fork[5].getTxid(), location));
+    EXPECT_EQ(location.height, 6u);
+    EXPECT_EQ(index.size(), other.getBlock(0).getTransactions().size() + 6);
+}
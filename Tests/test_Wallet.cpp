@@ -0,0 +1,186 @@
+#include "gtest/gtest.h"
+#include "Blockchain.h"
+#include "Mempool.h"
+#include "SignatureCache.h"
+#include "Wallet.h"
+#include <numeric>
+#include <vector>
+
+// Helper: coinbase transaction tagged `tag`, paying each amount to owner
+static Transaction makeCoinbase(const std::string& tag, const std::string& owner,
+                                const std::vector<uint64_t>& amounts) {
+    TxIn in(std::string(64, '0'), 0, "coinbase_" + tag, "");
+    std::vector<TxOut> outs;
+    for (uint64_t amount : amounts) {
+        outs.emplace_back(amount, owner);
+    }
+    return Transaction({in}, outs);
+}
+
+// Helper: mined block at difficulty 1 on top of prevHash
+static Block makeBlock(const std::string& prevHash, const std::vector<Transaction>& txs) {
+    Block block(txs, prevHash);
+    block.setHeader(BlockHeader(1, prevHash, "", 0, 0, 1));
+    block.computeMerkleRoot();
+    block.mine();
+    return block;
+}
+
+static uint64_t sum(const std::vector<Wallet::Coin>& coins) {
+    return std::accumulate(coins.begin(), coins.end(), uint64_t(0),
+                           [](uint64_t total, const Wallet::Coin& coin) { return total + coin.amount; });
+}
+
+// ====================================================================
+//  Key and Tracking Tests
+// ====================================================================
+
+TEST(WalletTest, KeysCacheTheirPublicKeyAndHash) {
+    Blockchain chain;
+    Wallet wallet(chain);
+    const WalletKey* key = wallet.generateKey();
+    ASSERT_NE(key, nullptr);
+    EXPECT_EQ(key->publicKey, Wallet::encodePublicKey(key->pkey));
+    EXPECT_EQ(key->publicKeyHash, Transaction::hashPublicKey(key->publicKey));
+    EXPECT_EQ(wallet.findKey(key->publicKeyHash), key);
+    EXPECT_EQ(wallet.findKey(std::string(64, 'a')), nullptr);
+
+    // The same key is added once
+    EXPECT_EQ(wallet.addKey(key->pkey), key);
+    EXPECT_NE(wallet.generateKey(), key);
+    EXPECT_EQ(wallet.getKeys().size(), 2u);
+}
+
+TEST(WalletTest, FollowsTheChainAcrossReorganizations) {
+    Blockchain chain;
+    Wallet wallet(chain);
+    const std::string owner = wallet.generateKey()->publicKeyHash;
+    const std::string genesis = chain.getLatestBlock().getHash();
+
+    Transaction coinbase = makeCoinbase("a1", owner, {10, 20});
+    Block a1 = makeBlock(genesis, {coinbase});
+    ASSERT_TRUE(chain.addBlock(a1));
+    EXPECT_EQ(wallet.getBalance(), 30u);
+    EXPECT_EQ(wallet.coinCount(), 2u);
+
+    // Spends the 10 and pays 4 back
+    Transaction spend({TxIn(coinbase.getTxid(), 0, "", "")}, {TxOut(6, "other"), TxOut(4, owner)});
+    Block a2 = makeBlock(a1.getHash(), {makeCoinbase("a2", "other", {50}), spend});
+    ASSERT_TRUE(chain.addBlock(a2));
+    EXPECT_EQ(wallet.getBalance(), 24u);
+    EXPECT_EQ(wallet.coinCount(), 2u);
+
+    // A key added later finds its outputs in the UTXO set
+    Wallet late(chain);
+    EXPECT_EQ(late.addKey(wallet.getKeys()[0].pkey)->publicKeyHash, owner);
+    EXPECT_EQ(late.getBalance(), 24u);
+
+    // A longer branch paying elsewhere
+    Block b1 = makeBlock(genesis, {makeCoinbase("b1", "other", {50})});
+    Block b2 = makeBlock(b1.getHash(), {makeCoinbase("b2", "other", {50})});
+    ASSERT_TRUE(chain.addBlock(b1));
+    ASSERT_TRUE(chain.addBlock(b2));
+    ASSERT_TRUE(chain.addBlock(makeBlock(b2.getHash(), {makeCoinbase("b3", owner, {7})})));
+    ASSERT_EQ(chain.getBlock(1).getHash(), b1.getHash());
+    EXPECT_EQ(wallet.getBalance(), 7u);
+    EXPECT_EQ(wallet.coinCount(), 1u);
+    EXPECT_EQ(late.getBalance(), 7u);
+}
+
+// ====================================================================
+//  Coin Selection Tests
+// ====================================================================
+
+TEST(WalletTest, BranchAndBoundAvoidsChange) {
+    Blockchain chain;
+    Wallet wallet(chain);
+    const std::string owner = wallet.generateKey()->publicKeyHash;
+    ASSERT_TRUE(chain.addBlock(makeBlock(chain.getLatestBlock().getHash(),
+                                         {makeCoinbase("a", owner, {1, 2, 4, 8, 16, 32})})));
+
+    std::vector<Wallet::Coin> coins;
+    for (uint64_t amount = 1; amount <= 63; ++amount) {
+        ASSERT_TRUE(wallet.selectCoins(amount, coins));
+        EXPECT_EQ(sum(coins), amount);
+    }
+    EXPECT_FALSE(wallet.selectCoins(64, coins));
+    EXPECT_TRUE(coins.empty());
+    EXPECT_FALSE(wallet.selectCoins(0, coins));
+}
+
+TEST(WalletTest, FallbackTakesFewOutputs) {
+    Blockchain chain;
+    Wallet wallet(chain);
+    const std::string owner = wallet.generateKey()->publicKeyHash;
+    std::vector<uint64_t> amounts;
+    for (uint64_t i = 1; i <= 1000; ++i) {
+        amounts.push_back(i * 1000);
+    }
+    ASSERT_TRUE(chain.addBlock(makeBlock(chain.getLatestBlock().getHash(),
+                                         {makeCoinbase("a", owner, amounts)})));
+
+    // No exact sum: the smallest output covering the amount
+    std::vector<Wallet::Coin> coins;
+    ASSERT_TRUE(wallet.selectCoins(2500, coins));
+    ASSERT_EQ(coins.size(), 1u);
+    EXPECT_EQ(coins[0].amount, 3000u);
+
+    // None covers it: the largest ones, then the smallest covering the rest
+    ASSERT_TRUE(wallet.selectCoins(2500500, coins));
+    ASSERT_EQ(coins.size(), 3u);
+    EXPECT_EQ(coins[0].amount, 1000000u);
+    EXPECT_EQ(coins[1].amount, 999000u);
+    EXPECT_EQ(coins[2].amount, 502000u);
+
+    // Within the tolerance no change is needed
+    WalletConfig config;
+    config.changeTolerance = 600;
+    Wallet tolerant(chain, nullptr, config);
+    tolerant.addKey(wallet.getKeys()[0].pkey);
+    ASSERT_TRUE(tolerant.selectCoins(2500, coins));
+    EXPECT_GE(sum(coins), 2500u);
+    EXPECT_LE(sum(coins), 3100u);
+}
+
+// ====================================================================
+//  Transaction Tests
+// ====================================================================
+
+TEST(WalletTest, SignedTransactionsLockTheirInputsUntilConfirmed) {
+    SignatureCache cache;
+    Blockchain chain;
+    chain.enableSignatureChecks(&cache);
+    Mempool mempool;
+    mempool.enableSignatureChecks(chain.getUTXOSet(), &cache);
+    chain.addListener(&mempool);
+    Wallet alice(chain, &mempool);
+    Wallet bob(chain, &mempool);
+    const std::string aliceOwner = alice.generateKey()->publicKeyHash;
+    const std::string bobOwner = bob.generateKey()->publicKeyHash;
+    ASSERT_TRUE(chain.addBlock(makeBlock(chain.getLatestBlock().getHash(),
+                                         {makeCoinbase("a", aliceOwner, {50, 40})})));
+
+    Transaction payment;
+    ASSERT_TRUE(alice.createTransaction(bobOwner, 30, payment));
+    ASSERT_EQ(payment.getInputs().size(), 1u);
+    ASSERT_EQ(payment.getOutputs().size(), 2u);
+    ASSERT_TRUE(mempool.addTransaction(payment));
+    EXPECT_EQ(alice.coinCount(), 1u);
+    Transaction second;
+    ASSERT_TRUE(alice.createTransaction(bobOwner, 45, second));
+    EXPECT_FALSE(alice.createTransaction(bobOwner, 100, second));
+
+    // Leaving the pool unlocks the output
+    const uint64_t locked = alice.getBalance();
+    ASSERT_TRUE(mempool.addTransaction(second));
+    EXPECT_EQ(alice.getBalance(), 0u);
+    ASSERT_TRUE(mempool.removeTransaction(second.getTxid()));
+    EXPECT_EQ(alice.getBalance(), locked);
+
+    ASSERT_TRUE(chain.addBlock(makeBlock(chain.getLatestBlock().getHash(),
+                                         {makeCoinbase("b", "other", {50}), payment})));
+    EXPECT_EQ(mempool.size(), 0u);
+    EXPECT_EQ(alice.getBalance(), 60u);
+    EXPECT_EQ(bob.getBalance(), 30u);
+    EXPECT_GT(cache.hits(), 0u);
+}
@@ -1,120 +1,137 @@
 #include "Core/Blockchain.h"
 #include "Core/Transaction.h"
 #include "Core/Block.h"
+#include "Core/ChainImporter.h"
+#include "Core/SignatureCache.h"
+#include "Core/Trace.h"
+#include "Core/Wallet.h"
+#include <chrono>
+#include <cstring>
 #include <iostream>
-#include <openssl/evp.h>
-#include <openssl/encoder.h>
 
-EVP_PKEY* generateKeyPair() {
-    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
-    if (!ctx) return nullptr;
-
-    if (EVP_PKEY_keygen_init(ctx) <= 0) return nullptr;
-    if (EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx, NID_secp256k1) <= 0)
-        return nullptr;
-
-    EVP_PKEY* pkey = nullptr;
-    if (EVP_PKEY_keygen(ctx, &pkey) <= 0) return nullptr;
-
-    EVP_PKEY_CTX_free(ctx);
-    return pkey;
+// Mines a block of transactions on top of the tip of chain, paying the
+// block reward to publicKeyHash
+static bool mineBlock(Blockchain& chain, const std::string& publicKeyHash,
+                      const std::vector<Transaction>& transactions) {
+    TxIn input(std::string(64, '0'), 0, "coinbase_" + std::to_string(chain.getHeight() + 1), "");
+    std::vector<Transaction> blockTransactions = {Transaction({input}, {TxOut(50, publicKeyHash)})};
+    blockTransactions.insert(blockTransactions.end(), transactions.begin(), transactions.end());
+    Block block(blockTransactions, chain.getLatestBlock().getHash());
+    block.computeMerkleRoot();
+    block.mine();
+    std::cout << "    Block mined: " << block.getHash() << std::endl;
+    return chain.addBlock(block).accepted;
 }
 
-std::string getPublicKey(EVP_PKEY* pkey) {
-    OSSL_ENCODER_CTX* ctx = OSSL_ENCODER_CTX_new_for_pkey(
-        pkey,
-        OSSL_KEYMGMT_SELECT_PUBLIC_KEY,
-        "DER",
-        nullptr,
-        nullptr
-    );
-
-    if (!ctx) return {};
-
-    unsigned char* data = nullptr;
-    size_t len = 0;
-
-    if (!OSSL_ENCODER_to_data(ctx, &data, &len)) {
-        OSSL_ENCODER_CTX_free(ctx);
-        return {};
+// Bootstraps a chain from a file written by Blockchain::exportBlocks(); its
+// first block is the genesis block
+int importChain(const char* path, bool checkSignatures) {
+    Block genesis("");
+    if (!ChainImporter::readFirstBlock(path, genesis)) {
+        std::cerr << "Error: cannot read a block from " << path << std::endl;
+        return 1;
     }
-
-    std::vector<unsigned char> pubKey(data, data + len);
-
-    OPENSSL_free(data);
-    OSSL_ENCODER_CTX_free(ctx);
-
-    return std::string(reinterpret_cast< char const* >(pubKey.data()), pubKey.size());
-}
-
-std::string hashPublicKey(
-    const std::string& pubKey) {
-
-    unsigned char hash[SHA256_DIGEST_LENGTH];
-    SHA256_CTX sha256;
-    SHA256_Init(&sha256);
-    SHA256_Update(&sha256, pubKey.data(), pubKey.size());
-    SHA256_Final(hash, &sha256);
-
-    return std::string(reinterpret_cast< char const* >(hash));
+    Blockchain chain(genesis);
+    SignatureCache cache;
+    if (checkSignatures) {
+        chain.enableSignatureChecks(&cache);
+    }
+    ChainImporter importer(chain, checkSignatures ? &cache : nullptr);
+
+    auto start = std::chrono::steady_clock::now();
+    bool imported = importer.importFile(path);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Imported " << importer.getBlocksConnected() << " blocks ("
+              << importer.getBytesRead() / 1e6 << " MB) in " << seconds << " s, height "
+              << chain.getHeight() << std::endl;
+
+    const Blockchain::MemoryUsage memory = chain.getMemoryUsage();
+    std::cout << "Memory: " << memory.total() / 1e6 << " MB (headers " << memory.headers / 1e6
+              << ", transactions " << memory.transactions / 1e6 << ", undo " << memory.undo / 1e6
+              << ", UTXO set " << memory.utxos / 1e6 << ", snapshots " << memory.snapshots / 1e6
+              << ", signature cache " << cache.memoryUsage() / 1e6 << ")" << std::endl;
+    return imported ? 0 : 1;
 }
 
-int main() {
-
+// Pays between two wallets on a new chain
+int runDemo() {
     std::cout << "Blockchain Implementation Demo" << std::endl;
     std::cout << "==============================" << std::endl << std::endl;
 
-    // Generate keys
-	std::cout << "[1] Generate key pairs and hash the receiver public key..." << std::endl;
-    EVP_PKEY* senderKey = generateKeyPair();
-    EVP_PKEY* receiverKey = generateKeyPair();
-    auto senderPubKey = getPublicKey(senderKey);
-    auto receiverPubKey = getPublicKey(receiverKey);
-    auto receiverHash = hashPublicKey(receiverPubKey);
-
     // Create a blockchain instance
-	std::cout << "[2] Creating blockchain with genesis block and default complexity..." << std::endl;
+    std::cout << "[1] Creating blockchain with genesis block and default complexity..." << std::endl;
     Blockchain blockchain;
+    blockchain.enableSignatureChecks();
+
+    // Generate keys; each wallet caches the DER public key and its hash
+    std::cout << "[2] Generating the sender and receiver wallets..." << std::endl;
+    Wallet sender(blockchain);
+    Wallet receiver(blockchain);
+    const WalletKey* senderKey = sender.generateKey();
+    const WalletKey* receiverKey = receiver.generateKey();
+    if (!senderKey || !receiverKey) {
+        return 1;
+    }
+    std::cout << "    Receiver address: " << receiverKey->publicKeyHash << std::endl << std::endl;
 
-    // Create the first transaction (TxIn and TxOut)
-    std::cout << "[3] Creating transaction..." << std::endl;
-    // Signature left as a random string for simplicity
-    TxIn input("0000000000000000000000000000000000000000000000000000000000000000", 0, "sig1", senderPubKey);
-    // Amount set to a random value for demonstration
-    TxOut output(50, receiverHash);
-
-    Transaction tx({input}, {output});
-    std::cout << "    Transaction 1 TXID: " << tx.txid << std::endl;
-    std::cout << "    Transaction 1 Timestamp: " << tx.timestamp << " ms" << std::endl << std::endl;
-
-    // Create Block with this transaction
-    std::cout << "[4] Creating block..." << std::endl;
-    std::vector<Transaction> transactions = { tx };
-    Block block(transactions, blockchain.getLatestBlock().getHash());
-
-    // Block mining
-    std::cout << "[5] Mining block..." << std::endl;
-    block.mine();
-    std::cout << "[6] Block mined: " << block.getHash() << "\n";
+    // Mine a block paying its reward to the sender
+    std::cout << "[3] Mining a block rewarding the sender..." << std::endl;
+    if (!mineBlock(blockchain, senderKey->publicKeyHash, {})) {
+        return 1;
+    }
+    std::cout << "    Sender balance: " << sender.getBalance() << std::endl << std::endl;
 
-    // Compute Merkle root
-    std::cout << "[7] Compute Merkle root: " << block.getMerkleRoot() << "\n";
-    block.computeMerkleRoot();
+    // Create the first transaction, signed by the sender
+    std::cout << "[4] Creating transaction..." << std::endl;
+    Transaction tx;
+    if (!sender.createTransaction(receiverKey->publicKeyHash, 30, tx)) {
+        return 1;
+    }
+    std::cout << "    Transaction 1 TXID: " << tx.getTxid() << std::endl;
+    std::cout << "    Transaction 1 Timestamp: " << tx.getTimestamp() << " ms" << std::endl << std::endl;
 
-    std::cout << "[8] Add Block to Blockchain: " << block.getMerkleRoot() << "\n";
-    blockchain.addBlock(block);
+    // Mine a block with this transaction and add it to the blockchain
+    std::cout << "[5] Mining a block with the transaction..." << std::endl;
+    bool added = mineBlock(blockchain, senderKey->publicKeyHash, {tx});
+    std::cout << "    Block added: " << (added ? "YES" : "NO") << std::endl;
+    std::cout << "    Sender balance: " << sender.getBalance() << ", receiver balance: "
+              << receiver.getBalance() << std::endl << std::endl;
 
     // Validate blockchain
-    std::cout << "[9] Validating block..." << std::endl;
+    std::cout << "[6] Validating blockchain..." << std::endl;
     bool isValid = blockchain.validateChain();
-    std::cout << "    Block validation result: " << (isValid ? "VALID" : "INVALID") << std::endl << std::endl;
+    std::cout << "    Blockchain validation result: " << (isValid ? "VALID" : "INVALID") << std::endl << std::endl;
 
-    // 10. Print chain
+    // Print chain
     blockchain.print();
 
-    // Cleanup
-    EVP_PKEY_free(senderKey);
-    EVP_PKEY_free(receiverKey);
-
     return 0;
 }
+
+int main(int argc, char* argv[]) {
+
+    // blockchain --trace <file> ...: also writes the spans recorded meanwhile
+    const char* tracePath = nullptr;
+    if (argc >= 3 && std::strcmp(argv[1], "--trace") == 0) {
+#ifndef BLOCKCHAIN_ENABLE_TRACING
+        std::cerr << "Error: tracing is compiled out, configure with -DBLOCKCHAIN_ENABLE_TRACING=ON" << std::endl;
+        return 1;
+#endif
+        tracePath = argv[2];
+        argc -= 2;
+        argv += 2;
+    }
+
+    int status;
+    // blockchain --import <file> [--check-signatures]
+    if (argc >= 3 && std::strcmp(argv[1], "--import") == 0) {
+        status = importChain(argv[2], argc >= 4 && std::strcmp(argv[3], "--check-signatures") == 0);
+    } else {
+        status = runDemo();
+    }
+
+    if (tracePath && !Trace::exportJson(tracePath)) {
+        return 1;
+    }
+    return status;
+}